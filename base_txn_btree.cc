@@ -1,4 +1,6 @@
 #include "base_txn_btree.h"
+#include "dbcore/sm-log-delta.h"
+#include "dbcore/sm-log-ship.h"
 
 rc_t
 base_txn_btree::do_search(transaction &t, const varstr &k, value_reader &vr)
@@ -67,6 +69,9 @@ rc_t base_txn_btree::do_tree_put(
                                  // to not be present, so we assert this doesn't happen
                                  // for now [since this would indicate a suboptimality]
     t.ensure_active();
+    // standbys only replay what the primary wrote, and the past is read-only
+    if (sm_log_is_standby() or (t.flags & transaction::TXN_FLAG_AS_OF))
+        return rc_t{RC_ABORT_USER};
     if (expect_new) {
         if (t.try_insert_new_tuple(&this->underlying_btree, k, v, this->fid))
             return rc_t{RC_TRUE};
@@ -93,6 +98,19 @@ rc_t base_txn_btree::do_tree_put(
         dbtuple *prev = ((object *)prev_obj_ptr.offset())->tuple();
         ASSERT((uint64_t)prev->get_object() == prev_obj_ptr.offset());
         ASSERT(t.xc);
+
+        // read prev's clsn first, in case it's a committing XID, the clsn's state
+        // might change to ASI_LOG anytime
+        fat_ptr prev_clsn = volatile_read(prev->get_object()->_clsn);
+        const bool own_prev =
+          prev_clsn.asi_type() == fat_ptr::ASI_XID and XID::from_ptr(prev_clsn) == t.xid;
+        // an overwrite of my own update replaced it in its chain, see
+        // oid_put_update(); keep it if a savepoint may need it back
+        bool prev_saved = false;
+        if (own_prev) {
+            prev_saved = t.save_overwritten(prev_obj_ptr, this->underlying_btree.get_oid_array(), oid);
+            prev->mark_defunct();
+        }
 #ifdef SSI
         ASSERT(prev->sstamp == NULL_PTR);
         if (t.xc->ct3) {
@@ -167,21 +185,21 @@ rc_t base_txn_btree::do_tree_put(
         volatile_write(tuple->xstamp, prev->xstamp);
 #endif
 
-        // read prev's clsn first, in case it's a committing XID, the clsn's state
-        // might change to ASI_LOG anytime
         ASSERT((uint64_t)prev->get_object() == prev_obj_ptr.offset());
-        fat_ptr prev_clsn = volatile_read(prev->get_object()->_clsn);
-        if (prev_clsn.asi_type() == fat_ptr::ASI_XID and XID::from_ptr(prev_clsn) == t.xid) {
+        dbtuple *committed_prev = NULL;  // candidate base for a delta log record
+        if (own_prev) {
             // updating my own updates!
             // prev's prev: previous *committed* version
-            ASSERT(prev->is_defunct()); // oid_put_update did this
+            ASSERT(prev->is_defunct());
             ASSERT(((object *)prev_obj_ptr.offset())->_alloc_epoch == t.xc->begin_epoch);
-            MM::deallocate(prev_obj_ptr);
+            if (not prev_saved)
+                MM::deallocate(prev_obj_ptr);
         }
         else {  // prev is committed (or precommitted but in post-commit now) head
 #if defined(SSI) || defined(SSN)
             volatile_write(prev->sstamp, t.xc->owner.to_ptr());
 #endif
+            committed_prev = prev;
         }
 
         ASSERT(not tuple->pvalue or tuple->pvalue->size() == tuple->size);
@@ -189,6 +207,8 @@ rc_t base_txn_btree::do_tree_put(
         ASSERT(tuple->get_object()->_clsn.asi_type() == fat_ptr::ASI_XID);
         ASSERT(oidmgr->oid_get_version(fid, oid, t.xc) == tuple);
         ASSERT(t.log);
+        if (sysconf::bulk_loading())
+            return rc_t{RC_TRUE};
         if (not v)
             t.log->log_delete(this->fid, oid);
         else {
@@ -198,8 +218,34 @@ rc_t base_txn_btree::do_tree_put(
             const size_t sz = v->size();
             ASSERT(sz == v->size());
             auto record_size = align_up(sz) + sizeof(varstr);
-            auto size_code = encode_size_aligned(record_size);
             ASSERT(not ((uint64_t)v & ((uint64_t)0xf)));
+
+            // Log only the changed bytes if the version we overwrote is a
+            // same-sized image that recovery can find in the log. Own
+            // overwrites fall through: their base has no log location yet.
+            if (sysconf::log_update_delta and committed_prev and
+                committed_prev->size == sz and
+                committed_prev->delta_depth < log_delta::MAX_DEPTH) {
+                fat_ptr base = volatile_read(committed_prev->get_object()->_pdest);
+                if (base.asi_type() == fat_ptr::ASI_LOG) {
+                    // Not worth it unless it saves at least one alignment unit
+                    varstr *buf = t.string_allocator().next(record_size);
+                    size_t delta_size = log_delta::encode(
+                      (char *)buf, record_size - DEFAULT_ALIGNMENT, base,
+                      committed_prev->delta_depth + 1,
+                      committed_prev->get_value_start(), v->data(), sz);
+                    if (delta_size) {
+                        tuple->delta_depth = committed_prev->delta_depth + 1;
+                        auto delta_record_size = align_up(delta_size);
+                        auto size_code = encode_size_aligned(delta_record_size);
+                        t.log->log_update_delta(this->fid, oid, fat_ptr::make((void *)buf, size_code),
+                                                DEFAULT_ALIGNMENT_BITS, &tuple->get_object()->_pdest);
+                        return rc_t{RC_TRUE};
+                    }
+                }
+            }
+
+            auto size_code = encode_size_aligned(record_size);
             // log the whole varstr so that recovery can figure out the real size
             // of the tuple, instead of using the decoded (larger-than-real) size.
             t.log->log_update(this->fid, oid, fat_ptr::make((void *)v, size_code),
@@ -222,7 +268,9 @@ base_txn_btree
                << ", version=" << version << ">" << std::endl);
     VERBOSE(std::cerr << "  " << concurrent_btree::NodeStringify(n) << std::endl);
 #ifdef PHANTOM_PROT
-#ifdef SSN
+    // a read-only scan sees a consistent snapshot under plain SI, so there
+    // is nothing to validate (and long analytic scans would never commit)
+#if defined(SSN) || !defined(SSI)
     if (t->flags & transaction::TXN_FLAG_READ_ONLY)
         return;
 #endif
@@ -237,7 +285,7 @@ base_txn_btree
   ::txn_search_range_callback
   ::invoke(
     const concurrent_btree *btr_ptr,
-    const typename concurrent_btree::string_type &k, dbtuple *v,
+    const typename concurrent_btree::string_type &k, OID o, dbtuple *v,
     const typename concurrent_btree::node_opaque_t *n, uint64_t version)
 {
     t->ensure_active();
@@ -15,6 +15,8 @@ using namespace TXN;
 
 class base_txn_btree {
     friend class sm_log_recover_impl;
+    friend class sm_oid_mgr;
+    friend class backup_scanner;
 public:
 
   typedef dbtuple::size_type size_type;
@@ -113,7 +115,7 @@ protected:
 
     virtual void on_resp_node(const typename concurrent_btree::node_opaque_t *n, uint64_t version);
     virtual bool invoke(const concurrent_btree *btr_ptr,
-                        const typename concurrent_btree::string_type &k, dbtuple* v,
+                        const typename concurrent_btree::string_type &k, OID o, dbtuple* v,
                         const typename concurrent_btree::node_opaque_t *n, uint64_t version);
 
   private:
@@ -104,6 +104,26 @@ public:
    */
   virtual void abort_txn(void *txn) = 0;
 
+  /**
+   * Savepoints: set_savepoint() returns a handle to how far txn got, and
+   * rollback_txn_to() undoes what txn wrote since, leaving txn active
+   * (e.g., to retry a failed step without starting over). Returns false
+   * if it can't, and txn then has to be aborted. By default there are
+   * no savepoints to roll back to.
+   */
+  virtual size_t set_savepoint(void *txn) { return 0; }
+  virtual bool rollback_txn_to(void *txn, size_t savepoint) { return false; }
+
+  /**
+   * Time travel: current_lsn() is what a transaction beginning now would
+   * read as of, and new_txn_as_of() begins a read-only transaction as of
+   * such an earlier LSN, to commit or abort as usual. It returns NULL,
+   * leaving nothing to abort, if that snapshot is no longer (or not yet)
+   * available. By default there is no history to read.
+   */
+  virtual uint64_t current_lsn() { return 0; }
+  virtual void *new_txn_as_of(uint64_t lsn, str_arena &arena, void *buf) { return NULL; }
+
   virtual void print_txn_debug(void *txn) const {}
 
   virtual abstract_ordered_index *
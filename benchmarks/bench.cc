@@ -4,6 +4,8 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include <stdlib.h>
 #include <sched.h>
@@ -14,11 +16,16 @@
 #include "ndb_wrapper.h"
 
 #include "../dbcore/rcu.h"
+#include "../dbcore/sm-backup.h"
 #include "../dbcore/sm-chkpt.h"
 #include "../dbcore/sm-config.h"
 #include "../dbcore/sm-file.h"
 #include "../dbcore/sm-log.h"
+#include "../dbcore/sm-log-cdc.h"
 #include "../dbcore/sm-log-recover-impl.h"
+#include "../dbcore/sm-log-ship.h"
+#include "../dbcore/sm-oid.h"
+#include "../dbcore/sm-oid-alloc-impl.h"
 
 using namespace std;
 using namespace util;
@@ -36,9 +43,233 @@ int slow_exit = 0;
 int retry_aborted_transaction = 0;
 int backoff_aborted_transaction = 0;
 int enable_chkpt = 0;
+int enable_cdc_consumer = 0;
+std::string results_json;
+std::string results_jsonl;
+std::string results_bench;
+std::string results_bench_opts;
 
 std::vector<bench_worker*> bench_runner::workers;
 
+namespace {
+  // Tail the log as fast as a change data capture client could, see
+  // --cdc-consumer. Stops once it has seen everything up to [stop].
+  struct cdc_consumer {
+    cdc_consumer()
+      : stream(logmgr->durable_flushed_lsn())
+      , start(stream.position())
+      , stop(INVALID_LSN)
+      , nbatches(0), ntxns(0), nrecords(0), nbytes(0)
+      , thd(&cdc_consumer::run, this)
+    {
+    }
+
+    void run() {
+      RCU::rcu_register();
+      sm_log_cdc::batch b;
+      timer t;
+      for (;;) {
+        LSN s = volatile_read(stop);
+        if (s != INVALID_LSN and s.offset() <= stream.position().offset())
+          break;
+        if (not stream.next(b, 1000))
+          continue;
+        nbatches++;
+        ntxns += b.ntxns;
+        nrecords += b.records.size();
+        for (auto &r : b.records)
+          nbytes += r.key_size + r.value_size;
+      }
+      elapsed_us = t.lap();
+      RCU::rcu_deregister();
+    }
+
+    void finish() {
+      volatile_write(stop._val, logmgr->durable_flushed_lsn()._val);
+      thd.join();
+    }
+
+    void print_stats(FILE *out) {
+      uint64_t log_bytes = stream.position().offset() - start.offset();
+      fprintf(out, "cdc: %lu batches, %lu txns, %lu records, %lu bytes of keys and values\n",
+              nbatches, ntxns, nrecords, nbytes);
+      fprintf(out, "cdc: consumed %lu bytes of log at %.1f MB/s\n",
+              log_bytes, elapsed_us ? log_bytes / double(elapsed_us) : 0.0);
+    }
+
+    sm_log_cdc stream;
+    LSN start;
+    LSN stop;
+    uint64_t nbatches;
+    uint64_t ntxns;
+    uint64_t nrecords;
+    uint64_t nbytes;
+    uint64_t elapsed_us;
+    std::thread thd;
+  };
+
+  // Per-table load rates, judged by how far each table's OID high-water mark
+  // has moved whenever a loader finishes (loaders span several tables and
+  // several loaders may share one, so per-loader timings won't do).
+  struct load_progress {
+    struct table_progress {
+      OID start, end;
+      uint64_t first_us, last_us;
+    };
+
+    load_progress() : last_sample_us(timer::cur_usec()) {
+      for (auto &f : sm_file_mgr::name_map) {
+        OID hw = hiwater(f.second->fid);
+        tables[f.first] = table_progress{hw, hw, 0, 0};
+      }
+    }
+
+    void sample() {
+      uint64_t now = timer::cur_usec();
+      for (auto &f : sm_file_mgr::name_map) {
+        auto &t = tables[f.first];
+        OID hw = hiwater(f.second->fid);
+        if (hw == t.end)
+          continue;
+        if (t.end == t.start)
+          t.first_us = last_sample_us;
+        t.end = hw;
+        t.last_us = now;
+      }
+      last_sample_us = now;
+    }
+
+    void print_stats() {
+      for (auto &t : tables) {
+        uint64_t n = t.second.end - t.second.start;
+        if (not n)
+          continue;
+        uint64_t us = t.second.last_us - t.second.first_us;
+        cerr << "table " << t.first << " loaded " << n << " records in "
+             << us / 1000 << " ms (" << (us ? n * 1000000 / us : n) << " records/s)" << endl;
+      }
+    }
+
+    static OID hiwater(FID f) {
+      return volatile_read(oidmgr->get_allocator(f)->head.hiwater_mark);
+    }
+
+    map<string, table_progress> tables;
+    uint64_t last_sample_us;
+  };
+
+  // What one second of the run looked like, see --results-json. Counters
+  // are differences against the previous second; memory figures are
+  // whatever they were at the end of it.
+  struct run_sample {
+    uint64_t sec;
+    uint64_t commits, aborts;
+    uint64_t user_aborts, si_aborts, serial_aborts;
+    uint64_t rw_aborts, int_aborts, phantom_aborts;
+    uint64_t log_bytes;
+    uint64_t gc_reclaimed_bytes;
+    uint64_t allocated_bytes;
+    uint64_t rss_bytes;
+
+    // Running totals since startup
+    static run_sample take(uint64_t sec) {
+      run_sample s;
+      memset(&s, 0, sizeof(s));
+      s.sec = sec;
+      for (auto *w : bench_runner::workers) {
+        s.commits += w->get_ntxn_commits();
+        s.aborts += w->get_ntxn_aborts();
+        s.user_aborts += w->get_ntxn_user_aborts();
+        s.si_aborts += w->get_ntxn_si_aborts();
+        s.serial_aborts += w->get_ntxn_serial_aborts();
+        s.rw_aborts += w->get_ntxn_rw_aborts();
+        s.int_aborts += w->get_ntxn_int_aborts();
+        s.phantom_aborts += w->get_ntxn_phantom_aborts();
+      }
+      s.log_bytes = logmgr->cur_lsn().offset();
+      s.gc_reclaimed_bytes = volatile_read(MM::gc_reclaimed_nbytes);
+      s.allocated_bytes = MM::allocated_memory();
+      s.rss_bytes = rss();
+      return s;
+    }
+
+    run_sample since(const run_sample &last) const {
+      run_sample s = *this;
+      s.commits -= last.commits;
+      s.aborts -= last.aborts;
+      s.user_aborts -= last.user_aborts;
+      s.si_aborts -= last.si_aborts;
+      s.serial_aborts -= last.serial_aborts;
+      s.rw_aborts -= last.rw_aborts;
+      s.int_aborts -= last.int_aborts;
+      s.phantom_aborts -= last.phantom_aborts;
+      s.log_bytes -= last.log_bytes;
+      s.gc_reclaimed_bytes -= last.gc_reclaimed_bytes;
+      return s;
+    }
+
+    string json() const {
+      ostringstream o;
+      o << "{\"sec\":" << sec
+        << ",\"commits\":" << commits
+        << ",\"aborts\":" << aborts
+        << ",\"user_aborts\":" << user_aborts
+        << ",\"si_aborts\":" << si_aborts
+        << ",\"serial_aborts\":" << serial_aborts
+        << ",\"rw_aborts\":" << rw_aborts
+        << ",\"internal_aborts\":" << int_aborts
+        << ",\"phantom_aborts\":" << phantom_aborts
+        << ",\"log_bytes\":" << log_bytes
+        << ",\"gc_reclaimed_bytes\":" << gc_reclaimed_bytes
+        << ",\"allocated_bytes\":" << allocated_bytes
+        << ",\"rss_bytes\":" << rss_bytes << "}";
+      return o.str();
+    }
+
+    static uint64_t rss() {
+      uint64_t size = 0, resident = 0;
+      FILE *f = fopen("/proc/self/statm", "r");
+      if (f) {
+        if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+          resident = 0;
+        fclose(f);
+      }
+      return resident * getpagesize();
+    }
+  };
+
+  string json_str(const string &s) {
+    string r = "\"";
+    for (char c : s) {
+      switch (c) {
+      case '"': r += "\\\""; break;
+      case '\\': r += "\\\\"; break;
+      case '\n': r += "\\n"; break;
+      case '\t': r += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          r += buf;
+        } else {
+          r += c;
+        }
+      }
+    }
+    return r + "\"";
+  }
+
+  // Replace [path] in one go so nobody polling for it sees half a file
+  void write_atomically(const string &path, const string &contents) {
+    string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    ALWAYS_ASSERT(f);
+    ALWAYS_ASSERT(fwrite(contents.data(), 1, contents.size(), f) == contents.size());
+    ALWAYS_ASSERT(fclose(f) == 0);
+    ALWAYS_ASSERT(rename(tmp.c_str(), path.c_str()) == 0);
+  }
+}
+
 template <typename T>
 static void
 delete_pointers(const vector<T *> &pts)
@@ -71,24 +302,42 @@ void
 bench_worker::my_work(char *)
 {
     on_run_setup();
+	char thread_name[32];
+	snprintf(thread_name, sizeof(thread_name), "worker %u", worker_id);
+	trace::name_thread(thread_name);
 	const workload_desc_vec workload = get_workload();
 	txn_counts.resize(workload.size());
+	txn_abort_counts.resize(workload.size());
+	txn_latency_us.resize(workload.size());
+	txn_phases.resize(workload.size());
 	barrier_a->count_down();
 	barrier_b->wait_for();
     uint64_t t_start = timer::cur_usec();
-	while (running && (run_mode != RUNMODE_OPS || ntxn_commits < ops_per_worker)) {
+	while (running && not finished()) {
 		double d = r.next_uniform();
 		for (size_t i = 0; i < workload.size(); i++) {
 			if ((i + 1) == workload.size() || d < workload[i].frequency) {
 retry:
 				timer t;
 				const unsigned long old_seed = r.get_seed();
+				const phase::counters phases_before = phase::snapshot();
+				const uint64_t cycles_before = phase::enabled ? rdtsc() : 0;
 				const auto ret = workload[i].fn(this);
+				// nothing ran, e.g., an idle server worker
+				if (unlikely(ret._val == RC_INVALID))
+					break;
+				if (phase::enabled) {
+					txn_phases[i].first += rdtsc() - cycles_before;
+					txn_phases[i].second += phase::snapshot() - phases_before;
+				}
 
         if (likely(not rc_is_abort(ret))) {
 					++ntxn_commits;
                     std::get<0>(txn_counts[i])++;
-					latency_numer_us += t.lap();
+					const uint64_t latency_us = t.lap();
+					latency_numer_us += latency_us;
+					txn_latency_us[i] += latency_us;
+					latency_hist.record(latency_us);
 					backoff_shifts >>= 1;
 				} else {
 					++ntxn_aborts;
@@ -99,11 +348,11 @@ retry:
                         std::get<2>(txn_counts[i])++;
                     }
                     switch (ret._val) {
-                        case RC_ABORT_SERIAL: inc_ntxn_serial_aborts(); break;
-                        case RC_ABORT_SI_CONFLICT: inc_ntxn_si_aborts(); break;
-                        case RC_ABORT_RW_CONFLICT: inc_ntxn_rw_aborts(); break;
-                        case RC_ABORT_INTERNAL: inc_ntxn_int_aborts(); break;
-                        case RC_ABORT_PHANTOM: inc_ntxn_phantom_aborts(); break;
+                        case RC_ABORT_SERIAL: inc_ntxn_serial_aborts(); std::get<1>(txn_abort_counts[i])++; break;
+                        case RC_ABORT_SI_CONFLICT: inc_ntxn_si_aborts(); std::get<0>(txn_abort_counts[i])++; break;
+                        case RC_ABORT_RW_CONFLICT: inc_ntxn_rw_aborts(); std::get<2>(txn_abort_counts[i])++; break;
+                        case RC_ABORT_INTERNAL: inc_ntxn_int_aborts(); std::get<3>(txn_abort_counts[i])++; break;
+                        case RC_ABORT_PHANTOM: inc_ntxn_phantom_aborts(); std::get<4>(txn_abort_counts[i])++; break;
                         case RC_ABORT_USER: inc_ntxn_user_aborts(); break;
                         default: ALWAYS_ASSERT(false);
                     }
@@ -133,6 +382,60 @@ retry:
 	}
 }
 
+// Loads one data file of a backup (see dbcore/sm-backup.h), in place of
+// the benchmark's own loaders
+class backup_loader : public bench_loader {
+public:
+  backup_loader(abstract_db *db,
+                const map<string, abstract_ordered_index *> &open_tables,
+                const backup::manifest &manifest,
+                const string &file)
+    : bench_loader(0, db, open_tables), manifest(manifest), file(file)
+  {
+  }
+
+protected:
+  virtual void
+  load()
+  {
+    // the backup's FIDs aren't ours: go through the table names
+    unordered_map<FID, abstract_ordered_index *> indexes;
+    for (auto &t : manifest.tables) {
+      auto it = sm_file_mgr::name_map.find(t.second);
+      ALWAYS_ASSERT(it != sm_file_mgr::name_map.end());
+      indexes[t.first] = it->second->index;
+    }
+
+    backup::reader reader(file);
+    const ssize_t bsize = db->txn_max_batch_size();
+    void *txn = db->new_txn(txn_flags, arena, txn_buf());
+    const char *k, *v;
+    uint32_t k_size, v_size;
+    uint64_t n = 0;
+    while (FID f = reader.next(k, k_size, v, v_size)) {
+      ALWAYS_ASSERT(indexes.count(f));
+      varstr &key = str(k_size);
+      key.copy_from(k, k_size);
+      varstr &value = str(v_size);
+      value.copy_from(v, v_size);
+      try_verify_strict(indexes[f]->insert(txn, key, value));
+      ++n;
+      if (bsize != -1 and not (n % bsize)) {
+        try_verify_strict(db->commit_txn(txn));
+        txn = db->new_txn(txn_flags, arena, txn_buf());
+        arena.reset();
+      }
+    }
+    try_verify_strict(db->commit_txn(txn));
+    if (verbose)
+      cerr << "[INFO] restored " << n << " records from " << file << endl;
+  }
+
+private:
+  const backup::manifest &manifest;
+  const string file;
+};
+
 void
 bench_runner::create_files_task(char *)
 {
@@ -144,7 +447,8 @@ bench_runner::create_files_task(char *)
   ASSERT(oidmgr);
   RCU::rcu_exit();
 
-  if (not sm_log::need_recovery) {
+  // a standby gets its FIDs from the primary's log
+  if (not sm_log::need_recovery and not log_standby) {
     // allocate an FID for each table
     for (auto &nm : sm_file_mgr::name_map) {
       ALWAYS_ASSERT(nm.second->index);
@@ -177,23 +481,59 @@ bench_runner::run()
   runner_thread->start_task(runner_task);
   runner_thread->join();
 
+  // a standby's log must match the primary's, so connect first
+  if (sysconf::standby_of.size())
+    log_standby = new sm_log_standby(sysconf::standby_of);
+
+  // a snapshot is just a log to recover, so put it in place first
+  if (sysconf::from_snapshot.size()) {
+    scoped_timer t("snapshot restore", verbose);
+    sm_log::restore_snapshot(sysconf::from_snapshot);
+  }
+
   // start another task to create the logmgr and FIDs backing each table
   runner_task = std::bind(&bench_runner::create_files_task, this, std::placeholders::_1);
   runner_thread->start_task(runner_task);
   runner_thread->join();
   thread::put_thread(runner_thread);
 
+  if (log_standby) {
+    scoped_timer t("standby catch-up", verbose);
+    log_standby->start();
+  }
+  else if (sysconf::log_ship_listen.size()) {
+    // ship the load too, so a standby can start along with us
+    logmgr->flush();
+    log_shipper = new sm_log_shipper(sysconf::log_ship_listen);
+  }
+
   // load data
-  if (not sm_log::need_recovery) {
-    vector<bench_loader *> loaders = make_loaders();
+  if (not sm_log::need_recovery and not log_standby) {
+    backup::manifest *manifest = nullptr;
+    vector<bench_loader *> loaders;
+    if (sysconf::restore_backup.size()) {
+      manifest = new backup::manifest(sysconf::restore_backup);
+      for (auto &file : manifest->files)
+        loaders.push_back(new backup_loader(db, open_tables, *manifest, file));
+    } else {
+      loaders = make_loaders();
+    }
+    load_progress progress;
     {
       scoped_timer t("dataloading", verbose);
-      uint32_t done = 0;
+      uint32_t done = 0, nrunning = 0;
     process:
       for (uint i = 0; i < loaders.size(); i++) {
         auto* loader = loaders[i];
-        if (loader and not loader->is_impersonated() and loader->try_impersonate()) {
+        if (not loader or loader->is_impersonated())
+          continue;
+        // a loader with a node of its own waits for a thread there, unless
+        // no other loader runs that could give one back
+        const int node = loader->numa_node();
+        if (node < 0 ? loader->try_impersonate() :
+            loader->try_impersonate(node) or (not nrunning and loader->try_impersonate())) {
           loader->start();
+          nrunning++;
         }
       }
 
@@ -205,11 +545,26 @@ bench_runner::run()
             delete loader;
             loaders[i] = nullptr;
             done++;
+            nrunning--;
+            progress.sample();
             goto process;
           }
         }
       }
     }
+    delete manifest;
+    on_load_end();
+    if (verbose)
+      progress.print_stats();
+    // a bulk load only becomes durable with its checkpoint
+    if (sysconf::bulk_load) {
+      scoped_timer t("load checkpoint", verbose);
+      auto* chkpt_thread = thread::get_thread();
+      thread::sm_thread::task_t chkpt_task = [](char *) { chkptmgr->take_image(); };
+      chkpt_thread->start_task(chkpt_task);
+      chkpt_thread->join();
+      thread::put_thread(chkpt_thread);
+    }
     RCU::rcu_register();
     RCU::rcu_enter();
     volatile_write(MM::safesnap_lsn, logmgr->cur_lsn().offset());
@@ -230,6 +585,12 @@ bench_runner::run()
 
   // Persist the database
   logmgr->flush();
+  if (sysconf::save_snapshot.size()) {
+    scoped_timer t("snapshot save", verbose);
+    logmgr->save_snapshot(sysconf::save_snapshot);
+  }
+
+  cdc_consumer *cdc = enable_cdc_consumer ? new cdc_consumer : nullptr;
 
   workers = make_workers();
   ALWAYS_ASSERT(!workers.empty());
@@ -237,6 +598,12 @@ bench_runner::run()
        it != workers.end(); ++it)
     (*it)->start();
 
+  // throughput next to the storage manager's own metrics
+  metrics::add("ermia_commits_total", "Transactions committed by benchmark workers", "counter",
+               [this] { uint64_t n = 0; for (auto *w : workers) n += w->get_ntxn_commits(); return n; });
+  metrics::add("ermia_aborts_total", "Transactions aborted by benchmark workers", "counter",
+               [this] { uint64_t n = 0; for (auto *w : workers) n += w->get_ntxn_aborts(); return n; });
+
   barrier_a.wait_for(); // wait for all threads to start up
   if (verbose) {
     for (map<string, abstract_ordered_index *>::iterator it = open_tables.begin();
@@ -250,39 +617,77 @@ bench_runner::run()
   timer t, t_nosync;
   barrier_b.count_down(); // bombs away!
 
-  // Print some results every second
-  if (run_mode == RUNMODE_TIME) {
-    if (verbose) {
-      uint64_t slept = 0;
-      uint64_t last_commits = 0, last_aborts = 0;
+  // an online backup, taken while the workers run
+  std::thread backup_thread;
+  if (sysconf::backup_dir.size()) {
+    backup_thread = std::thread([] {
+      backup::stats s = backup::take(sysconf::backup_dir, sysconf::backup_threads,
+                                     sysconf::backup_mb_per_sec);
+      printf("[Backup] LSN %lx, %lu records, %.2f MB in %.2f s (%.2f MB/s)\n",
+             s.snapshot, s.nrecords, double(s.nbytes) / sysconf::MB, s.seconds,
+             double(s.nbytes) / sysconf::MB / s.seconds);
+    });
+  }
+
+  // Print some results every second, and keep them for --results-json
+  vector<run_sample> series;
+  FILE *jsonl = nullptr;
+  if (results_jsonl.size()) {
+    jsonl = fopen(results_jsonl.c_str(), "w");
+    ALWAYS_ASSERT(jsonl);
+  }
+  // In ops mode there's only something to print if results are wanted;
+  // sampling then goes on until the workers are done or max_runtime
+  // stops them
+  auto ops_done = [this]() {
+    if (not volatile_read(running))
+      return true;
+    for (auto *w : workers)
+      if (not w->finished())
+        return false;
+    return true;
+  };
+  if (results_json.size() or jsonl or (verbose and run_mode == RUNMODE_TIME)) {
+    uint64_t slept = 0;
+    run_sample last = run_sample::take(0);
+    if (verbose)
       printf("[Throughput] Sec,Commits,Aborts\n");
-      while (slept < runtime) {
-        sleep(1);
-        uint64_t sec_commits = 0, sec_aborts = 0;
-        for (size_t i = 0; i < sysconf::worker_threads; i++) {
-          sec_commits += workers[i]->get_ntxn_commits();
-          sec_aborts += workers[i]->get_ntxn_aborts();
-        }
-        sec_commits -= last_commits;
-        sec_aborts -= last_aborts;
-        last_commits += sec_commits;
-        last_aborts += sec_aborts;
-        printf("[Throughput] %lu,%lu,%lu\n", slept+1, sec_commits, sec_aborts);
-        slept++;
-      };
-    }
-    else {
-      sleep(runtime);
-    }
-    running = false;
+    while (run_mode == RUNMODE_TIME ? slept < runtime : not ops_done()) {
+      sleep(1);
+      run_sample now = run_sample::take(slept+1);
+      run_sample sec = now.since(last);
+      last = now;
+      if (verbose)
+        printf("[Throughput] %lu,%lu,%lu\n", slept+1, sec.commits, sec.aborts);
+      if (jsonl) {
+        fprintf(jsonl, "{\"type\":\"sample\",%s\n", sec.json().c_str() + 1);
+        fflush(jsonl);
+      }
+      series.push_back(sec);
+      slept++;
+    };
+  }
+  else if (run_mode == RUNMODE_TIME) {
+    sleep(runtime);
   }
+  if (run_mode == RUNMODE_TIME)
+    running = false;
+  if (backup_thread.joinable())
+    backup_thread.join();
 
   // Persist whatever still left in the log buffer
   logmgr->flush();
+  if (log_shipper and not log_shipper->drain(10000))
+    cerr << "standby did not receive all of the log in time" << endl;
+  if (cdc)
+    cdc->finish();
 
   __sync_synchronize();
   for (size_t i = 0; i < sysconf::worker_threads; i++)
     workers[i]->join();
+  on_run_end();
+  metrics::remove("ermia_commits_total");
+  metrics::remove("ermia_aborts_total");
   const unsigned long elapsed_nosync = t_nosync.lap();
   size_t n_commits = 0;
   size_t n_aborts = 0;
@@ -333,6 +738,10 @@ bench_runner::run()
   const double avg_latency_ms = avg_latency_us / 1000.0;
 
   tx_stat_map agg_txn_counts = workers[0]->get_txn_counts();
+  tx_abort_stat_map agg_txn_abort_counts = workers[0]->get_txn_abort_counts();
+  map<string, uint64_t> agg_txn_latencies = workers[0]->get_txn_latencies();
+  pow2_histogram agg_latency = workers[0]->get_latency_histogram();
+  tx_phase_stat_map agg_txn_phases = workers[0]->get_txn_phases();
   for (size_t i = 1; i < workers.size(); i++) {
     auto &c = workers[i]->get_txn_counts();
     for (auto &t : c) {
@@ -341,6 +750,20 @@ bench_runner::run()
       std::get<2>(agg_txn_counts[t.first]) += std::get<2>(t.second);
       std::get<3>(agg_txn_counts[t.first]) += std::get<3>(t.second);
     }
+    auto &a = workers[i]->get_txn_abort_counts();
+    for (auto &t : a) {
+      std::get<0>(agg_txn_abort_counts[t.first]) += std::get<0>(t.second);
+      std::get<1>(agg_txn_abort_counts[t.first]) += std::get<1>(t.second);
+      std::get<2>(agg_txn_abort_counts[t.first]) += std::get<2>(t.second);
+      std::get<3>(agg_txn_abort_counts[t.first]) += std::get<3>(t.second);
+      std::get<4>(agg_txn_abort_counts[t.first]) += std::get<4>(t.second);
+    }
+    map_agg(agg_txn_latencies, workers[i]->get_txn_latencies());
+    agg_latency.merge(workers[i]->get_latency_histogram());
+    for (auto &t : workers[i]->get_txn_phases()) {
+      agg_txn_phases[t.first].first += t.second.first;
+      agg_txn_phases[t.first].second += t.second.second;
+    }
     workers[i]->~bench_worker();
   }
 
@@ -369,6 +792,14 @@ bench_runner::run()
     cerr << "agg_abort_rate: " << agg_abort_rate << " aborts/sec" << endl;
     cerr << "avg_per_core_abort_rate: " << avg_per_core_abort_rate << " aborts/sec/core" << endl;
     cerr << "txn breakdown: " << format_list(agg_txn_counts.begin(), agg_txn_counts.end()) << endl;
+    cerr << "--- log write latency ---" << endl;
+    logmgr->print_write_latency(stderr);
+    if (log_shipper)
+      log_shipper->print_stats(stderr);
+    if (log_standby)
+      log_standby->print_stats(stderr);
+    if (cdc)
+      cdc->print_stats(stderr);
 
 #if 0
 	RCU::rcu_gc_info gc_info = RCU::rcu_get_gc_info();
@@ -381,6 +812,7 @@ bench_runner::run()
     cerr << "---------------------------------------" << endl;
 #endif
   }
+  delete cdc;
 
   /*
   ALWAYS_ASSERT(n_aborts == n_user_aborts +
@@ -422,10 +854,127 @@ bench_runner::run()
          << std::get<0>(c.second) / (double)elapsed_sec << " commits/s\t"
          << std::get<1>(c.second) / (double)elapsed_sec << " aborts/s\t"
          << std::get<2>(c.second) / (double)elapsed_sec << " system aborts/s\t"
-         << std::get<3>(c.second) / (double)elapsed_sec << " user aborts/s\n";
+         << std::get<3>(c.second) / (double)elapsed_sec << " user aborts/s\t"
+         << (std::get<0>(c.second) ?
+             agg_txn_latencies[c.first] / 1000.0 / std::get<0>(c.second) : 0)
+         << " ms avg latency\n";
+  }
+  if (verbose) {
+    // which concurrency control check each transaction type loses to
+    cerr << "--- system aborts by reason ---" << endl;
+    for (auto &c : agg_txn_abort_counts) {
+      cerr << c.first << "\t"
+           << std::get<0>(c.second) / (double)elapsed_sec << " si_aborts/s\t"
+           << std::get<1>(c.second) / (double)elapsed_sec << " serial_aborts/s\t"
+           << std::get<2>(c.second) / (double)elapsed_sec << " rw_aborts/s\t"
+           << std::get<3>(c.second) / (double)elapsed_sec << " internal aborts/s\t"
+           << std::get<4>(c.second) / (double)elapsed_sec << " phantom aborts/s\n";
+    }
+  }
+  if (phase::enabled) {
+    // own cycles of each phase per attempt (aborted ones included) and
+    // their share of the transaction; "other" is benchmark code
+    cerr << "--- phase breakdown (cycles per attempt, % of transaction) ---" << endl;
+    cerr << "txn\tattempts\ttotal";
+    for (int p = 0; p < phase::NPHASES; p++)
+      cerr << "\t" << phase::names[p];
+    cerr << "\tother" << endl;
+    for (auto &t : agg_txn_phases) {
+      auto &c = agg_txn_counts[t.first];
+      uint64_t attempts = std::get<0>(c) + std::get<1>(c);
+      uint64_t total = t.second.first, in_phases = 0;
+      if (not attempts or not total)
+        continue;
+      cerr << t.first << "\t" << attempts << "\t" << total / attempts;
+      for (int p = 0; p < phase::NPHASES; p++) {
+        uint64_t cycles = t.second.second.cycles[p];
+        in_phases += cycles;
+        fprintf(stderr, "\t%lu (%.1f%%)", cycles / attempts, 100.0 * cycles / total);
+      }
+      uint64_t other = total > in_phases ? total - in_phases : 0;
+      fprintf(stderr, "\t%lu (%.1f%%)\n", other / attempts, 100.0 * other / total);
+    }
   }
   cout.flush();
 
+  if (results_json.size() or jsonl) {
+    ostringstream o;
+    o << "\"config\":{"
+      << "\"bench\":" << json_str(results_bench)
+      << ",\"bench_opts\":" << json_str(results_bench_opts)
+#if defined(SSN) && defined(SSI)
+      << ",\"cc\":\"SSI+SSN\""
+#elif defined(SSN)
+      << ",\"cc\":\"SSN\""
+#elif defined(SSI)
+      << ",\"cc\":\"SSI\""
+#else
+      << ",\"cc\":\"SI\""
+#endif
+      << ",\"scale_factor\":" << scale_factor
+      << ",\"num_threads\":" << sysconf::worker_threads
+      << ",\"runtime\":" << runtime
+      << ",\"run_mode\":" << json_str(run_mode == RUNMODE_TIME ? "time" : "ops")
+      << ",\"txn_flags\":" << txn_flags
+      << ",\"log_buffer_mb\":" << sysconf::log_buffer_mb
+      << ",\"log_segment_mb\":" << sysconf::log_segment_mb
+      << ",\"node_memory_gb\":" << sysconf::node_memory_gb
+      << ",\"enable_gc\":" << sysconf::enable_gc
+      << "}";
+    o << ",\"elapsed_sec\":" << elapsed_sec
+      << ",\"commits\":" << n_commits
+      << ",\"query_commits\":" << n_query_commits
+      << ",\"throughput\":" << agg_throughput
+      << ",\"aborts\":" << n_aborts
+      << ",\"user_aborts\":" << n_user_aborts
+      << ",\"si_aborts\":" << n_si_aborts
+      << ",\"serial_aborts\":" << n_serial_aborts
+      << ",\"rw_aborts\":" << n_rw_aborts
+      << ",\"internal_aborts\":" << n_int_aborts
+      << ",\"phantom_aborts\":" << n_phantom_aborts;
+    // percentiles are bucket upper bounds, see pow2_histogram
+    o << ",\"latency_us\":{"
+      << "\"avg\":" << (n_commits ? avg_latency_us : 0)
+      << ",\"p50\":" << agg_latency.percentile(50)
+      << ",\"p90\":" << agg_latency.percentile(90)
+      << ",\"p99\":" << agg_latency.percentile(99)
+      << ",\"p99.9\":" << agg_latency.percentile(99.9)
+      << ",\"max\":" << agg_latency.max_value
+      << "}";
+    o << ",\"txns\":{";
+    const char *sep = "";
+    for (auto &c : agg_txn_counts) {
+      auto &a = agg_txn_abort_counts[c.first];
+      o << sep << json_str(c.first) << ":{"
+        << "\"commits\":" << std::get<0>(c.second)
+        << ",\"aborts\":" << std::get<1>(c.second)
+        << ",\"system_aborts\":" << std::get<2>(c.second)
+        << ",\"user_aborts\":" << std::get<3>(c.second)
+        << ",\"si_aborts\":" << std::get<0>(a)
+        << ",\"serial_aborts\":" << std::get<1>(a)
+        << ",\"rw_aborts\":" << std::get<2>(a)
+        << ",\"internal_aborts\":" << std::get<3>(a)
+        << ",\"phantom_aborts\":" << std::get<4>(a)
+        << ",\"avg_latency_us\":"
+        << (std::get<0>(c.second) ?
+            agg_txn_latencies[c.first] / double(std::get<0>(c.second)) : 0)
+        << "}";
+      sep = ",";
+    }
+    o << "}";
+    if (jsonl) {
+      fprintf(jsonl, "{\"type\":\"summary\",%s}\n", o.str().c_str());
+      ALWAYS_ASSERT(fclose(jsonl) == 0);
+    }
+    if (results_json.size()) {
+      o << ",\"series\":[";
+      for (size_t i = 0; i < series.size(); i++)
+        o << (i ? "," : "") << series[i].json();
+      o << "]";
+      write_atomically(results_json, "{" + o.str() + "}\n");
+    }
+  }
+
   if (!slow_exit)
     return;
 
@@ -464,3 +1013,33 @@ bench_worker::get_txn_counts() const
     m[workload[i].name] = txn_counts[i];
   return m;
 }
+
+const map<string, uint64_t>
+bench_worker::get_txn_latencies() const
+{
+  map<string, uint64_t> m;
+  const workload_desc_vec workload = get_workload();
+  for (size_t i = 0; i < txn_latency_us.size(); i++)
+    m[workload[i].name] = txn_latency_us[i];
+  return m;
+}
+
+const tx_phase_stat_map
+bench_worker::get_txn_phases() const
+{
+  tx_phase_stat_map m;
+  const workload_desc_vec workload = get_workload();
+  for (size_t i = 0; i < txn_phases.size(); i++)
+    m[workload[i].name] = txn_phases[i];
+  return m;
+}
+
+const tx_abort_stat_map
+bench_worker::get_txn_abort_counts() const
+{
+  tx_abort_stat_map m;
+  const workload_desc_vec workload = get_workload();
+  for (size_t i = 0; i < txn_abort_counts.size(); i++)
+    m[workload[i].name] = txn_abort_counts[i];
+  return m;
+}
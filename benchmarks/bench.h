@@ -6,6 +6,7 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <algorithm>
 
 #include "abstract_db.h"
 #include "../macros.h"
@@ -17,10 +18,15 @@
 #include "../dbcore/sm-log.h"
 #include "../dbcore/sm-alloc.h"
 #include "../dbcore/sm-oid.h"
+#include "../dbcore/sm-histogram.h"
+#include "../dbcore/sm-phase.h"
+#include "../dbcore/sm-metrics.h"
+#include "../dbcore/sm-trace.h"
 #include "../dbcore/sm-rc.h"
 #include "../dbcore/sm-thread.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h> // Needed for mlockall()
 #include <sys/time.h> // needed for getrusage
 #include <sys/resource.h> // needed for getrusage
@@ -31,6 +37,13 @@
 extern void ycsb_do_test(abstract_db *db, int argc, char **argv);
 extern void tpcc_do_test(abstract_db *db, int argc, char **argv);
 extern void tpce_do_test(abstract_db *db, int argc, char **argv);
+extern void tatp_do_test(abstract_db *db, int argc, char **argv);
+extern void smallbank_do_test(abstract_db *db, int argc, char **argv);
+extern void bid_do_test(abstract_db *db, int argc, char **argv);
+extern void queue_do_test(abstract_db *db, int argc, char **argv);
+extern void encstress_do_test(abstract_db *db, int argc, char **argv);
+extern void replay_do_test(abstract_db *db, int argc, char **argv);
+extern void server_do_test(abstract_db *db, int argc, char **argv);
 
 enum {
   RUNMODE_TIME = 0,
@@ -51,6 +64,11 @@ extern int slow_exit;
 extern int retry_aborted_transaction;
 extern int backoff_aborted_transaction;
 extern int enable_chkpt;
+extern int enable_cdc_consumer;
+extern std::string results_json;
+extern std::string results_jsonl;
+extern std::string results_bench;
+extern std::string results_bench_opts;
 
 template <typename T> static std::vector<T>
 unique_filter(const std::vector<T> &v)
@@ -69,7 +87,7 @@ class bench_loader : public thread::sm_runner {
 public:
   bench_loader(unsigned long seed, abstract_db *db,
                const std::map<std::string, abstract_ordered_index *> &open_tables)
-    : sm_runner(), r(seed), db(db), open_tables(open_tables)
+    : sm_runner(), r(seed), db(db), open_tables(open_tables), arena(str_arena::deferred)
   {
     txn_obj_buf.reserve(str_arena::MinStrReserveLength);
     txn_obj_buf.resize(db->sizeof_txn_object(txn_flags));
@@ -78,6 +96,11 @@ public:
   }
 
   virtual ~bench_loader() {}
+
+  // NUMA node to load on, so that what load() allocates lives there;
+  // -1 for anywhere (see bench_runner::run())
+  virtual int numa_node() const { return -1; }
+
   inline ALWAYS_INLINE varstr &
   str(uint64_t size)
   {
@@ -87,7 +110,11 @@ public:
 private:
   virtual void my_work(char *)
   {
+    // loaders are made all at once but only run a few at a time, so the
+    // arena buffer is only held while loading and handed on afterwards
+    arena.attach();
     load();
+    arena.detach();
   }
 
 protected:
@@ -104,6 +131,23 @@ protected:
 
 typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> tx_stat;
 typedef std::map<std::string, tx_stat> tx_stat_map;
+// system aborts by reason: si, serial, rw, internal, phantom
+typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> tx_abort_stat;
+typedef std::map<std::string, tx_abort_stat> tx_abort_stat_map;
+// cycles spent in transactions (aborted attempts included) and in
+// each of their phases, see dbcore/sm-phase.h
+typedef std::pair<uint64_t, phase::counters> tx_phase_stat;
+typedef std::map<std::string, tx_phase_stat> tx_phase_stat_map;
+
+// Workers fill up NUMA nodes in order: worker [worker_id] runs on this node
+// (unless its threads are taken), so data meant for a worker can be loaded
+// there beforehand
+inline uint16_t
+worker_node(uint32_t worker_id)
+{
+  return std::min<uint32_t>(worker_id / sysconf::max_threads_per_node,
+                            sysconf::numa_nodes - 1);
+}
 
 class bench_worker : public thread::sm_runner {
   friend class sm_log_alloc_mgr;
@@ -132,7 +176,8 @@ public:
   {
     txn_obj_buf.reserve(str_arena::MinStrReserveLength);
     txn_obj_buf.resize(db->sizeof_txn_object(txn_flags));
-    try_impersonate();
+    if (not try_impersonate(worker_node(worker_id)))
+      try_impersonate();
   }
 
   virtual ~bench_worker() {}
@@ -154,6 +199,12 @@ public:
   typedef std::vector<workload_desc> workload_desc_vec;
   virtual workload_desc_vec get_workload() const = 0;
 
+  // true once this worker has nothing more to run
+  virtual bool finished() const
+  {
+    return run_mode == RUNMODE_OPS && ntxn_commits >= ops_per_worker;
+  }
+
   inline size_t get_ntxn_commits() const { return ntxn_commits; }
   inline size_t get_ntxn_aborts() const { return ntxn_aborts; }
   inline size_t get_ntxn_user_aborts() const { return ntxn_user_aborts; }
@@ -172,6 +223,7 @@ public:
   inline void inc_ntxn_query_commits() { ++ntxn_query_commits; }
 
   inline uint64_t get_latency_numer_us() const { return volatile_read(latency_numer_us); }
+  inline const pow2_histogram &get_latency_histogram() const { return latency_hist; }
 
   inline double
   get_avg_latency_us() const
@@ -180,6 +232,9 @@ public:
   }
 
   const tx_stat_map get_txn_counts() const;
+  const tx_abort_stat_map get_txn_abort_counts() const;
+  const std::map<std::string, uint64_t> get_txn_latencies() const;
+  const tx_phase_stat_map get_txn_phases() const;
 
   typedef abstract_db::counter_map counter_map;
   typedef abstract_db::txn_counter_map txn_counter_map;
@@ -210,6 +265,7 @@ protected:
 
 private:
   uint64_t latency_numer_us;
+  pow2_histogram latency_hist;  // committed transactions, in us
   unsigned backoff_shifts;
 
   // stats
@@ -233,6 +289,9 @@ protected:
 #endif
 
   std::vector<tx_stat> txn_counts; // commits and aborts breakdown
+  std::vector<tx_abort_stat> txn_abort_counts; // system aborts breakdown
+  std::vector<uint64_t> txn_latency_us; // committed latency breakdown
+  std::vector<tx_phase_stat> txn_phases; // only with PHASE_TIMING=1
 
   std::string txn_obj_buf;
   str_arena arena;
@@ -257,9 +316,15 @@ protected:
   // only called once
   virtual std::vector<bench_loader*> make_loaders() = 0;
 
+  // called once every loader has finished, before the load checkpoint
+  virtual void on_load_end() {}
+
   // only called once
   virtual std::vector<bench_worker*> make_workers() = 0;
 
+  // called once the workers have stopped, before they are torn down
+  virtual void on_run_end() {}
+
   abstract_db *const db;
   std::map<std::string, abstract_ordered_index *> open_tables;
 
@@ -439,6 +504,16 @@ private:
     __abort_txn(r);  \
 }
 
+// same as try_verify_relax but don't do abort, only return rc
+// (e.g., to roll back to a savepoint instead)
+#define try_verify_relax_return(oper) \
+{ \
+  rc_t r = oper;   \
+  ALWAYS_ASSERT(r._val == RC_TRUE or rc_is_abort(r)); \
+  if (rc_is_abort(r))  \
+    return r;  \
+}
+
 // No abort is allowed, usually for loading
 #define try_verify_strict(oper) \
 { \
@@ -50,7 +50,7 @@ public:
       unsigned long seed, abstract_db *db,
       const map<string, abstract_ordered_index *> &open_tables,
       spin_barrier *barrier_a, spin_barrier *barrier_b)
-    : bench_worker(worker_id, false, seed, db,
+    : bench_worker(worker_id, seed, db,
                    open_tables, barrier_a, barrier_b),
       bidusertbl(open_tables.at("biduser")),
       bidtbl(open_tables.at("bid")),
@@ -58,47 +58,48 @@ public:
   {
   }
 
-  txn_result
+  rc_t
   txn_bid()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    try {
-      // pick user at random
-      biduser_rec::key biduser_key(r.next() % nusers);
-      ALWAYS_ASSERT(bidusertbl->get(txn, Encode(obj_k0, biduser_key), obj_v0));
-      biduser_rec::value biduser_value_temp;
-      const biduser_rec::value *biduser_value = Decode(obj_v0, biduser_value_temp);
-
-      // update the user's bid
-      const uint32_t bid = biduser_value->bid;
-      biduser_value_temp.bid++;
-      bidusertbl->put(txn, Encode(str(), biduser_key), Encode(str(), biduser_value_temp));
-
-      // insert the new bid
-      const bid_rec::key bid_key(biduser_key.uid, bid);
-      const bid_rec::value bid_value(r.next() % nproducts, r.next_uniform() * pricefactor);
-      bidtbl->insert(txn, Encode(str(), bid_key), Encode(str(), bid_value));
-
-      // update the max value if necessary
-      const bidmax_rec::key bidmax_key(bid_value.pid);
-      ALWAYS_ASSERT(bidmaxtbl->get(txn, Encode(obj_k0, bidmax_key), obj_v0));
-      bidmax_rec::value bidmax_value_temp;
-      const bidmax_rec::value *bidmax_value = Decode(obj_v0, bidmax_value_temp);
-
-      if (bid_value.amount > bidmax_value->amount) {
-        bidmax_value_temp.amount = bid_value.amount;
-        bidmaxtbl->put(txn, Encode(str(), bidmax_key), Encode(str(), bidmax_value_temp));
-      }
-
-      db->commit_txn(txn);
-      return txn_result(true, 0);
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
+    scoped_str_arena s_arena(arena);
+
+    // pick user at random
+    const biduser_rec::key biduser_key(r.next() % nusers);
+    biduser_rec::value biduser_value_temp;
+    varstr sv_biduser = str(Size(biduser_value_temp));
+    try_verify_relax(bidusertbl->get(txn, Encode(str(Size(biduser_key)), biduser_key), sv_biduser));
+    const biduser_rec::value *biduser_value = Decode(sv_biduser, biduser_value_temp);
+
+    // update the user's bid
+    const uint32_t bid = biduser_value->bid;
+    biduser_value_temp.bid++;
+    try_catch(bidusertbl->put(txn, Encode(str(Size(biduser_key)), biduser_key),
+                              Encode(str(Size(biduser_value_temp)), biduser_value_temp)));
+
+    // insert the new bid
+    const bid_rec::key bid_key(biduser_key.uid, bid);
+    const bid_rec::value bid_value(r.next() % nproducts, r.next_uniform() * pricefactor);
+    try_catch(bidtbl->insert(txn, Encode(str(Size(bid_key)), bid_key), Encode(str(Size(bid_value)), bid_value)));
+
+    // update the max value if necessary
+    const bidmax_rec::key bidmax_key(bid_value.pid);
+    bidmax_rec::value bidmax_value_temp;
+    varstr sv_bidmax = str(Size(bidmax_value_temp));
+    try_verify_relax(bidmaxtbl->get(txn, Encode(str(Size(bidmax_key)), bidmax_key), sv_bidmax));
+    const bidmax_rec::value *bidmax_value = Decode(sv_bidmax, bidmax_value_temp);
+
+    if (bid_value.amount > bidmax_value->amount) {
+      bidmax_value_temp.amount = bid_value.amount;
+      try_catch(bidmaxtbl->put(txn, Encode(str(Size(bidmax_key)), bidmax_key),
+                               Encode(str(Size(bidmax_value_temp)), bidmax_value_temp)));
     }
+
+    try_catch(db->commit_txn(txn));
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnBid(bench_worker *w)
   {
     return static_cast<bid_worker *>(w)->txn_bid();
@@ -113,20 +114,15 @@ public:
   }
 
 private:
-  inline ALWAYS_INLINE string &
-  str()
+  inline ALWAYS_INLINE varstr &
+  str(uint64_t size)
   {
-    return *arena.next();
+    return *arena.next(size);
   }
 
   abstract_ordered_index *bidusertbl;
   abstract_ordered_index *bidtbl;
   abstract_ordered_index *bidmaxtbl;
-
-  // scratch buffer space
-  string obj_k0;
-  string obj_v0;
-
 };
 
 class bid_loader : public bench_loader {
@@ -143,81 +139,33 @@ protected:
   {
     abstract_ordered_index *bidusertbl = open_tables.at("biduser");
     abstract_ordered_index *bidmaxtbl = open_tables.at("bidmax");
-    try {
-      // load
-      const size_t batchsize = (db->txn_max_batch_size() == -1) ?
-        10000 : db->txn_max_batch_size();
-      ALWAYS_ASSERT(batchsize > 0);
-
-      {
-        const size_t nbatches = nusers / batchsize;
-        if (nbatches == 0) {
-          void *txn = db->new_txn(txn_flags, arena, txn_buf());
-          for (size_t j = 0; j < nusers; j++) {
-            const biduser_rec::key key(j);
-            const biduser_rec::value value(0);
-            string buf0;
-            bidusertbl->insert(txn, Encode(key), Encode(buf0, value));
-          }
-          if (verbose)
-            cerr << "batch 1/1 done" << endl;
-          db->commit_txn(txn);
-        } else {
-          for (size_t i = 0; i < nbatches; i++) {
-            size_t keyend = (i == nbatches - 1) ? nusers : (i + 1) * batchsize;
-            void *txn = db->new_txn(txn_flags, arena, txn_buf());
-            for (size_t j = i * batchsize; j < keyend; j++) {
-              const biduser_rec::key key(j);
-              const biduser_rec::value value(0);
-              string buf0;
-              bidusertbl->insert(txn, Encode(key), Encode(buf0, value));
-            }
-            if (verbose)
-              cerr << "batch " << (i + 1) << "/" << nbatches << " done" << endl;
-            db->commit_txn(txn);
-          }
-        }
-        if (verbose)
-          cerr << "[INFO] finished loading BIDUSER table" << endl;
+    static const size_t BatchSize = 10000;
+
+    for (size_t batch = 0; batch < nusers; batch += BatchSize) {
+      void *txn = db->new_txn(txn_flags, arena, txn_buf());
+      for (size_t j = batch; j < std::min(batch + BatchSize, nusers); j++) {
+        const biduser_rec::key key(j);
+        const biduser_rec::value value(0);
+        try_verify_strict(bidusertbl->insert(txn, Encode(str(Size(key)), key), Encode(str(Size(value)), value)));
       }
-
-      {
-        const size_t nbatches = nproducts / batchsize;
-        if (nbatches == 0) {
-          void *txn = db->new_txn(txn_flags, arena, txn_buf());
-          for (size_t j = 0; j < nproducts; j++) {
-            const bidmax_rec::key key(j);
-            const bidmax_rec::value value(0.0);
-            string buf0;
-            bidmaxtbl->insert(txn, Encode(key), Encode(buf0, value));
-          }
-          if (verbose)
-            cerr << "batch 1/1 done" << endl;
-          db->commit_txn(txn);
-        } else {
-          for (size_t i = 0; i < nbatches; i++) {
-            size_t keyend = (i == nbatches - 1) ? nproducts : (i + 1) * batchsize;
-            void *txn = db->new_txn(txn_flags, arena, txn_buf());
-            for (size_t j = i * batchsize; j < keyend; j++) {
-              const bidmax_rec::key key(j);
-              const bidmax_rec::value value(0.0);
-              string buf0;
-              bidmaxtbl->insert(txn, Encode(key), Encode(buf0, value));
-            }
-            if (verbose)
-              cerr << "batch " << (i + 1) << "/" << nbatches << " done" << endl;
-            db->commit_txn(txn);
-          }
-        }
-        if (verbose)
-          cerr << "[INFO] finished loading BIDMAX table" << endl;
+      try_verify_strict(db->commit_txn(txn));
+      arena.reset();
+    }
+    if (verbose)
+      cerr << "[INFO] finished loading BIDUSER table" << endl;
+
+    for (size_t batch = 0; batch < nproducts; batch += BatchSize) {
+      void *txn = db->new_txn(txn_flags, arena, txn_buf());
+      for (size_t j = batch; j < std::min(batch + BatchSize, nproducts); j++) {
+        const bidmax_rec::key key(j);
+        const bidmax_rec::value value(0.0);
+        try_verify_strict(bidmaxtbl->insert(txn, Encode(str(Size(key)), key), Encode(str(Size(value)), value)));
       }
-
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      // shouldn't abort on loading!
-      ALWAYS_ASSERT(false);
+      try_verify_strict(db->commit_txn(txn));
+      arena.reset();
     }
-
+    if (verbose)
+      cerr << "[INFO] finished loading BIDMAX table" << endl;
   }
 };
 
@@ -225,6 +173,10 @@ class bid_bench_runner : public bench_runner {
 public:
   bid_bench_runner(abstract_db *db)
     : bench_runner(db)
+  {
+  }
+
+  virtual void prepare(char *)
   {
     open_tables["biduser"] = db->open_index("biduser", sizeof(biduser_rec));
     open_tables["bid"] = db->open_index("bid", sizeof(bid_rec));
@@ -245,7 +197,7 @@ protected:
   {
     fast_random r(36578943);
     vector<bench_worker *> ret;
-    for (size_t i = 0; i < nthreads; i++)
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
       ret.push_back(
         new bid_worker(
           i, r.next(), db, open_tables,
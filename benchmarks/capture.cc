@@ -0,0 +1,309 @@
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "capture.h"
+#include "../macros.h"
+#include "../varstr.h"
+#include "../txn.h"
+#include "../dbcore/sm-config.h"
+
+using namespace capture;
+
+// a thread loads first and may run a benchmark worker afterwards, each
+// goes to its own stream
+static __thread FILE *tls_stream = nullptr;
+static __thread bool tls_loading;
+
+static inline void
+emit_raw(FILE *f, const void *p, size_t n)
+{
+  ALWAYS_ASSERT(fwrite_unlocked(p, 1, n, f) == n);
+}
+
+template <typename T> static inline void
+emit(FILE *f, T v)
+{
+  emit_raw(f, &v, sizeof(v));
+}
+
+static inline void
+emit_key(FILE *f, const varstr &k)
+{
+  ALWAYS_ASSERT(k.size() <= UINT16_MAX);
+  emit<uint16_t>(f, k.size());
+  emit_raw(f, k.data(), k.size());
+}
+
+class capture_ordered_index : public abstract_ordered_index {
+public:
+  capture_ordered_index(capture_db *db, abstract_ordered_index *inner, uint16_t id)
+    : db(db), inner(inner), id(id) {}
+
+  virtual rc_t get(
+      void *txn,
+      const varstr &key,
+      varstr &value,
+      size_t max_bytes_read) override
+  {
+    rc_t rc = inner->get(txn, key, value, max_bytes_read);
+    // what was read, the buffer given may be too small and spill over
+    record(OP_GET, key, rc._val == RC_TRUE ? value.size() : 0);
+    return rc;
+  }
+
+  virtual rc_t scan(
+      void *txn,
+      const varstr &start_key,
+      const varstr *end_key,
+      scan_callback &callback,
+      str_arena *arena) override
+  {
+    counting_callback c(callback);
+    rc_t rc = inner->scan(txn, start_key, end_key, c, arena);
+    record_scan(OP_SCAN, start_key, end_key, c.n);
+    return rc;
+  }
+
+  virtual rc_t rscan(
+      void *txn,
+      const varstr &start_key,
+      const varstr *end_key,
+      scan_callback &callback,
+      str_arena *arena) override
+  {
+    counting_callback c(callback);
+    rc_t rc = inner->rscan(txn, start_key, end_key, c, arena);
+    record_scan(OP_RSCAN, start_key, end_key, c.n);
+    return rc;
+  }
+
+  virtual rc_t
+  put(void *txn,
+      const varstr &key,
+      const varstr &value) override
+  {
+    record(OP_PUT, key, value.size());
+    return inner->put(txn, key, value);
+  }
+
+  virtual rc_t
+  put(void *txn,
+      varstr &&key,
+      varstr &&value) override
+  {
+    record(OP_PUT, key, value.size());
+    return inner->put(txn, std::move(key), std::move(value));
+  }
+
+  virtual rc_t
+  insert(void *txn,
+         const varstr &key,
+         const varstr &value) override
+  {
+    record(OP_INSERT, key, value.size());
+    return inner->insert(txn, key, value);
+  }
+
+  virtual rc_t
+  insert(void *txn,
+         varstr &&key,
+         varstr &&value) override
+  {
+    record(OP_INSERT, key, value.size());
+    return inner->insert(txn, std::move(key), std::move(value));
+  }
+
+  virtual rc_t remove(
+      void *txn,
+      const varstr &key) override
+  {
+    record(OP_REMOVE, key);
+    return inner->remove(txn, key);
+  }
+
+  virtual rc_t remove(
+      void *txn,
+      varstr &&key) override
+  {
+    record(OP_REMOVE, key);
+    return inner->remove(txn, std::move(key));
+  }
+
+  virtual size_t size() const override { return inner->size(); }
+
+  virtual std::map<std::string, uint64_t> clear() override
+  {
+    return inner->clear();
+  }
+
+  capture_db *const db;
+  abstract_ordered_index *const inner;
+  const uint16_t id;
+
+private:
+  class counting_callback : public scan_callback {
+  public:
+    counting_callback(scan_callback &callback) : callback(callback), n(0) {}
+
+    virtual bool invoke(const char *keyp, size_t keylen,
+                        const varstr &value)
+    {
+      n++;
+      return callback.invoke(keyp, keylen, value);
+    }
+
+    scan_callback &callback;
+    uint32_t n;
+  };
+
+  inline void
+  record(op_type op, const varstr &key)
+  {
+    FILE *f = db->stream();
+    emit<uint8_t>(f, op);
+    emit(f, id);
+    emit_key(f, key);
+  }
+
+  inline void
+  record(op_type op, const varstr &key, size_t value_size)
+  {
+    record(op, key);
+    emit<uint32_t>(db->stream(), value_size);
+  }
+
+  void
+  record_scan(op_type op, const varstr &start_key, const varstr *end_key, uint32_t rows)
+  {
+    record(op, start_key);
+    FILE *f = db->stream();
+    emit<uint8_t>(f, end_key != nullptr);
+    if (end_key)
+      emit_key(f, *end_key);
+    emit(f, rows);
+  }
+};
+
+capture_db::capture_db(abstract_db *inner, const std::string &dir)
+  : inner(inner), dir(dir), ntables(0), nload(0), nrun(0)
+{
+  ALWAYS_ASSERT(mkdir(dir.c_str(), 0755) == 0 or errno == EEXIST);
+  tables = fopen((dir + "/" + TABLES_FILE).c_str(), "w");
+  ALWAYS_ASSERT(tables);
+}
+
+capture_db::~capture_db()
+{
+  for (auto *f : streams)
+    ALWAYS_ASSERT(fclose(f) == 0);
+  ALWAYS_ASSERT(fclose(tables) == 0);
+  delete inner;
+}
+
+FILE *
+capture_db::stream()
+{
+  const bool loading = volatile_read(sysconf::loading);
+  if (likely(tls_stream and tls_loading == loading))
+    return tls_stream;
+
+  std::lock_guard<std::mutex> guard(lock);
+  char path[32];
+  snprintf(path, sizeof(path), "/%s-%u.ops",
+           loading ? "load" : "run", loading ? nload++ : nrun++);
+  FILE *f = fopen((dir + path).c_str(), "w");
+  ALWAYS_ASSERT(f);
+  setvbuf(f, nullptr, _IOFBF, 1 << 20);
+  streams.push_back(f);
+  tls_stream = f;
+  tls_loading = loading;
+  return f;
+}
+
+void *
+capture_db::new_txn(
+    uint64_t txn_flags,
+    str_arena &arena,
+    void *buf,
+    TxnProfileHint hint)
+{
+  FILE *f = stream();
+  emit<uint8_t>(f, OP_BEGIN);
+  emit(f, txn_flags);
+  emit<uint8_t>(f, hint);
+  return inner->new_txn(txn_flags, arena, buf, hint);
+}
+
+void *
+capture_db::new_txn_as_of(uint64_t lsn, str_arena &arena, void *buf)
+{
+  void *txn = inner->new_txn_as_of(lsn, arena, buf);
+  if (txn) {
+    FILE *f = stream();
+    emit<uint8_t>(f, OP_BEGIN);
+    emit<uint64_t>(f, transaction::TXN_FLAG_READ_ONLY);
+    emit<uint8_t>(f, HINT_DEFAULT);
+  }
+  return txn;
+}
+
+rc_t
+capture_db::commit_txn(void *txn)
+{
+  rc_t rc = inner->commit_txn(txn);
+  // otherwise the caller aborts it
+  if (not rc_is_abort(rc))
+    emit<uint8_t>(stream(), OP_COMMIT);
+  return rc;
+}
+
+void
+capture_db::abort_txn(void *txn)
+{
+  emit<uint8_t>(stream(), OP_ABORT);
+  inner->abort_txn(txn);
+}
+
+size_t
+capture_db::set_savepoint(void *txn)
+{
+  const size_t sp = inner->set_savepoint(txn);
+  FILE *f = stream();
+  emit<uint8_t>(f, OP_SAVEPOINT);
+  emit<uint32_t>(f, sp);
+  return sp;
+}
+
+bool
+capture_db::rollback_txn_to(void *txn, size_t savepoint)
+{
+  // otherwise the caller aborts it
+  if (not inner->rollback_txn_to(txn, savepoint))
+    return false;
+  FILE *f = stream();
+  emit<uint8_t>(f, OP_ROLLBACK);
+  emit<uint32_t>(f, savepoint);
+  return true;
+}
+
+abstract_ordered_index *
+capture_db::open_index(const std::string &name,
+                       size_t value_size_hint,
+                       bool mostly_append)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  ALWAYS_ASSERT(ntables < UINT16_MAX);
+  abstract_ordered_index *idx = inner->open_index(name, value_size_hint, mostly_append);
+  fprintf(tables, "%u %lu %d %s\n", ntables, value_size_hint, mostly_append, name.c_str());
+  fflush(tables);
+  return new capture_ordered_index(this, idx, ntables++);
+}
+
+void
+capture_db::close_index(abstract_ordered_index *idx)
+{
+  auto *c = static_cast<capture_ordered_index *>(idx);
+  inner->close_index(c->inner);
+  delete c;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "abstract_db.h"
+
+/**
+ * Records the operations a benchmark issues, so they can be replayed
+ * later against another build (see replay.cc).
+ *
+ * capture_db wraps another abstract_db and its indexes and forwards
+ * everything to them. Every thread that runs transactions gets its own
+ * stream file in the capture directory: load-<n>.ops for threads that
+ * loaded, run-<n>.ops for benchmark workers (a thread that does both
+ * gets one of each). Streams are written without any sharing, in the
+ * order the thread issued the operations. The tables file lists the
+ * indexes that were opened, one per line:
+ *
+ *   <table id> <value size hint> <mostly append> <name>
+ *
+ * A stream is a sequence of records, in host byte order:
+ *
+ *   BEGIN           u8 op, u64 txn flags, u8 profile hint
+ *   COMMIT, ABORT   u8 op
+ *   GET, PUT,       u8 op, u16 table, u16 key length, key, u32 value size
+ *   INSERT          (for GET, the bytes read; 0 if nothing was found)
+ *   REMOVE          u8 op, u16 table, u16 key length, key
+ *   SCAN, RSCAN     u8 op, u16 table, u16 key length, start key,
+ *                   u8 has end key, [u16 key length, end key,]
+ *                   u32 rows read
+ *   SAVEPOINT,      u8 op, u32 savepoint
+ *   ROLLBACK        (a ROLLBACK undoes the transaction's operations since
+ *                   the SAVEPOINT it names; one that failed isn't kept,
+ *                   the transaction ends with ABORT)
+ *
+ * Values are not kept, only their sizes. A transaction whose commit
+ * failed ends with ABORT, like one the benchmark gave up on. One begun
+ * with new_txn_as_of() is recorded as a read-only BEGIN; its LSN is not
+ * kept, so a replay reads the data of its own time.
+ */
+namespace capture {
+
+enum op_type : uint8_t {
+  OP_BEGIN = 1,
+  OP_COMMIT,
+  OP_ABORT,
+  OP_GET,
+  OP_PUT,
+  OP_INSERT,
+  OP_REMOVE,
+  OP_SCAN,
+  OP_RSCAN,
+  OP_SAVEPOINT,
+  OP_ROLLBACK,
+};
+
+static const char TABLES_FILE[] = "tables";
+
+}  // namespace capture
+
+class capture_db : public abstract_db {
+  friend class capture_ordered_index;
+public:
+
+  // takes over [inner]; creates [dir] if needed
+  capture_db(abstract_db *inner, const std::string &dir);
+  ~capture_db();
+
+  virtual ssize_t txn_max_batch_size() const override
+  {
+    return inner->txn_max_batch_size();
+  }
+
+  virtual bool index_has_stable_put_memory() const override
+  {
+    return inner->index_has_stable_put_memory();
+  }
+
+  virtual size_t
+  sizeof_txn_object(uint64_t txn_flags) const override
+  {
+    return inner->sizeof_txn_object(txn_flags);
+  }
+
+  virtual void *new_txn(
+      uint64_t txn_flags,
+      str_arena &arena,
+      void *buf,
+      TxnProfileHint hint) override;
+
+  virtual counter_map
+  get_txn_counters(void *txn) const override
+  {
+    return inner->get_txn_counters(txn);
+  }
+
+  virtual rc_t commit_txn(void *txn) override;
+  virtual void abort_txn(void *txn) override;
+
+  virtual size_t set_savepoint(void *txn) override;
+  virtual bool rollback_txn_to(void *txn, size_t savepoint) override;
+
+  virtual uint64_t current_lsn() override
+  {
+    return inner->current_lsn();
+  }
+
+  virtual void *new_txn_as_of(uint64_t lsn, str_arena &arena, void *buf) override;
+
+  virtual void print_txn_debug(void *txn) const override
+  {
+    inner->print_txn_debug(txn);
+  }
+
+  virtual abstract_ordered_index *
+  open_index(const std::string &name,
+             size_t value_size_hint,
+             bool mostly_append) override;
+
+  virtual void
+  close_index(abstract_ordered_index *idx) override;
+
+private:
+  // the calling thread's stream, opened on its first operation
+  FILE *stream();
+
+  abstract_db *const inner;
+  const std::string dir;
+
+  std::mutex lock; // for everything below
+  FILE *tables;
+  uint16_t ntables;
+  unsigned nload;
+  unsigned nrun;
+  std::vector<FILE *> streams;
+};
@@ -13,10 +13,12 @@
 
 #include "../dbcore/sm-alloc.h"
 #include "../dbcore/sm-config.h"
+#include "../dbcore/sm-log-checksum.h"
 #include "../dbcore/sm-log-recover-impl.h"
 #include "../dbcore/sm-thread.h"
 #include "bench.h"
 #include "ndb_wrapper.h"
+#include "capture.h"
 //#include "kvdb_wrapper.h"
 //#include "kvdb_wrapper_impl.h"
 
@@ -49,6 +51,7 @@ main(int argc, char **argv)
   free(curdir);
   int saw_run_spec = 0;
   string replay_mode("oid");
+  string capture_dir;
 
   while (1) {
     static struct option long_options[] =
@@ -71,7 +74,27 @@ main(int argc, char **argv)
       {"log-buffer-mb"              , required_argument , 0                          , 'u'} ,
       {"recovery-warm-up"           , required_argument , 0                          , 'w'} ,
       {"enable-chkpt"               , no_argument       , &enable_chkpt              , 1} ,
+      {"cdc-consumer"               , no_argument       , &enable_cdc_consumer       , 1} ,
       {"null-log-device"            , no_argument       , &sysconf::null_log_device  , 1} ,
+      {"log-update-delta"           , no_argument       , &sysconf::log_update_delta , 1} ,
+      {"log-preallocate"            , no_argument       , &sysconf::log_preallocate  , 1} ,
+      {"bulk-load"                  , no_argument       , &sysconf::bulk_load        , 1} ,
+      {"log-checksum"               , required_argument , 0                          , 'k'},
+      {"log-ship-listen"            , required_argument , 0                          , 'L'},
+      {"standby-of"                 , required_argument , 0                          , 'S'},
+      {"save-snapshot"              , required_argument , 0                          , 'A'},
+      {"from-snapshot"              , required_argument , 0                          , 'F'},
+      {"backup-dir"                 , required_argument , 0                          , 'D'},
+      {"backup-threads"             , required_argument , 0                          , 'I'},
+      {"backup-mb-per-sec"          , required_argument , 0                          , 'W'},
+      {"restore-backup"             , required_argument , 0                          , 'E'},
+      {"snapshot-retention-mb"      , required_argument , 0                          , 'H'},
+      {"results-json"               , required_argument , 0                          , 'J'},
+      {"results-jsonl"              , required_argument , 0                          , 'j'},
+      {"trace"                      , required_argument , 0                          , 'T'},
+      {"metrics-file"               , required_argument , 0                          , 'M'},
+      {"metrics-listen"             , required_argument , 0                          , 'P'},
+      {"capture-dir"                , required_argument , 0                          , 'C'},
       {"parallel-recovery-by"       , required_argument , 0                          , 'c'},
       {"node-memory-gb"             , required_argument , 0                          , 'p'},
       {"enable-gc"                  , no_argument       , &sysconf::enable_gc        , 1},
@@ -88,7 +111,7 @@ main(int argc, char **argv)
       {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long(argc, argv, "b:s:t:B:f:r:n:o:m:l:e:u:w:x:p:m:", long_options, &option_index);
+    int c = getopt_long(argc, argv, "b:s:t:B:f:r:n:o:m:l:e:u:w:x:p:m:k:L:S:A:F:D:I:W:E:H:J:j:T:M:P:C:", long_options, &option_index);
     if (c == -1)
       break;
 
@@ -110,6 +133,76 @@ main(int argc, char **argv)
       }
       break;
 
+    case 'k':
+      if (auto *csum = log_checksum_find(optarg)) {
+        sysconf::log_checksum = csum->kind;
+      } else {
+        std::cout << "Invalid log checksum: " << optarg << "\n";
+        abort();
+      }
+      break;
+
+    case 'L':
+      sysconf::log_ship_listen = string(optarg);
+      break;
+
+    case 'S':
+      sysconf::standby_of = string(optarg);
+      break;
+
+    case 'A':
+      sysconf::save_snapshot = string(optarg);
+      break;
+
+    case 'F':
+      sysconf::from_snapshot = string(optarg);
+      break;
+
+    case 'D':
+      sysconf::backup_dir = string(optarg);
+      break;
+
+    case 'I':
+      sysconf::backup_threads = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(sysconf::backup_threads > 0);
+      break;
+
+    case 'W':
+      sysconf::backup_mb_per_sec = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'E':
+      sysconf::restore_backup = string(optarg);
+      break;
+
+    case 'H':
+      sysconf::snapshot_retention_mb = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'J':
+      results_json = string(optarg);
+      break;
+
+    case 'j':
+      results_jsonl = string(optarg);
+      break;
+
+    case 'T':
+      sysconf::trace_file = string(optarg);
+      break;
+
+    case 'M':
+      sysconf::metrics_file = string(optarg);
+      break;
+
+    case 'P':
+      sysconf::metrics_listen = string(optarg);
+      break;
+
+    case 'C':
+      capture_dir = string(optarg);
+      break;
+
     case 'p':
       sysconf::node_memory_gb = strtoul(optarg, NULL, 10);
       break;
@@ -197,12 +290,28 @@ main(int argc, char **argv)
     }
   }
 
+  results_bench = bench_type;
+  results_bench_opts = bench_opts;
  if (bench_type == "ycsb")
     test_fn = ycsb_do_test;
   else if (bench_type == "tpcc")
     test_fn = tpcc_do_test;
   else if (bench_type == "tpce")
     test_fn = tpce_do_test;
+  else if (bench_type == "tatp")
+    test_fn = tatp_do_test;
+  else if (bench_type == "smallbank")
+    test_fn = smallbank_do_test;
+  else if (bench_type == "bid")
+    test_fn = bid_do_test;
+  else if (bench_type == "queue")
+    test_fn = queue_do_test;
+  else if (bench_type == "encstress")
+    test_fn = encstress_do_test;
+  else if (bench_type == "replay")
+    test_fn = replay_do_test;
+  else if (bench_type == "server")
+    test_fn = server_do_test;
   else
     ALWAYS_ASSERT(false);
 
@@ -217,6 +326,40 @@ main(int argc, char **argv)
     return 1;
   }
 
+  if ((sysconf::save_snapshot.size() or sysconf::from_snapshot.size()) and sysconf::null_log_device) {
+    cerr << "[ERROR] snapshots need a log device" << endl;
+    return 1;
+  }
+
+  if (sysconf::from_snapshot.size() and sysconf::standby_of.size()) {
+    cerr << "[ERROR] a standby gets its database from the primary, not a snapshot" << endl;
+    return 1;
+  }
+
+  if (sysconf::restore_backup.size() and (sysconf::from_snapshot.size() or sysconf::standby_of.size())) {
+    cerr << "[ERROR] a restored backup replaces the load; no snapshot or primary to start from" << endl;
+    return 1;
+  }
+
+  if (sysconf::log_ship_listen.size() or sysconf::standby_of.size()) {
+#if defined(SSN) || defined(SSI)
+    cerr << "[ERROR] log shipping only supports SI" << endl;
+    return 1;
+#endif
+    if (sysconf::null_log_device) {
+      cerr << "[ERROR] log shipping needs a log device" << endl;
+      return 1;
+    }
+    if (sysconf::bulk_load) {
+      cerr << "[ERROR] a bulk load can't be shipped, it is not in the log" << endl;
+      return 1;
+    }
+    if (sysconf::standby_of.size() and (enable_chkpt or sysconf::log_ship_listen.size())) {
+      cerr << "[ERROR] a standby can't take checkpoints or ship its log" << endl;
+      return 1;
+    }
+  }
+
 #ifndef NDEBUG
   cerr << "WARNING: benchmark built in DEBUG mode!!!" << endl;
 #endif
@@ -286,8 +429,33 @@ main(int argc, char **argv)
     cerr << endl;
     cerr << "  parallel-recover-by: " << replay_mode         << endl;
     cerr << "  enable-chkpt    : " << enable_chkpt           << endl;
+    cerr << "  cdc-consumer    : " << enable_cdc_consumer    << endl;
     cerr << "  enable-gc       : " << sysconf::enable_gc     << endl;
     cerr << "  null-log-device : " << sysconf::null_log_device << endl;
+    cerr << "  log-update-delta: " << sysconf::log_update_delta << endl;
+    cerr << "  log-preallocate : " << sysconf::log_preallocate << endl;
+    cerr << "  bulk-load       : " << sysconf::bulk_load << endl;
+    cerr << "  log-checksum    : ";
+    if (sysconf::log_checksum == sysconf::LOG_CHECKSUM_CRC32C)
+      cerr << "crc32c";
+    else
+      cerr << "adler32";
+    cerr << endl;
+    cerr << "  log-ship-listen : " << sysconf::log_ship_listen << endl;
+    cerr << "  standby-of      : " << sysconf::standby_of << endl;
+    cerr << "  save-snapshot   : " << sysconf::save_snapshot << endl;
+    cerr << "  from-snapshot   : " << sysconf::from_snapshot << endl;
+    cerr << "  backup-dir      : " << sysconf::backup_dir << endl;
+    cerr << "  backup-threads  : " << sysconf::backup_threads << endl;
+    cerr << "  backup-mb-per-sec: " << sysconf::backup_mb_per_sec << endl;
+    cerr << "  restore-backup  : " << sysconf::restore_backup << endl;
+    cerr << "  snapshot-retention-mb: " << sysconf::snapshot_retention_mb << endl;
+    cerr << "  results-json    : " << results_json << endl;
+    cerr << "  results-jsonl   : " << results_jsonl << endl;
+    cerr << "  trace           : " << sysconf::trace_file << endl;
+    cerr << "  metrics-file    : " << sysconf::metrics_file << endl;
+    cerr << "  metrics-listen  : " << sysconf::metrics_listen << endl;
+    cerr << "  capture-dir     : " << capture_dir << endl;
 
     cerr << "system properties:" << endl;
     cerr << "  btree_internal_node_size: " << concurrent_btree::InternalNodeSize() << endl;
@@ -326,6 +494,8 @@ main(int argc, char **argv)
   // Must have everything in CONF ready by this point (ndb-wrapper's ctor will use them)
   sysconf::sanity_check();
   db = new ndb_wrapper();
+  if (capture_dir.size())
+    db = new capture_db(db, capture_dir);
   test_fn(db, argc, new_argv);
   delete db;
   return 0;
@@ -611,6 +611,36 @@ char argv[20][100];
 	    return 0;
 	}
 
+	/*
+	 * Splits this instance's customers into at most nParts ranges of whole
+	 * load units and returns a generator for each, the way separate EGen
+	 * instances would be started on disjoint ranges. Call after egen_init().
+	 */
+	std::vector<CGenerateAndLoad*> egen_split_init(UINT nParts)
+	{
+		std::vector<CGenerateAndLoad*> ret;
+		TIdent iUnits = iCustomerCount / iLoadUnitSize;
+		if (nParts > iUnits)
+			nParts = iUnits;
+		for (UINT i = 0; i < nParts; i++) {
+			TIdent iStart = iStartFromCustomer + i * iUnits / nParts * iLoadUnitSize;
+			TIdent iCount = ((i + 1) * iUnits / nParts - i * iUnits / nParts) * iLoadUnitSize;
+
+			char szLogFileName[64];
+			snprintf(&szLogFileName[0], sizeof(szLogFileName),
+				 "EGenLoaderFrom %lldTo%lld.log", iStart, (iStart + iCount)-1);
+			CLogFormatTab fmt;
+			CEGenLogger logger(eDriverEGenLoader, 0, szLogFileName, &fmt);
+
+			ret.push_back(new CGenerateAndLoad(*inputFiles, iCount, iStart,
+							iTotalCustomerCount, iLoadUnitSize,
+							iScaleFactor, iDaysOfInitialTrades,
+							pLoaderFactory, &logger, Output, szInDir,
+							bGenerateUsingCache));
+		}
+		return ret;
+	}
+
 	CCETxnInputGenerator*  transactions_input_init(int customers, int sf, int wdays) 
 	{	
 	//	TDriverCETxnSettings		m_DriverCETxnSettings;
@@ -60,6 +60,7 @@ public:
       moreToRead=true;
       cnt = 0;
     }
+    ~EgenTupleContainer() { delete [] buffer; }
     T* get(int i){cnt++; return &buffer[i]; }
     void append(T* row) {memcpy(&buffer[size++],row, sizeof(T)); }
     bool hasSpace(){return (size<capacity-2);}
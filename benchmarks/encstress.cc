@@ -41,29 +41,28 @@ public:
       unsigned long seed, abstract_db *db,
       const map<string, abstract_ordered_index *> &open_tables,
       spin_barrier *barrier_a, spin_barrier *barrier_b)
-    : bench_worker(worker_id, false, seed, db,
+    : bench_worker(worker_id, seed, db,
                    open_tables, barrier_a, barrier_b),
       tbl(open_tables.at("table"))
   {
   }
 
-  txn_result
+  rc_t
   txn_read()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    const string k = u64_varkey(r.next() % nkeys).str();
-    try {
-      string v;
-      ALWAYS_ASSERT(tbl->get(txn, k, v));
-      db->commit_txn(txn);
-      return txn_result(true, 0);
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
-    }
+    scoped_str_arena s_arena(arena);
+    const encstress_rec::key k(r.next() % nkeys);
+    encstress_rec::value v_temp;
+    varstr sv = str(Size(v_temp));
+    try_verify_relax(tbl->get(txn, Encode(str(Size(k)), k), sv));
+    const encstress_rec::value *v = Decode(sv, v_temp);
+    ALWAYS_ASSERT(v->f0 == 1);
+    try_catch(db->commit_txn(txn));
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnRead(bench_worker *w)
   {
     return static_cast<encstress_worker *>(w)->txn_read();
@@ -78,6 +77,12 @@ public:
   }
 
 private:
+  inline ALWAYS_INLINE varstr &
+  str(uint64_t size)
+  {
+    return *arena.next(size);
+  }
+
   abstract_ordered_index *tbl;
 };
 
@@ -94,45 +99,18 @@ protected:
   load()
   {
     abstract_ordered_index *tbl = open_tables.at("table");
-    try {
-      // load
-      const size_t batchsize = (db->txn_max_batch_size() == -1) ?
-        10000 : db->txn_max_batch_size();
-      ALWAYS_ASSERT(batchsize > 0);
-      const size_t nbatches = nkeys / batchsize;
-      if (nbatches == 0) {
-        void *txn = db->new_txn(txn_flags, arena, txn_buf());
-        for (size_t j = 0; j < nkeys; j++) {
-          const encstress_rec::key key(j);
-          encstress_rec::value rec;
-          rec.f0 = 1; rec.f1 = 1; rec.f2 = 1; rec.f3 = 1;
-          rec.f4 = 1; rec.f5 = 1; rec.f6 = 1; rec.f7 = 1;
-          string buf;
-          tbl->insert(txn, Encode(key), Encode(buf, rec));
-        }
-        if (verbose)
-          cerr << "batch 1/1 done" << endl;
-        db->commit_txn(txn);
-      } else {
-        for (size_t i = 0; i < nbatches; i++) {
-          size_t keyend = (i == nbatches - 1) ? nkeys : (i + 1) * batchsize;
-          void *txn = db->new_txn(txn_flags, arena, txn_buf());
-          for (size_t j = i * batchsize; j < keyend; j++) {
-            const encstress_rec::key key(j);
-            encstress_rec::value rec;
-            rec.f0 = 1; rec.f1 = 1; rec.f2 = 1; rec.f3 = 1;
-            rec.f4 = 1; rec.f5 = 1; rec.f6 = 1; rec.f7 = 1;
-            string buf;
-            tbl->insert(txn, Encode(key), Encode(buf, rec));
-          }
-          if (verbose)
-            cerr << "batch " << (i + 1) << "/" << nbatches << " done" << endl;
-          db->commit_txn(txn);
-        }
+    static const size_t BatchSize = 10000;
+    for (size_t batch = 0; batch < nkeys; batch += BatchSize) {
+      void *txn = db->new_txn(txn_flags, arena, txn_buf());
+      for (size_t j = batch; j < std::min(batch + BatchSize, nkeys); j++) {
+        const encstress_rec::key key(j);
+        encstress_rec::value rec;
+        rec.f0 = 1; rec.f1 = 1; rec.f2 = 1; rec.f3 = 1;
+        rec.f4 = 1; rec.f5 = 1; rec.f6 = 1; rec.f7 = 1;
+        try_verify_strict(tbl->insert(txn, Encode(str(Size(key)), key), Encode(str(Size(rec)), rec)));
       }
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      // shouldn't abort on loading!
-      ALWAYS_ASSERT(false);
+      try_verify_strict(db->commit_txn(txn));
+      arena.reset();
     }
     if (verbose)
       cerr << "[INFO] finished loading USERTABLE" << endl;
@@ -143,6 +121,10 @@ class encstress_bench_runner : public bench_runner {
 public:
   encstress_bench_runner(abstract_db *db)
     : bench_runner(db)
+  {
+  }
+
+  virtual void prepare(char *)
   {
     open_tables["table"] = db->open_index("table", sizeof(encstress_rec));
   }
@@ -161,7 +143,7 @@ protected:
   {
     fast_random r(8544290);
     vector<bench_worker *> ret;
-    for (size_t i = 0; i < nthreads; i++)
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
       ret.push_back(
         new encstress_worker(
           i, r.next(), db, open_tables,
@@ -0,0 +1,233 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/select.h>
+
+#include "../macros.h"
+#include "../util.h"
+#include "../dbcore/sm-common.h"
+#include "../masstree/kvio.hh"
+#include "../masstree/json.hh"
+
+using lcdf::Json;
+using lcdf::Str;
+using lcdf::String;
+
+#include "../masstree/mtclient.hh"
+#include "server.h"
+
+using namespace std;
+using namespace util;
+using namespace kvserver;
+
+// Load generator for the transaction server (dbtest --bench server).
+// Every thread opens one connection and keeps --depth one-shot requests,
+// or --depth transactions of --txn-ops requests each, in flight: it sends
+// them all, then reads all of the replies. Keys are picked uniformly from
+// the --keys the server preloaded; each request reads the key with
+// probability --get-ratio and replaces it otherwise.
+
+static string g_server = "unix:/tmp/ermia-server.sock";
+static size_t g_nthreads = 1;
+static size_t g_runtime = 10;
+static size_t g_nkeys = 100000;
+static size_t g_value_size = 100;
+static double g_get_ratio = 0.5;
+static size_t g_txn_ops = 0;
+static size_t g_depth = 16;
+
+static volatile bool g_running = true;
+
+struct client_stats {
+  client_stats() : nrequests(0), nretries(0), ncommits(0), naborts(0) {}
+  uint64_t nrequests;
+  uint64_t nretries;  // one-shot requests and transaction requests answered Retry
+  uint64_t ncommits;
+  uint64_t naborts;
+};
+
+// as in mtclient.cc, which has its own main()
+void KVConn::hard_check(int tryhard) {
+    masstree_precondition(inbufpos_ == inbuflen_);
+    if (parser_.empty()) {
+        inbufpos_ = inbuflen_ = 0;
+        for (auto x : oldinbuf_)
+            delete[] x;
+        oldinbuf_.clear();
+    } else if (inbufpos_ == inbufsz) {
+        oldinbuf_.push_back(inbuf_);
+        inbuf_ = new char[inbufsz];
+        inbufpos_ = inbuflen_ = 0;
+    }
+    if (tryhard == 1) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(infd_, &rfds);
+        struct timeval tv = {0, 0};
+        if (select(infd_ + 1, &rfds, NULL, NULL, &tv) <= 0)
+            return;
+    } else
+        kvflush(out_);
+
+    ssize_t r = read(infd_, inbuf_ + inbufpos_, inbufsz - inbufpos_);
+    if (r != -1)
+        inbuflen_ += r;
+}
+
+static void
+client_thread(unsigned id, client_stats *stats)
+{
+  const int fd = os_socket(g_server, false);
+  KVConn conn(fd, true);
+  fast_random r(id + 1);
+  const string value(g_value_size, 'b');
+  unsigned seq = 1;
+
+  while (volatile_read(g_running)) {
+    size_t nreplies = 0;
+    for (size_t i = 0; i < g_depth; i++) {
+      if (g_txn_ops) {
+        conn.sendcmd(Cmd_Begin, seq++);
+        nreplies++;
+      }
+      for (size_t j = 0; j < std::max<size_t>(g_txn_ops, 1); j++) {
+        const string key = make_key(r.next() % g_nkeys);
+        if (r.next_uniform() < g_get_ratio)
+          conn.sendgetwhole(key, seq++);
+        else
+          conn.sendputwhole(key, value, seq++);
+        nreplies++;
+      }
+      if (g_txn_ops) {
+        conn.sendcmd(Cmd_Commit, seq++);
+        nreplies++;
+      }
+    }
+    conn.flush();
+
+    for (; nreplies; nreplies--) {
+      const Json &reply = conn.receive();
+      if (not reply.is_a()) {
+        cerr << "client " << id << ": server went away" << endl;
+        close(fd);
+        return;
+      }
+      const int cmd = reply[1].as_i();
+      if (cmd == Cmd_Begin + 1)
+        continue;
+      if (cmd == Cmd_Commit + 1) {
+        if (reply[2].as_b())
+          stats->ncommits++;
+        else
+          stats->naborts++;
+        continue;
+      }
+      stats->nrequests++;
+      if (reply[2].is_i() and reply[2].as_i() == Retry)
+        stats->nretries++;
+    }
+  }
+  close(fd);
+}
+
+int
+main(int argc, char **argv)
+{
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"server"                               , required_argument , 0 , 's'} ,
+      {"num-threads"                          , required_argument , 0 , 't'} ,
+      {"runtime"                              , required_argument , 0 , 'r'} ,
+      {"keys"                                 , required_argument , 0 , 'k'} ,
+      {"value-size"                           , required_argument , 0 , 'v'} ,
+      {"get-ratio"                            , required_argument , 0 , 'g'} ,
+      {"txn-ops"                              , required_argument , 0 , 'x'} ,
+      {"depth"                                , required_argument , 0 , 'd'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "s:t:r:k:v:g:x:d:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 's':
+      g_server = optarg;
+      break;
+
+    case 't':
+      g_nthreads = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_nthreads > 0);
+      break;
+
+    case 'r':
+      g_runtime = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'k':
+      g_nkeys = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_nkeys > 0);
+      break;
+
+    case 'v':
+      g_value_size = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_value_size > 0 and g_value_size <= MaxValueSize);
+      break;
+
+    case 'g':
+      g_get_ratio = strtod(optarg, NULL);
+      ALWAYS_ASSERT(g_get_ratio >= 0 and g_get_ratio <= 1);
+      break;
+
+    case 'x':
+      g_txn_ops = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'd':
+      g_depth = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_depth > 0);
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  vector<client_stats> stats(g_nthreads);
+  vector<thread> threads;
+  timer t;
+  for (size_t i = 0; i < g_nthreads; i++)
+    threads.emplace_back(client_thread, i, &stats[i]);
+  sleep(g_runtime);
+  g_running = false;
+  for (auto &th : threads)
+    th.join();
+  const double elapsed_sec = t.lap() / 1000000.0;
+
+  client_stats total;
+  for (auto &s : stats) {
+    total.nrequests += s.nrequests;
+    total.nretries += s.nretries;
+    total.ncommits += s.ncommits;
+    total.naborts += s.naborts;
+  }
+  cout << "requests: " << total.nrequests
+       << " (" << total.nrequests / elapsed_sec << " /sec), retried: "
+       << total.nretries << endl;
+  if (g_txn_ops)
+    cout << "transactions: " << total.ncommits
+         << " (" << total.ncommits / elapsed_sec << " /sec), aborted: "
+         << total.naborts << endl;
+  return 0;
+}
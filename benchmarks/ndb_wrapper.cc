@@ -50,6 +50,43 @@ ndb_wrapper::abort_txn(void *txn)
   t->~transaction();
 }
 
+size_t
+ndb_wrapper::set_savepoint(void *txn)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+  auto t = (transaction *)&p->buf[0];
+  return t->set_savepoint();
+}
+
+bool
+ndb_wrapper::rollback_txn_to(void *txn, size_t savepoint)
+{
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(txn);
+  auto t = (transaction *)&p->buf[0];
+  return t->rollback_to(savepoint);
+}
+
+uint64_t
+ndb_wrapper::current_lsn()
+{
+  return transaction::begin_lsn_offset();
+}
+
+void *
+ndb_wrapper::new_txn_as_of(uint64_t lsn, str_arena &arena, void *buf)
+{
+  if (not lsn)   // before anything was written
+    return NULL;
+  ndbtxn * const p = reinterpret_cast<ndbtxn *>(buf);
+  p->hint = HINT_DEFAULT;
+  auto t = new (&p->buf[0]) transaction(0, arena, lsn);
+  if (not t->snapshot_available()) {
+    t->~transaction();
+    return NULL;
+  }
+  return p;
+}
+
 void
 ndb_wrapper::print_txn_debug(void *txn) const
 {
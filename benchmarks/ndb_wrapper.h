@@ -33,6 +33,10 @@ public:
       TxnProfileHint hint);
   virtual rc_t commit_txn(void *txn);
   virtual void abort_txn(void *txn);
+  virtual size_t set_savepoint(void *txn);
+  virtual bool rollback_txn_to(void *txn, size_t savepoint);
+  virtual uint64_t current_lsn();
+  virtual void *new_txn_as_of(uint64_t lsn, str_arena &arena, void *buf);
   virtual void print_txn_debug(void *txn) const;
 
   virtual abstract_ordered_index *
@@ -47,6 +51,8 @@ public:
 
 class ndb_ordered_index : public abstract_ordered_index {
     friend class sm_log_recover_impl;
+    friend class sm_oid_mgr;
+    friend class backup_scanner;
 protected:
   typedef private_::ndbtxn ndbtxn;
 
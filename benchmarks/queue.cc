@@ -6,6 +6,7 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
 
 #include "../macros.h"
 #include "../varkey.h"
@@ -13,147 +14,140 @@
 #include "../util.h"
 #include "../spinbarrier.h"
 
+#include "../record/encoder.h"
+#include "../record/inline_str.h"
 #include "bench.h"
 
 using namespace std;
 using namespace util;
 
-static size_t nkeys;
+static size_t nkeys;  // preloaded items per queue
 
-static inline string
-queue_key(uint64_t id0, uint64_t id1)
+// workers are grouped into queues of g_producers producers followed by
+// g_consumers consumers; with no consumers the queues only grow
+static uint g_producers = 1;
+static uint g_consumers = 1;
+
+#define QUEUE_REC_KEY_FIELDS(x, y) \
+  x(uint64_t,q_id) \
+  y(uint64_t,q_seq)
+#define QUEUE_REC_VALUE_FIELDS(x, y) \
+  x(inline_str_fixed<8>,q_payload)
+DO_STRUCT(queue_rec, QUEUE_REC_KEY_FIELDS, QUEUE_REC_VALUE_FIELDS)
+
+static const char queue_values[] = "ABCDEFGH";
+
+static inline size_t
+NumQueues()
 {
-  big_endian_trfm<uint64_t> t;
-  string buf(2 * sizeof(uint64_t), 0);
-  uint64_t *p = (uint64_t *) &buf[0];
-  *p++ = t(id0);
-  *p++ = t(id1);
-  return buf;
+  const size_t n = g_producers + g_consumers;
+  return (sysconf::worker_threads + n - 1) / n;
 }
 
-static const string queue_values("ABCDEFGH");
-
 class queue_worker : public bench_worker {
 public:
+  // producer p of a queue appends items nkeys + p, nkeys + p + g_producers,
+  // ...; consumers remove from the head
   queue_worker(unsigned int worker_id,
                unsigned long seed, abstract_db *db,
                const map<string, abstract_ordered_index *> &open_tables,
                spin_barrier *barrier_a, spin_barrier *barrier_b,
-               uint64_t id, bool consumer)
-    : bench_worker(worker_id, false, seed, db,
+               uint64_t id, bool consumer, uint64_t producer_idx)
+    : bench_worker(worker_id, seed, db,
                    open_tables, barrier_a, barrier_b),
       tbl(open_tables.at("table")), id(id), consumer(consumer),
-      ctr(consumer ? 0 : nkeys)
+      ctr(consumer ? 0 : nkeys + producer_idx)
   {
   }
 
-  txn_result
+  rc_t
   txn_produce()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    try {
-      const string k = queue_key(id, ctr);
-      tbl->insert(txn, k, queue_values);
-      db->commit_txn(txn);
-      ctr++;
-      return txn_result(true, queue_values.size());
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
-    }
+    scoped_str_arena s_arena(arena);
+    const queue_rec::key k(id, ctr);
+    const queue_rec::value v(queue_values);
+    try_catch(tbl->insert(txn, Encode(str(Size(k)), k), Encode(str(Size(v)), v)));
+    try_catch(db->commit_txn(txn));
+    ctr += g_producers;
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnProduce(bench_worker *w)
   {
     return static_cast<queue_worker *>(w)->txn_produce();
   }
 
-  txn_result
+  rc_t
   txn_consume()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    try {
-      const string lowk = queue_key(id, 0);
-      const string highk = queue_key(id, numeric_limits<uint64_t>::max());
-      limit_callback c(1);
-      tbl->scan(txn, lowk, &highk, c);
-      ssize_t ret = 0;
-      if (likely(!c.values.empty())) {
-        ALWAYS_ASSERT(c.values.size() == 1);
-        const string &k = c.values.front().first;
-        tbl->remove(txn, k);
-        ret = -queue_values.size();
-      }
-      db->commit_txn(txn);
-      return txn_result(true, ret);
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
-    }
+    scoped_str_arena s_arena(arena);
+    const queue_rec::key lowk(id, 0);
+    const queue_rec::key highk(id, numeric_limits<uint64_t>::max());
+    varstr &k = str(Size(lowk));
+    latest_key_callback c(k, 1);
+    try_catch(tbl->scan(txn, Encode(str(Size(lowk)), lowk), &Encode(str(Size(highk)), highk), c, s_arena.get()));
+    if (likely(c.size()))
+      try_catch(tbl->remove(txn, k));
+    try_catch(db->commit_txn(txn));
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnConsume(bench_worker *w)
   {
     return static_cast<queue_worker *>(w)->txn_consume();
   }
 
-  txn_result
+  rc_t
   txn_consume_scanhint()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    try {
-      const string lowk = queue_key(id, ctr);
-      const string highk = queue_key(id, numeric_limits<uint64_t>::max());
-      limit_callback c(1);
-      tbl->scan(txn, lowk, &highk, c);
-      const bool found = !c.values.empty();
-      ssize_t ret = 0;
-      if (likely(found)) {
-        ALWAYS_ASSERT(c.values.size() == 1);
-        const string &k = c.values.front().first;
-        tbl->remove(txn, k);
-        ret = -queue_values.size();
-      }
-      db->commit_txn(txn);
-      if (likely(found)) ctr++;
-      return txn_result(true, ret);
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
+    scoped_str_arena s_arena(arena);
+    const queue_rec::key lowk(id, ctr);
+    const queue_rec::key highk(id, numeric_limits<uint64_t>::max());
+    varstr &k = str(Size(lowk));
+    latest_key_callback c(k, 1);
+    try_catch(tbl->scan(txn, Encode(str(Size(lowk)), lowk), &Encode(str(Size(highk)), highk), c, s_arena.get()));
+    const bool found = c.size();
+    if (likely(found))
+      try_catch(tbl->remove(txn, k));
+    try_catch(db->commit_txn(txn));
+    if (likely(found)) {
+      queue_rec::key k_temp;
+      ctr = Decode(k, k_temp)->q_seq + 1;
     }
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnConsumeScanHint(bench_worker *w)
   {
     return static_cast<queue_worker *>(w)->txn_consume_scanhint();
   }
 
-  txn_result
+  rc_t
   txn_consume_noscan()
   {
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
-    try {
-      const string k = queue_key(id, ctr);
-      string v;
-      bool found = false;
-      ssize_t ret = 0;
-      if (likely((found = tbl->get(txn, k, v)))) {
-        tbl->remove(txn, k);
-        ret = -queue_values.size();
-      }
-      db->commit_txn(txn);
-      if (likely(found)) ctr++;
-      return txn_result(true, ret);
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      db->abort_txn(txn);
-      return txn_result(false, 0);
-    }
+    scoped_str_arena s_arena(arena);
+    const queue_rec::key k(id, ctr);
+    queue_rec::value v_temp;
+    varstr sv = str(Size(v_temp));
+    rc_t rc = tbl->get(txn, Encode(str(Size(k)), k), sv);
+    if (rc_is_abort(rc))
+      __abort_txn(rc);
+    const bool found = rc._val == RC_TRUE;
+    if (likely(found))
+      try_catch(tbl->remove(txn, Encode(str(Size(k)), k)));
+    try_catch(db->commit_txn(txn));
+    if (likely(found)) ctr++;
+    return {RC_TRUE};
   }
 
-  static txn_result
+  static rc_t
   TxnConsumeNoScan(bench_worker *w)
   {
     return static_cast<queue_worker *>(w)->txn_consume_noscan();
@@ -173,6 +167,12 @@ public:
   }
 
 private:
+  inline ALWAYS_INLINE varstr &
+  str(uint64_t size)
+  {
+    return *arena.next(size);
+  }
+
   abstract_ordered_index *tbl;
   uint64_t id;
   bool consumer;
@@ -192,41 +192,18 @@ protected:
   load()
   {
     abstract_ordered_index *tbl = open_tables.at("table");
-    try {
-      // load
-      const size_t batchsize = (db->txn_max_batch_size() == -1) ?
-        10000 : db->txn_max_batch_size();
-      ALWAYS_ASSERT(batchsize > 0);
-      const size_t nbatches = nkeys / batchsize;
-      for (size_t id = 0; id < nthreads / 2; id++) {
-        if (nbatches == 0) {
-          void *txn = db->new_txn(txn_flags, arena, txn_buf());
-          for (size_t j = 0; j < nkeys; j++) {
-            const string k = queue_key(id, j);
-            const string &v = queue_values;
-            tbl->insert(txn, k, v);
-          }
-          if (verbose)
-            cerr << "batch 1/1 done" << endl;
-          db->commit_txn(txn);
-        } else {
-          for (size_t i = 0; i < nbatches; i++) {
-            size_t keyend = (i == nbatches - 1) ? nkeys : (i + 1) * batchsize;
-            void *txn = db->new_txn(txn_flags, arena, txn_buf());
-            for (size_t j = i * batchsize; j < keyend; j++) {
-              const string k = queue_key(id, j);
-              const string &v = queue_values;
-              tbl->insert(txn, k, v);
-            }
-            if (verbose)
-              cerr << "batch " << (i + 1) << "/" << nbatches << " done" << endl;
-            db->commit_txn(txn);
-          }
+    static const size_t BatchSize = 10000;
+    const queue_rec::value v(queue_values);
+    for (size_t id = 0; id < NumQueues(); id++) {
+      for (size_t batch = 0; batch < nkeys; batch += BatchSize) {
+        void *txn = db->new_txn(txn_flags, arena, txn_buf());
+        for (size_t j = batch; j < std::min(batch + BatchSize, nkeys); j++) {
+          const queue_rec::key k(id, j);
+          try_verify_strict(tbl->insert(txn, Encode(str(Size(k)), k), Encode(str(Size(v)), v)));
         }
+        try_verify_strict(db->commit_txn(txn));
+        arena.reset();
       }
-    } catch (abstract_db::abstract_abort_exception &ex) {
-      // shouldn't abort on loading!
-      ALWAYS_ASSERT(false);
     }
     if (verbose)
       cerr << "[INFO] finished loading table" << endl;
@@ -235,10 +212,14 @@ protected:
 
 class queue_bench_runner : public bench_runner {
 public:
-  queue_bench_runner(abstract_db *db, bool write_only)
-    : bench_runner(db), write_only(write_only)
+  queue_bench_runner(abstract_db *db)
+    : bench_runner(db)
   {
-    open_tables["table"] = db->open_index("table", queue_values.size());
+  }
+
+  virtual void prepare(char *)
+  {
+    open_tables["table"] = db->open_index("table", sizeof(queue_rec));
   }
 
 protected:
@@ -255,39 +236,73 @@ protected:
   {
     fast_random r(8544290);
     vector<bench_worker *> ret;
-    if (write_only) {
-      for (size_t i = 0; i < nthreads; i++)
-        ret.push_back(
-          new queue_worker(
-            i, r.next(), db, open_tables,
-            &barrier_a, &barrier_b, i, false));
-    } else {
-      ALWAYS_ASSERT(nthreads >= 2);
-      if (verbose && (nthreads % 2))
-        cerr << "queue_bench_runner: odd number of workers given" << endl;
-      for (size_t i = 0; i < nthreads / 2; i++) {
-        ret.push_back(
-          new queue_worker(
-            i, r.next(), db, open_tables,
-            &barrier_a, &barrier_b, i, true));
-        ret.push_back(
-          new queue_worker(
-            i + 1, r.next(), db, open_tables,
-            &barrier_a, &barrier_b, i, false));
-      }
+    const size_t n = g_producers + g_consumers;
+    if (verbose && (sysconf::worker_threads % n))
+      cerr << "queue_bench_runner: last queue has fewer than "
+           << n << " workers" << endl;
+    for (size_t i = 0; i < sysconf::worker_threads; i++) {
+      const size_t idx = i % n;
+      ret.push_back(
+        new queue_worker(
+          i, r.next(), db, open_tables,
+          &barrier_a, &barrier_b, i / n, idx >= g_producers, idx));
     }
     return ret;
   }
-
-private:
-  bool write_only;
 };
 
 void
 queue_do_test(abstract_db *db, int argc, char **argv)
 {
+  // parse options
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"producers"                            , required_argument , 0 , 'p'} ,
+      {"consumers"                            , required_argument , 0 , 'c'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "p:c:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'p':
+      g_producers = strtoul(optarg, nullptr, 10);
+      ALWAYS_ASSERT(g_producers > 0);
+      break;
+
+    case 'c':
+      g_consumers = strtoul(optarg, nullptr, 10);
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
   nkeys = size_t(scale_factor * 1000.0);
   ALWAYS_ASSERT(nkeys > 0);
-  queue_bench_runner r(db, true);
+
+  if (verbose) {
+    cerr << "queue settings:" << endl;
+    cerr << "  queues                       : " << NumQueues() << endl;
+    cerr << "  preloaded items per queue    : " << nkeys << endl;
+    cerr << "  producers per queue          : " << g_producers << endl;
+    cerr << "  consumers per queue          : " << g_consumers << endl;
+  }
+
+  queue_bench_runner r(db);
   r.run();
 }
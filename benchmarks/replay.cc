@@ -0,0 +1,431 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <string>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../macros.h"
+#include "../util.h"
+#include "../spinbarrier.h"
+
+#include "bench.h"
+#include "capture.h"
+
+using namespace std;
+using namespace util;
+using namespace capture;
+
+// Replays streams recorded with --capture-dir (see capture.h): each load
+// stream is run by a loader and each run stream by a worker, transaction
+// by transaction in the recorded order. Keys are the recorded ones,
+// values are filler of the recorded size.
+
+static string g_dir;
+static vector<string> g_table_names; // by table id
+static size_t g_nload_streams;
+static size_t g_nrun_streams;
+
+static string
+StreamPath(const char *kind, size_t i)
+{
+  return g_dir + "/" + kind + "-" + to_string(i) + ".ops";
+}
+
+static size_t
+CountStreams(const char *kind)
+{
+  size_t n = 0;
+  while (access(StreamPath(kind, n).c_str(), R_OK) == 0)
+    n++;
+  return n;
+}
+
+// one thread's recorded operations, split into transactions
+class replay_stream {
+public:
+  replay_stream(const string &path)
+    : max_value(0)
+  {
+    ifstream in(path, ios::binary);
+    ALWAYS_ASSERT(in);
+    ostringstream s;
+    s << in.rdbuf();
+    data = s.str();
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+      if (uint8_t(data[pos]) == OP_BEGIN)
+        txns.push_back(pos);
+      pos = skip(pos);
+    }
+    ALWAYS_ASSERT(pos == data.size());
+    buf.resize(max_value);
+  }
+
+  inline size_t ntxns() const { return txns.size(); }
+
+  // returns the commit's rc, RC_ABORT_USER if the transaction was
+  // recorded as aborted, or whatever made it abort here
+  rc_t
+  run(size_t i, abstract_db *db, const vector<abstract_ordered_index *> &tables,
+      str_arena &arena, void *txn_buf)
+  {
+    size_t pos = txns[i];
+    ALWAYS_ASSERT(get<uint8_t>(pos) == OP_BEGIN);
+    const uint64_t flags = get<uint64_t>(pos);
+    const auto hint = abstract_db::TxnProfileHint(get<uint8_t>(pos));
+    void *txn = db->new_txn(flags, arena, txn_buf, hint);
+    // recorded savepoint -> ours, in case they're numbered differently
+    savepoints.clear();
+    for (;;) {
+      const uint8_t op = get<uint8_t>(pos);
+      if (op == OP_SAVEPOINT) {
+        const uint32_t sp = get<uint32_t>(pos);
+        if (savepoints.size() <= sp)
+          savepoints.resize(sp + 1);
+        savepoints[sp] = db->set_savepoint(txn);
+        continue;
+      }
+      if (op == OP_ROLLBACK) {
+        const uint32_t sp = get<uint32_t>(pos);
+        ALWAYS_ASSERT(sp < savepoints.size());
+        if (not db->rollback_txn_to(txn, savepoints[sp])) {
+          db->abort_txn(txn);
+          return {RC_ABORT_INTERNAL};
+        }
+        continue;
+      }
+      if (op == OP_COMMIT) {
+        const rc_t rc = db->commit_txn(txn);
+        if (rc_is_abort(rc))
+          db->abort_txn(txn);
+        return rc;
+      }
+      if (op == OP_ABORT) {
+        db->abort_txn(txn);
+        return {RC_ABORT_USER};
+      }
+      abstract_ordered_index *tbl = tables[get<uint16_t>(pos)];
+      const varstr k = get_key(pos);
+      rc_t rc;
+      switch (op) {
+      case OP_GET:
+        rc = tbl->get(txn, k, *arena.next(get<uint32_t>(pos)));
+        break;
+      case OP_PUT:
+        rc = tbl->put(txn, k, varstr(buf.data(), get<uint32_t>(pos)));
+        break;
+      case OP_INSERT:
+        rc = tbl->insert(txn, k, varstr(buf.data(), get<uint32_t>(pos)));
+        break;
+      case OP_REMOVE:
+        rc = tbl->remove(txn, k);
+        break;
+      case OP_SCAN:
+      case OP_RSCAN: {
+        const bool has_end = get<uint8_t>(pos);
+        const varstr end = has_end ? get_key(pos) : varstr();
+        const uint32_t rows = get<uint32_t>(pos);
+        rows_callback c(rows);
+        if (not rows)
+          rc = {RC_TRUE};  // the callback would still see the first row
+        else if (op == OP_SCAN)
+          rc = tbl->scan(txn, k, has_end ? &end : nullptr, c, &arena);
+        else
+          rc = tbl->rscan(txn, k, has_end ? &end : nullptr, c, &arena);
+        break;
+      }
+      default:
+        ALWAYS_ASSERT(false);
+      }
+      if (rc_is_abort(rc)) {
+        db->abort_txn(txn);
+        return rc;
+      }
+    }
+  }
+
+private:
+  // stops after as many rows as the recorded scan read
+  class rows_callback : public abstract_ordered_index::scan_callback {
+  public:
+    rows_callback(uint32_t rows) : rows(rows), n(0) {}
+
+    virtual bool invoke(const char *keyp, size_t keylen,
+                        const varstr &value)
+    {
+      return ++n < rows;
+    }
+
+  private:
+    uint32_t rows;
+    uint32_t n;
+  };
+
+  template <typename T> inline T
+  get(size_t &pos) const
+  {
+    ALWAYS_ASSERT(pos + sizeof(T) <= data.size());
+    T v;
+    memcpy(&v, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+  }
+
+  inline varstr
+  get_key(size_t &pos) const
+  {
+    const uint16_t len = get<uint16_t>(pos);
+    ALWAYS_ASSERT(pos + len <= data.size());
+    varstr k(data.data() + pos, len);
+    pos += len;
+    return k;
+  }
+
+  // position of the record after the one at [pos]
+  size_t
+  skip(size_t pos)
+  {
+    const uint8_t op = get<uint8_t>(pos);
+    switch (op) {
+    case OP_BEGIN:
+      return pos + sizeof(uint64_t) + sizeof(uint8_t);
+    case OP_COMMIT:
+    case OP_ABORT:
+      return pos;
+    case OP_SAVEPOINT:
+    case OP_ROLLBACK:
+      return pos + sizeof(uint32_t);
+    case OP_PUT:
+    case OP_INSERT:
+      get<uint16_t>(pos);
+      get_key(pos);
+      max_value = std::max<size_t>(max_value, get<uint32_t>(pos));
+      return pos;
+    case OP_GET:
+      get<uint16_t>(pos);
+      get_key(pos);
+      return pos + sizeof(uint32_t);
+    case OP_REMOVE:
+      get<uint16_t>(pos);
+      get_key(pos);
+      return pos;
+    case OP_SCAN:
+    case OP_RSCAN:
+      get<uint16_t>(pos);
+      get_key(pos);
+      if (get<uint8_t>(pos))
+        get_key(pos);
+      return pos + sizeof(uint32_t);
+    default:
+      ALWAYS_ASSERT(false);
+      return pos;
+    }
+  }
+
+  string data;
+  vector<size_t> txns; // offsets of BEGIN records
+  size_t max_value;
+  string buf; // values written
+  vector<size_t> savepoints; // of the transaction being run
+};
+
+static vector<abstract_ordered_index *>
+TablesById(const map<string, abstract_ordered_index *> &open_tables)
+{
+  vector<abstract_ordered_index *> ret;
+  for (auto &name : g_table_names)
+    ret.push_back(open_tables.at(name));
+  return ret;
+}
+
+class replay_worker : public bench_worker {
+public:
+  replay_worker(unsigned int worker_id,
+                unsigned long seed, abstract_db *db,
+                const map<string, abstract_ordered_index *> &open_tables,
+                spin_barrier *barrier_a, spin_barrier *barrier_b,
+                const string &path)
+    : bench_worker(worker_id, seed, db,
+                   open_tables, barrier_a, barrier_b),
+      tables(TablesById(open_tables)), stream(path), next(0)
+  {
+  }
+
+  rc_t
+  txn_replay()
+  {
+    scoped_str_arena s_arena(arena);
+    const rc_t rc = stream.run(next, db, tables, arena, txn_buf());
+    // recorded aborts are final; one that only happened here is tried
+    // again if aborted transactions are retried, skipped otherwise
+    if (not rc_is_abort(rc) or rc_is_user_abort(rc) or not retry_aborted_transaction)
+      volatile_write(next, next + 1);
+    return rc;
+  }
+
+  static rc_t
+  TxnReplay(bench_worker *w)
+  {
+    return static_cast<replay_worker *>(w)->txn_replay();
+  }
+
+  virtual workload_desc_vec
+  get_workload() const
+  {
+    workload_desc_vec w;
+    w.push_back(workload_desc("Replay", 1.0, TxnReplay));
+    return w;
+  }
+
+  virtual bool
+  finished() const
+  {
+    return volatile_read(next) == stream.ntxns();
+  }
+
+private:
+  vector<abstract_ordered_index *> tables;
+  replay_stream stream;
+  size_t next;
+};
+
+class replay_loader : public bench_loader {
+public:
+  replay_loader(unsigned long seed,
+                abstract_db *db,
+                const map<string, abstract_ordered_index *> &open_tables,
+                const string &path)
+    : bench_loader(seed, db, open_tables), path(path)
+  {}
+
+protected:
+  virtual void
+  load()
+  {
+    replay_stream stream(path);
+    const vector<abstract_ordered_index *> tables = TablesById(open_tables);
+    for (size_t i = 0; i < stream.ntxns(); i++) {
+      const rc_t rc = stream.run(i, db, tables, arena, txn_buf());
+      ALWAYS_ASSERT(not rc_is_abort(rc) or rc_is_user_abort(rc));
+      arena.reset();
+    }
+    if (verbose)
+      cerr << "[INFO] replayed " << path << endl;
+  }
+
+private:
+  string path;
+};
+
+class replay_bench_runner : public bench_runner {
+public:
+  replay_bench_runner(abstract_db *db)
+    : bench_runner(db)
+  {
+  }
+
+  virtual void prepare(char *)
+  {
+    ifstream in(g_dir + "/" + TABLES_FILE);
+    ALWAYS_ASSERT(in);
+    size_t id, value_size_hint;
+    int mostly_append;
+    string name;
+    while (in >> id >> value_size_hint >> mostly_append && getline(in >> ws, name)) {
+      ALWAYS_ASSERT(id == g_table_names.size());
+      g_table_names.push_back(name);
+      open_tables[name] = db->open_index(name, value_size_hint, mostly_append);
+    }
+  }
+
+protected:
+  virtual vector<bench_loader *>
+  make_loaders()
+  {
+    vector<bench_loader *> ret;
+    for (size_t i = 0; i < g_nload_streams; i++)
+      ret.push_back(new replay_loader(i, db, open_tables, StreamPath("load", i)));
+    return ret;
+  }
+
+  virtual vector<bench_worker *>
+  make_workers()
+  {
+    vector<bench_worker *> ret;
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
+      ret.push_back(
+        new replay_worker(
+          i, i, db, open_tables,
+          &barrier_a, &barrier_b, StreamPath("run", i)));
+    return ret;
+  }
+};
+
+void
+replay_do_test(abstract_db *db, int argc, char **argv)
+{
+  // parse options
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"dir"                                  , required_argument , 0 , 'd'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "d:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'd':
+      g_dir = optarg;
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  if (g_dir.empty()) {
+    cerr << "replay needs --dir, a directory written by --capture-dir" << endl;
+    exit(1);
+  }
+  g_nload_streams = CountStreams("load");
+  g_nrun_streams = CountStreams("run");
+  if (g_nrun_streams != sysconf::worker_threads) {
+    cerr << "replay: " << g_dir << " has " << g_nrun_streams
+         << " worker streams, run with --num-threads " << g_nrun_streams << endl;
+    exit(1);
+  }
+
+  // a worker is done at the end of its stream
+  run_mode = RUNMODE_OPS;
+
+  if (verbose) {
+    cerr << "replay settings:" << endl;
+    cerr << "  dir                          : " << g_dir << endl;
+    cerr << "  load streams                 : " << g_nload_streams << endl;
+    cerr << "  worker streams               : " << g_nrun_streams << endl;
+  }
+
+  replay_bench_runner r(db);
+  r.run();
+}
@@ -0,0 +1,628 @@
+#include <iostream>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <string>
+#include <algorithm>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "../macros.h"
+#include "../util.h"
+#include "../spinbarrier.h"
+#include "../dbcore/sm-common.h"
+#include "../dbcore/sm-metrics.h"
+#include "../masstree/json.hh"
+#include "../masstree/msgpack.hh"
+
+#include "bench.h"
+#include "server.h"
+
+using namespace std;
+using namespace util;
+using namespace kvserver;
+using lcdf::Json;
+using lcdf::String;
+using lcdf::StringAccum;
+
+// Serves table "kv" to clients speaking the protocol in server.h for
+// the length of the run. The workers are regular benchmark workers, so
+// they are pinned node by node like any other. An acceptor thread hands
+// new connections to them round robin; a worker keeps a connection for
+// good and watches all of its own with one epoll set.
+//
+// A worker reads whatever its clients sent, so requests can be
+// pipelined, and runs one transaction at a time:
+//  - up to --batch one-shot requests, taken from all of its connections,
+//    run in a single transaction, and each connection gets its replies
+//    in one write afterwards. If that transaction aborts, the requests
+//    are run again one by one.
+//  - Begin starts a transaction for its connection. Transactions are
+//    bound to their thread, so the worker then serves that connection
+//    alone until Commit or Abort; its other connections wait.
+// Commits and aborts count these transactions, not requests;
+// ermia_server_requests_total has those.
+
+static const char TABLE[] = "kv";
+
+static string g_listen = "unix:/tmp/ermia-server.sock";
+static size_t g_nkeys = 0;
+static size_t g_value_size = 100;
+static size_t g_batch = 32;
+
+static inline varstr
+to_varstr(const Json &j)
+{
+  const String &s = j.as_s();
+  return varstr(s.data(), s.length());
+}
+
+static bool
+well_formed(const Json &req)
+{
+  if (not req.is_a() or req.size() < 2 or not req[0].is_i() or not req[1].is_i())
+    return false;
+  switch (req[1].as_i()) {
+  case Cmd_Handshake:
+  case Cmd_Begin:
+  case Cmd_Commit:
+  case Cmd_Abort:
+    return true;
+  case Cmd_Get:
+  case Cmd_Remove:
+    return req.size() == 3 and req[2].is_s();
+  case Cmd_Replace:
+    return req.size() == 4 and req[2].is_s() and req[3].is_s()
+           and size_t(req[3].as_s().length()) <= MaxValueSize;
+  case Cmd_Scan:
+    return req.size() == 4 and req[2].is_s() and req[3].is_i() and req[3].as_i() >= 0;
+  default:
+    return false;
+  }
+}
+
+static inline Json
+reply_to(const Json &req)
+{
+  return Json::array(req[0], req[1].as_i() + 1);
+}
+
+class server_conn {
+public:
+  server_conn(int fd) : fd(fd) {}
+  ~server_conn() { close(fd); }
+
+  // parses whatever arrived without blocking, false once the client is
+  // gone or sent something we don't understand
+  bool
+  receive()
+  {
+    char buf[64 * 1024];
+    for (;;) {
+      ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (n < 0 and errno == EINTR)
+        continue;
+      if (n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+        return true;
+      if (n <= 0)
+        return false;
+      for (ssize_t pos = 0; pos < n; ) {
+        pos += parser.consume(buf + pos, n - pos);
+        if (parser.done()) {
+          if (not parser.success() or not well_formed(parser.result()))
+            return false;
+          requests.push_back(std::move(parser.result()));
+          parser.reset();
+        }
+      }
+    }
+  }
+
+  inline Json
+  pop()
+  {
+    Json req = std::move(requests.front());
+    requests.pop_front();
+    return req;
+  }
+
+  inline void
+  reply(const Json &j)
+  {
+    msgpack::unparse(out, j);
+  }
+
+  bool
+  flush()
+  {
+    bool ok = os_send_all(fd, out.data(), out.length());
+    out.clear();
+    return ok;
+  }
+
+  const int fd;
+  deque<Json> requests; // parsed, not served yet
+
+private:
+  msgpack::streaming_parser parser;
+  StringAccum out;
+};
+
+class server_worker : public bench_worker {
+public:
+  server_worker(unsigned int worker_id,
+                unsigned long seed, abstract_db *db,
+                const map<string, abstract_ordered_index *> &open_tables,
+                spin_barrier *barrier_a, spin_barrier *barrier_b)
+    : bench_worker(worker_id, seed, db,
+                   open_tables, barrier_a, barrier_b),
+      tbl(open_tables.at(TABLE)), epfd(epoll_create1(0)),
+      nconns(0), nrequests(0)
+  {
+    ALWAYS_ASSERT(epfd >= 0);
+  }
+
+  // called by the acceptor, [c] is ours from now on
+  void
+  add(server_conn *c)
+  {
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    ALWAYS_ASSERT(epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) == 0);
+    __sync_fetch_and_add(&nconns, 1);
+  }
+
+  rc_t
+  serve()
+  {
+    while (ready.empty()) {
+      if (not volatile_read(running))
+        return {RC_INVALID};
+      poll_conns(100);
+    }
+    // whatever else is there joins the batch
+    poll_conns(0);
+    if (ready.empty())
+      return {RC_INVALID};
+    if (ready.front()->requests.front()[1].as_i() == Cmd_Begin)
+      return serve_txn();
+    return serve_batch();
+  }
+
+  static rc_t
+  Serve(bench_worker *w)
+  {
+    return static_cast<server_worker *>(w)->serve();
+  }
+
+  virtual workload_desc_vec
+  get_workload() const
+  {
+    workload_desc_vec w;
+    w.push_back(workload_desc("Serve", 1.0, Serve));
+    return w;
+  }
+
+  inline size_t get_nconns() const { return volatile_read(nconns); }
+  inline size_t get_nrequests() const { return volatile_read(nrequests); }
+
+private:
+  void
+  poll_conns(int timeout_ms)
+  {
+    epoll_event events[64];
+    int n = epoll_wait(epfd, events, 64, timeout_ms);
+    for (int i = 0; i < n; i++) {
+      server_conn *c = (server_conn *) events[i].data.ptr;
+      const bool was_ready = c->requests.size();
+      if (not c->receive())
+        drop(c);
+      else if (not was_ready and c->requests.size())
+        ready.push_back(c);
+    }
+  }
+
+  // waits for more from [c] alone; false if it went away or the run is over
+  bool
+  wait_for(server_conn *c)
+  {
+    while (volatile_read(running)) {
+      pollfd p = {c->fd, POLLIN, 0};
+      if (::poll(&p, 1, 100) > 0)
+        return c->receive();
+    }
+    return false;
+  }
+
+  void
+  drop(server_conn *c)
+  {
+    ready.erase(remove(ready.begin(), ready.end(), c), ready.end());
+    delete c;
+    __sync_fetch_and_sub(&nconns, 1);
+  }
+
+  rc_t
+  exec(void *txn, const Json &req, Json &reply)
+  {
+    const int cmd = req[1].as_i();
+    reply = reply_to(req);
+    rc_t rc = {RC_TRUE};
+    switch (cmd) {
+    case Cmd_Handshake:
+      reply.push_back(true).push_back(worker_id).push_back("ermia");
+      break;
+    case Cmd_Get: {
+      // nothing longer was ever stored
+      varstr &v = *arena.next(MaxValueSize);
+      rc = tbl->get(txn, to_varstr(req[2]), v);
+      if (rc._val == RC_TRUE)
+        reply.push_back(Found).push_back(String(v.data(), v.size()));
+      else
+        reply.push_back(NotFound);
+      break;
+    }
+    case Cmd_Replace:
+      // inserts if the key is new
+      rc = tbl->insert(txn, to_varstr(req[2]), to_varstr(req[3]));
+      reply.push_back(Updated);
+      break;
+    case Cmd_Remove: {
+      // removing a key that isn't there aborts, so look first
+      const varstr k = to_varstr(req[2]);
+      rc = tbl->get(txn, k, *arena.next(MaxValueSize));
+      if (rc._val == RC_TRUE) {
+        rc = tbl->remove(txn, k);
+        reply.push_back(Found);
+      } else {
+        reply.push_back(NotFound);
+      }
+      break;
+    }
+    case Cmd_Scan: {
+      reply.push_back(ScanDone);
+      pairs_callback c(reply, req[3].as_i());
+      if (req[3].as_i())
+        rc = tbl->scan(txn, to_varstr(req[2]), nullptr, c, &arena);
+      break;
+    }
+    default:
+      // Begin, Commit and Abort where they don't belong
+      reply.push_back(false);
+    }
+    return rc;
+  }
+
+  // runs batch[begin, end) in one transaction and queues the replies.
+  // If it aborts, only the last try answers, with Retry
+  rc_t
+  run_batch(size_t begin, size_t end, bool last_try)
+  {
+    scoped_str_arena s_arena(arena);
+    void *txn = db->new_txn(txn_flags, arena, txn_buf());
+    replies.resize(end - begin);
+    rc_t rc = {RC_TRUE};
+    for (size_t i = begin; i < end and not rc_is_abort(rc); i++)
+      rc = exec(txn, batch[i].second, replies[i - begin]);
+    if (not rc_is_abort(rc))
+      rc = db->commit_txn(txn);
+    if (rc_is_abort(rc)) {
+      db->abort_txn(txn);
+      if (not last_try)
+        return rc;
+      for (size_t i = begin; i < end; i++)
+        replies[i - begin] = reply_to(batch[i].second).push_back(Retry);
+    }
+    for (size_t i = begin; i < end; i++)
+      batch[i].first->reply(replies[i - begin]);
+    return rc;
+  }
+
+  rc_t
+  serve_batch()
+  {
+    batch.clear();
+    for (size_t n = ready.size(); n and batch.size() < g_batch; n--) {
+      server_conn *c = ready.front();
+      ready.pop_front();
+      while (c->requests.size() and batch.size() < g_batch and
+             c->requests.front()[1].as_i() != Cmd_Begin)
+        batch.emplace_back(c, c->pop());
+      if (c->requests.size())
+        ready.push_back(c);
+    }
+
+    const rc_t rc = run_batch(0, batch.size(), batch.size() == 1);
+    if (rc_is_abort(rc) and batch.size() > 1) {
+      for (size_t i = 0; i < batch.size(); i++)
+        run_batch(i, i + 1, true);
+    }
+    volatile_write(nrequests, nrequests + batch.size());
+
+    // one write per connection
+    for (auto &b : batch) {
+      if (find(flushed.begin(), flushed.end(), b.first) == flushed.end())
+        flushed.push_back(b.first);
+    }
+    for (auto *c : flushed) {
+      if (not c->flush())
+        drop(c);
+    }
+    flushed.clear();
+    return rc;
+  }
+
+  // serves the connection at the front from Begin to Commit or Abort
+  rc_t
+  serve_txn()
+  {
+    server_conn *c = ready.front();
+    ready.pop_front();
+    Json req = c->pop();
+    c->reply(reply_to(req).push_back(true));
+    volatile_write(nrequests, nrequests + 1);
+
+    scoped_str_arena s_arena(arena);
+    void *txn = db->new_txn(txn_flags, arena, txn_buf());
+    rc_t rc = {RC_TRUE};
+    for (;;) {
+      if (c->requests.empty()) {
+        if (c->flush() and wait_for(c))
+          continue;
+        if (not rc_is_abort(rc))
+          db->abort_txn(txn);
+        delete c;
+        __sync_fetch_and_sub(&nconns, 1);
+        return rc_is_abort(rc) ? rc : rc_t{RC_ABORT_USER};
+      }
+
+      req = c->pop();
+      volatile_write(nrequests, nrequests + 1);
+      const int cmd = req[1].as_i();
+      Json reply;
+      if (cmd == Cmd_Commit) {
+        if (not rc_is_abort(rc)) {
+          rc = db->commit_txn(txn);
+          if (rc_is_abort(rc))
+            db->abort_txn(txn);
+        }
+        reply = reply_to(req).push_back(not rc_is_abort(rc));
+      } else if (cmd == Cmd_Abort) {
+        if (not rc_is_abort(rc)) {
+          db->abort_txn(txn);
+          rc = {RC_ABORT_USER};
+        }
+        reply = reply_to(req).push_back(true);
+      } else if (rc_is_abort(rc)) {
+        reply = reply_to(req).push_back(Retry);
+      } else {
+        const rc_t r = exec(txn, req, reply);
+        if (rc_is_abort(r)) {
+          db->abort_txn(txn);
+          rc = r;
+          reply = reply_to(req).push_back(Retry);
+        }
+      }
+      c->reply(reply);
+
+      if (cmd == Cmd_Commit or cmd == Cmd_Abort) {
+        if (not c->flush()) {
+          delete c;
+          __sync_fetch_and_sub(&nconns, 1);
+        } else if (c->requests.size()) {
+          ready.push_back(c);
+        }
+        return rc;
+      }
+    }
+  }
+
+  // appends up to [n] key/value pairs to [reply]
+  class pairs_callback : public abstract_ordered_index::scan_callback {
+  public:
+    pairs_callback(Json &reply, size_t n) : reply(reply), n(n) {}
+
+    virtual bool invoke(const char *keyp, size_t keylen,
+                        const varstr &value)
+    {
+      reply.push_back(String(keyp, keylen))
+           .push_back(String(value.data(), value.size()));
+      return --n > 0;
+    }
+
+  private:
+    Json &reply;
+    size_t n;
+  };
+
+  abstract_ordered_index *const tbl;
+  const int epfd;
+  size_t nconns;
+  size_t nrequests;
+
+  deque<server_conn *> ready; // connections with requests to serve
+  vector<pair<server_conn *, Json> > batch;
+  vector<Json> replies;
+  vector<server_conn *> flushed;
+};
+
+// hands out connections until [listen_fd] is shut down
+static void
+accept_loop(int listen_fd, vector<server_worker *> workers)
+{
+  for (size_t i = 0;; ) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINVAL)
+        return;
+      // out of fds (EMFILE and the like) until some clients go away
+      if (errno != EINTR and errno != ECONNABORTED)
+        usleep(10000);
+      continue;
+    }
+    // unix sockets just say no
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    workers[i++ % workers.size()]->add(new server_conn(fd));
+  }
+}
+
+class server_loader : public bench_loader {
+public:
+  server_loader(unsigned long seed,
+                abstract_db *db,
+                const map<string, abstract_ordered_index *> &open_tables)
+    : bench_loader(seed, db, open_tables)
+  {}
+
+protected:
+  void
+  load()
+  {
+    abstract_ordered_index *tbl = open_tables.at(TABLE);
+    const string value(g_value_size, 'a');
+    for (size_t i = 0; i < g_nkeys; i++) {
+      const string key = make_key(i);
+      void *txn = db->new_txn(0, arena, txn_buf(), abstract_db::HINT_DEFAULT);
+      arena.reset();
+      try_verify_strict(tbl->insert(txn, varstr(key.data(), key.size()),
+                                    varstr(value.data(), value.size())));
+      try_verify_strict(db->commit_txn(txn));
+    }
+    if (verbose)
+      cerr << "[INFO] loaded " << g_nkeys << " keys in " << TABLE << endl;
+  }
+};
+
+class server_bench_runner : public bench_runner {
+public:
+  server_bench_runner(abstract_db *db, int listen_fd)
+    : bench_runner(db), listen_fd(listen_fd)
+  {
+  }
+
+  virtual void prepare(char *)
+  {
+    open_tables[TABLE] = db->open_index(TABLE, g_value_size);
+  }
+
+protected:
+  virtual vector<bench_loader *>
+  make_loaders()
+  {
+    vector<bench_loader *> ret;
+    ret.push_back(new server_loader(0, db, open_tables));
+    return ret;
+  }
+
+  virtual vector<bench_worker *>
+  make_workers()
+  {
+    vector<server_worker *> servers;
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
+      servers.push_back(
+        new server_worker(
+          i, i, db, open_tables,
+          &barrier_a, &barrier_b));
+    acceptor = std::thread(accept_loop, listen_fd, servers);
+
+    metrics::add("ermia_server_connections", "Open client connections", "gauge",
+                 [servers] { uint64_t n = 0; for (auto *w : servers) n += w->get_nconns(); return n; });
+    metrics::add("ermia_server_requests_total", "Client requests served", "counter",
+                 [servers] { uint64_t n = 0; for (auto *w : servers) n += w->get_nrequests(); return n; });
+    return vector<bench_worker *>(servers.begin(), servers.end());
+  }
+
+  // the acceptor and the metrics use the workers, which go next
+  virtual void
+  on_run_end()
+  {
+    metrics::remove("ermia_server_connections");
+    metrics::remove("ermia_server_requests_total");
+    ALWAYS_ASSERT(shutdown(listen_fd, SHUT_RDWR) == 0);
+    acceptor.join();
+    close(listen_fd);
+  }
+
+private:
+  const int listen_fd;
+  std::thread acceptor;
+};
+
+void
+server_do_test(abstract_db *db, int argc, char **argv)
+{
+  // parse options
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"listen"                               , required_argument , 0 , 'l'} ,
+      {"keys"                                 , required_argument , 0 , 'k'} ,
+      {"value-size"                           , required_argument , 0 , 'v'} ,
+      {"batch"                                , required_argument , 0 , 'b'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "l:k:v:b:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'l':
+      g_listen = optarg;
+      break;
+
+    case 'k':
+      g_nkeys = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'v':
+      g_value_size = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_value_size > 0 and g_value_size <= MaxValueSize);
+      break;
+
+    case 'b':
+      g_batch = strtoul(optarg, NULL, 10);
+      ALWAYS_ASSERT(g_batch > 0);
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  if (verbose) {
+    cerr << "server settings:" << endl;
+    cerr << "  listen                       : " << g_listen << endl;
+    cerr << "  keys                         : " << g_nkeys << endl;
+    cerr << "  value size                   : " << g_value_size << endl;
+    cerr << "  batch                        : " << g_batch << endl;
+  }
+
+  // fail before loading if the address is no good
+  const int listen_fd = os_socket(g_listen, true);
+  cerr << "[Server] listening at " << g_listen << endl;
+
+  server_bench_runner r(db, listen_fd);
+  r.run();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "../masstree/kvproto.hh"
+
+/**
+ * Protocol of the transaction server (dbtest --bench server, see
+ * server.cc), which is masstree's (mtd, mtclient) plus explicit
+ * transactions. A request is a msgpack array [seq, command, args...]; each
+ * gets a reply [seq, command + 1, results...], in the order sent:
+ *
+ *   Handshake  [seq, 14, {...}]         [seq, 15, true, worker, "ermia"]
+ *   Get        [seq, 2, key]            [seq, 3, Found, value]
+ *                                       or [seq, 3, NotFound]
+ *   Replace    [seq, 8, key, value]     [seq, 9, Updated]
+ *   Remove     [seq, 10, key]           [seq, 11, Found or NotFound]
+ *   Scan       [seq, 4, key, n]         [seq, 5, ScanDone, key, value, ...]
+ *   Begin      [seq, 16]                [seq, 17, true]
+ *   Commit     [seq, 18]                [seq, 19, committed]
+ *   Abort      [seq, 20]                [seq, 21, true]
+ *
+ * Replace inserts the key if it is not there. Scan returns up to n pairs
+ * starting at key. Outside Begin/Commit every request is a transaction of
+ * its own, and Retry in place of the result means it aborted and did
+ * nothing. Between Begin and Commit, Retry means the transaction aborted:
+ * what follows gets Retry as well and Commit answers false. Anything else
+ * (unknown commands, bad arguments, values over MaxValueSize) closes the
+ * connection.
+ */
+namespace kvserver {
+
+enum {
+  Cmd_Begin = 16,
+  Cmd_Commit = 18,
+  Cmd_Abort = 20,
+};
+
+static const size_t MaxValueSize = 4096;
+
+// key of the server's preloaded row [i]
+inline std::string
+make_key(uint64_t i)
+{
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016lx", i);
+  return buf;
+}
+
+}  // namespace kvserver
@@ -0,0 +1,550 @@
+/**
+ * An implementation of SmallBank, after Cahill et al., "Serializable
+ * Isolation for Snapshot Databases" (SIGMOD 2008) and the H-Store
+ * version of it. WriteCheck reads both balances but writes only
+ * checking, so concurrent WriteChecks and TransactSavings on the same
+ * customer are a write skew under SI; a hotspot of customers makes it
+ * show up often enough to compare SI, SSI and SSN.
+ */
+
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <vector>
+
+#include "../txn.h"
+#include "../macros.h"
+
+#include "bench.h"
+#include "smallbank.h"
+using namespace std;
+using namespace util;
+
+#define SMALLBANK_TABLE_LIST(x) \
+  x(accounts) \
+  x(savings) \
+  x(checking)
+
+// { Amalgamate, Balance, DepositChecking,
+//   SendPayment, TransactSavings, WriteCheck }
+static unsigned g_txn_workload_mix[] = { 15, 15, 15, 25, 15, 15 };
+static uint64_t g_hotspot_size = 100;
+static unsigned g_hotspot_prob = 90;  // percent of accesses to the hotspot
+
+static const float MinBalance = 10000;
+static const float MaxBalance = 50000;
+
+static inline ALWAYS_INLINE uint64_t
+NumAccounts()
+{
+  return (uint64_t) (scale_factor * 100000);
+}
+
+class smallbank_worker_mixin {
+public:
+  smallbank_worker_mixin(const map<string, abstract_ordered_index *> &open_tables)
+  {
+#define INIT_TBL_X(name) \
+    tbl_ ## name = open_tables.at(#name);
+
+    SMALLBANK_TABLE_LIST(INIT_TBL_X)
+
+#undef INIT_TBL_X
+    ALWAYS_ASSERT(NumAccounts() >= 2);
+  }
+
+protected:
+
+#define DEFN_TBL_X(name) \
+  abstract_ordered_index *tbl_ ## name;
+
+  SMALLBANK_TABLE_LIST(DEFN_TBL_X)
+
+#undef DEFN_TBL_X
+
+public:
+
+  static inline ALWAYS_INLINE uint64_t
+  RandomNumber(fast_random &r, uint64_t min, uint64_t max)
+  {
+    return (uint64_t) (r.next_uniform() * (max - min + 1) + min);
+  }
+
+  // customers are 1..NumAccounts(); the first g_hotspot_size of them
+  // get g_hotspot_prob percent of the accesses. [other], if given, is
+  // never picked: the id comes from the rest of the same part, or from
+  // the other part when [other] is all there is to this one
+  static inline uint64_t
+  CustomerId(fast_random &r, uint64_t other = 0)
+  {
+    const uint64_t n = NumAccounts();
+    const uint64_t hot = std::min(g_hotspot_size, n);
+    uint64_t lo = hot + 1, hi = n;
+    if (hot == n or (hot and RandomNumber(r, 1, 100) <= g_hotspot_prob)) {
+      lo = 1;
+      hi = hot;
+    }
+    if (other < lo or other > hi)
+      return RandomNumber(r, lo, hi);
+    if (lo == hi)
+      return lo == 1 ? RandomNumber(r, 2, n) : RandomNumber(r, 1, n - 1);
+    const uint64_t id = RandomNumber(r, lo, hi - 1);
+    return id < other ? id : id + 1;
+  }
+
+  static inline void
+  CustomerIds(fast_random &r, uint64_t &custid0, uint64_t &custid1)
+  {
+    custid0 = CustomerId(r);
+    custid1 = CustomerId(r, custid0);
+  }
+};
+
+class smallbank_worker : public bench_worker, public smallbank_worker_mixin {
+public:
+  smallbank_worker(unsigned int worker_id,
+                   unsigned long seed, abstract_db *db,
+                   const map<string, abstract_ordered_index *> &open_tables,
+                   spin_barrier *barrier_a, spin_barrier *barrier_b)
+    : bench_worker(worker_id, seed, db,
+                   open_tables, barrier_a, barrier_b),
+      smallbank_worker_mixin(open_tables)
+  {
+  }
+
+  rc_t txn_amalgamate();
+
+  static rc_t
+  TxnAmalgamate(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_amalgamate();
+  }
+
+  rc_t txn_balance();
+
+  static rc_t
+  TxnBalance(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_balance();
+  }
+
+  rc_t txn_deposit_checking();
+
+  static rc_t
+  TxnDepositChecking(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_deposit_checking();
+  }
+
+  rc_t txn_send_payment();
+
+  static rc_t
+  TxnSendPayment(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_send_payment();
+  }
+
+  rc_t txn_transact_savings();
+
+  static rc_t
+  TxnTransactSavings(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_transact_savings();
+  }
+
+  rc_t txn_write_check();
+
+  static rc_t
+  TxnWriteCheck(bench_worker *w)
+  {
+    return static_cast<smallbank_worker *>(w)->txn_write_check();
+  }
+
+  virtual workload_desc_vec
+  get_workload() const
+  {
+    workload_desc_vec w;
+    unsigned m = 0;
+    for (size_t i = 0; i < ARRAY_NELEMS(g_txn_workload_mix); i++)
+      m += g_txn_workload_mix[i];
+    ALWAYS_ASSERT(m == 100);
+    if (g_txn_workload_mix[0])
+      w.push_back(workload_desc("Amalgamate", double(g_txn_workload_mix[0])/100.0, TxnAmalgamate));
+    if (g_txn_workload_mix[1])
+      w.push_back(workload_desc("Balance", double(g_txn_workload_mix[1])/100.0, TxnBalance));
+    if (g_txn_workload_mix[2])
+      w.push_back(workload_desc("DepositChecking", double(g_txn_workload_mix[2])/100.0, TxnDepositChecking));
+    if (g_txn_workload_mix[3])
+      w.push_back(workload_desc("SendPayment", double(g_txn_workload_mix[3])/100.0, TxnSendPayment));
+    if (g_txn_workload_mix[4])
+      w.push_back(workload_desc("TransactSavings", double(g_txn_workload_mix[4])/100.0, TxnTransactSavings));
+    if (g_txn_workload_mix[5])
+      w.push_back(workload_desc("WriteCheck", double(g_txn_workload_mix[5])/100.0, TxnWriteCheck));
+    return w;
+  }
+
+protected:
+
+  inline ALWAYS_INLINE varstr &
+  str(uint64_t size)
+  {
+    return *arena.next(size);
+  }
+
+private:
+  inline rc_t
+  get_account(void *txn, uint64_t custid)
+  {
+    const accounts::key k(custid);
+    accounts::value v_temp;
+    varstr sv = str(Size(v_temp));
+    return tbl_accounts->get(txn, Encode(str(Size(k)), k), sv);
+  }
+
+  inline rc_t
+  get_savings(void *txn, uint64_t custid, float &balance)
+  {
+    const savings::key k(custid);
+    savings::value v_temp;
+    varstr sv = str(Size(v_temp));
+    rc_t rc = tbl_savings->get(txn, Encode(str(Size(k)), k), sv);
+    if (rc._val == RC_TRUE)
+      balance = Decode(sv, v_temp)->s_balance;
+    return rc;
+  }
+
+  inline rc_t
+  put_savings(void *txn, uint64_t custid, float balance)
+  {
+    const savings::key k(custid);
+    const savings::value v(balance);
+    return tbl_savings->put(txn, Encode(str(Size(k)), k), Encode(str(Size(v)), v));
+  }
+
+  inline rc_t
+  get_checking(void *txn, uint64_t custid, float &balance)
+  {
+    const checking::key k(custid);
+    checking::value v_temp;
+    varstr sv = str(Size(v_temp));
+    rc_t rc = tbl_checking->get(txn, Encode(str(Size(k)), k), sv);
+    if (rc._val == RC_TRUE)
+      balance = Decode(sv, v_temp)->c_balance;
+    return rc;
+  }
+
+  inline rc_t
+  put_checking(void *txn, uint64_t custid, float balance)
+  {
+    const checking::key k(custid);
+    const checking::value v(balance);
+    return tbl_checking->put(txn, Encode(str(Size(k)), k), Encode(str(Size(v)), v));
+  }
+};
+
+rc_t
+smallbank_worker::txn_amalgamate()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  uint64_t custid0, custid1;
+  CustomerIds(r, custid0, custid1);
+  try_catch_cond_abort(get_account(txn, custid0));
+  try_catch_cond_abort(get_account(txn, custid1));
+
+  // move everything custid0 has into custid1's checking
+  float savings0 = 0, checking0 = 0, checking1 = 0;
+  try_verify_relax(get_savings(txn, custid0, savings0));
+  try_verify_relax(get_checking(txn, custid0, checking0));
+  try_verify_relax(get_checking(txn, custid1, checking1));
+  try_catch(put_savings(txn, custid0, 0));
+  try_catch(put_checking(txn, custid0, 0));
+  try_catch(put_checking(txn, custid1, checking1 + savings0 + checking0));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+smallbank_worker::txn_balance()
+{
+  const uint64_t read_only_mask =
+    sysconf::enable_safesnap ? transaction::TXN_FLAG_READ_ONLY : 0;
+  void *txn = db->new_txn(txn_flags | read_only_mask, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  const uint64_t custid = CustomerId(r);
+  try_catch_cond_abort(get_account(txn, custid));
+
+  float savings = 0, checking = 0;
+  try_verify_relax(get_savings(txn, custid, savings));
+  try_verify_relax(get_checking(txn, custid, checking));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+smallbank_worker::txn_deposit_checking()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  const uint64_t custid = CustomerId(r);
+  const float amount = 1.3;
+  try_catch_cond_abort(get_account(txn, custid));
+
+  float checking = 0;
+  try_verify_relax(get_checking(txn, custid, checking));
+  try_catch(put_checking(txn, custid, checking + amount));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+smallbank_worker::txn_send_payment()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  uint64_t custid0, custid1;
+  CustomerIds(r, custid0, custid1);
+  const float amount = 5.0;
+  try_catch_cond_abort(get_account(txn, custid0));
+  try_catch_cond_abort(get_account(txn, custid1));
+
+  float checking0 = 0, checking1 = 0;
+  try_verify_relax(get_checking(txn, custid0, checking0));
+  try_verify_relax(get_checking(txn, custid1, checking1));
+  // insufficient funds
+  if (checking0 < amount)
+    __abort_txn(rc_t{RC_FALSE});
+
+  try_catch(put_checking(txn, custid0, checking0 - amount));
+  try_catch(put_checking(txn, custid1, checking1 + amount));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+smallbank_worker::txn_transact_savings()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  const uint64_t custid = CustomerId(r);
+  const float amount = 20.20;
+  try_catch_cond_abort(get_account(txn, custid));
+
+  float savings = 0;
+  try_verify_relax(get_savings(txn, custid, savings));
+  // a deposit, as in Cahill's version; Amalgamate drains hotspot savings
+  // quickly enough that withdrawals would mostly abort
+  try_catch(put_savings(txn, custid, savings + amount));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+smallbank_worker::txn_write_check()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  const uint64_t custid = CustomerId(r);
+  const float amount = 5.0;
+  try_catch_cond_abort(get_account(txn, custid));
+
+  // reads savings but writes only checking: the write skew
+  float savings = 0, checking = 0;
+  try_verify_relax(get_savings(txn, custid, savings));
+  try_verify_relax(get_checking(txn, custid, checking));
+  // overdrafts cost a penalty of 1
+  const float debit = savings + checking < amount ? amount + 1 : amount;
+  try_catch(put_checking(txn, custid, checking - debit));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+// Loads customers [start, end), a batch of them per transaction.
+class smallbank_account_loader : public bench_loader, public smallbank_worker_mixin {
+public:
+  smallbank_account_loader(unsigned long seed,
+                           abstract_db *db,
+                           const map<string, abstract_ordered_index *> &open_tables,
+                           uint64_t start, uint64_t end)
+    : bench_loader(seed, db, open_tables),
+      smallbank_worker_mixin(open_tables),
+      start(start), end(end)
+  {
+    ALWAYS_ASSERT(start >= 1 and start < end and end <= NumAccounts() + 1);
+  }
+
+protected:
+  virtual void
+  load()
+  {
+    static const uint64_t BatchSize = 1000;
+    for (uint64_t batch = start; batch < end; batch += BatchSize) {
+      void *txn = db->new_txn(txn_flags, arena, txn_buf());
+      for (uint64_t custid = batch; custid < std::min(batch + BatchSize, end); custid++) {
+        const accounts::key k_a(custid);
+        accounts::value v_a;
+        const string name = "customer" + to_string(custid);
+        v_a.a_name.assign(name);
+        try_verify_strict(tbl_accounts->insert(txn, Encode(str(Size(k_a)), k_a), Encode(str(Size(v_a)), v_a)));
+
+        const savings::key k_s(custid);
+        const savings::value v_s(RandomBalance());
+        try_verify_strict(tbl_savings->insert(txn, Encode(str(Size(k_s)), k_s), Encode(str(Size(v_s)), v_s)));
+
+        const checking::key k_c(custid);
+        const checking::value v_c(RandomBalance());
+        try_verify_strict(tbl_checking->insert(txn, Encode(str(Size(k_c)), k_c), Encode(str(Size(v_c)), v_c)));
+      }
+      try_verify_strict(db->commit_txn(txn));
+      arena.reset();
+    }
+
+    if (verbose)
+      cerr << "[INFO] finished loading customers " << start << " to " << end - 1 << endl;
+  }
+
+private:
+  inline float
+  RandomBalance()
+  {
+    return MinBalance + r.next_uniform() * (MaxBalance - MinBalance);
+  }
+
+  const uint64_t start;
+  const uint64_t end;
+};
+
+class smallbank_bench_runner : public bench_runner {
+public:
+  smallbank_bench_runner(abstract_db *db)
+    : bench_runner(db)
+  {
+  }
+
+  virtual void prepare(char *)
+  {
+#define OPEN_TABLE_X(x) \
+    open_tables[#x] = db->open_index(#x, sizeof(x));
+
+    SMALLBANK_TABLE_LIST(OPEN_TABLE_X);
+
+#undef OPEN_TABLE_X
+  }
+
+protected:
+  virtual vector<bench_loader *>
+  make_loaders()
+  {
+    vector<bench_loader *> ret;
+    const uint64_t n = NumAccounts();
+    const uint64_t nloaders =
+      enable_parallel_loading ? std::min<uint64_t>(sysconf::worker_threads, n) : 1;
+    fast_random r(9324);
+    for (uint64_t i = 0; i < nloaders; i++) {
+      const uint64_t start = i * n / nloaders + 1;
+      const uint64_t end = (i + 1) * n / nloaders + 1;
+      ret.push_back(new smallbank_account_loader(r.next(), db, open_tables, start, end));
+    }
+    return ret;
+  }
+
+  virtual vector<bench_worker *>
+  make_workers()
+  {
+    fast_random r(23984543);
+    vector<bench_worker *> ret;
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
+      ret.push_back(new smallbank_worker(i, r.next(), db, open_tables,
+                                         &barrier_a, &barrier_b));
+    return ret;
+  }
+};
+
+void
+smallbank_do_test(abstract_db *db, int argc, char **argv)
+{
+  // parse options
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"workload-mix"                         , required_argument , 0 , 'w'} ,
+      {"hotspot-size"                         , required_argument , 0 , 's'} ,
+      {"hotspot-prob"                         , required_argument , 0 , 'p'} ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "w:s:p:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'w':
+      {
+        const vector<string> toks = split(optarg, ',');
+        ALWAYS_ASSERT(toks.size() == ARRAY_NELEMS(g_txn_workload_mix));
+        unsigned s = 0;
+        for (size_t i = 0; i < toks.size(); i++) {
+          unsigned p = strtoul(toks[i].c_str(), nullptr, 10);
+          ALWAYS_ASSERT(p >= 0 && p <= 100);
+          s += p;
+          g_txn_workload_mix[i] = p;
+        }
+        ALWAYS_ASSERT(s == 100);
+      }
+      break;
+
+    case 's':
+      g_hotspot_size = strtoull(optarg, nullptr, 10);
+      break;
+
+    case 'p':
+      g_hotspot_prob = strtoul(optarg, nullptr, 10);
+      ALWAYS_ASSERT(g_hotspot_prob <= 100);
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  // the two-customer transactions need two distinct accounts to pick from
+  ALWAYS_ASSERT(NumAccounts() >= 2);
+  ALWAYS_ASSERT(not (g_hotspot_size == 1 and g_hotspot_prob == 100));
+
+  if (verbose) {
+    cerr << "smallbank settings:" << endl;
+    cerr << "  accounts                     : " << NumAccounts() << endl;
+    cerr << "  hotspot_size                 : " << g_hotspot_size << endl;
+    cerr << "  hotspot_prob                 : " << g_hotspot_prob << "%" << endl;
+    cerr << "  workload_mix                 : " <<
+      format_list(g_txn_workload_mix,
+                  g_txn_workload_mix + ARRAY_NELEMS(g_txn_workload_mix)) << endl;
+  }
+
+  smallbank_bench_runner r(db);
+  r.run();
+}
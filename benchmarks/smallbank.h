@@ -0,0 +1,26 @@
+#ifndef _NDB_BENCH_SMALLBANK_H_
+#define _NDB_BENCH_SMALLBANK_H_
+
+#include "../record/encoder.h"
+#include "../record/inline_str.h"
+#include "../macros.h"
+
+#define ACCOUNTS_KEY_FIELDS(x, y) \
+  x(uint64_t,a_custid)
+#define ACCOUNTS_VALUE_FIELDS(x, y) \
+  x(inline_str_fixed<64>,a_name)
+DO_STRUCT(accounts, ACCOUNTS_KEY_FIELDS, ACCOUNTS_VALUE_FIELDS)
+
+#define SAVINGS_KEY_FIELDS(x, y) \
+  x(uint64_t,s_custid)
+#define SAVINGS_VALUE_FIELDS(x, y) \
+  x(float,s_balance)
+DO_STRUCT(savings, SAVINGS_KEY_FIELDS, SAVINGS_VALUE_FIELDS)
+
+#define CHECKING_KEY_FIELDS(x, y) \
+  x(uint64_t,c_custid)
+#define CHECKING_VALUE_FIELDS(x, y) \
+  x(float,c_balance)
+DO_STRUCT(checking, CHECKING_KEY_FIELDS, CHECKING_VALUE_FIELDS)
+
+#endif
@@ -0,0 +1,649 @@
+/**
+ * An implementation of TATP (Telecom Application Transaction Processing)
+ * based off of the v1.0 description:
+ * http://tatpbenchmark.sourceforge.net/TATP_Description.pdf
+ */
+
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <vector>
+
+#include "../txn.h"
+#include "../macros.h"
+
+#include "bench.h"
+#include "tatp.h"
+using namespace std;
+using namespace util;
+
+#define TATP_TABLE_LIST(x) \
+  x(subscriber) \
+  x(subscriber_nbr_idx) \
+  x(access_info) \
+  x(special_facility) \
+  x(call_forwarding)
+
+// { GetSubscriberData, GetNewDestination, GetAccessData,
+//   UpdateSubscriberData, UpdateLocation,
+//   InsertCallForwarding, DeleteCallForwarding }
+static unsigned g_txn_workload_mix[] = { 35, 10, 35, 2, 14, 2, 2 };
+static int g_uniform_subscriber_dist = 0;
+
+static inline ALWAYS_INLINE uint32_t
+NumSubscribers()
+{
+  return (uint32_t) (scale_factor * 100000);
+}
+
+class tatp_worker_mixin {
+public:
+  tatp_worker_mixin(const map<string, abstract_ordered_index *> &open_tables)
+  {
+#define INIT_TBL_X(name) \
+    tbl_ ## name = open_tables.at(#name);
+
+    TATP_TABLE_LIST(INIT_TBL_X)
+
+#undef INIT_TBL_X
+    ALWAYS_ASSERT(NumSubscribers() >= 1);
+  }
+
+protected:
+
+#define DEFN_TBL_X(name) \
+  abstract_ordered_index *tbl_ ## name;
+
+  TATP_TABLE_LIST(DEFN_TBL_X)
+
+#undef DEFN_TBL_X
+
+public:
+
+  static inline ALWAYS_INLINE int
+  RandomNumber(fast_random &r, int min, int max)
+  {
+    return (int) (r.next_uniform() * (max - min + 1) + min);
+  }
+
+  // the spec's non-uniform subscriber id, skewed like TPC-C's NURand
+  static inline ALWAYS_INLINE int32_t
+  SubscriberId(fast_random &r)
+  {
+    const uint32_t n = NumSubscribers();
+    if (g_uniform_subscriber_dist)
+      return RandomNumber(r, 1, n);
+    const int a = n <= 1000000 ? 65535 : n <= 10000000 ? 1048575 : 2097151;
+    return ((RandomNumber(r, 0, a) | RandomNumber(r, 1, n)) % n) + 1;
+  }
+
+  // sub_nbr is s_id as a 15-digit, zero-padded string
+  static inline void
+  SubscriberNumber(int32_t s_id, inline_str_fixed<15> &sub_nbr)
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%015d", s_id);
+    sub_nbr.assign(buf, 15);
+  }
+
+  static inline void
+  RandomDigits(fast_random &r, char *buf, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+      buf[i] = '0' + RandomNumber(r, 0, 9);
+  }
+
+  static inline void
+  RandomUpper(fast_random &r, char *buf, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+      buf[i] = 'A' + RandomNumber(r, 0, 25);
+  }
+};
+
+class tatp_worker : public bench_worker, public tatp_worker_mixin {
+public:
+  tatp_worker(unsigned int worker_id,
+              unsigned long seed, abstract_db *db,
+              const map<string, abstract_ordered_index *> &open_tables,
+              spin_barrier *barrier_a, spin_barrier *barrier_b)
+    : bench_worker(worker_id, seed, db,
+                   open_tables, barrier_a, barrier_b),
+      tatp_worker_mixin(open_tables)
+  {
+  }
+
+  rc_t txn_get_subscriber_data();
+
+  static rc_t
+  TxnGetSubscriberData(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_get_subscriber_data();
+  }
+
+  rc_t txn_get_new_destination();
+
+  static rc_t
+  TxnGetNewDestination(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_get_new_destination();
+  }
+
+  rc_t txn_get_access_data();
+
+  static rc_t
+  TxnGetAccessData(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_get_access_data();
+  }
+
+  rc_t txn_update_subscriber_data();
+
+  static rc_t
+  TxnUpdateSubscriberData(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_update_subscriber_data();
+  }
+
+  rc_t txn_update_location();
+
+  static rc_t
+  TxnUpdateLocation(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_update_location();
+  }
+
+  rc_t txn_insert_call_forwarding();
+
+  static rc_t
+  TxnInsertCallForwarding(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_insert_call_forwarding();
+  }
+
+  rc_t txn_delete_call_forwarding();
+
+  static rc_t
+  TxnDeleteCallForwarding(bench_worker *w)
+  {
+    return static_cast<tatp_worker *>(w)->txn_delete_call_forwarding();
+  }
+
+  virtual workload_desc_vec
+  get_workload() const
+  {
+    workload_desc_vec w;
+    unsigned m = 0;
+    for (size_t i = 0; i < ARRAY_NELEMS(g_txn_workload_mix); i++)
+      m += g_txn_workload_mix[i];
+    ALWAYS_ASSERT(m == 100);
+    if (g_txn_workload_mix[0])
+      w.push_back(workload_desc("GetSubscriberData", double(g_txn_workload_mix[0])/100.0, TxnGetSubscriberData));
+    if (g_txn_workload_mix[1])
+      w.push_back(workload_desc("GetNewDestination", double(g_txn_workload_mix[1])/100.0, TxnGetNewDestination));
+    if (g_txn_workload_mix[2])
+      w.push_back(workload_desc("GetAccessData", double(g_txn_workload_mix[2])/100.0, TxnGetAccessData));
+    if (g_txn_workload_mix[3])
+      w.push_back(workload_desc("UpdateSubscriberData", double(g_txn_workload_mix[3])/100.0, TxnUpdateSubscriberData));
+    if (g_txn_workload_mix[4])
+      w.push_back(workload_desc("UpdateLocation", double(g_txn_workload_mix[4])/100.0, TxnUpdateLocation));
+    if (g_txn_workload_mix[5])
+      w.push_back(workload_desc("InsertCallForwarding", double(g_txn_workload_mix[5])/100.0, TxnInsertCallForwarding));
+    if (g_txn_workload_mix[6])
+      w.push_back(workload_desc("DeleteCallForwarding", double(g_txn_workload_mix[6])/100.0, TxnDeleteCallForwarding));
+    return w;
+  }
+
+protected:
+
+  inline ALWAYS_INLINE varstr &
+  str(uint64_t size)
+  {
+    return *arena.next(size);
+  }
+
+private:
+  // the three lookups are read-only, so let them use safe snapshots
+  inline void *
+  new_read_only_txn()
+  {
+    const uint64_t read_only_mask =
+      sysconf::enable_safesnap ? transaction::TXN_FLAG_READ_ONLY : 0;
+    return db->new_txn(txn_flags | read_only_mask, arena, txn_buf());
+  }
+
+  // sub_nbr => s_id through the secondary index
+  rc_t lookup_subscriber_number(void *txn, int32_t &s_id);
+};
+
+rc_t
+tatp_worker::lookup_subscriber_number(void *txn, int32_t &s_id)
+{
+  subscriber_nbr_idx::key k_idx;
+  SubscriberNumber(SubscriberId(r), k_idx.sub_nbr);
+  subscriber_nbr_idx::value v_idx_temp;
+  varstr sv_idx = str(Size(v_idx_temp));
+  rc_t rc = tbl_subscriber_nbr_idx->get(txn, Encode(str(Size(k_idx)), k_idx), sv_idx);
+  if (rc._val == RC_TRUE)
+    s_id = Decode(sv_idx, v_idx_temp)->s_id;
+  return rc;
+}
+
+rc_t
+tatp_worker::txn_get_subscriber_data()
+{
+  void *txn = new_read_only_txn();
+  scoped_str_arena s_arena(arena);
+
+  const subscriber::key k(SubscriberId(r));
+  subscriber::value v_temp;
+  varstr sv = str(Size(v_temp));
+  try_verify_relax(tbl_subscriber->get(txn, Encode(str(Size(k)), k), sv));
+  const subscriber::value *v = Decode(sv, v_temp);
+  ALWAYS_ASSERT(v->sub_nbr.size() == 15);
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_get_new_destination()
+{
+  void *txn = new_read_only_txn();
+  scoped_str_arena s_arena(arena);
+
+  const int32_t s_id = SubscriberId(r);
+  const uint8_t sf_type = RandomNumber(r, 1, 4);
+  const uint8_t start_time = RandomNumber(r, 0, 2) * 8;
+  const uint8_t end_time = RandomNumber(r, 1, 24);
+
+  const special_facility::key k_sf(s_id, sf_type);
+  special_facility::value v_sf_temp;
+  varstr sv_sf = str(Size(v_sf_temp));
+  rc_t rc = tbl_special_facility->get(txn, Encode(str(Size(k_sf)), k_sf), sv_sf);
+  try_catch(rc);
+  if (rc._val == RC_TRUE and Decode(sv_sf, v_sf_temp)->is_active) {
+    // call forwardings that start by start_time, i.e. [0, start_time]
+    const call_forwarding::key k_cf_0(s_id, sf_type, 0);
+    const call_forwarding::key k_cf_1(s_id, sf_type, start_time + 1);
+    static_limit_callback<3> c(s_arena.get(), true);
+    try_catch(tbl_call_forwarding->scan(txn, Encode(str(Size(k_cf_0)), k_cf_0), &Encode(str(Size(k_cf_1)), k_cf_1), c, s_arena.get()));
+    uint found = 0;
+    for (size_t i = 0; i < c.size(); i++) {
+      call_forwarding::value v_cf_temp;
+      if (end_time < Decode(*c.values[i].second, v_cf_temp)->end_time)
+        found++;
+    }
+    (void)found;  // numberx of each would go back to the caller
+  }
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_get_access_data()
+{
+  void *txn = new_read_only_txn();
+  scoped_str_arena s_arena(arena);
+
+  const access_info::key k(SubscriberId(r), RandomNumber(r, 1, 4));
+  access_info::value v_temp;
+  varstr sv = str(Size(v_temp));
+  // a missing ai_type is a valid (empty) result
+  try_catch(tbl_access_info->get(txn, Encode(str(Size(k)), k), sv));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_update_subscriber_data()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  const int32_t s_id = SubscriberId(r);
+  const uint8_t sf_type = RandomNumber(r, 1, 4);
+  const uint16_t bit_1 = RandomNumber(r, 0, 1);
+  const uint8_t data_a = RandomNumber(r, 0, 255);
+
+  const subscriber::key k_s(s_id);
+  subscriber::value v_s_temp;
+  varstr sv_s = str(Size(v_s_temp));
+  try_verify_relax(tbl_subscriber->get(txn, Encode(str(Size(k_s)), k_s), sv_s));
+  subscriber::value v_s_new(*Decode(sv_s, v_s_temp));
+  v_s_new.s_bits = (v_s_new.s_bits & ~1) | bit_1;
+  try_catch(tbl_subscriber->put(txn, Encode(str(Size(k_s)), k_s), Encode(str(Size(v_s_new)), v_s_new)));
+
+  // the spec rolls back when the subscriber lacks this facility
+  const special_facility::key k_sf(s_id, sf_type);
+  special_facility::value v_sf_temp;
+  varstr sv_sf = str(Size(v_sf_temp));
+  try_catch_cond_abort(tbl_special_facility->get(txn, Encode(str(Size(k_sf)), k_sf), sv_sf));
+  special_facility::value v_sf_new(*Decode(sv_sf, v_sf_temp));
+  v_sf_new.data_a = data_a;
+  try_catch(tbl_special_facility->put(txn, Encode(str(Size(k_sf)), k_sf), Encode(str(Size(v_sf_new)), v_sf_new)));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_update_location()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  int32_t s_id = 0;
+  try_verify_relax(lookup_subscriber_number(txn, s_id));
+
+  const subscriber::key k_s(s_id);
+  subscriber::value v_s_temp;
+  varstr sv_s = str(Size(v_s_temp));
+  try_verify_relax(tbl_subscriber->get(txn, Encode(str(Size(k_s)), k_s), sv_s));
+  subscriber::value v_s_new(*Decode(sv_s, v_s_temp));
+  v_s_new.vlr_location = r.next_u32();
+  try_catch(tbl_subscriber->put(txn, Encode(str(Size(k_s)), k_s), Encode(str(Size(v_s_new)), v_s_new)));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_insert_call_forwarding()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  int32_t s_id = 0;
+  try_verify_relax(lookup_subscriber_number(txn, s_id));
+
+  const uint8_t sf_type = RandomNumber(r, 1, 4);
+  const uint8_t start_time = RandomNumber(r, 0, 2) * 8;
+  const uint8_t end_time = RandomNumber(r, 1, 24);
+
+  // the spec reads the subscriber's facility types first
+  const special_facility::key k_sf_0(s_id, 0);
+  const special_facility::key k_sf_1(s_id + 1, 0);
+  static_limit_callback<4> c(s_arena.get(), false);
+  try_catch(tbl_special_facility->scan(txn, Encode(str(Size(k_sf_0)), k_sf_0), &Encode(str(Size(k_sf_1)), k_sf_1), c, s_arena.get()));
+
+  // a call forwarding needs one of them: the spec's expected foreign key
+  // violation otherwise, which rolls back
+  bool has_sf_type = false;
+  for (size_t i = 0; i < c.size(); i++) {
+    special_facility::key k_sf_temp;
+    if (Decode(*c.values[i].first, k_sf_temp)->sf_type == sf_type)
+      has_sf_type = true;
+  }
+  if (not has_sf_type)
+    __abort_txn(rc_t{RC_ABORT_USER});
+
+  // inserting over an existing call forwarding is the spec's expected
+  // primary key violation, which rolls back
+  const call_forwarding::key k_cf(s_id, sf_type, start_time);
+  call_forwarding::value v_cf;
+  varstr sv_cf = str(Size(v_cf));
+  rc_t rc = tbl_call_forwarding->get(txn, Encode(str(Size(k_cf)), k_cf), sv_cf);
+  try_catch(rc);
+  if (rc._val == RC_TRUE)
+    __abort_txn(rc);
+
+  v_cf.end_time = end_time;
+  char numberx[15];
+  RandomDigits(r, numberx, sizeof(numberx));
+  v_cf.numberx.assign(numberx, sizeof(numberx));
+  try_catch(tbl_call_forwarding->insert(txn, Encode(str(Size(k_cf)), k_cf), Encode(str(Size(v_cf)), v_cf)));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+rc_t
+tatp_worker::txn_delete_call_forwarding()
+{
+  void *txn = db->new_txn(txn_flags, arena, txn_buf());
+  scoped_str_arena s_arena(arena);
+
+  int32_t s_id = 0;
+  try_verify_relax(lookup_subscriber_number(txn, s_id));
+
+  const uint8_t sf_type = RandomNumber(r, 1, 4);
+  const uint8_t start_time = RandomNumber(r, 0, 2) * 8;
+
+  // deleting a call forwarding that isn't there rolls back
+  const call_forwarding::key k_cf(s_id, sf_type, start_time);
+  call_forwarding::value v_cf_temp;
+  varstr sv_cf = str(Size(v_cf_temp));
+  try_catch_cond_abort(tbl_call_forwarding->get(txn, Encode(str(Size(k_cf)), k_cf), sv_cf));
+  try_catch(tbl_call_forwarding->remove(txn, Encode(str(Size(k_cf)), k_cf)));
+
+  try_catch(db->commit_txn(txn));
+  return {RC_TRUE};
+}
+
+// Loads subscribers [start, end) with their access info, special facilities
+// and call forwardings, one subscriber per transaction.
+class tatp_subscriber_loader : public bench_loader, public tatp_worker_mixin {
+public:
+  tatp_subscriber_loader(unsigned long seed,
+                         abstract_db *db,
+                         const map<string, abstract_ordered_index *> &open_tables,
+                         int32_t start, int32_t end)
+    : bench_loader(seed, db, open_tables),
+      tatp_worker_mixin(open_tables),
+      start(start), end(end)
+  {
+    ALWAYS_ASSERT(start >= 1 and start < end and end <= (int32_t)NumSubscribers() + 1);
+  }
+
+protected:
+  virtual void
+  load()
+  {
+    uint64_t n_access_info = 0, n_special_facility = 0, n_call_forwarding = 0;
+    for (int32_t s_id = start; s_id < end; s_id++) {
+      void *txn = db->new_txn(txn_flags, arena, txn_buf());
+
+      const subscriber::key k_s(s_id);
+      subscriber::value v_s;
+      SubscriberNumber(s_id, v_s.sub_nbr);
+      v_s.s_bits = RandomNumber(r, 0, (1 << 10) - 1);
+      v_s.s_hexes = 0;
+      for (uint i = 0; i < 10; i++)
+        v_s.s_hexes = (v_s.s_hexes << 4) | RandomNumber(r, 0, 15);
+      char byte2[10];
+      for (uint i = 0; i < sizeof(byte2); i++)
+        byte2[i] = RandomNumber(r, 0, 255);
+      v_s.s_byte2.assign(byte2, sizeof(byte2));
+      v_s.msc_location = r.next_u32();
+      v_s.vlr_location = r.next_u32();
+      try_verify_strict(tbl_subscriber->insert(txn, Encode(str(Size(k_s)), k_s), Encode(str(Size(v_s)), v_s)));
+
+      const subscriber_nbr_idx::key k_idx(v_s.sub_nbr);
+      const subscriber_nbr_idx::value v_idx(s_id);
+      try_verify_strict(tbl_subscriber_nbr_idx->insert(txn, Encode(str(Size(k_idx)), k_idx), Encode(str(Size(v_idx)), v_idx)));
+
+      // 1-4 access infos and special facilities, each of a distinct type
+      for (uint8_t ai_type : pick_types()) {
+        const access_info::key k_ai(s_id, ai_type);
+        access_info::value v_ai;
+        v_ai.data1 = RandomNumber(r, 0, 255);
+        v_ai.data2 = RandomNumber(r, 0, 255);
+        char data3[3], data4[5];
+        RandomUpper(r, data3, sizeof(data3));
+        RandomUpper(r, data4, sizeof(data4));
+        v_ai.data3.assign(data3, sizeof(data3));
+        v_ai.data4.assign(data4, sizeof(data4));
+        try_verify_strict(tbl_access_info->insert(txn, Encode(str(Size(k_ai)), k_ai), Encode(str(Size(v_ai)), v_ai)));
+        n_access_info++;
+      }
+
+      for (uint8_t sf_type : pick_types()) {
+        const special_facility::key k_sf(s_id, sf_type);
+        special_facility::value v_sf;
+        v_sf.is_active = RandomNumber(r, 1, 100) <= 85;
+        v_sf.error_cntrl = RandomNumber(r, 0, 255);
+        v_sf.data_a = RandomNumber(r, 0, 255);
+        char data_b[5];
+        RandomUpper(r, data_b, sizeof(data_b));
+        v_sf.data_b.assign(data_b, sizeof(data_b));
+        try_verify_strict(tbl_special_facility->insert(txn, Encode(str(Size(k_sf)), k_sf), Encode(str(Size(v_sf)), v_sf)));
+        n_special_facility++;
+
+        // 0-3 call forwardings starting at distinct times of 0, 8 and 16
+        bool used[3] = { false, false, false };
+        const uint n_cf = RandomNumber(r, 0, 3);
+        for (uint i = 0; i < n_cf; i++) {
+          uint slot;
+          do {
+            slot = RandomNumber(r, 0, 2);
+          } while (used[slot]);
+          used[slot] = true;
+
+          const call_forwarding::key k_cf(s_id, sf_type, slot * 8);
+          call_forwarding::value v_cf;
+          v_cf.end_time = slot * 8 + RandomNumber(r, 1, 8);
+          char numberx[15];
+          RandomDigits(r, numberx, sizeof(numberx));
+          v_cf.numberx.assign(numberx, sizeof(numberx));
+          try_verify_strict(tbl_call_forwarding->insert(txn, Encode(str(Size(k_cf)), k_cf), Encode(str(Size(v_cf)), v_cf)));
+          n_call_forwarding++;
+        }
+      }
+
+      try_verify_strict(db->commit_txn(txn));
+      arena.reset();
+    }
+
+    if (verbose) {
+      cerr << "[INFO] finished loading subscribers " << start << " to " << end - 1 << ": "
+           << n_access_info << " access infos, " << n_special_facility << " special facilities, "
+           << n_call_forwarding << " call forwardings" << endl;
+    }
+  }
+
+private:
+  // 1-4 distinct types out of 1..4
+  vector<uint8_t>
+  pick_types()
+  {
+    vector<uint8_t> types = { 1, 2, 3, 4 };
+    for (uint i = types.size() - 1; i > 0; i--)
+      swap(types[i], types[RandomNumber(r, 0, i)]);
+    types.resize(RandomNumber(r, 1, 4));
+    return types;
+  }
+
+  const int32_t start;
+  const int32_t end;
+};
+
+class tatp_bench_runner : public bench_runner {
+public:
+  tatp_bench_runner(abstract_db *db)
+    : bench_runner(db)
+  {
+  }
+
+  virtual void prepare(char *)
+  {
+#define OPEN_TABLE_X(x) \
+    open_tables[#x] = db->open_index(#x, sizeof(x));
+
+    TATP_TABLE_LIST(OPEN_TABLE_X);
+
+#undef OPEN_TABLE_X
+  }
+
+protected:
+  virtual vector<bench_loader *>
+  make_loaders()
+  {
+    vector<bench_loader *> ret;
+    const uint32_t n = NumSubscribers();
+    const uint32_t nloaders =
+      enable_parallel_loading ? std::min<uint32_t>(sysconf::worker_threads, n) : 1;
+    fast_random r(9324);
+    for (uint32_t i = 0; i < nloaders; i++) {
+      const int32_t start = (uint64_t)i * n / nloaders + 1;
+      const int32_t end = (uint64_t)(i + 1) * n / nloaders + 1;
+      ret.push_back(new tatp_subscriber_loader(r.next(), db, open_tables, start, end));
+    }
+    return ret;
+  }
+
+  virtual vector<bench_worker *>
+  make_workers()
+  {
+    fast_random r(23984543);
+    vector<bench_worker *> ret;
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
+      ret.push_back(new tatp_worker(i, r.next(), db, open_tables,
+                                    &barrier_a, &barrier_b));
+    return ret;
+  }
+};
+
+void
+tatp_do_test(abstract_db *db, int argc, char **argv)
+{
+  // parse options
+  optind = 1;
+  while (1) {
+    static struct option long_options[] =
+    {
+      {"workload-mix"                         , required_argument , 0                                     , 'w'} ,
+      {"uniform-subscriber-dist"              , no_argument       , &g_uniform_subscriber_dist            , 1}   ,
+      {0, 0, 0, 0}
+    };
+    int option_index = 0;
+    int c = getopt_long(argc, argv, "w:", long_options, &option_index);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+      abort();
+      break;
+
+    case 'w':
+      {
+        const vector<string> toks = split(optarg, ',');
+        ALWAYS_ASSERT(toks.size() == ARRAY_NELEMS(g_txn_workload_mix));
+        unsigned s = 0;
+        for (size_t i = 0; i < toks.size(); i++) {
+          unsigned p = strtoul(toks[i].c_str(), nullptr, 10);
+          ALWAYS_ASSERT(p >= 0 && p <= 100);
+          s += p;
+          g_txn_workload_mix[i] = p;
+        }
+        ALWAYS_ASSERT(s == 100);
+      }
+      break;
+
+    case '?':
+      /* getopt_long already printed an error message. */
+      exit(1);
+
+    default:
+      abort();
+    }
+  }
+
+  if (verbose) {
+    cerr << "tatp settings:" << endl;
+    cerr << "  subscribers                  : " << NumSubscribers() << endl;
+    cerr << "  uniform_subscriber_dist      : " << g_uniform_subscriber_dist << endl;
+    cerr << "  workload_mix                 : " <<
+      format_list(g_txn_workload_mix,
+                  g_txn_workload_mix + ARRAY_NELEMS(g_txn_workload_mix)) << endl;
+  }
+
+  tatp_bench_runner r(db);
+  r.run();
+}
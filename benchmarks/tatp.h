@@ -0,0 +1,56 @@
+#ifndef _NDB_BENCH_TATP_H_
+#define _NDB_BENCH_TATP_H_
+
+#include "../record/encoder.h"
+#include "../record/inline_str.h"
+#include "../macros.h"
+
+// bit_1..bit_10 and hex_1..hex_10 are packed into s_bits (one bit each)
+// and s_hexes (one nibble each); byte2_1..byte2_10 are one byte each
+#define SUBSCRIBER_KEY_FIELDS(x, y) \
+  x(int32_t,s_id)
+#define SUBSCRIBER_VALUE_FIELDS(x, y) \
+  x(inline_str_fixed<15>,sub_nbr) \
+  y(uint16_t,s_bits) \
+  y(uint64_t,s_hexes) \
+  y(inline_str_fixed<10>,s_byte2) \
+  y(uint32_t,msc_location) \
+  y(uint32_t,vlr_location)
+DO_STRUCT(subscriber, SUBSCRIBER_KEY_FIELDS, SUBSCRIBER_VALUE_FIELDS)
+
+#define SUBSCRIBER_NBR_IDX_KEY_FIELDS(x, y) \
+  x(inline_str_fixed<15>,sub_nbr)
+#define SUBSCRIBER_NBR_IDX_VALUE_FIELDS(x, y) \
+  x(int32_t,s_id)
+DO_STRUCT(subscriber_nbr_idx, SUBSCRIBER_NBR_IDX_KEY_FIELDS, SUBSCRIBER_NBR_IDX_VALUE_FIELDS)
+
+#define ACCESS_INFO_KEY_FIELDS(x, y) \
+  x(int32_t,s_id) \
+  y(uint8_t,ai_type)
+#define ACCESS_INFO_VALUE_FIELDS(x, y) \
+  x(uint8_t,data1) \
+  y(uint8_t,data2) \
+  y(inline_str_fixed<3>,data3) \
+  y(inline_str_fixed<5>,data4)
+DO_STRUCT(access_info, ACCESS_INFO_KEY_FIELDS, ACCESS_INFO_VALUE_FIELDS)
+
+#define SPECIAL_FACILITY_KEY_FIELDS(x, y) \
+  x(int32_t,s_id) \
+  y(uint8_t,sf_type)
+#define SPECIAL_FACILITY_VALUE_FIELDS(x, y) \
+  x(uint8_t,is_active) \
+  y(uint8_t,error_cntrl) \
+  y(uint8_t,data_a) \
+  y(inline_str_fixed<5>,data_b)
+DO_STRUCT(special_facility, SPECIAL_FACILITY_KEY_FIELDS, SPECIAL_FACILITY_VALUE_FIELDS)
+
+#define CALL_FORWARDING_KEY_FIELDS(x, y) \
+  x(int32_t,s_id) \
+  y(uint8_t,sf_type) \
+  y(uint8_t,start_time)
+#define CALL_FORWARDING_VALUE_FIELDS(x, y) \
+  x(uint8_t,end_time) \
+  y(inline_str_fixed<15>,numberx)
+DO_STRUCT(call_forwarding, CALL_FORWARDING_KEY_FIELDS, CALL_FORWARDING_VALUE_FIELDS)
+
+#endif
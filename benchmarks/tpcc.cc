@@ -11,9 +11,11 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <sched.h>
 #include <getopt.h>
 
 #include <set>
+#include <tuple>
 #include <vector>
 
 #include "../txn.h"
@@ -212,6 +214,7 @@ static int g_new_order_fast_id_gen = 0;
 static int g_uniform_item_dist = 0;
 static int g_order_status_scan_hack = 0;
 static int g_wh_temperature = 0;
+static int g_numa_placement = 0;
 static uint g_microbench_rows = 100000;  // this many rows
 // can't have both ratio and rows at the same time
 static int g_microbench_wr_rows = 0; // this number of rows to write
@@ -234,6 +237,19 @@ static double g_wh_spread = 0;
 // 7: Microbenchmark-random - same as Microbenchmark, but uses random read-set range
 static unsigned g_txn_workload_mix[] = { 45, 43, 0, 4, 4, 4, 0, 0 }; // default TPC-C workload mix
 
+// CH-benCHmark: the last g_analytic_workers workers run only the analytic
+// queries Q1..Q22 (relative weights in g_analytic_workload_mix), the rest
+// run g_txn_workload_mix
+static uint g_analytic_workers = 0;
+static unsigned g_analytic_workload_mix[] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+// Analytic queries read as of the LSN this many MB of log ago when it is
+// still available (--snapshot-retention-mb), and the live data otherwise
+static size_t g_analytic_lag_mb = 0;
+static uint64_t g_analytic_loaded_lsn = 0;  // nothing to read before the load
+static atomic<uint64_t> g_analytic_as_of_queries(0);
+static atomic<uint64_t> g_analytic_live_queries(0);
+
 static aligned_padded_elem<spinlock> *g_partition_locks = nullptr;
 static aligned_padded_elem<atomic<uint64_t>> *g_district_ids = nullptr;
 
@@ -260,6 +276,102 @@ LockForPartition(unsigned int wid)
   return g_partition_locks[PartitionId(wid)].elem;
 }
 
+// NUMA placement (--numa-placement): warehouse wid belongs to the workers in
+// [WarehouseOwner(wid), WarehouseOwner(wid + 1)), or to the partition's worker
+// if there are more warehouses than workers. Its rows are loaded on the node
+// of its (first) owner and its owners have it as their home warehouse.
+static inline unsigned int
+WarehouseOwner(unsigned int wid)
+{
+  if (NumWarehouses() >= sysconf::worker_threads)
+    return PartitionId(wid);
+  return (wid - 1) * sysconf::worker_threads / NumWarehouses();
+}
+
+static inline uint16_t
+NodeOfWarehouse(unsigned int wid)
+{
+  return worker_node(WarehouseOwner(wid));
+}
+
+// a warehouse owned by [worker_id], see WarehouseOwner()
+static inline unsigned int
+PlacedHomeWarehouse(unsigned int worker_id)
+{
+  if (NumWarehouses() >= sysconf::worker_threads)
+    return worker_id * (NumWarehouses() / sysconf::worker_threads) + 1;
+  return ((worker_id + 1) * NumWarehouses() + sysconf::worker_threads - 1) /
+         sysconf::worker_threads;
+}
+
+// Node each loader ran on, per warehouse (-1: not loaded in this run, e.g.,
+// recovered), and which loader writes each table, to tell local from
+// remote accesses by workers
+enum tpcc_loader_kind {
+  LOADER_NONE = -1,  // not partitioned by warehouse
+  LOADER_WAREHOUSE,
+  LOADER_DISTRICT,
+  LOADER_STOCK,
+  LOADER_CUSTOMER,
+  LOADER_ORDER,
+  NLOADER_KINDS
+};
+
+static vector<int16_t> g_load_node[NLOADER_KINDS];
+
+struct tpcc_loaded_by {
+  enum {
+    customer = LOADER_CUSTOMER,
+    customer_name_idx = LOADER_CUSTOMER,
+    district = LOADER_DISTRICT,
+    history = LOADER_CUSTOMER,
+    item = LOADER_NONE,
+    new_order = LOADER_ORDER,
+    oorder = LOADER_ORDER,
+    oorder_c_id_idx = LOADER_ORDER,
+    order_line = LOADER_ORDER,
+    stock = LOADER_STOCK,
+    stock_data = LOADER_STOCK,
+    nation = LOADER_NONE,
+    region = LOADER_NONE,
+    supplier = LOADER_NONE,
+    warehouse = LOADER_WAREHOUSE,
+  };
+};
+
+// records that [kind] loads warehouse [warehouse_id] (-1: all of them) on
+// the calling thread's node
+static void
+NoteLoadNode(tpcc_loader_kind kind, ssize_t warehouse_id)
+{
+  const int16_t node = numa_node_of_cpu(sched_getcpu());
+  if (warehouse_id == -1)
+    std::fill(g_load_node[kind].begin(), g_load_node[kind].end(), node);
+  else
+    g_load_node[kind][warehouse_id] = node;
+}
+
+// table accesses (index operations) of a worker
+struct numa_access_stat {
+  int16_t node;  // the worker's
+  uint64_t local;
+  uint64_t remote;
+
+  inline ALWAYS_INLINE void
+  note(int kind, unsigned int wid)
+  {
+    if (kind == LOADER_NONE)
+      return;
+    const int16_t n = g_load_node[kind][wid];
+    if (n == node)
+      local++;
+    else if (n >= 0)
+      remote++;
+  }
+};
+
+static aligned_padded_elem<numa_access_stat> *g_numa_access = nullptr;
+
 static inline atomic<uint64_t> &
 NewOrderIdHolder(unsigned warehouse, unsigned district)
 {
@@ -363,6 +475,7 @@ public:
   tpcc_worker_mixin(const map<string, vector<abstract_ordered_index *>> &partitions) :
     _dummy() // so hacky...
     TPCC_TABLE_LIST(DEFN_TBL_INIT_X)
+    , access_stat(nullptr)
   {
     ALWAYS_ASSERT(NumWarehouses() >= 1);
   }
@@ -380,6 +493,8 @@ protected: \
   { \
     ASSERT(wid >= 1 && wid <= NumWarehouses()); \
     ASSERT(tbl_ ## name ## _vec.size() == NumWarehouses()); \
+    if (access_stat) \
+      access_stat->note(tpcc_loaded_by::name, wid); \
     return tbl_ ## name ## _vec[wid - 1]; \
   }
 
@@ -387,6 +502,9 @@ protected: \
 
 #undef DEFN_TBL_ACCESSOR_X
 
+  // counts table accesses if set (workers only)
+  numa_access_stat *access_stat;
+
 public:
 
   static inline uint32_t
@@ -548,6 +666,25 @@ string tpcc_worker_mixin::NameTokens[] =
     string("EING"),
   };
 
+// adapts a lambda taking the decoded key and value of each row to a scan
+// callback
+template <typename T, typename F>
+class lambda_scan_callback : public abstract_ordered_index::scan_callback {
+public:
+  lambda_scan_callback(F &f) : f(f) {}
+  virtual bool invoke(const char *keyp, size_t keylen, const varstr &value)
+  {
+    typename T::key k_temp;
+    typename T::value v_temp;
+    const typename T::key *k = Decode(keyp, k_temp);
+    const typename T::value *v = Decode(value, v_temp);
+    f(*k, *v);
+    return true;
+  }
+private:
+  F &f;
+};
+
 class tpcc_worker : public bench_worker, public tpcc_worker_mixin {
 public:
   tpcc_worker(unsigned int worker_id,
@@ -555,16 +692,27 @@ public:
               const map<string, abstract_ordered_index *> &open_tables,
               const map<string, vector<abstract_ordered_index *>> &partitions,
               spin_barrier *barrier_a, spin_barrier *barrier_b,
-              uint home_warehouse_id)
+              uint home_warehouse_id, bool analytic = false)
     : bench_worker(worker_id, seed, db,
                    open_tables, barrier_a, barrier_b),
       tpcc_worker_mixin(partitions),
-      home_warehouse_id(home_warehouse_id)
+      home_warehouse_id(home_warehouse_id),
+      analytic(analytic)
   {
     ASSERT(home_warehouse_id >= 1 and home_warehouse_id <= NumWarehouses() + 1);
     NDB_MEMSET(&last_no_o_ids[0], 0, sizeof(last_no_o_ids));
   }
 
+  virtual void
+  on_run_setup()
+  {
+    // counting costs a lookup per table access, so only when it's of use
+    if (not g_numa_placement)
+      return;
+    access_stat = &g_numa_access[worker_id].elem;
+    access_stat->node = numa_node_of_cpu(sched_getcpu());
+  }
+
   // XXX(stephentu): tune this
   static const size_t NMaxCustomerIdxScanElems = 512;
 
@@ -630,9 +778,51 @@ public:
   {
     return static_cast<tpcc_worker *>(w)->txn_query2();
   }
+
+#define CH_QUERY_LIST(x) \
+  x(1) x(3) x(4) x(5) x(6) x(7) x(8) x(9) x(10) x(11) x(12) \
+  x(13) x(14) x(15) x(16) x(17) x(18) x(19) x(20) x(21) x(22)
+
+#define CH_QUERY_DECL_X(n) \
+  rc_t txn_query##n(); \
+  static rc_t \
+  TxnQuery##n(bench_worker *w) \
+  { \
+    return static_cast<tpcc_worker *>(w)->txn_query##n(); \
+  }
+
+  CH_QUERY_LIST(CH_QUERY_DECL_X)
+
+#undef CH_QUERY_DECL_X
+
+  workload_desc_vec
+  get_analytic_workload() const
+  {
+    static const bench_worker::txn_fn_t queries[] = {
+      TxnQuery1, TxnQuery2, TxnQuery3, TxnQuery4, TxnQuery5, TxnQuery6,
+      TxnQuery7, TxnQuery8, TxnQuery9, TxnQuery10, TxnQuery11, TxnQuery12,
+      TxnQuery13, TxnQuery14, TxnQuery15, TxnQuery16, TxnQuery17, TxnQuery18,
+      TxnQuery19, TxnQuery20, TxnQuery21, TxnQuery22,
+    };
+    static_assert(ARRAY_NELEMS(queries) == ARRAY_NELEMS(g_analytic_workload_mix), "xx");
+    workload_desc_vec w;
+    unsigned m = 0;
+    for (size_t i = 0; i < ARRAY_NELEMS(g_analytic_workload_mix); i++)
+      m += g_analytic_workload_mix[i];
+    ALWAYS_ASSERT(m > 0);
+    for (size_t i = 0; i < ARRAY_NELEMS(queries); i++) {
+      if (g_analytic_workload_mix[i])
+        w.push_back(workload_desc("Query" + to_string(i + 1),
+                                  double(g_analytic_workload_mix[i]) / m, queries[i]));
+    }
+    return w;
+  }
+
   virtual workload_desc_vec
   get_workload() const
   {
+    if (analytic)
+      return get_analytic_workload();
     workload_desc_vec w;
     // numbers from sigmod.csail.mit.edu:
     //w.push_back(workload_desc("NewOrder", 1.0, TxnNewOrder)); // ~10k ops/sec
@@ -672,6 +862,61 @@ protected:
   }
 
 private:
+  // the nation and region tables, indexed by key
+  struct ch_nations {
+    static const size_t MaxNations = 128;  // nation keys are ASCII codes
+    int32_t region[MaxNations];
+    inline_str_fixed<25> name[MaxNations];
+    inline_str_fixed<25> region_name[5];
+    int32_t find(const char *nation_name) const;
+  };
+
+  template <typename T, typename F>
+  rc_t
+  scan_rows(void *txn, abstract_ordered_index *tbl,
+            const typename T::key &lo, const typename T::key &hi, F f)
+  {
+    lambda_scan_callback<T, F> c(f);
+    return tbl->scan(txn, Encode(str(Size(lo)), lo), &Encode(str(Size(hi)), hi), c, &arena);
+  }
+
+  // runs f(w, d) on every district, dropping the rows it scanned from the
+  // arena afterwards so a query's footprint is one district's worth
+  template <typename F>
+  rc_t
+  for_each_district(F f)
+  {
+    for (uint w = 1; w <= NumWarehouses(); w++) {
+      for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
+        rc_t rc = f(w, d);
+        arena.reset();
+        if (rc_is_abort(rc))
+          return rc;
+      }
+    }
+    return {RC_TRUE};
+  }
+
+  template <typename F>
+  rc_t
+  for_each_warehouse(F f)
+  {
+    for (uint w = 1; w <= NumWarehouses(); w++) {
+      rc_t rc = f(w);
+      arena.reset();
+      if (rc_is_abort(rc))
+        return rc;
+    }
+    return {RC_TRUE};
+  }
+
+  void *new_query_txn();
+  rc_t scan_nations(void *txn, ch_nations &n);
+  rc_t scan_supplier_nations(void *txn, vector<int32_t> &su_nation);
+  rc_t scan_customer_nations(void *txn, uint w, uint d, vector<int32_t> &c_nation);
+  rc_t scan_district_orders(void *txn, uint w, uint d, vector<oorder::value> &orders);
+  rc_t scan_items(void *txn, vector<item::value> &items);
+
   inline ALWAYS_INLINE unsigned
   pick_wh(fast_random &r)
   {
@@ -702,6 +947,7 @@ public:
   static vector<uint> cold_whs;
 private:
   const uint home_warehouse_id;
+  const bool analytic;
   int32_t last_no_o_ids[10]; // XXX(stephentu): hack
 };
 
@@ -822,6 +1068,7 @@ protected:
   virtual void
   load()
   {
+    NoteLoadNode(LOADER_WAREHOUSE, -1);
     string obj_buf;
     void *txn = db->new_txn(txn_flags, arena, txn_buf());
     uint64_t warehouse_total_sz = 0, n_warehouses = 0;
@@ -955,10 +1202,17 @@ public:
                    static_cast<size_t>(warehouse_id) <= NumWarehouses()));
   }
 
+  virtual int
+  numa_node() const
+  {
+    return g_numa_placement and warehouse_id != -1 ? NodeOfWarehouse(warehouse_id) : -1;
+  }
+
 protected:
   virtual void
   load()
   {
+    NoteLoadNode(LOADER_STOCK, warehouse_id);
     string obj_buf, obj_buf1;
 
     uint64_t stock_total_sz = 0, n_stocks = 0;
@@ -1048,6 +1302,7 @@ protected:
   virtual void
   load()
   {
+    NoteLoadNode(LOADER_DISTRICT, -1);
     string obj_buf;
 
     const ssize_t bsize = db->txn_max_batch_size();
@@ -1107,10 +1362,17 @@ public:
                    static_cast<size_t>(warehouse_id) <= NumWarehouses()));
   }
 
+  virtual int
+  numa_node() const
+  {
+    return g_numa_placement and warehouse_id != -1 ? NodeOfWarehouse(warehouse_id) : -1;
+  }
+
 protected:
   virtual void
   load()
   {
+    NoteLoadNode(LOADER_CUSTOMER, warehouse_id);
     string obj_buf;
 
     const uint w_start = (warehouse_id == -1) ?
@@ -1232,6 +1494,12 @@ public:
                    static_cast<size_t>(warehouse_id) <= NumWarehouses()));
   }
 
+  virtual int
+  numa_node() const
+  {
+    return g_numa_placement and warehouse_id != -1 ? NodeOfWarehouse(warehouse_id) : -1;
+  }
+
 protected:
   size_t
   NumOrderLinesPerCustomer()
@@ -1242,6 +1510,7 @@ protected:
   virtual void
   load()
   {
+    NoteLoadNode(LOADER_ORDER, warehouse_id);
     string obj_buf;
 
     uint64_t order_line_total_sz = 0, n_order_lines = 0;
@@ -2184,7 +2453,7 @@ tpcc_worker::txn_stock_level()
 rc_t
 tpcc_worker::txn_query2()
 {
-	void *txn = db->new_txn(txn_flags | transaction::TXN_FLAG_READ_MOSTLY, arena, txn_buf());
+	void *txn = new_query_txn();
 	scoped_str_arena s_arena(arena);
 
 	static __thread table_scanner r_scanner(&arena);
@@ -2192,14 +2461,14 @@ tpcc_worker::txn_query2()
 	const region::key k_r_0( 0 );
 	const region::key k_r_1( 5 );
 	try_catch(tbl_region(1)->scan(txn, Encode(str(sizeof(k_r_0)), k_r_0), &Encode(str(sizeof(k_r_1)), k_r_1), r_scanner, s_arena.get()));
-	ALWAYS_ASSERT( r_scanner.output.size() == 5);
+	ALWAYS_ASSERT( r_scanner.output.size() == ARRAY_NELEMS(regions));
 
 	static __thread table_scanner n_scanner(&arena);
 	n_scanner.clear();
 	const nation::key k_n_0( 0 );
 	const nation::key k_n_1( numeric_limits<int32_t>::max() );
 	try_catch(tbl_nation(1)->scan(txn, Encode(str(sizeof(k_n_0)), k_n_0), &Encode(str(sizeof(k_n_1)), k_n_1), n_scanner, s_arena.get()));
-	ALWAYS_ASSERT( n_scanner.output.size() == 62);
+	ALWAYS_ASSERT( n_scanner.output.size() == ARRAY_NELEMS(nations));
 
 	// Pick a target region
 	auto target_region = RandomNumber(r, 0, 4);
@@ -2313,6 +2582,999 @@ tpcc_worker::txn_query2()
     return {RC_TRUE};
 }
 
+// CH-benCHmark analytic queries (Q2 is txn_query2 above), after Cole et al.,
+// "The mixed workload CH-benCHmark" (DBTest 2011). They are read-only and
+// aggregate while scanning, a district (or, for stock, a warehouse) per
+// scan; see for_each_district(). Dates in this TPC-C are per-thread
+// counters (GetCurrentTimeMillis()), so the queries' date ranges are
+// dropped and "delivered" means ol_delivery_d != 0. Customers belong to the
+// nation keyed by the first character of c_state, and stock (w, i) to
+// supplier (w * i) % 10000, as in the spec.
+
+void *
+tpcc_worker::new_query_txn()
+{
+  if (g_analytic_lag_mb) {
+    const uint64_t lag = g_analytic_lag_mb * sysconf::MB;
+    const uint64_t lsn = db->current_lsn();
+    void *txn = lsn > g_analytic_loaded_lsn + lag ?
+      db->new_txn_as_of(lsn - lag, arena, txn_buf()) : NULL;
+    if (txn) {
+      g_analytic_as_of_queries++;
+      return txn;
+    }
+    g_analytic_live_queries++;
+  }
+  return db->new_txn(txn_flags | transaction::TXN_FLAG_READ_MOSTLY, arena, txn_buf());
+}
+
+rc_t
+tpcc_worker::scan_nations(void *txn, ch_nations &n)
+{
+  std::fill(n.region, n.region + ARRAY_NELEMS(n.region), -1);
+  auto on_nation = [&n](const nation::key &k, const nation::value &v) {
+    ASSERT(k.n_nationkey >= 0 and k.n_nationkey < (int32_t)ARRAY_NELEMS(n.region));
+    n.region[k.n_nationkey] = v.n_regionkey;
+    n.name[k.n_nationkey] = v.n_name;
+  };
+  rc_t rc = scan_rows<nation>(txn, tbl_nation(1), nation::key(0),
+                              nation::key(ARRAY_NELEMS(n.region)), on_nation);
+  if (rc_is_abort(rc))
+    return rc;
+  auto on_region = [&n](const region::key &k, const region::value &v) {
+    ASSERT(k.r_regionkey >= 0 and k.r_regionkey < (int32_t)ARRAY_NELEMS(n.region_name));
+    n.region_name[k.r_regionkey] = v.r_name;
+  };
+  return scan_rows<region>(txn, tbl_region(1), region::key(0),
+                           region::key(ARRAY_NELEMS(n.region_name)), on_region);
+}
+
+int32_t
+tpcc_worker::ch_nations::find(const char *nation_name) const
+{
+  const inline_str_fixed<25> target(nation_name);
+  for (size_t i = 0; i < ARRAY_NELEMS(name); i++) {
+    if (region[i] >= 0 and name[i] == target)
+      return i;
+  }
+  return -1;
+}
+
+rc_t
+tpcc_worker::scan_supplier_nations(void *txn, vector<int32_t> &su_nation)
+{
+  su_nation.assign(10000, -1);
+  auto on_supplier = [&su_nation](const supplier::key &k, const supplier::value &v) {
+    if (k.su_suppkey >= 0 and k.su_suppkey < (int32_t)su_nation.size())
+      su_nation[k.su_suppkey] = v.su_nationkey;
+  };
+  return scan_rows<supplier>(txn, tbl_supplier(1), supplier::key(0),
+                             supplier::key(su_nation.size()), on_supplier);
+}
+
+rc_t
+tpcc_worker::scan_customer_nations(void *txn, uint w, uint d, vector<int32_t> &c_nation)
+{
+  c_nation.assign(NumCustomersPerDistrict() + 1, -1);
+  auto on_customer = [&c_nation](const customer::key &k, const customer::value &v) {
+    if ((size_t)k.c_id < c_nation.size())
+      c_nation[k.c_id] = v.c_state.data()[0];
+  };
+  return scan_rows<customer>(txn, tbl_customer(w), customer::key(w, d, 0),
+                             customer::key(w, d + 1, 0), on_customer);
+}
+
+rc_t
+tpcc_worker::scan_district_orders(void *txn, uint w, uint d, vector<oorder::value> &orders)
+{
+  orders.clear();
+  auto on_order = [&orders](const oorder::key &k, const oorder::value &v) {
+    if ((size_t)k.o_id >= orders.size())
+      orders.resize(k.o_id + 1);
+    orders[k.o_id] = v;
+  };
+  return scan_rows<oorder>(txn, tbl_oorder(w), oorder::key(w, d, 0),
+                           oorder::key(w, d + 1, 0), on_order);
+}
+
+rc_t
+tpcc_worker::scan_items(void *txn, vector<item::value> &items)
+{
+  items.assign(NumItems() + 1, item::value());
+  auto on_item = [&items](const item::key &k, const item::value &v) {
+    items[k.i_id] = v;
+  };
+  return scan_rows<item>(txn, tbl_item(1), item::key(0),
+                         item::key(NumItems() + 1), on_item);
+}
+
+static inline bool
+ch_ends_with(const inline_str_8<50> &s, const char *suffix)
+{
+  const size_t n = strlen(suffix);
+  return s.size() >= n and memcmp(s.data() + s.size() - n, suffix, n) == 0;
+}
+
+static inline bool
+ch_starts_with(const inline_str_8<50> &s, const char *prefix)
+{
+  const size_t n = strlen(prefix);
+  return s.size() >= n and memcmp(s.data(), prefix, n) == 0;
+}
+
+static inline int32_t
+ch_supplier(int32_t w_id, int32_t i_id)
+{
+  return (w_id * i_id) % 10000;
+}
+
+// Q1: pricing summary of delivered order lines by ol_number
+rc_t
+tpcc_worker::txn_query1()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  struct group { uint64_t quantity = 0; double amount = 0; uint64_t count = 0; };
+  group groups[16];  // ol_number is 1..15
+
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if (v.ol_delivery_d == 0)
+        return;
+      ASSERT(k.ol_number >= 1 and k.ol_number < (int32_t)ARRAY_NELEMS(groups));
+      groups[k.ol_number].quantity += v.ol_quantity;
+      groups[k.ol_number].amount += v.ol_amount;
+      groups[k.ol_number].count++;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query1");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q3: top 10 unshipped orders by revenue of customers in states 'A%'
+rc_t
+tpcc_worker::txn_query3()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  // (revenue, w, d, o_id)
+  vector<std::tuple<double, uint, uint, int32_t>> results;
+  vector<int32_t> c_nation;
+  vector<oorder::value> orders;
+  vector<bool> is_new;
+  vector<double> revenue;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_customer_nations(txn, w, d, c_nation);
+    if (rc_is_abort(rc))
+      return rc;
+    rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    is_new.assign(orders.size(), false);
+    int32_t min_o_id = numeric_limits<int32_t>::max();
+    auto on_new_order = [&](const new_order::key &k, const new_order::value &) {
+      if ((size_t)k.no_o_id < is_new.size())
+        is_new[k.no_o_id] = true;
+      min_o_id = std::min(min_o_id, k.no_o_id);
+    };
+    rc = scan_rows<new_order>(txn, tbl_new_order(w), new_order::key(w, d, 0),
+                              new_order::key(w, d + 1, 0), on_new_order);
+    if (rc_is_abort(rc) or min_o_id == numeric_limits<int32_t>::max())
+      return rc;
+    revenue.assign(orders.size(), 0);
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id < is_new.size() and is_new[k.ol_o_id] and
+          c_nation[orders[k.ol_o_id].o_c_id] == 'A')
+        revenue[k.ol_o_id] += v.ol_amount;
+    };
+    rc = scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, min_o_id, 0),
+                               order_line::key(w, d + 1, 0, 0), on_line);
+    for (size_t o_id = min_o_id; o_id < revenue.size(); o_id++) {
+      if (revenue[o_id] > 0)
+        results.emplace_back(revenue[o_id], w, d, o_id);
+    }
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  const size_t n = std::min(results.size(), (size_t)10);
+  std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                    std::greater<std::tuple<double, uint, uint, int32_t>>());
+  results.resize(n);
+
+  measure_txn_counters(txn, "txn_query3");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q4: orders with a line delivered after entry, by o_ol_cnt
+rc_t
+tpcc_worker::txn_query4()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  uint64_t order_count[16] = { 0 };  // o_ol_cnt is 5..15
+  vector<oorder::value> orders;
+  vector<bool> late;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    late.assign(orders.size(), false);
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id < orders.size() and v.ol_delivery_d and
+          v.ol_delivery_d >= orders[k.ol_o_id].o_entry_d)
+        late[k.ol_o_id] = true;
+    };
+    rc = scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                               order_line::key(w, d + 1, 0, 0), on_line);
+    for (size_t o_id = 0; o_id < orders.size(); o_id++) {
+      if (late[o_id] and orders[o_id].o_ol_cnt < (int8_t)ARRAY_NELEMS(order_count))
+        order_count[orders[o_id].o_ol_cnt]++;
+    }
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query4");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q5: revenue by nation within a region, where customer and supplier share
+// the nation
+rc_t
+tpcc_worker::txn_query5()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  const int32_t target_region = RandomNumber(r, 0, 4);
+  ch_nations n;
+  vector<int32_t> su_nation;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  arena.reset();
+
+  double revenue[ARRAY_NELEMS(n.region)] = { 0 };
+  vector<int32_t> c_nation;
+  vector<oorder::value> orders;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_customer_nations(txn, w, d, c_nation);
+    if (rc_is_abort(rc))
+      return rc;
+    rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id >= orders.size())
+        return;
+      const int32_t nation = c_nation[orders[k.ol_o_id].o_c_id];
+      if (nation >= 0 and n.region[nation] == target_region and
+          su_nation[ch_supplier(v.ol_supply_w_id, v.ol_i_id)] == nation)
+        revenue[nation] += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query5");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q6: revenue of delivered lines with a quantity between 1 and 100000
+rc_t
+tpcc_worker::txn_query6()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  double revenue = 0;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (v.ol_delivery_d and v.ol_quantity >= 1)
+        revenue += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+  ALWAYS_ASSERT(revenue >= 0);
+
+  measure_txn_counters(txn, "txn_query6");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q7: volume shipped between Germany and Cambodia, both ways
+rc_t
+tpcc_worker::txn_query7()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  ch_nations n;
+  vector<int32_t> su_nation;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  arena.reset();
+  const int32_t n1 = n.find("GERMANY");
+  const int32_t n2 = n.find("CAMBODIA");
+  ALWAYS_ASSERT(n1 >= 0 and n2 >= 0);
+
+  double volume[2] = { 0, 0 };  // supplied from n1 to n2, from n2 to n1
+  vector<int32_t> c_nation;
+  vector<oorder::value> orders;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_customer_nations(txn, w, d, c_nation);
+    if (rc_is_abort(rc))
+      return rc;
+    rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if (not v.ol_delivery_d or (size_t)k.ol_o_id >= orders.size())
+        return;
+      const int32_t cn = c_nation[orders[k.ol_o_id].o_c_id];
+      const int32_t sn = su_nation[ch_supplier(v.ol_supply_w_id, v.ol_i_id)];
+      if (sn == n1 and cn == n2)
+        volume[0] += v.ol_amount;
+      else if (sn == n2 and cn == n1)
+        volume[1] += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query7");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q8: Germany's share of Europe's revenue from items '%b' with i_id < 1000
+rc_t
+tpcc_worker::txn_query8()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  ch_nations n;
+  vector<int32_t> su_nation;
+  vector<item::value> items;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  try_catch(scan_items(txn, items));
+  arena.reset();
+  const int32_t germany = n.find("GERMANY");
+  int32_t europe = -1;
+  for (size_t i = 0; i < ARRAY_NELEMS(n.region_name); i++) {
+    if (n.region_name[i] == inline_str_fixed<25>("EUROPE"))
+      europe = i;
+  }
+  ALWAYS_ASSERT(germany >= 0 and europe >= 0);
+
+  double total = 0, germany_total = 0;
+  vector<int32_t> c_nation;
+  vector<oorder::value> orders;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_customer_nations(txn, w, d, c_nation);
+    if (rc_is_abort(rc))
+      return rc;
+    rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if (v.ol_i_id >= 1000 or not ch_ends_with(items[v.ol_i_id].i_data, "b") or
+          (size_t)k.ol_o_id >= orders.size())
+        return;
+      const int32_t cn = c_nation[orders[k.ol_o_id].o_c_id];
+      if (cn < 0 or n.region[cn] != europe)
+        return;
+      total += v.ol_amount;
+      if (su_nation[ch_supplier(v.ol_supply_w_id, v.ol_i_id)] == germany)
+        germany_total += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+  ALWAYS_ASSERT(germany_total <= total);
+
+  measure_txn_counters(txn, "txn_query8");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q9: revenue from items '%BB' by supplier nation
+rc_t
+tpcc_worker::txn_query9()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<int32_t> su_nation;
+  vector<item::value> items;
+  try_catch(scan_supplier_nations(txn, su_nation));
+  try_catch(scan_items(txn, items));
+  arena.reset();
+
+  double revenue[ch_nations::MaxNations] = { 0 };
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (not ch_ends_with(items[v.ol_i_id].i_data, "BB"))
+        return;
+      const int32_t sn = su_nation[ch_supplier(v.ol_supply_w_id, v.ol_i_id)];
+      if (sn >= 0)
+        revenue[sn] += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query9");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q10: top 20 customers by revenue of delivered lines
+rc_t
+tpcc_worker::txn_query10()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  // (revenue, w, d, c_id)
+  vector<std::tuple<double, uint, uint, int32_t>> results;
+  vector<oorder::value> orders;
+  vector<double> revenue;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    revenue.assign(NumCustomersPerDistrict() + 1, 0);
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if (v.ol_delivery_d and (size_t)k.ol_o_id < orders.size())
+        revenue[orders[k.ol_o_id].o_c_id] += v.ol_amount;
+    };
+    rc = scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                               order_line::key(w, d + 1, 0, 0), on_line);
+    for (size_t c_id = 1; c_id < revenue.size(); c_id++) {
+      if (revenue[c_id] > 0)
+        results.emplace_back(revenue[c_id], w, d, c_id);
+    }
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  const size_t n = std::min(results.size(), (size_t)20);
+  std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                    std::greater<std::tuple<double, uint, uint, int32_t>>());
+  results.resize(n);
+
+  measure_txn_counters(txn, "txn_query10");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q11: items most ordered from German suppliers' stock
+rc_t
+tpcc_worker::txn_query11()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  ch_nations n;
+  vector<int32_t> su_nation;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  arena.reset();
+  const int32_t germany = n.find("GERMANY");
+  ALWAYS_ASSERT(germany >= 0);
+
+  vector<uint64_t> order_cnt(NumItems() + 1, 0);
+  uint64_t total = 0;
+  auto per_warehouse = [&](uint w) -> rc_t {
+    auto on_stock = [&](const stock::key &k, const stock::value &v) {
+      if (su_nation[ch_supplier(k.s_w_id, k.s_i_id)] == germany) {
+        order_cnt[k.s_i_id] += v.s_order_cnt;
+        total += v.s_order_cnt;
+      }
+    };
+    return scan_rows<stock>(txn, tbl_stock(w), stock::key(w, 0),
+                            stock::key(w + 1, 0), on_stock);
+  };
+  try_catch(for_each_warehouse(per_warehouse));
+
+  // (order count, i_id) above 0.5% of the total
+  vector<pair<uint64_t, int32_t>> results;
+  for (size_t i_id = 1; i_id < order_cnt.size(); i_id++) {
+    if (order_cnt[i_id] > total * 0.005)
+      results.emplace_back(order_cnt[i_id], i_id);
+  }
+  std::sort(results.begin(), results.end(), std::greater<pair<uint64_t, int32_t>>());
+
+  measure_txn_counters(txn, "txn_query11");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q12: delivered lines by o_ol_cnt, split by high (carrier 1 or 2) and low
+// priority
+rc_t
+tpcc_worker::txn_query12()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  uint64_t high_line_count[16] = { 0 }, low_line_count[16] = { 0 };
+  vector<oorder::value> orders;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id >= orders.size())
+        return;
+      const oorder::value &o = orders[k.ol_o_id];
+      if (not v.ol_delivery_d or o.o_entry_d > v.ol_delivery_d or
+          o.o_ol_cnt >= (int8_t)ARRAY_NELEMS(high_line_count))
+        return;
+      if (o.o_carrier_id == 1 or o.o_carrier_id == 2)
+        high_line_count[o.o_ol_cnt]++;
+      else
+        low_line_count[o.o_ol_cnt]++;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query12");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q13: how many customers have how many orders with o_carrier_id > 8
+rc_t
+tpcc_worker::txn_query13()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  map<uint32_t, uint64_t> customers_by_order_count;
+  vector<uint32_t> order_count;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    order_count.assign(NumCustomersPerDistrict() + 1, 0);
+    auto on_order = [&](const oorder::key &, const oorder::value &v) {
+      if (v.o_carrier_id > 8 and (size_t)v.o_c_id < order_count.size())
+        order_count[v.o_c_id]++;
+    };
+    rc_t rc = scan_rows<oorder>(txn, tbl_oorder(w), oorder::key(w, d, 0),
+                                oorder::key(w, d + 1, 0), on_order);
+    for (size_t c_id = 1; c_id < order_count.size(); c_id++)
+      customers_by_order_count[order_count[c_id]]++;
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query13");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q14: share of delivered revenue from promotional items ('PR%')
+rc_t
+tpcc_worker::txn_query14()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<item::value> items;
+  try_catch(scan_items(txn, items));
+  arena.reset();
+
+  double promo = 0, total = 0;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (not v.ol_delivery_d)
+        return;
+      total += v.ol_amount;
+      if (ch_starts_with(items[v.ol_i_id].i_data, "PR"))
+        promo += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+  ALWAYS_ASSERT(promo <= total);
+
+  measure_txn_counters(txn, "txn_query14");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q15: the supplier(s) with the most delivered revenue
+rc_t
+tpcc_worker::txn_query15()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<double> revenue(10000, 0);
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (v.ol_delivery_d)
+        revenue[ch_supplier(v.ol_supply_w_id, v.ol_i_id)] += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  const double max_revenue = *std::max_element(revenue.begin(), revenue.end());
+  for (size_t su = 0; su < revenue.size(); su++) {
+    if (max_revenue == 0 or revenue[su] != max_revenue)
+      continue;
+    const supplier::key k_su(su);
+    supplier::value v_su_temp;
+    varstr sv_su = str(Size(v_su_temp));
+    try_verify_relax(tbl_supplier(1)->get(txn, Encode(str(Size(k_su)), k_su), sv_su));
+  }
+
+  measure_txn_counters(txn, "txn_query15");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q16: suppliers per item outside brand 'zz%'. su_comment isn't loaded,
+// so the spec's exclusion of suppliers with complaints is dropped; items
+// have unique names, so grouping by item stands in for grouping by
+// (i_name, brand, i_price).
+rc_t
+tpcc_worker::txn_query16()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<item::value> items;
+  try_catch(scan_items(txn, items));
+  arena.reset();
+
+  // (i_id, supplier)
+  vector<pair<int32_t, int32_t>> item_suppliers;
+  auto per_warehouse = [&](uint w) -> rc_t {
+    auto on_stock = [&](const stock::key &k, const stock::value &) {
+      if (not ch_starts_with(items[k.s_i_id].i_data, "zz"))
+        item_suppliers.emplace_back(k.s_i_id, ch_supplier(k.s_w_id, k.s_i_id));
+    };
+    return scan_rows<stock>(txn, tbl_stock(w), stock::key(w, 0),
+                            stock::key(w + 1, 0), on_stock);
+  };
+  try_catch(for_each_warehouse(per_warehouse));
+
+  std::sort(item_suppliers.begin(), item_suppliers.end());
+  item_suppliers.erase(std::unique(item_suppliers.begin(), item_suppliers.end()),
+                       item_suppliers.end());
+  vector<uint32_t> supplier_cnt(NumItems() + 1, 0);
+  for (auto &p : item_suppliers)
+    supplier_cnt[p.first]++;
+
+  measure_txn_counters(txn, "txn_query16");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q17: revenue lost to small orders of items '%b', i.e. lines below the
+// item's average quantity
+rc_t
+tpcc_worker::txn_query17()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<item::value> items;
+  try_catch(scan_items(txn, items));
+  arena.reset();
+
+  vector<uint64_t> quantity(NumItems() + 1, 0), count(NumItems() + 1, 0);
+  auto avg_per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (ch_ends_with(items[v.ol_i_id].i_data, "b")) {
+        quantity[v.ol_i_id] += v.ol_quantity;
+        count[v.ol_i_id]++;
+      }
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(avg_per_district));
+
+  double small_revenue = 0;
+  auto sum_per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (count[v.ol_i_id] and
+          v.ol_quantity * count[v.ol_i_id] < quantity[v.ol_i_id])
+        small_revenue += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(sum_per_district));
+  small_revenue /= 2.0;
+
+  measure_txn_counters(txn, "txn_query17");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q18: top 100 orders above 200 in total amount
+rc_t
+tpcc_worker::txn_query18()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  // (amount, w, d, o_id)
+  vector<std::tuple<double, uint, uint, int32_t>> results;
+  vector<double> amount;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    amount.clear();
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id >= amount.size())
+        amount.resize(k.ol_o_id + 1, 0);
+      amount[k.ol_o_id] += v.ol_amount;
+    };
+    rc_t rc = scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                    order_line::key(w, d + 1, 0, 0), on_line);
+    for (size_t o_id = 1; o_id < amount.size(); o_id++) {
+      if (amount[o_id] > 200)
+        results.emplace_back(amount[o_id], w, d, o_id);
+    }
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  const size_t n = std::min(results.size(), (size_t)100);
+  std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                    std::greater<std::tuple<double, uint, uint, int32_t>>());
+  results.resize(n);
+
+  measure_txn_counters(txn, "txn_query18");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q19: revenue of three item/warehouse/quantity combinations
+rc_t
+tpcc_worker::txn_query19()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  vector<item::value> items;
+  try_catch(scan_items(txn, items));
+  arena.reset();
+
+  double revenue = 0;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if (v.ol_quantity < 1 or v.ol_quantity > 10)
+        return;
+      const item::value &i = items[v.ol_i_id];
+      if (i.i_price < 1 or i.i_price > 400000)
+        return;
+      const int32_t w_id = k.ol_w_id;
+      if ((ch_ends_with(i.i_data, "a") and (w_id == 1 or w_id == 2 or w_id == 3)) or
+          (ch_ends_with(i.i_data, "b") and (w_id == 1 or w_id == 2 or w_id == 4)) or
+          (ch_ends_with(i.i_data, "c") and (w_id == 1 or w_id == 5 or w_id == 3)))
+        revenue += v.ol_amount;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+  ALWAYS_ASSERT(revenue >= 0);
+
+  measure_txn_counters(txn, "txn_query19");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q20: German suppliers with stock of items 'co%' above half of what was
+// delivered of it
+rc_t
+tpcc_worker::txn_query20()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  ch_nations n;
+  vector<int32_t> su_nation;
+  vector<item::value> items;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  try_catch(scan_items(txn, items));
+  arena.reset();
+  const int32_t germany = n.find("GERMANY");
+  ALWAYS_ASSERT(germany >= 0);
+
+  // (supply w_id, i_id) => delivered quantity
+  map<pair<int32_t, int32_t>, uint64_t> delivered;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    auto on_line = [&](const order_line::key &, const order_line::value &v) {
+      if (v.ol_delivery_d and ch_starts_with(items[v.ol_i_id].i_data, "co"))
+        delivered[make_pair(v.ol_supply_w_id, v.ol_i_id)] += v.ol_quantity;
+    };
+    return scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                                 order_line::key(w, d + 1, 0, 0), on_line);
+  };
+  try_catch(for_each_district(per_district));
+
+  set<int32_t> suppliers;
+  for (auto &p : delivered) {
+    const int32_t su = ch_supplier(p.first.first, p.first.second);
+    if (su_nation[su] != germany or suppliers.count(su))
+      continue;
+    const stock::key k_s(p.first.first, p.first.second);
+    stock::value v_s_temp;
+    varstr sv_s = str(Size(v_s_temp));
+    try_verify_relax(tbl_stock(k_s.s_w_id)->get(txn, Encode(str(Size(k_s)), k_s), sv_s));
+    if (2 * (uint64_t)std::max<int16_t>(Decode(sv_s, v_s_temp)->s_quantity, 0) > p.second)
+      suppliers.insert(su);
+  }
+
+  measure_txn_counters(txn, "txn_query20");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q21: German suppliers whose line was an order's last, late delivery
+rc_t
+tpcc_worker::txn_query21()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  ch_nations n;
+  vector<int32_t> su_nation;
+  try_catch(scan_nations(txn, n));
+  try_catch(scan_supplier_nations(txn, su_nation));
+  arena.reset();
+  const int32_t germany = n.find("GERMANY");
+  ALWAYS_ASSERT(germany >= 0);
+
+  vector<uint64_t> num_wait(10000, 0);
+  vector<oorder::value> orders;
+  // the current order's (ol_delivery_d, supplier)s; order lines come in
+  // o_id order
+  vector<pair<uint32_t, int32_t>> lines;
+  int32_t o_id = 0;
+  auto flush_order = [&]() {
+    uint32_t last = 0;
+    for (auto &l : lines)
+      last = std::max(last, l.first);
+    for (auto &l : lines) {
+      if (l.first == last and last > orders[o_id].o_entry_d and su_nation[l.second] == germany)
+        num_wait[l.second]++;
+    }
+    lines.clear();
+  };
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    auto on_line = [&](const order_line::key &k, const order_line::value &v) {
+      if ((size_t)k.ol_o_id >= orders.size())
+        return;
+      if (k.ol_o_id != o_id)
+        flush_order();
+      o_id = k.ol_o_id;
+      if (v.ol_delivery_d)
+        lines.emplace_back(v.ol_delivery_d, ch_supplier(v.ol_supply_w_id, v.ol_i_id));
+    };
+    rc = scan_rows<order_line>(txn, tbl_order_line(w), order_line::key(w, d, 0, 0),
+                               order_line::key(w, d + 1, 0, 0), on_line);
+    flush_order();
+    return rc;
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query21");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
+// Q22: by state, customers with phones '1'..'7' and above-average balances
+// who never ordered
+rc_t
+tpcc_worker::txn_query22()
+{
+  void *txn = new_query_txn();
+  scoped_str_arena s_arena(arena);
+
+  auto phone_matches = [](const customer::value &v) {
+    return v.c_phone.data()[0] >= '1' and v.c_phone.data()[0] <= '7';
+  };
+
+  double balance = 0;
+  uint64_t n = 0;
+  auto avg_per_district = [&](uint w, uint d) -> rc_t {
+    auto on_customer = [&](const customer::key &, const customer::value &v) {
+      if (v.c_balance > 0 and phone_matches(v)) {
+        balance += v.c_balance;
+        n++;
+      }
+    };
+    return scan_rows<customer>(txn, tbl_customer(w), customer::key(w, d, 0),
+                               customer::key(w, d + 1, 0), on_customer);
+  };
+  try_catch(for_each_district(avg_per_district));
+  const double avg_balance = n ? balance / n : 0;
+
+  // by first char of c_state: (count, balance)
+  map<char, pair<uint64_t, double>> results;
+  vector<oorder::value> orders;
+  vector<bool> ordered;
+  auto per_district = [&](uint w, uint d) -> rc_t {
+    rc_t rc = scan_district_orders(txn, w, d, orders);
+    if (rc_is_abort(rc))
+      return rc;
+    ordered.assign(NumCustomersPerDistrict() + 1, false);
+    for (auto &o : orders) {
+      if ((size_t)o.o_c_id < ordered.size())
+        ordered[o.o_c_id] = true;
+    }
+    auto on_customer = [&](const customer::key &k, const customer::value &v) {
+      if (v.c_balance > avg_balance and phone_matches(v) and
+          (size_t)k.c_id < ordered.size() and not ordered[k.c_id]) {
+        auto &res = results[v.c_state.data()[0]];
+        res.first++;
+        res.second += v.c_balance;
+      }
+    };
+    return scan_rows<customer>(txn, tbl_customer(w), customer::key(w, d, 0),
+                               customer::key(w, d + 1, 0), on_customer);
+  };
+  try_catch(for_each_district(per_district));
+
+  measure_txn_counters(txn, "txn_query22");
+  try_catch(db->commit_txn(txn));
+  inc_ntxn_query_commits();
+  return {RC_TRUE};
+}
+
 rc_t
 tpcc_worker::txn_microbench_random()
 {
@@ -2474,6 +3736,15 @@ public:
       for (size_t i = 0; i < NumWarehouses() * NumDistrictsPerWarehouse(); i++)
         new (&g_district_ids[i]) atomic<uint64_t>(3001);
     }
+
+    for (auto &v : g_load_node)
+      v.assign(NumWarehouses() + 1, -1);
+    void * const px = memalign(
+      CACHELINE_SIZE, sizeof(aligned_padded_elem<numa_access_stat>) * sysconf::worker_threads);
+    ALWAYS_ASSERT(px);
+    g_numa_access = reinterpret_cast<aligned_padded_elem<numa_access_stat> *>(px);
+    for (size_t i = 0; i < sysconf::worker_threads; i++)
+      new (&g_numa_access[i]) aligned_padded_elem<numa_access_stat>();
   }
 
 protected:
@@ -2486,7 +3757,9 @@ protected:
     ret.push_back(new tpcc_region_loader(789121, db, open_tables, partitions));
     ret.push_back(new tpcc_supplier_loader(51271928, db, open_tables, partitions));
     ret.push_back(new tpcc_item_loader(235443, db, open_tables, partitions));
-    if (enable_parallel_loading) {
+    // placement needs a loader per warehouse
+    const bool per_warehouse = enable_parallel_loading or g_numa_placement;
+    if (per_warehouse) {
       fast_random r(89785943);
       for (uint i = 1; i <= NumWarehouses(); i++)
         ret.push_back(new tpcc_stock_loader(r.next(), db, open_tables, partitions, i));
@@ -2494,14 +3767,14 @@ protected:
       ret.push_back(new tpcc_stock_loader(89785943, db, open_tables, partitions, -1));
     }
     ret.push_back(new tpcc_district_loader(129856349, db, open_tables, partitions));
-    if (enable_parallel_loading) {
+    if (per_warehouse) {
       fast_random r(923587856425);
       for (uint i = 1; i <= NumWarehouses(); i++)
         ret.push_back(new tpcc_customer_loader(r.next(), db, open_tables, partitions, i));
     } else {
       ret.push_back(new tpcc_customer_loader(923587856425, db, open_tables, partitions, -1));
     }
-    if (enable_parallel_loading) {
+    if (per_warehouse) {
       fast_random r(2343352);
       for (uint i = 1; i <= NumWarehouses(); i++)
         ret.push_back(new tpcc_order_loader(r.next(), db, open_tables, partitions, i));
@@ -2516,12 +3789,23 @@ protected:
   {
     fast_random r(23984543);
     vector<bench_worker *> ret;
-    if (NumWarehouses() <= sysconf::worker_threads) {
+    const size_t first_analytic = sysconf::worker_threads - g_analytic_workers;
+    g_analytic_loaded_lsn = db->current_lsn();
+    if (g_numa_placement) {
       for (size_t i = 0; i < sysconf::worker_threads; i++)
         ret.push_back(new tpcc_worker(i, r.next(), db,
                                       open_tables, partitions,
                                       &barrier_a, &barrier_b,
-                                      (i % NumWarehouses()) + 1));
+                                      PlacedHomeWarehouse(i),
+                                      i >= first_analytic));
+    }
+    else if (NumWarehouses() <= sysconf::worker_threads) {
+      for (size_t i = 0; i < sysconf::worker_threads; i++)
+        ret.push_back(new tpcc_worker(i, r.next(), db,
+                                      open_tables, partitions,
+                                      &barrier_a, &barrier_b,
+                                      (i % NumWarehouses()) + 1,
+                                      i >= first_analytic));
     }
     else {
       for (size_t i = 0; i < sysconf::worker_threads; i++) {
@@ -2529,7 +3813,7 @@ protected:
           new tpcc_worker(
             i,
             r.next(), db, open_tables, partitions,
-            &barrier_a, &barrier_b, i + 1));
+            &barrier_a, &barrier_b, i + 1, i >= first_analytic));
       }
     }
     return ret;
@@ -2558,14 +3842,18 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
       {"workload-mix"                         , required_argument , 0                                     , 'w'} ,
       {"warehouse-spread"                     , required_argument , 0                                     , 's'} ,
       {"80-20-dist"                           , no_argument       , &g_wh_temperature                     , 't'} ,
+      {"numa-placement"                       , no_argument       , &g_numa_placement                     , 1}   ,
       {"microbench-rows"                      , required_argument , 0                                     , 'n'} ,
       {"microbench-wr-ratio"                  , required_argument , 0                                     , 'p'} ,
       {"microbench-wr-rows"                   , required_argument , 0                                     , 'q'} ,
       {"suppliers"                            , required_argument , 0                                     , 'z'} ,
+      {"analytic-workers"                     , required_argument , 0                                     , 'a'} ,
+      {"analytic-mix"                         , required_argument , 0                                     , 'm'} ,
+      {"analytic-lag-mb"                      , required_argument , 0                                     , 'l'} ,
       {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long(argc, argv, "r:w:s:t:n:p:q:z", long_options, &option_index);
+    int c = getopt_long(argc, argv, "r:w:s:t:n:p:q:za:m:l:", long_options, &option_index);
     if (c == -1)
       break;
     switch (c) {
@@ -2613,6 +3901,27 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
       ALWAYS_ASSERT(g_nr_suppliers > 0);
 	  break;
 
+    case 'a':
+      g_analytic_workers = strtoul(optarg, NULL, 10);
+      break;
+
+    case 'm':
+      {
+        const vector<string> toks = split(optarg, ',');
+        ALWAYS_ASSERT(toks.size() == ARRAY_NELEMS(g_analytic_workload_mix));
+        unsigned s = 0;
+        for (size_t i = 0; i < toks.size(); i++) {
+          g_analytic_workload_mix[i] = strtoul(toks[i].c_str(), nullptr, 10);
+          s += g_analytic_workload_mix[i];
+        }
+        ALWAYS_ASSERT(s > 0);
+      }
+      break;
+
+    case 'l':
+      g_analytic_lag_mb = strtoul(optarg, NULL, 10);
+      break;
+
     case '?':
       /* getopt_long already printed an error message. */
       exit(1);
@@ -2627,6 +3936,8 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     cerr << "  --new-order-remote-item-pct will have no effect" << endl;
   }
 
+  ALWAYS_ASSERT(g_analytic_workers <= sysconf::worker_threads);
+
   if (g_wh_temperature) {
     // set up hot and cold WHs
     ALWAYS_ASSERT(NumWarehouses() * 0.2 >= 1);
@@ -2661,6 +3972,7 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     cerr << "  cross_partition_transactions : " << !g_disable_xpartition_txn << endl;
     cerr << "  partition_locks              : " << g_enable_partition_locks << endl;
     cerr << "  separate_tree_per_partition  : " << g_enable_separate_tree_per_partition << endl;
+    cerr << "  numa_placement               : " << g_numa_placement << endl;
     cerr << "  new_order_remote_item_pct    : " << g_new_order_remote_item_pct << endl;
     cerr << "  new_order_fast_id_gen        : " << g_new_order_fast_id_gen << endl;
     cerr << "  uniform_item_dist            : " << g_uniform_item_dist << endl;
@@ -2672,8 +3984,30 @@ tpcc_do_test(abstract_db *db, int argc, char **argv)
     cerr << "  workload_mix                 : " <<
       format_list(g_txn_workload_mix,
                   g_txn_workload_mix + ARRAY_NELEMS(g_txn_workload_mix)) << endl;
+    cerr << "  analytic_workers             : " << g_analytic_workers << endl;
+    cerr << "  analytic_mix                 : " <<
+      format_list(g_analytic_workload_mix,
+                  g_analytic_workload_mix + ARRAY_NELEMS(g_analytic_workload_mix)) << endl;
+    cerr << "  analytic_lag_mb              : " << g_analytic_lag_mb << endl;
   }
 
   tpcc_bench_runner r(db);
   r.run();
+
+  // whether workers found the warehouse-partitioned rows they touched on
+  // their own node, by where the loaders ran
+  uint64_t local = 0, remote = 0;
+  for (size_t i = 0; i < sysconf::worker_threads; i++) {
+    local += g_numa_access[i].elem.local;
+    remote += g_numa_access[i].elem.remote;
+  }
+  if (local + remote)
+    cout << "numa: " << sysconf::numa_nodes << " node(s), "
+         << 100.0 * local / (local + remote) << "% local accesses, "
+         << 100.0 * remote / (local + remote) << "% remote accesses ("
+         << local << " local, " << remote << " remote)" << endl;
+  if (g_analytic_lag_mb)
+    cout << "analytic: " << g_analytic_as_of_queries << " queries as of "
+         << g_analytic_lag_mb << "MB of log ago, " << g_analytic_live_queries
+         << " on live data" << endl;
 }
@@ -29,6 +29,11 @@ int64_t max_ca_id = 0;
 static double g_txn_workload_mix[] = {4.9,13,1,18,14,8,10.1,10,19,2,0}; 
 int64_t long_query_scan_range=20;
 
+// MarketFeed: a savepoint per ticker (see DoMarketFeedFrame1)
+static int g_market_feed_savepoints = 0;
+static uint64_t g_market_feed_rollbacks = 0;
+static uint64_t g_market_feed_skips = 0;
+
 // Egen
 int egen_init(int argc, char* argv[]);
 void egen_release();
@@ -36,6 +41,7 @@ CCETxnInputGenerator* 		transactions_input_init(int customers, int sf, int wdays
 CDM* 						data_maintenance_init(int customers, int sf, int wdays);
 CMEE* 						market_init(INT32 TradingTimeSoFar, CMEESUTInterface *pSUT, UINT32 UniqueId);
 extern CGenerateAndLoad*	pGenerateAndLoad;
+vector<CGenerateAndLoad*>	egen_split_init(UINT nParts);
 CCETxnInputGenerator*		m_TxnInputGenerator;
 CDM*						m_CDM;
 //CMEESUT*					meesut;
@@ -43,37 +49,14 @@ vector<CMEE*> 						mees;
 vector<MFBuffer*> 					MarketFeedInputBuffers;
 vector<TRBuffer*> 					TradeResultInputBuffers;
 
-//Buffers
+//Buffers of the fixed tables; customer-scaled tables have one per range loader
 const int loadUnit = 1000;
-AccountPermissionBuffer accountPermissionBuffer (3015);
-CustomerBuffer customerBuffer (1005);
-CustomerAccountBuffer customerAccountBuffer (1005);
-CustomerTaxrateBuffer  customerTaxrateBuffer (2010);
-HoldingBuffer holdingBuffer(10000);
-HoldingHistoryBuffer holdingHistoryBuffer(2*loadUnit);
-HoldingSummaryBuffer holdingSummaryBuffer(6000);
-WatchItemBuffer watchItemBuffer (iMaxItemsInWL*1020+5000);
-WatchListBuffer watchListBuffer (1020);
-BrokerBuffer brokerBuffer(100);
-CashTransactionBuffer cashTransactionBuffer(loadUnit);
 ChargeBuffer chargeBuffer(20);
 CommissionRateBuffer commissionRateBuffer (245);
-SettlementBuffer settlementBuffer(loadUnit);
-TradeBuffer tradeBuffer(loadUnit);
-TradeHistoryBuffer tradeHistoryBuffer(3*loadUnit);
 TradeTypeBuffer tradeTypeBuffer (10);
-CompanyBuffer companyBuffer (1000);
-CompanyCompetitorBuffer companyCompetitorBuffer(3000);
-DailyMarketBuffer dailyMarketBuffer(3000);
 ExchangeBuffer exchangeBuffer(9);
-FinancialBuffer financialBuffer (1500);
 IndustryBuffer industryBuffer(107);
-LastTradeBuffer lastTradeBuffer (1005);
-NewsItemBuffer newsItemBuffer(200); 
-NewsXRefBuffer newsXRefBuffer(200);//big
 SectorBuffer sectorBuffer(17);
-SecurityBuffer securityBuffer(1005);
-AddressBuffer addressBuffer(1005);
 StatusTypeBuffer statusTypeBuffer (10);
 TaxrateBuffer taxrateBuffer (325);
 ZipCodeBuffer zipCodeBuffer (14850);
@@ -410,6 +393,7 @@ class tpce_worker :
             return ret;
 		}
         rc_t DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn, TMarketFeedFrame1Output *pOut, CSendToMarketInterface *pSendToMarket);
+        rc_t DoMarketFeedTicker(const TTickerEntry &ticker, const TStatusAndTradeType &type, UINT64 now_dts, vector<TTradeRequest> &TradeRequestBuffer);
 
 		// MarketWatch
         static rc_t MarketWatch(bench_worker *w)
@@ -993,10 +977,6 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn, TMarketF
 
 	auto now_dts = CDateTime().GetDate();	
 	vector<TTradeRequest> TradeRequestBuffer;
-	double req_price_quote = 0; 
-	uint64_t req_trade_id = 0; 
-	int32_t req_trade_qty = 0; 
-    inline_str_fixed<cTT_ID_len> req_trade_type;
 
 	TStatusAndTradeType type = pIn->StatusAndTradeType;
     // FIXME (tzwang): Spec (v1.3) says to use a new tx in the loop below,
@@ -1012,131 +992,163 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn, TMarketF
     txn = db->new_txn(txn_flags, arena, txn_buf(), abstract_db::HINT_DEFAULT);
 	for( int i = 0; i < max_feed_len; i++ )
 	{
-		TTickerEntry ticker = pIn->Entries[i];
-
-		last_trade::key k_lt(ticker.symbol);
-		last_trade::value v_lt_temp;
-		try_verify_relax(tbl_last_trade(1)->get(txn, Encode(obj_key0=str(sizeof(k_lt)), k_lt), obj_v=str(sizeof(v_lt_temp))));
-		const last_trade::value *v_lt = Decode(obj_v,v_lt_temp);
-		last_trade::value v_lt_new(*v_lt);
-		v_lt_new.lt_dts = now_dts;
-		v_lt_new.lt_price = v_lt->lt_price + ticker.price_quote;
-		v_lt_new.lt_vol = ticker.price_quote;
-		try_catch(tbl_last_trade(1)->put(txn, Encode(obj_key0=str(sizeof(k_lt)), k_lt), Encode(obj_v=str(sizeof(v_lt_new)), v_lt_new)));
+		const TTickerEntry &ticker = pIn->Entries[i];
+		// With savepoints each ticker is a step of its own, as in the
+		// spec's sub-transactions: a step that hits a write conflict is
+		// rolled back and retried once, then left out instead of aborting
+		// the others. Other aborts end the transaction: under SSN/SSI the
+		// reads that caused them stay in its read set and stamps, so a
+		// retry would fail the same way at commit.
+		const size_t sp = g_market_feed_savepoints ? db->set_savepoint(txn) : 0;
+		rc_t rc = DoMarketFeedTicker(ticker, type, now_dts, TradeRequestBuffer);
+		if (rc._val == RC_ABORT_SI_CONFLICT and g_market_feed_savepoints and
+		    db->rollback_txn_to(txn, sp)) {
+			__sync_fetch_and_add(&g_market_feed_rollbacks, 1);
+			TradeRequestBuffer.clear();
+			rc = DoMarketFeedTicker(ticker, type, now_dts, TradeRequestBuffer);
+			if (rc._val == RC_ABORT_SI_CONFLICT and db->rollback_txn_to(txn, sp)) {
+				__sync_fetch_and_add(&g_market_feed_rollbacks, 1);
+				__sync_fetch_and_add(&g_market_feed_skips, 1);
+				TradeRequestBuffer.clear();
+				continue;
+			}
+		}
+		try_catch(rc);
 
 		pOut->num_updated++;
-
-		const trade_request::key k_tr_0( string(ticker.symbol),  MIN_VAL(k_tr_0.tr_b_id), MIN_VAL(k_tr_0.tr_t_id) );
-		const trade_request::key k_tr_1( string(ticker.symbol),  MAX_VAL(k_tr_1.tr_b_id), MAX_VAL(k_tr_1.tr_t_id) );
-		table_scanner tr_scanner(&arena);
-		try_catch(tbl_trade_request(1)->scan(txn, Encode(obj_key0=str(sizeof(k_tr_0)), k_tr_0), &Encode(obj_key1=str(sizeof(k_tr_1)), k_tr_1), tr_scanner, &arena));
-//		ALWAYS_ASSERT( tr_scanner.output.size() );			// XXX. If there's no previous trade, this can happen. Higher initial trading days would enlarge this scan set
-
-		std::vector<std::pair<varstr *, const varstr *>> request_list_cursor;
-		for( auto &r_tr : tr_scanner.output )
+		pOut->send_len += TradeRequestBuffer.size();
+		for( size_t i = 0; i < TradeRequestBuffer.size(); i++ )
 		{
-			trade_request::value v_tr_temp;
-			const trade_request::value* v_tr = Decode(*r_tr.second, v_tr_temp );
-
-			if( (v_tr->tr_tt_id == string(type.type_stop_loss) and v_tr->tr_bid_price >= ticker.price_quote) or
-				(v_tr->tr_tt_id == string(type.type_limit_sell) and v_tr->tr_bid_price <= ticker.price_quote) or
-				(v_tr->tr_tt_id == string(type.type_limit_buy) and v_tr->tr_bid_price >= ticker.price_quote) )
-			{
-				request_list_cursor.push_back( r_tr );
-			}
+			SendToMarketFromFrame(TradeRequestBuffer[i]);
 		}
+		TradeRequestBuffer.clear();
+	}
 
-		for( auto &r_tr : request_list_cursor )
-		{
-			trade_request::key k_tr_temp;
-			trade_request::value v_tr_temp;
-			const trade_request::key* k_tr = Decode( *r_tr.first, k_tr_temp );
-			const trade_request::value* v_tr = Decode(*r_tr.second, v_tr_temp );
-
-			req_trade_id = k_tr->tr_t_id;
-			req_price_quote = v_tr->tr_bid_price;
-			req_trade_type = v_tr->tr_tt_id;
-			req_trade_qty = v_tr->tr_qty;
-
-			const trade::key k_t(req_trade_id);
-			trade::value v_t_temp;
-			try_verify_relax(tbl_trade(1)->get(txn, Encode(obj_key0=str(sizeof(k_t)), k_t), obj_v=str(sizeof(v_t_temp))));
-			const trade::value *v_t = Decode(obj_v,v_t_temp);
-			trade::value v_t_new(*v_t);
-			v_t_new.t_dts = now_dts;
-			v_t_new.t_st_id = string(type.status_submitted);
-			try_catch(tbl_trade(1)->put(txn, Encode(obj_key0=str(sizeof(k_t)), k_t), Encode(obj_v=str(sizeof(v_t_new)), v_t_new)));
+    try_catch(db->commit_txn(txn));
+    return {RC_TRUE};
+}
 
-			// DTS field is updated. cascading update( actually insert after remove, because dts is included in PK )
-			t_ca_id_index::key k_t_idx1;
-			t_ca_id_index::value v_t_idx1;
-			k_t_idx1.t_ca_id 		= v_t->t_ca_id;
-			k_t_idx1.t_dts 			= v_t->t_dts;
-			k_t_idx1.t_id 			= k_t.t_id;
-			try_verify_relax(tbl_t_ca_id_index(1)->remove(txn, Encode(obj_key0=str(sizeof(k_t_idx1)), k_t_idx1)));
+// One ticker of MarketFeed: update its last trade and turn the trade
+// requests it triggers into trades. Returns an abort code instead of
+// aborting, so the caller can roll back to a savepoint.
+rc_t tpce_worker::DoMarketFeedTicker(const TTickerEntry &ticker, const TStatusAndTradeType &type, UINT64 now_dts, vector<TTradeRequest> &TradeRequestBuffer)
+{
+	double req_price_quote = 0;
+	uint64_t req_trade_id = 0;
+	int32_t req_trade_qty = 0;
+	inline_str_fixed<cTT_ID_len> req_trade_type;
 
-			k_t_idx1.t_ca_id 		= v_t_new.t_ca_id;
-			k_t_idx1.t_dts 			= v_t_new.t_dts;
-			k_t_idx1.t_id 			= k_t.t_id;
-			v_t_idx1.t_st_id 		= v_t_new.t_st_id ;
-			v_t_idx1.t_tt_id 		= v_t_new.t_tt_id ;
-			v_t_idx1.t_is_cash 		= v_t_new.t_is_cash ;
-			v_t_idx1.t_s_symb 		= v_t_new.t_s_symb ;
-			v_t_idx1.t_qty 			= v_t_new.t_qty ;
-			v_t_idx1.t_bid_price 	= v_t_new.t_bid_price ;
-			v_t_idx1.t_exec_name 	= v_t_new.t_exec_name ;
-			v_t_idx1.t_trade_price 	= v_t_new.t_trade_price ;
-			v_t_idx1.t_chrg 		= v_t_new.t_chrg ;
-			try_catch(tbl_t_ca_id_index(1)->insert(txn, Encode(obj_key0=str(sizeof(k_t_idx1)), k_t_idx1), Encode(obj_v=str(sizeof(v_t_idx1)), v_t_idx1)));
+	last_trade::key k_lt(ticker.symbol);
+	last_trade::value v_lt_temp;
+	try_verify_relax_return(tbl_last_trade(1)->get(txn, Encode(obj_key0=str(sizeof(k_lt)), k_lt), obj_v=str(sizeof(v_lt_temp))));
+	const last_trade::value *v_lt = Decode(obj_v,v_lt_temp);
+	last_trade::value v_lt_new(*v_lt);
+	v_lt_new.lt_dts = now_dts;
+	v_lt_new.lt_price = v_lt->lt_price + ticker.price_quote;
+	v_lt_new.lt_vol = ticker.price_quote;
+	try_return(tbl_last_trade(1)->put(txn, Encode(obj_key0=str(sizeof(k_lt)), k_lt), Encode(obj_v=str(sizeof(v_lt_new)), v_lt_new)));
+
+	const trade_request::key k_tr_0( string(ticker.symbol),  MIN_VAL(k_tr_0.tr_b_id), MIN_VAL(k_tr_0.tr_t_id) );
+	const trade_request::key k_tr_1( string(ticker.symbol),  MAX_VAL(k_tr_1.tr_b_id), MAX_VAL(k_tr_1.tr_t_id) );
+	table_scanner tr_scanner(&arena);
+	try_return(tbl_trade_request(1)->scan(txn, Encode(obj_key0=str(sizeof(k_tr_0)), k_tr_0), &Encode(obj_key1=str(sizeof(k_tr_1)), k_tr_1), tr_scanner, &arena));
+//		ALWAYS_ASSERT( tr_scanner.output.size() );			// XXX. If there's no previous trade, this can happen. Higher initial trading days would enlarge this scan set
 
-			t_s_symb_index::key k_t_idx2;
-			t_s_symb_index::value v_t_idx2;
-			k_t_idx2.t_s_symb 		= v_t->t_s_symb;
-			k_t_idx2.t_dts 			= v_t->t_dts;
-			k_t_idx2.t_id 			= k_t.t_id;
-			try_verify_relax(tbl_t_s_symb_index(1)->remove(txn, Encode(obj_key0=str(sizeof(k_t_idx2)), k_t_idx2)));
-			k_t_idx2.t_s_symb 		= v_t_new.t_s_symb ;
-			k_t_idx2.t_dts 			= v_t_new.t_dts;
-			k_t_idx2.t_id 			= k_t.t_id;
-			v_t_idx2.t_ca_id 		= v_t_new.t_ca_id;
-			v_t_idx2.t_st_id 		= v_t_new.t_st_id ;
-			v_t_idx2.t_tt_id 		= v_t_new.t_tt_id ;
-			v_t_idx2.t_is_cash 		= v_t_new.t_is_cash ;
-			v_t_idx2.t_qty 			= v_t_new.t_qty ;
-			v_t_idx2.t_exec_name 	= v_t_new.t_exec_name ;
-			v_t_idx2.t_trade_price 	= v_t_new.t_trade_price ;
-			try_catch(tbl_t_s_symb_index(1)->insert(txn, Encode(obj_key0=str(sizeof(k_t_idx2)), k_t_idx2), Encode(obj_v=str(sizeof(v_t_idx2)), v_t_idx2)));
-
-			trade_request::key k_tr_new(*k_tr);
-			try_verify_relax(tbl_trade_request(1)->remove(txn, Encode(obj_key0=str(sizeof(k_tr_new)), k_tr_new)));
-
-			trade_history::key k_th;
-			trade_history::value v_th;
-			k_th.th_t_id = req_trade_id;
-			k_th.th_dts = now_dts;
-			k_th.th_st_id = string(type.status_submitted);
-			try_catch(tbl_trade_history(1)->insert(txn, Encode(obj_key0=str(sizeof(k_th)), k_th), Encode(obj_v=str(sizeof(v_th)), v_th)));
-
-			TTradeRequest request;
-			memset( &request, 0, sizeof(request));
-			memcpy(request.symbol, ticker.symbol, cSYMBOL_len+1);
-			request.trade_id = req_trade_id;
-			request.price_quote = req_price_quote;
-			request.trade_qty = req_trade_qty;
-			memcpy(request.trade_type_id, req_trade_type.data(), req_trade_type.size());
-			TradeRequestBuffer.emplace_back( request );
-		}
+	std::vector<std::pair<varstr *, const varstr *>> request_list_cursor;
+	for( auto &r_tr : tr_scanner.output )
+	{
+		trade_request::value v_tr_temp;
+		const trade_request::value* v_tr = Decode(*r_tr.second, v_tr_temp );
 
-		pOut->send_len += request_list_cursor.size();
-		for( size_t i = 0; i < request_list_cursor.size(); i++ )
+		if( (v_tr->tr_tt_id == string(type.type_stop_loss) and v_tr->tr_bid_price >= ticker.price_quote) or
+			(v_tr->tr_tt_id == string(type.type_limit_sell) and v_tr->tr_bid_price <= ticker.price_quote) or
+			(v_tr->tr_tt_id == string(type.type_limit_buy) and v_tr->tr_bid_price >= ticker.price_quote) )
 		{
-			SendToMarketFromFrame(TradeRequestBuffer[i]);
+			request_list_cursor.push_back( r_tr );
 		}
-		TradeRequestBuffer.clear();
 	}
 
-    try_catch(db->commit_txn(txn));
-    return {RC_TRUE};
+	for( auto &r_tr : request_list_cursor )
+	{
+		trade_request::key k_tr_temp;
+		trade_request::value v_tr_temp;
+		const trade_request::key* k_tr = Decode( *r_tr.first, k_tr_temp );
+		const trade_request::value* v_tr = Decode(*r_tr.second, v_tr_temp );
+
+		req_trade_id = k_tr->tr_t_id;
+		req_price_quote = v_tr->tr_bid_price;
+		req_trade_type = v_tr->tr_tt_id;
+		req_trade_qty = v_tr->tr_qty;
+
+		const trade::key k_t(req_trade_id);
+		trade::value v_t_temp;
+		try_verify_relax_return(tbl_trade(1)->get(txn, Encode(obj_key0=str(sizeof(k_t)), k_t), obj_v=str(sizeof(v_t_temp))));
+		const trade::value *v_t = Decode(obj_v,v_t_temp);
+		trade::value v_t_new(*v_t);
+		v_t_new.t_dts = now_dts;
+		v_t_new.t_st_id = string(type.status_submitted);
+		try_return(tbl_trade(1)->put(txn, Encode(obj_key0=str(sizeof(k_t)), k_t), Encode(obj_v=str(sizeof(v_t_new)), v_t_new)));
+
+		// DTS field is updated. cascading update( actually insert after remove, because dts is included in PK )
+		t_ca_id_index::key k_t_idx1;
+		t_ca_id_index::value v_t_idx1;
+		k_t_idx1.t_ca_id 		= v_t->t_ca_id;
+		k_t_idx1.t_dts 			= v_t->t_dts;
+		k_t_idx1.t_id 			= k_t.t_id;
+		try_verify_relax_return(tbl_t_ca_id_index(1)->remove(txn, Encode(obj_key0=str(sizeof(k_t_idx1)), k_t_idx1)));
+
+		k_t_idx1.t_ca_id 		= v_t_new.t_ca_id;
+		k_t_idx1.t_dts 			= v_t_new.t_dts;
+		k_t_idx1.t_id 			= k_t.t_id;
+		v_t_idx1.t_st_id 		= v_t_new.t_st_id ;
+		v_t_idx1.t_tt_id 		= v_t_new.t_tt_id ;
+		v_t_idx1.t_is_cash 		= v_t_new.t_is_cash ;
+		v_t_idx1.t_s_symb 		= v_t_new.t_s_symb ;
+		v_t_idx1.t_qty 			= v_t_new.t_qty ;
+		v_t_idx1.t_bid_price 	= v_t_new.t_bid_price ;
+		v_t_idx1.t_exec_name 	= v_t_new.t_exec_name ;
+		v_t_idx1.t_trade_price 	= v_t_new.t_trade_price ;
+		v_t_idx1.t_chrg 		= v_t_new.t_chrg ;
+		try_return(tbl_t_ca_id_index(1)->insert(txn, Encode(obj_key0=str(sizeof(k_t_idx1)), k_t_idx1), Encode(obj_v=str(sizeof(v_t_idx1)), v_t_idx1)));
+
+		t_s_symb_index::key k_t_idx2;
+		t_s_symb_index::value v_t_idx2;
+		k_t_idx2.t_s_symb 		= v_t->t_s_symb;
+		k_t_idx2.t_dts 			= v_t->t_dts;
+		k_t_idx2.t_id 			= k_t.t_id;
+		try_verify_relax_return(tbl_t_s_symb_index(1)->remove(txn, Encode(obj_key0=str(sizeof(k_t_idx2)), k_t_idx2)));
+		k_t_idx2.t_s_symb 		= v_t_new.t_s_symb ;
+		k_t_idx2.t_dts 			= v_t_new.t_dts;
+		k_t_idx2.t_id 			= k_t.t_id;
+		v_t_idx2.t_ca_id 		= v_t_new.t_ca_id;
+		v_t_idx2.t_st_id 		= v_t_new.t_st_id ;
+		v_t_idx2.t_tt_id 		= v_t_new.t_tt_id ;
+		v_t_idx2.t_is_cash 		= v_t_new.t_is_cash ;
+		v_t_idx2.t_qty 			= v_t_new.t_qty ;
+		v_t_idx2.t_exec_name 	= v_t_new.t_exec_name ;
+		v_t_idx2.t_trade_price 	= v_t_new.t_trade_price ;
+		try_return(tbl_t_s_symb_index(1)->insert(txn, Encode(obj_key0=str(sizeof(k_t_idx2)), k_t_idx2), Encode(obj_v=str(sizeof(v_t_idx2)), v_t_idx2)));
+
+		trade_request::key k_tr_new(*k_tr);
+		try_verify_relax_return(tbl_trade_request(1)->remove(txn, Encode(obj_key0=str(sizeof(k_tr_new)), k_tr_new)));
+
+		trade_history::key k_th;
+		trade_history::value v_th;
+		k_th.th_t_id = req_trade_id;
+		k_th.th_dts = now_dts;
+		k_th.th_st_id = string(type.status_submitted);
+		try_return(tbl_trade_history(1)->insert(txn, Encode(obj_key0=str(sizeof(k_th)), k_th), Encode(obj_v=str(sizeof(v_th)), v_th)));
+
+		TTradeRequest request;
+		memset( &request, 0, sizeof(request));
+		memcpy(request.symbol, ticker.symbol, cSYMBOL_len+1);
+		request.trade_id = req_trade_id;
+		request.price_quote = req_price_quote;
+		request.trade_qty = req_trade_qty;
+		memcpy(request.trade_type_id, req_trade_type.data(), req_trade_type.size());
+		TradeRequestBuffer.emplace_back( request );
+	}
+	return {RC_TRUE};
 }
 
 rc_t tpce_worker::DoMarketWatchFrame1 (const TMarketWatchFrame1Input *pIn, TMarketWatchFrame1Output *pOut)
@@ -3749,15 +3761,28 @@ class tpce_zip_code_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_address_loader : public bench_loader, public tpce_worker_mixin {
+// Customer-scaled tables can be generated for any range of whole load units,
+// so their loaders take the generator of one customer range instead of the
+// global one and several ranges load at once (see make_loaders()).
+class tpce_range_loader_mixin {
+	protected:
+		tpce_range_loader_mixin(CGenerateAndLoad *generator)
+			: pGenerateAndLoad(generator) {}
+
+		CGenerateAndLoad *pGenerateAndLoad;	// hides the global generator
+};
+
+class tpce_address_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_address_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -3770,6 +3795,7 @@ class tpce_address_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					AddressBuffer addressBuffer(1005);
 					pGenerateAndLoad->InitAddress();
 					while(addressBuffer.hasMoreToRead()){
 						addressBuffer.reset();
@@ -3809,15 +3835,17 @@ class tpce_address_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_customer_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_customer_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_customer_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -3830,6 +3858,7 @@ class tpce_customer_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					CustomerBuffer customerBuffer(1005);
 					pGenerateAndLoad->InitCustomer();
 					while(customerBuffer.hasMoreToRead()){
 						customerBuffer.reset();
@@ -3895,15 +3924,17 @@ class tpce_customer_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_ca_and_ap_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -3916,6 +3947,8 @@ class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					AccountPermissionBuffer accountPermissionBuffer(3015);
+					CustomerAccountBuffer customerAccountBuffer(1005);
 					pGenerateAndLoad->InitCustomerAccountAndAccountPermission();
 					while(customerAccountBuffer.hasMoreToRead()){
 						customerAccountBuffer.reset();
@@ -3946,10 +3979,12 @@ class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
 
 							k.ca_id 		= record->CA_ID;
 
-							if( likely( record->CA_ID > max_ca_id ) )
-								max_ca_id = record->CA_ID;
-							if( unlikely( record->CA_ID < min_ca_id ) )
-								min_ca_id = record->CA_ID;
+							// other customer ranges may be loading concurrently
+							int64_t ca_id;
+							while( likely( record->CA_ID > ( ca_id = volatile_read( max_ca_id ) ) ) and
+									not __sync_bool_compare_and_swap( &max_ca_id, ca_id, record->CA_ID ) );
+							while( unlikely( record->CA_ID < ( ca_id = volatile_read( min_ca_id ) ) ) and
+									not __sync_bool_compare_and_swap( &min_ca_id, ca_id, record->CA_ID ) );
 
 							v.ca_b_id 	= record->CA_B_ID;
 							v.ca_c_id 	= record->CA_C_ID;
@@ -3997,15 +4032,17 @@ class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_customer_taxrate_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_customer_taxrate_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_customer_taxrate_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4018,6 +4055,7 @@ class tpce_customer_taxrate_loader : public bench_loader, public tpce_worker_mix
 		virtual void
 			load()
 			{
+					CustomerTaxrateBuffer customerTaxrateBuffer(2010);
 					pGenerateAndLoad->InitCustomerTaxrate();
 					while(customerTaxrateBuffer.hasMoreToRead()){
 						customerTaxrateBuffer.reset();
@@ -4058,15 +4096,17 @@ class tpce_customer_taxrate_loader : public bench_loader, public tpce_worker_mix
 		ssize_t partition_id;
 };
 
-class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_wl_and_wi_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4079,6 +4119,8 @@ class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					WatchItemBuffer watchItemBuffer(iMaxItemsInWL*1020+5000);
+					WatchListBuffer watchListBuffer(1020);
 					pGenerateAndLoad->InitWatchListAndWatchItem();
 					while(watchListBuffer.hasMoreToRead()){
 						watchItemBuffer.reset();
@@ -4139,15 +4181,17 @@ class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_company_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_company_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_company_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4160,6 +4204,7 @@ class tpce_company_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					CompanyBuffer companyBuffer(1000);
 					pGenerateAndLoad->InitCompany();
 					while(companyBuffer.hasMoreToRead()){
 						companyBuffer.reset();
@@ -4214,15 +4259,17 @@ class tpce_company_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_company_competitor_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_company_competitor_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_company_competitor_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4235,6 +4282,7 @@ class tpce_company_competitor_loader : public bench_loader, public tpce_worker_m
 		virtual void
 			load()
 			{
+					CompanyCompetitorBuffer companyCompetitorBuffer(3000);
 					pGenerateAndLoad->InitCompanyCompetitor();
 					while(companyCompetitorBuffer.hasMoreToRead()){
 						companyCompetitorBuffer.reset();
@@ -4273,15 +4321,17 @@ class tpce_company_competitor_loader : public bench_loader, public tpce_worker_m
 		ssize_t partition_id;
 };
 
-class tpce_daily_market_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_daily_market_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_daily_market_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4294,6 +4344,7 @@ class tpce_daily_market_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					DailyMarketBuffer dailyMarketBuffer(3000);
 					pGenerateAndLoad->InitDailyMarket();
 					while(dailyMarketBuffer.hasMoreToRead()){
 						dailyMarketBuffer.reset();
@@ -4334,15 +4385,17 @@ class tpce_daily_market_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_financial_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_financial_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_financial_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4355,6 +4408,7 @@ class tpce_financial_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					FinancialBuffer financialBuffer(1500);
 					pGenerateAndLoad->InitFinancial();
 					while(financialBuffer.hasMoreToRead()){
 						financialBuffer.reset();
@@ -4397,22 +4451,24 @@ class tpce_financial_loader : public bench_loader, public tpce_worker_mixin {
 						}
 					}
 					pGenerateAndLoad->ReleaseFinancial();
-					dailyMarketBuffer.release();
+					financialBuffer.release();
 			}
 
 	private:
 		ssize_t partition_id;
 };
 
-class tpce_last_trade_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_last_trade_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_last_trade_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4425,6 +4481,7 @@ class tpce_last_trade_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					LastTradeBuffer lastTradeBuffer(1005);
 					pGenerateAndLoad->InitLastTrade();
 					while(lastTradeBuffer.hasMoreToRead()){
 						lastTradeBuffer.reset();
@@ -4464,15 +4521,17 @@ class tpce_last_trade_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_ni_and_nx_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4485,6 +4544,8 @@ class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					NewsItemBuffer newsItemBuffer(200);
+					NewsXRefBuffer newsXRefBuffer(200);
 					pGenerateAndLoad->InitNewsItemAndNewsXRef();
 					while(newsItemBuffer.hasMoreToRead()){
 						newsItemBuffer.reset();
@@ -4550,15 +4611,17 @@ class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_security_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_security_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_security_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
+			tpce_range_loader_mixin(generator),
 			partition_id(partition_id)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
@@ -4571,6 +4634,7 @@ class tpce_security_loader : public bench_loader, public tpce_worker_mixin {
 		virtual void
 			load()
 			{
+					SecurityBuffer securityBuffer(1005);
 					pGenerateAndLoad->InitSecurity();
 					while(securityBuffer.hasMoreToRead()){
 						securityBuffer.reset();
@@ -4628,16 +4692,26 @@ class tpce_security_loader : public bench_loader, public tpce_worker_mixin {
 		ssize_t partition_id;
 };
 
-class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
+class tpce_growing_loader : public bench_loader, public tpce_worker_mixin, public tpce_range_loader_mixin {
 	public:
 		tpce_growing_loader(unsigned long seed,
 				abstract_db *db,
 				const map<string, abstract_ordered_index *> &open_tables,
 				const map<string, vector<abstract_ordered_index *>> &partitions,
-				ssize_t partition_id)
+				ssize_t partition_id,
+				CGenerateAndLoad *generator)
 			: bench_loader(seed, db, open_tables),
 			tpce_worker_mixin(partitions),
-			partition_id(partition_id)
+			tpce_range_loader_mixin(generator),
+			partition_id(partition_id),
+			holdingBuffer(10000),
+			holdingHistoryBuffer(2*loadUnit),
+			holdingSummaryBuffer(6000),
+			brokerBuffer(100),
+			cashTransactionBuffer(loadUnit),
+			settlementBuffer(loadUnit),
+			tradeBuffer(loadUnit),
+			tradeHistoryBuffer(3*loadUnit)
 	{
 		ALWAYS_ASSERT(partition_id == -1 ||
 				(partition_id >= 1 &&
@@ -4720,8 +4794,9 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
 					trade::value v;
 
 					k.t_id 			=	record->T_ID 			;
-					if( likely( record->T_ID > lastTradeId ) )
-						lastTradeId		= record->T_ID ;
+					int64_t t_id;
+					while( likely( record->T_ID > ( t_id = volatile_read( lastTradeId ) ) ) and
+							not __sync_bool_compare_and_swap( &lastTradeId, t_id, record->T_ID ) );
 					v.t_dts 			=	record->T_DTS.GetDate();
 					v.t_st_id			=	string(record->T_ST_ID)	;
 					v.t_tt_id			=	string(record->T_TT_ID)	;
@@ -4951,6 +5026,14 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
 
 	private:
 		ssize_t partition_id;
+		HoldingBuffer holdingBuffer;
+		HoldingHistoryBuffer holdingHistoryBuffer;
+		HoldingSummaryBuffer holdingSummaryBuffer;
+		BrokerBuffer brokerBuffer;
+		CashTransactionBuffer cashTransactionBuffer;
+		SettlementBuffer settlementBuffer;
+		TradeBuffer tradeBuffer;
+		TradeHistoryBuffer tradeHistoryBuffer;
 };
 
 
@@ -5020,23 +5103,42 @@ class tpce_bench_runner : public bench_runner {
 				ret.push_back(new tpce_tax_rate_loader(89785943, db, open_tables, partitions, -1));
 				ret.push_back(new tpce_trade_type_loader(129856349, db, open_tables, partitions, -1));
 				ret.push_back(new tpce_zip_code_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_address_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_customer_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_ca_and_ap_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_customer_taxrate_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_wl_and_wi_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_company_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_company_competitor_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_daily_market_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_financial_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_last_trade_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_ni_and_nx_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_security_loader(923587856425, db, open_tables, partitions, -1));
-				ret.push_back(new tpce_growing_loader(923587856425, db, open_tables, partitions, -1));
+				// The customer-scaled tables load as one range per worker thread
+				// with --parallel-loading, each from a generator of its own
+				vector<CGenerateAndLoad *> generators;
+				if (enable_parallel_loading) {
+					split_generators = egen_split_init(sysconf::worker_threads);
+					generators = split_generators;
+				} else
+					generators.push_back(pGenerateAndLoad);
+				for (auto *generator : generators) {
+					ret.push_back(new tpce_address_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_customer_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_ca_and_ap_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_customer_taxrate_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_wl_and_wi_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_company_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_company_competitor_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_daily_market_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_financial_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_last_trade_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_ni_and_nx_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_security_loader(923587856425, db, open_tables, partitions, -1, generator));
+					ret.push_back(new tpce_growing_loader(923587856425, db, open_tables, partitions, -1, generator));
+				}
 
 				return ret;
 			}
 
+		// pGenerateAndLoad stays with egen_release(); only the split ones are ours
+		virtual void
+			on_load_end()
+			{
+				for (auto *generator : split_generators)
+					delete generator;
+				split_generators.clear();
+			}
+
 		virtual vector<bench_worker *>
 			make_workers()
 			{
@@ -5079,6 +5181,8 @@ class tpce_bench_runner : public bench_runner {
 
 	private:
 		map<string, vector<abstract_ordered_index *>> partitions;
+		// per-range generators from egen_split_init(), freed in on_load_end()
+		vector<CGenerateAndLoad *> split_generators;
 };
 
 
@@ -5105,6 +5209,7 @@ void tpce_do_test(abstract_db *db, int argc, char **argv)
 			{"customers"                        , required_argument , 0                                     , 'c'} ,
 			{"working-days"                     , required_argument , 0                                     , 'd'} ,
 			{"query-range"                     , required_argument , 0                                     , 'r'} ,
+			{"market-feed-savepoints"           , no_argument       , &g_market_feed_savepoints             , 1} ,
 			{0, 0, 0, 0}
 		};
 		int option_index = 0;
@@ -5194,8 +5299,12 @@ void tpce_do_test(abstract_db *db, int argc, char **argv)
 		cerr << "  working days                 :" << " " << wd_str << endl;
 		cerr << "  customers                    :" << " " << cust_str << endl;
 		cerr << "  long query scan range		:" << " " << long_query_scan_range << "%" << endl;
+		cerr << "  market feed savepoints       :" << " " << g_market_feed_savepoints << endl;
 	}
 
 	tpce_bench_runner r(db);
 	r.run();
+	if (g_market_feed_savepoints)
+		cerr << "market feed: " << g_market_feed_rollbacks << " ticker rollbacks, "
+			<< g_market_feed_skips << " tickers left out" << endl;
 }
@@ -16,6 +16,8 @@
 #include "sm-defs.h"
 #include "sm-exceptions.h"
 
+#include <algorithm>
+
 struct adler32_nop_op {
     template <typename T>
     void operator()(T) { }
@@ -105,6 +107,85 @@ adler32_memcpy_vanilla(char *dest, char const *src, size_t nbytes, uint32_t sofa
 }
 
 
+#ifdef __x86_64__
+#include <immintrin.h>
+
+/* AVX2 works on 32-byte chunks. For a chunk d[0..31] and running sums
+   (a, b):
+
+   a' = a + sum(d[i])
+   b' = b + 32*a + sum((32-i)*d[i])
+
+   Over n chunks, the 32*a terms add up to 32*n*a plus 32 times the
+   sum of the partial [a] deltas seen before each chunk (vps below). We
+   reduce every AVX2_MAX_CHUNKS chunks, which keeps every 32-bit lane
+   far from overflow (the largest, vps, stays below 2**26).
+ */
+static size_t const AVX2_MAX_CHUNKS = 173;
+
+static inline __attribute__((target("avx2")))
+uint32_t adler32_avx2_hsum(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+}
+
+template <bool Copy>
+static uint32_t __attribute__((target("avx2")))
+adler32_avx2(char *dest, char const *data, size_t nbytes, uint32_t sofar)
+{
+    uint64_t a = sofar & 0xffff, b = sofar >> 16;
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const ones = _mm256_set1_epi16(1);
+    __m256i const weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                             24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10,  9,
+                                              8,  7,  6,  5,  4,  3,  2,  1);
+    size_t i = 0;
+    while (nbytes - i >= 32) {
+        size_t n = std::min((nbytes - i) / 32, AVX2_MAX_CHUNKS);
+        __m256i vs1 = zero, vs2 = zero, vps = zero;
+        for (size_t j = 0; j < n; j++, i += 32) {
+            __m256i d = _mm256_loadu_si256((__m256i const *) (data + i));
+            if (Copy)
+                _mm256_storeu_si256((__m256i *) (dest + i), d);
+            vps = _mm256_add_epi32(vps, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(d, zero));
+            vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(d, weights), ones));
+        }
+        b += 32*n*a + 32*(uint64_t) adler32_avx2_hsum(vps) + adler32_avx2_hsum(vs2);
+        a += adler32_avx2_hsum(vs1);
+        a %= MOD_ADLER;
+        b %= MOD_ADLER;
+    }
+
+    for (; i < nbytes; i++) {
+        if (Copy)
+            dest[i] = data[i];
+        a += (uint8_t) data[i];
+        b += a;
+    }
+    a %= MOD_ADLER;
+    b %= MOD_ADLER;
+    return (b << 16) | a;
+}
+
+uint32_t
+adler32_avx2(char const *data, size_t nbytes, uint32_t sofar)
+{
+    return adler32_avx2<false>(0, data, nbytes, sofar);
+}
+
+/* Unlike the SSE variant, this one has no alignment requirements */
+uint32_t
+adler32_memcpy_avx2(char *dest, char const *src, size_t nbytes, uint32_t sofar)
+{
+    return adler32_avx2<true>(dest, src, nbytes, sofar);
+}
+#endif
+
 #ifdef __SSSE3__
 #include <x86intrin.h>
 
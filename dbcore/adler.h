@@ -46,6 +46,12 @@ uint32_t adler32_vanilla(char const *data, size_t nbytes, uint32_t sofar=ADLER32
 #ifdef __SSSE3__
 uint32_t adler32_sse(char const *data, size_t nbytes, uint32_t sofar=ADLER32_CSUM_INIT);
 #endif
+#ifdef __x86_64__
+/* AVX2 variants are compiled regardless of -march, so callers must
+   check for CPU support first (see sm-log-checksum.h).
+ */
+uint32_t adler32_avx2(char const *data, size_t nbytes, uint32_t sofar=ADLER32_CSUM_INIT);
+#endif
 
 /* Combine two adjacent checksums into a single one and return the
    result. Useful for creating the aggregate checksum that would have
@@ -66,5 +72,8 @@ uint32_t adler32_memcpy_vanilla(char *dest, char const *src, size_t nbytes, uint
 #ifdef __SSSE3__
 uint32_t adler32_memcpy_sse(char *dest, char const *src, size_t nbytes, uint32_t sofar=ADLER32_CSUM_INIT);
 #endif
+#ifdef __x86_64__
+uint32_t adler32_memcpy_avx2(char *dest, char const *src, size_t nbytes, uint32_t sofar=ADLER32_CSUM_INIT);
+#endif
 
 #endif
@@ -0,0 +1,160 @@
+#include "crc32c.h"
+
+#include <string.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+/* Reflected Castagnoli polynomial */
+static uint32_t const CRC32C_POLY = 0x82f63b78;
+
+namespace {
+
+/* Byte-at-a-time lookup table for the scalar version */
+struct crc32c_table {
+    uint32_t entries[256];
+    crc32c_table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++)
+                crc = (crc >> 1) ^ (-(crc & 1) & CRC32C_POLY);
+            entries[i] = crc;
+        }
+    }
+};
+
+/* Appending [n] zero bytes to a message is a linear operation on its
+   (unfinished) CRC, which we can express as a 32x32 matrix over
+   GF(2). Merging two checksums needs the operator for the length of
+   the right hand piece; we keep the ones for every power-of-two length
+   around so a merge costs one matrix-vector product per set bit of the
+   length rather than zlib's repeated squaring.
+ */
+struct crc32c_zeros {
+    uint32_t ops[64][32];
+
+    static uint32_t times(uint32_t const *mat, uint32_t vec) {
+        uint32_t sum = 0;
+        for (; vec; vec >>= 1, mat++) {
+            if (vec & 1)
+                sum ^= *mat;
+        }
+        return sum;
+    }
+    static void square(uint32_t *dest, uint32_t const *mat) {
+        for (int i = 0; i < 32; i++)
+            dest[i] = times(mat, mat[i]);
+    }
+
+    crc32c_zeros() {
+        // operator for one zero bit, then square up to one zero byte
+        uint32_t bit[32], two[32], four[32];
+        bit[0] = CRC32C_POLY;
+        for (int i = 1; i < 32; i++)
+            bit[i] = 1u << (i - 1);
+        square(two, bit);
+        square(four, two);
+        square(ops[0], four);
+        for (int i = 1; i < 64; i++)
+            square(ops[i], ops[i-1]);
+    }
+};
+
+crc32c_table const table;
+crc32c_zeros const zeros;
+
+}
+
+template <bool Copy>
+static uint32_t
+crc32c_vanilla(char *dest, char const *data, size_t nbytes, uint32_t sofar)
+{
+    uint32_t crc = ~sofar;
+    for (size_t i = 0; i < nbytes; i++) {
+        if (Copy)
+            dest[i] = data[i];
+        crc = table.entries[(crc ^ (uint8_t) data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t
+crc32c_vanilla(char const *data, size_t nbytes, uint32_t sofar)
+{
+    return crc32c_vanilla<false>(0, data, nbytes, sofar);
+}
+
+uint32_t
+crc32c_memcpy_vanilla(char *dest, char const *src, size_t nbytes, uint32_t sofar)
+{
+    return crc32c_vanilla<true>(dest, src, nbytes, sofar);
+}
+
+#ifdef __x86_64__
+template <bool Copy>
+static uint32_t __attribute__((target("sse4.2")))
+crc32c_sse42(char *dest, char const *data, size_t nbytes, uint32_t sofar)
+{
+    uint64_t crc = (uint32_t) ~sofar;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= nbytes; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        if (Copy)
+            memcpy(dest + i, &w, sizeof(w));
+        crc = _mm_crc32_u64(crc, w);
+    }
+    for (; i < nbytes; i++) {
+        if (Copy)
+            dest[i] = data[i];
+        crc = _mm_crc32_u8((uint32_t) crc, data[i]);
+    }
+    return ~(uint32_t) crc;
+}
+
+uint32_t
+crc32c_sse42(char const *data, size_t nbytes, uint32_t sofar)
+{
+    return crc32c_sse42<false>(0, data, nbytes, sofar);
+}
+
+uint32_t
+crc32c_memcpy_sse42(char *dest, char const *src, size_t nbytes, uint32_t sofar)
+{
+    return crc32c_sse42<true>(dest, src, nbytes, sofar);
+}
+#endif
+
+uint32_t
+crc32c(char const *data, size_t nbytes, uint32_t sofar)
+{
+#ifdef __SSE4_2__
+    return crc32c_sse42(data, nbytes, sofar);
+#else
+    return crc32c_vanilla(data, nbytes, sofar);
+#endif
+}
+
+uint32_t
+crc32c_memcpy(char *dest, char const *src, size_t nbytes, uint32_t sofar)
+{
+#ifdef __SSE4_2__
+    return crc32c_memcpy_sse42(dest, src, nbytes, sofar);
+#else
+    return crc32c_memcpy_vanilla(dest, src, nbytes, sofar);
+#endif
+}
+
+uint32_t
+crc32c_merge(uint32_t left, uint32_t right, size_t right_size)
+{
+    /* The pre- and post-inversions cancel out here: crc(A.B) =
+       zeros(crc(A), |B|) ^ crc(B) holds for finished checksums too.
+     */
+    for (int i = 0; right_size; i++, right_size >>= 1) {
+        if (right_size & 1)
+            left = crc32c_zeros::times(zeros.ops[i], left);
+    }
+    return left ^ right;
+}
@@ -0,0 +1,43 @@
+// -*- mode:c++ -*-
+#ifndef __CRC32C_H
+#define __CRC32C_H
+
+#include <stdint.h>
+#include <cstddef>
+
+/* CRC32C (Castagnoli polynomial), the CRC that SSE4.2 computes in
+   hardware.
+
+   CRC32C detects all burst errors up to 32 bits and has none of
+   adler32's blind spots for short inputs, and with the crc32
+   instruction it costs about as much as the SSE adler32 on the
+   kB-sized blocks the log writes. Like adler32, checksums compose:
+   crc32c_merge combines the checksums of two adjacent pieces given the
+   length of the second one.
+
+   Checksums use the usual pre- and post-inversion, so [sofar] is
+   always a finished checksum and CRC32C_CSUM_INIT is zero.
+ */
+
+static uint32_t const CRC32C_CSUM_INIT = 0;
+
+uint32_t crc32c(char const *data, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+uint32_t crc32c_vanilla(char const *data, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+#ifdef __x86_64__
+/* Compiled regardless of -march; only call if the CPU has SSE4.2 */
+uint32_t crc32c_sse42(char const *data, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+#endif
+
+/* Combine two adjacent checksums, as for adler32_merge */
+uint32_t crc32c_merge(uint32_t left, uint32_t right, size_t right_size);
+
+/* Compute a checksum and perform a memcpy at the same time. There are
+   no alignment requirements.
+ */
+uint32_t crc32c_memcpy(char *dest, char const *src, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+uint32_t crc32c_memcpy_vanilla(char *dest, char const *src, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+#ifdef __x86_64__
+uint32_t crc32c_memcpy_sse42(char *dest, char const *src, size_t nbytes, uint32_t sofar=CRC32C_CSUM_INIT);
+#endif
+
+#endif
@@ -0,0 +1,248 @@
+/* Per-operation cost of the storage manager primitives every
+   transaction goes through, measured at 1..N threads.
+
+   Threads come from the usual per-node pools (see sm-thread.h), so
+   they are pinned socket by socket exactly as benchmark workers
+   are. Each primitive runs [ops] times per thread, timed in batches
+   of BATCH_SIZE so clock reads stay out of the per-op numbers;
+   the percentiles are over those batch averages. Throughput is
+   judged by the slowest thread.
+
+   Output is one tab-separated line per (primitive, thread count),
+   with a fixed header, so runs from different builds can be diffed
+   or pasted side by side.
+
+   Usage: microbench [-t max-threads] [-n ops-per-thread]
+                     [-l log-dir] [-b primitive[,primitive...]]
+
+   The log goes to a null device unless -l names a directory.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../object.h"
+#include "../spinbarrier.h"
+#include "epoch.h"
+#include "rcu.h"
+#include "sm-alloc.h"
+#include "sm-common.h"
+#include "sm-config.h"
+#include "sm-histogram.h"
+#include "sm-log.h"
+#include "sm-log-recover-impl.h"
+#include "sm-oid.h"
+#include "sm-thread.h"
+#include "sm-trace.h"
+#include "stopwatch.h"
+#include "xid.h"
+
+static size_t const BATCH_SIZE = 64;
+
+static FID bench_fid;
+static __thread epoch_num mm_epoch;
+
+/* The primitives. Each op leaves the thread in the state it found
+   it in, so ops can repeat back to back forever.
+ */
+static void op_epoch() {
+    MM::mm_epochs.thread_enter();
+    MM::mm_epochs.thread_exit();
+}
+
+static void op_rcu() {
+    RCU::rcu_enter();
+    RCU::rcu_exit();
+}
+
+static void op_xid() {
+    XID x = TXN::xid_alloc();
+    TXN::xid_free(x);
+}
+
+static void op_oid() {
+    OID o = oidmgr->alloc_oid(bench_fid);
+    oidmgr->free_oid(bench_fid, o);
+}
+
+/* A commit block with no records: what a read-write transaction
+   pays for its place in the log, without any payload to copy.
+ */
+static void op_log() {
+    RCU::rcu_enter();
+    sm_tx_log *log = logmgr->new_tx_log();
+    log->commit(NULL);
+    RCU::rcu_exit();
+}
+
+/* An object allocation under the epoch the thread entered before
+   the run (see bench_thread), freed right away so the TLS free list
+   gets to recycle it.
+ */
+static void op_mm() {
+    size_t sz = sizeof(object) + 64;
+    object *obj = new (MM::allocate(sz, mm_epoch)) object();
+    MM::deallocate(fat_ptr::make(obj, encode_size_aligned(sz)));
+}
+
+/* One tracepoint, run once with tracing off and once with it on (see
+   the traced flag below); the events go to the thread's ring and are
+   never dumped.
+ */
+static void op_trace() {
+    trace::instant("microbench");
+}
+
+struct primitive {
+    char const *name;
+    void (*op)();
+    bool in_mm_epoch;
+    bool traced;
+};
+
+static primitive const primitives[] = {
+    {"epoch_enter_exit", &op_epoch, false, false},
+    {"rcu_enter_exit", &op_rcu, false, false},
+    {"xid_alloc_free", &op_xid, false, false},
+    {"oid_alloc_free", &op_oid, false, false},
+    {"log_alloc_commit", &op_log, false, false},
+    {"mm_alloc_free", &op_mm, true, false},
+    {"trace_event_off", &op_trace, false, false},
+    {"trace_event_on", &op_trace, false, true},
+};
+
+struct bench_thread final : thread::sm_runner {
+    bench_thread(primitive const *p, uint64_t ops, spin_barrier *ready, spin_barrier *go)
+        : p(p), ops(ops), elapsed_ns(0), ready(ready), go(go)
+    {
+        ALWAYS_ASSERT(try_impersonate());
+    }
+
+    virtual void my_work(char *) {
+        if (p->in_mm_epoch)
+            mm_epoch = MM::epoch_enter();
+        ready->count_down();
+        go->wait_for();
+        stopwatch_t total;
+        for (uint64_t i = 0; i < ops; i += BATCH_SIZE) {
+            stopwatch_t t;
+            for (size_t j = 0; j < BATCH_SIZE; j++)
+                p->op();
+            hist.record(t.time_ns() / BATCH_SIZE, BATCH_SIZE);
+        }
+        elapsed_ns = total.time_ns();
+        if (p->in_mm_epoch)
+            MM::epoch_exit(logmgr->cur_lsn().offset(), mm_epoch);
+    }
+
+    primitive const *p;
+    uint64_t ops;
+    uint64_t elapsed_ns;
+    pow2_histogram hist;  // per-op ns, averaged over each batch
+    spin_barrier *ready;
+    spin_barrier *go;
+};
+
+static void run(primitive const *p, uint32_t nthreads, uint64_t ops) {
+    trace::enabled = p->traced;
+    spin_barrier ready(nthreads), go(1);
+    std::vector<bench_thread*> threads;
+    for (uint32_t i = 0; i < nthreads; i++)
+        threads.push_back(new bench_thread(p, ops, &ready, &go));
+    for (auto *t : threads)
+        t->start();
+    ready.wait_for();
+    go.count_down();
+
+    pow2_histogram hist;
+    uint64_t slowest_ns = 0;
+    for (auto *t : threads) {
+        t->join();
+        hist.merge(t->hist);
+        slowest_ns = std::max(slowest_ns, t->elapsed_ns);
+        delete t;
+    }
+
+    uint32_t nodes = (nthreads + sysconf::max_threads_per_node - 1) / sysconf::max_threads_per_node;
+    double total_ops = double(hist.count);
+    printf("%s\t%u\t%u\t%.0f\t%.1f\t%lu\t%lu\t%lu\n",
+           p->name, nthreads, nodes,
+           total_ops * 1e9 / slowest_ns,
+           double(slowest_ns) * nthreads / total_ops,
+           hist.percentile(50), hist.percentile(99), hist.percentile(99.9));
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    uint32_t max_threads = 1;
+    uint64_t ops = 1000000;
+    std::string only;
+
+    int c;
+    while ((c = getopt(argc, argv, "t:n:l:b:")) != -1) {
+        switch (c) {
+        case 't':
+            max_threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            ops = strtoull(optarg, NULL, 10);
+            break;
+        case 'l':
+            sysconf::log_dir = optarg;
+            break;
+        case 'b':
+            only = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-t max-threads] [-n ops-per-thread] "
+                    "[-l log-dir] [-b primitive[,primitive...]]\n", argv[0]);
+            return 1;
+        }
+    }
+    ALWAYS_ASSERT(max_threads > 0);
+    ALWAYS_ASSERT(ops >= BATCH_SIZE);
+
+    std::unique_ptr<tmp_dir> scratch;
+    if (sysconf::log_dir.empty()) {
+        scratch.reset(new tmp_dir);
+        sysconf::log_dir = **scratch;
+        sysconf::null_log_device = 1;
+    }
+
+    sysconf::worker_threads = max_threads;
+    sysconf::recover_functor = new parallel_oid_replay;
+    sysconf::init();
+    sysconf::sanity_check();
+    MM::prepare_node_memory();
+
+    // the log and OID manager must be created from a registered thread
+    auto *setup = thread::get_thread();
+    setup->start_task([](char *) {
+        RCU::rcu_enter();
+        logmgr = sm_log::new_log(sysconf::recover_functor, nullptr);
+        bench_fid = oidmgr->create_file(true);
+        RCU::rcu_exit();
+    });
+    setup->join();
+    thread::put_thread(setup);
+
+    std::vector<uint32_t> counts;
+    for (uint32_t n = 1; n < max_threads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(max_threads);
+
+    printf("primitive\tthreads\tnodes\tops/s\tns/op\tp50_ns\tp99_ns\tp99.9_ns\n");
+    for (auto &p : primitives) {
+        if (only.size() and ("," + only + ",").find(std::string(",") + p.name + ",") == std::string::npos)
+            continue;
+        for (auto n : counts)
+            run(&p, n, ops);
+    }
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include "sm-common.h"
 #include "size-encode.h"
 #include "sm-defs.h"
+#include "sm-trace.h"
 
 #include <stdint.h>
 #include <pthread.h>
@@ -550,7 +551,8 @@ void rcu_free(void const* ptr) {
         too_big = gbytes > tbytes;
         if (rcu_epochs.new_epoch_possible() and (too_many or too_big)) {
             // try to install a new safe point
-            rcu_epochs.new_epoch();
+            if (rcu_epochs.new_epoch())
+                trace::instant("rcu epoch", rcu_epochs.get_cur_epoch());
         }
 
         // reset the local count
@@ -8,6 +8,8 @@
 
 #include "sm-alloc.h"
 #include "sm-common.h"
+#include "sm-phase.h"
+#include "sm-trace.h"
 #include "../txn.h"
 
 /*
@@ -64,6 +66,25 @@ uint64_t EPOCH_SIZE_COUNT = 200000;
 uint64_t epoch_excl_begin_lsn[3] = {0, 0, 0};
 uint64_t epoch_reclaim_lsn[3] = {0, 0, 0};
 uint64_t safesnap_lsn = 0;
+uint64_t gc_hold_lsn = 0;
+uint64_t snapshot_horizon_lsn = 0;
+
+// Begin LSNs of the AS OF transactions running on each thread, 0 for none
+struct snapshot_pin_lsn {
+    uint64_t lsn;
+} CACHE_ALIGNED;
+static snapshot_pin_lsn snapshot_pins[sysconf::MAX_THREADS];
+
+// Bytes of old versions the GC daemon has handed back to the object pools
+uint64_t gc_reclaimed_nbytes = 0;
+
+// Updated OIDs queued by each thread in recycle(), and dropped from the
+// queue by the GC daemon; the difference is its backlog
+struct recycle_count {
+    uint64_t n;
+} CACHE_ALIGNED;
+static recycle_count recycle_queued[sysconf::MAX_THREADS];
+static uint64_t recycle_dropped = 0;
 
 object_pool central_object_pool CACHE_ALIGNED;
 static __thread thread_object_pool *tls_object_pool CACHE_ALIGNED;
@@ -122,6 +143,7 @@ epoch_mgr mm_epochs {{nullptr, &global_init, &get_tls,
                     &epoch_ended, &epoch_ended_thread, &epoch_reclaimed}};
 
 void *allocate(size_t size, epoch_num e) {
+    phase::timer pt(phase::ALLOC);
     size = align_up(size);
     void *p = NULL;
 
@@ -204,6 +226,16 @@ out:
     return p;
 }
 
+uint64_t allocated_memory() {
+    uint64_t n = 0;
+    if (not allocated_node_memory)
+        return 0;
+    for (int i = 0; i < sysconf::numa_nodes; i++)
+        n += std::min(volatile_read(allocated_node_memory[i]),
+                      sysconf::node_memory_gb * sysconf::GB);
+    return n;
+}
+
 // Allocate memory directly from the node pool (only loader does this so far)
 void* allocate_onnode(size_t size) {
     size = align_up(size);
@@ -315,14 +347,19 @@ epoch_exit(uint64_t s, epoch_num e)
         // this lsn. The real trim_lsn should be some lsn at the end of the
         // ending epoch, not some lsn after the next epoch.
         epoch_excl_begin_lsn[(e + 1) % 3] = s;
-        if (mm_epochs.new_epoch_possible() and mm_epochs.new_epoch())
+        if (mm_epochs.new_epoch_possible() and mm_epochs.new_epoch()) {
+            trace::instant("mm epoch", mm_epochs.get_cur_epoch());
             epoch_tls.nbytes = epoch_tls.counts = 0;
+        }
     }
     mm_epochs.thread_exit();
 }
 
-void recycle(fat_ptr list_head, fat_ptr list_tail)
+void recycle(fat_ptr list_head, fat_ptr list_tail, uint64_t count)
 {
+    auto &queued = recycle_queued[thread::my_id()].n;
+    volatile_write(queued, queued + count);
+
     fat_ptr succ_head = recycle_oid_list.exchange(list_head, std::memory_order_seq_cst);
     object *tail_obj = (object *)list_tail.offset();
     ASSERT(tail_obj->_next == NULL_PTR);
@@ -330,12 +367,56 @@ void recycle(fat_ptr list_head, fat_ptr list_tail)
     std::atomic_thread_fence(std::memory_order_release);    // Let the GC thread know
 }
 
+// A transaction pins its LSN, then checks it against the horizon; the
+// daemon moves the horizon, then looks for pins under it. Either the
+// transaction sees the new horizon and gives up, or the daemon sees
+// the pin and keeps its snapshot.
+bool snapshot_pin(uint64_t lsn)
+{
+    auto &pin = snapshot_pins[thread::my_id()].lsn;
+    ASSERT(not pin);
+    volatile_write(pin, lsn);
+    __sync_synchronize();
+    if (lsn < volatile_read(snapshot_horizon_lsn)) {
+        volatile_write(pin, 0);
+        return false;
+    }
+    return true;
+}
+
+void snapshot_unpin()
+{
+    volatile_write(snapshot_pins[thread::my_id()].lsn, 0);
+}
+
+// The LSN a GC pass keeps every snapshot from: the retention window
+// behind the current LSN, a backup's and any pinned snapshot
+static uint64_t snapshot_hold()
+{
+    uint64_t cur = transaction::begin_lsn_offset();
+    uint64_t window = uint64_t(sysconf::snapshot_retention_mb) * sysconf::MB;
+    uint64_t hold = cur > window ? cur - window : 0;
+    auto backup = volatile_read(gc_hold_lsn);
+    if (backup)
+        hold = std::min(hold, backup);
+    if (hold > snapshot_horizon_lsn)
+        volatile_write(snapshot_horizon_lsn, hold);
+    __sync_synchronize();
+    for (uint32_t i = 0; i < thread::next_thread_id; i++) {
+        auto pin = volatile_read(snapshot_pins[i].lsn);
+        if (pin)
+            hold = std::min(hold, pin);
+    }
+    return hold;
+}
+
 void gc_daemon()
 {
     std::unique_lock<std::mutex> lock(gc_lock);
     dense_hash_map<size_t, object_list> scavenged_object_lists;
     scavenged_object_lists.set_empty_key(0);
     uint32_t next_thread = 0;
+    trace::name_thread("gc");
 
 try_recycle:
     uint64_t reclaimed_count = 0;
@@ -352,6 +433,10 @@ try_recycle:
     r = r_obj->_next;
     ASSERT(r != NULL_PTR);
     ASSERT(r != r_prev);
+    // What trim_lsn passes during this pass isn't covered by the horizon
+    // yet, so hold that back too
+    uint64_t hold = snapshot_hold();
+    trace::begin("gc pass", volatile_read(trim_lsn));
 
     while (1) {
         // need to update tlsn each time, to make sure we can make
@@ -381,6 +466,7 @@ try_recycle:
         object *cur_obj = (object *)head.offset();
         if (not cur_obj) {
             // in case it's a delete... remove the oid as if we trimmed it
+            volatile_write(recycle_dropped, recycle_dropped + 1);
             deallocate(r);
             ASSERT(r_prev != NULL_PTR);
             object *r_prev_obj = (object *)r_prev.offset();
@@ -433,6 +519,16 @@ try_recycle:
                 break;
         }
 
+        // A held snapshot older than that version needs an older one:
+        // keep the chain down to the newest version it can see
+        while (cur.offset() and LSN::from_ptr(clsn).offset() > hold) {
+            cur_obj = (object *)cur.offset();
+            clsn = volatile_read(cur_obj->_clsn);
+            ALWAYS_ASSERT(clsn.asi_type() == fat_ptr::ASI_LOG);
+            prev_next = &cur_obj->_next;
+            cur = volatile_read(*prev_next);
+        }
+
         while (cur.offset()) {
             cur_obj = (object *)cur.offset();
             ASSERT(cur_obj);
@@ -468,6 +564,7 @@ try_recycle:
         if (trimmed) {
             // really recycled something, detach the node, but don't update r_prev
             ASSERT(r_prev != NULL_PTR);
+            volatile_write(recycle_dropped, recycle_dropped + 1);
             deallocate(r);
             object *r_prev_obj = (object *)r_prev.offset();
             volatile_write(r_prev_obj->_next, r_next);
@@ -477,6 +574,8 @@ try_recycle:
         }
         r = r_next;
     }
+    volatile_write(gc_reclaimed_nbytes, gc_reclaimed_nbytes + reclaimed_nbytes);
+    trace::end("gc pass", reclaimed_nbytes);
 #ifndef NDEBUG
     if (reclaimed_nbytes or reclaimed_count)
         printf("GC: reclaimed %lu bytes, %lu objects\n", reclaimed_nbytes, reclaimed_count);
@@ -484,6 +583,20 @@ try_recycle:
     goto try_recycle;
 }
 
+uint64_t gc_backlog()
+{
+    uint64_t queued = 0;
+    for (uint32_t i = 0; i < thread::next_thread_id; i++)
+        queued += volatile_read(recycle_queued[i].n);
+    uint64_t dropped = volatile_read(recycle_dropped);
+    return queued > dropped ? queued - dropped : 0;
+}
+
+uint64_t central_pool_nobjects()
+{
+    return central_object_pool.nobjects();
+}
+
 bool
 object_list::put(fat_ptr objptr) {
     if (nobjects == CAPACITY)
@@ -529,6 +642,20 @@ object_pool::put_object_list(object_list& ol, uint32_t thread_index) {
     lock.unlock();
 }
 
+size_t
+object_pool::nobjects() {
+    size_t n = 0;
+    lock.lock();
+    for (uint32_t i = 0; i < thread::next_thread_id; i++) {
+        for (auto &p : pool[i]) {
+            for (object_list *ol = p.second; ol; ol = ol->next)
+                n += ol->nobjects;
+        }
+    }
+    lock.unlock();
+    return n;
+}
+
 object*
 thread_object_pool::get_object(size_t size) {
     size_t aligned_size = align_up(size);
@@ -74,6 +74,8 @@ namespace MM {
 
         // Return a list of objects to the pool; the gc thread is the only caller.
         void put_object_list(object_list& ol, uint32_t thread_index);
+
+        size_t nobjects();
     };
 
     // Same thing as object_pool, but for a thread; no CC whatsoever
@@ -90,8 +92,36 @@ namespace MM {
     void *allocate(size_t size, epoch_num e);
     void deallocate(fat_ptr p);
     void* allocate_onnode(size_t size);
+    /* Bytes handed out from the per-node pools so far */
+    uint64_t allocated_memory();
 
     extern uint64_t safesnap_lsn;
+    extern uint64_t trim_lsn;
+
+    /* Begin LSN offset of a snapshot the GC daemon must keep readable even
+       after trim_lsn passed it, e.g., a backup's; 0 for none
+     */
+    extern uint64_t gc_hold_lsn;
+
+    /* Oldest begin LSN offset an AS OF transaction can still start at; the
+       GC daemon may have trimmed what older snapshots read. It trails the
+       current LSN by at least --snapshot-retention-mb of log.
+     */
+    extern uint64_t snapshot_horizon_lsn;
+
+    /* Keep the versions a snapshot at [lsn] reads from the GC daemon until
+       snapshot_unpin(), one snapshot per thread. False, pinning nothing,
+       if [lsn] is already past the horizon.
+     */
+    bool snapshot_pin(uint64_t lsn);
+    void snapshot_unpin();
+    extern uint64_t gc_reclaimed_nbytes;
+
+    /* Updated OIDs handed to the GC daemon that it hasn't trimmed yet */
+    uint64_t gc_backlog();
+
+    /* Reclaimed objects in the central pool, not yet taken by a thread */
+    uint64_t central_pool_nobjects();
 
     struct thread_data {
         bool initialized;
@@ -120,6 +150,6 @@ namespace MM {
 
     void epoch_exit(uint64_t s, epoch_num e);
     void recycle(oid_array *oa, OID oid);
-    void recycle(fat_ptr list_head, fat_ptr list_tail);
+    void recycle(fat_ptr list_head, fat_ptr list_tail, uint64_t count);
 };
 
@@ -0,0 +1,326 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../benchmarks/ndb_wrapper.h"
+#include "../txn.h"
+#include "../txn_btree.h"
+
+#include "serial.h"
+#include "defer.h"
+#include "sm-alloc.h"
+#include "sm-backup.h"
+#include "sm-config.h"
+#include "sm-file.h"
+#include "sm-log-checksum.h"
+#include "sm-trace.h"
+
+/* Scans a table as a transaction beginning at [begin] would see it;
+   befriended by the index and transaction classes, like sm_oid_mgr
+ */
+class backup_scanner {
+public:
+    template <typename Callback>
+    static void scan(sm_file_descriptor *fd, uint64_t begin, str_arena &arena,
+                     varkey const &lower, Callback &callback) {
+        transaction t(0, arena);
+        t.xc->begin = begin;
+        fd->index->btr.underlying_btree.search_range_call(lower, NULL, callback, t.xc);
+        t.abort_impl();
+    }
+};
+
+namespace backup {
+
+namespace {
+#if 0
+} // enter namespace, disable autoindent
+#endif
+
+uint32_t
+checksum(char const *data, size_t size)
+{
+    static log_checksum const *csum = log_checksum_find("crc32c");
+    return csum->sum(data, size, csum->init);
+}
+
+/* Appends [key size, key, value size, value] for each record a scan
+   finds until the block is full, then stops the scan; the next one
+   starts after [last], the last key it went over.
+ */
+struct block_writer : public concurrent_btree::low_level_search_range_callback {
+    block_writer(std::vector<char> &block, std::string &last)
+        : block(block), last(last), nrecords(0), full(false) { }
+
+    virtual void on_resp_node(const concurrent_btree::node_opaque_t *n, uint64_t version) { }
+
+    virtual bool invoke(const concurrent_btree *btr, const concurrent_btree::string_type &k,
+                        OID o, dbtuple *v, const concurrent_btree::node_opaque_t *n, uint64_t version) {
+        if (block.size() >= BLOCK_SIZE) {
+            full = true;
+            return false;
+        }
+        last.assign(k.data(), k.length());
+        if (not v->size)  // deleted as of the snapshot
+            return true;
+        append(k.data(), k.length());
+        append(v->get_value_start(), v->size);
+        nrecords++;
+        return true;
+    }
+
+    void append(void const *p, uint32_t size) {
+        char const *s = (char const *)&size;
+        block.insert(block.end(), s, s + sizeof(uint32_t));
+        block.insert(block.end(), (char const *)p, (char const *)p + size);
+    }
+
+    std::vector<char> &block;
+    std::string &last;
+    uint32_t nrecords;
+    bool full;
+};
+
+struct job {
+    uint64_t snapshot;
+    int dfd;
+    std::vector<sm_file_descriptor *> tables;
+    std::atomic<size_t> next_table;
+    double bytes_per_sec;   // per thread, 0 for no limit
+    std::atomic<uint64_t> nrecords;
+    std::atomic<uint64_t> nbytes;
+};
+
+void
+backup_thread(job *j, uint32_t id)
+{
+    // as sm_thread::idle_task does
+#if defined(SSN) || defined(SSI)
+    TXN::assign_reader_bitmap_entry();
+#endif
+    RCU::rcu_register();
+    MM::register_thread();
+    trace::name_thread("backup");
+
+    char name[32];
+    os_snprintf(name, sizeof(name), "data-%u", id);
+    int fd = os_openat(j->dfd, name, O_CREAT|O_WRONLY|O_TRUNC);
+
+    str_arena arena;
+    std::vector<char> block;
+    block.reserve(BLOCK_SIZE);
+    std::string last;
+    uint64_t written = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i; (i = j->next_table++) < j->tables.size(); ) {
+        auto *fd_desc = j->tables[i];
+        bool first = true;
+        bool more = true;
+        while (more) {
+            // A transaction per block: the GC hold, not the epoch, keeps
+            // the snapshot's versions around in between
+            block.clear();
+            block_writer w(block, last);
+            if (first) {
+                backup_scanner::scan(fd_desc, j->snapshot, arena, varkey(), w);
+            } else {
+                std::string lower = last + '\0';
+                backup_scanner::scan(fd_desc, j->snapshot, arena,
+                                     varkey((uint8_t *)lower.data(), lower.size()), w);
+            }
+            first = false;
+            more = w.full;
+            if (not w.nrecords)
+                continue;
+
+            block_header h;
+            h.magic = BLOCK_MAGIC;
+            h.fid = fd_desc->fid;
+            h.nrecords = w.nrecords;
+            h.size = block.size();
+            h.checksum = checksum(block.data(), block.size());
+            os_write(fd, &h, sizeof(h));
+            os_write(fd, block.data(), block.size());
+            written += sizeof(h) + block.size();
+            j->nrecords += w.nrecords;
+            j->nbytes += sizeof(h) + block.size();
+
+            if (j->bytes_per_sec) {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                double ahead = written / j->bytes_per_sec - elapsed.count();
+                if (ahead > 0)
+                    usleep(ahead * 1000000);
+            }
+        }
+    }
+    os_fsync(fd);
+    os_close(fd);
+
+    MM::deregister_thread();
+    RCU::rcu_deregister();
+#if defined(SSN) || defined(SSI)
+    TXN::deassign_reader_bitmap_entry();
+#endif
+}
+
+template <typename T>
+void
+put(std::string &s, T const &v)
+{
+    s.append((char const *)&v, sizeof(T));
+}
+
+template <typename T>
+T
+get(std::vector<char> const &buf, size_t &pos)
+{
+    THROW_IF(pos + sizeof(T) > buf.size(), illegal_argument, "Backup manifest is truncated");
+    T v;
+    memcpy(&v, buf.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+
+#if 0
+{ // exit namespace, disable autoindent
+#endif
+}
+
+stats
+take(std::string const &dir, uint32_t nthreads, uint32_t mb_per_sec)
+{
+    static std::atomic<bool> taking(false);
+    THROW_IF(taking.exchange(true), illegal_argument, "A backup is already running");
+    ALWAYS_ASSERT(nthreads);
+    auto start = std::chrono::steady_clock::now();
+
+    job j;
+    dirent_iterator di(dir.c_str());
+    j.dfd = di.dup();
+    for (auto &fm : sm_file_mgr::fid_map)
+        j.tables.push_back(fm.second);
+    std::sort(j.tables.begin(), j.tables.end(),
+              [](sm_file_descriptor *a, sm_file_descriptor *b) { return a->fid < b->fid; });
+    j.next_table = 0;
+    j.bytes_per_sec = double(mb_per_sec) * sysconf::MB / nthreads;
+    j.nrecords = 0;
+    j.nbytes = 0;
+
+    // What a transaction starting now sees. The GC daemon can't have
+    // trimmed any of it yet: trim_lsn trails the current LSN.
+    j.snapshot = transaction::begin_lsn_offset();
+    volatile_write(MM::gc_hold_lsn, j.snapshot);
+    trace::begin("backup", j.snapshot);
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < nthreads; i++)
+        threads.emplace_back(backup_thread, &j, i);
+    for (auto &t : threads)
+        t.join();
+
+    volatile_write(MM::gc_hold_lsn, 0);
+    trace::end("backup", j.nrecords);
+
+    // The manifest makes the backup complete
+    std::string m;
+    put(m, j.snapshot);
+    put(m, nthreads);
+    put(m, uint32_t(j.tables.size()));
+    for (auto *fd : j.tables) {
+        put(m, fd->fid);
+        put(m, uint32_t(fd->name.size()));
+        m.append(fd->name);
+    }
+    int fd = os_openat(j.dfd, "manifest.tmp", O_CREAT|O_WRONLY|O_TRUNC);
+    os_write(fd, m.data(), m.size());
+    os_fsync(fd);
+    os_close(fd);
+    os_renameat(j.dfd, "manifest.tmp", j.dfd, "manifest");
+    os_fsync(j.dfd);
+    os_close(j.dfd);
+
+    stats s;
+    s.snapshot = j.snapshot;
+    s.nrecords = j.nrecords;
+    s.nbytes = j.nbytes + m.size();
+    s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    taking = false;
+    return s;
+}
+
+manifest::manifest(std::string const &dir)
+{
+    std::string path = dir + "/manifest";
+    int fd = os_open(path.c_str(), O_RDONLY);
+    DEFER(os_close(fd));
+    off_t size = lseek(fd, 0, SEEK_END);
+    THROW_IF(size < 0, os_error, errno, "Error reading backup manifest");
+    std::vector<char> buf(size);
+    THROW_IF(os_pread(fd, buf.data(), size, 0) != size_t(size), illegal_argument,
+             "Backup manifest is truncated");
+
+    size_t pos = 0;
+    snapshot = get<uint64_t>(buf, pos);
+    uint32_t nfiles = get<uint32_t>(buf, pos);
+    uint32_t ntables = get<uint32_t>(buf, pos);
+    for (uint32_t i = 0; i < ntables; i++) {
+        FID f = get<FID>(buf, pos);
+        uint32_t len = get<uint32_t>(buf, pos);
+        THROW_IF(pos + len > buf.size(), illegal_argument, "Backup manifest is truncated");
+        tables.emplace_back(f, std::string(buf.data() + pos, len));
+        pos += len;
+    }
+    for (uint32_t i = 0; i < nfiles; i++)
+        files.push_back(dir + "/data-" + std::to_string(i));
+}
+
+reader::reader(std::string const &path)
+    : _fd(os_open(path.c_str(), O_RDONLY)), _offset(0), _pos(0), _left(0)
+{
+}
+
+reader::~reader()
+{
+    os_close(_fd);
+}
+
+FID
+reader::next(char const *&key, uint32_t &key_size,
+             char const *&value, uint32_t &value_size)
+{
+    while (not _left) {
+        size_t n = os_pread(_fd, (char *)&_header, sizeof(_header), _offset);
+        if (not n)
+            return 0;
+        THROW_IF(n != sizeof(_header) or _header.magic != BLOCK_MAGIC, illegal_argument,
+                 "Backup file is truncated or corrupt");
+        _block.resize(_header.size);
+        THROW_IF(os_pread(_fd, _block.data(), _header.size, _offset + n) != _header.size,
+                 illegal_argument, "Backup file is truncated");
+        THROW_IF(checksum(_block.data(), _header.size) != _header.checksum, illegal_argument,
+                 "Backup block checksum mismatch");
+        _offset += n + _header.size;
+        _pos = 0;
+        _left = _header.nrecords;
+    }
+
+    auto field = [this](char const *&p, uint32_t &size) {
+        THROW_IF(_pos + sizeof(uint32_t) > _block.size(), illegal_argument, "Backup block is corrupt");
+        memcpy(&size, _block.data() + _pos, sizeof(uint32_t));
+        _pos += sizeof(uint32_t);
+        THROW_IF(_pos + size > _block.size(), illegal_argument, "Backup block is corrupt");
+        p = _block.data() + _pos;
+        _pos += size;
+    };
+    field(key, key_size);
+    field(value, value_size);
+    _left--;
+    return _header.fid;
+}
+
+}  // namespace backup
@@ -0,0 +1,96 @@
+// -*- mode:c++ -*-
+#ifndef __SM_BACKUP_H
+#define __SM_BACKUP_H
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sm-common.h"
+
+/* Online backups: a full copy of every table as of one snapshot LSN,
+   taken while transactions keep running, and the files to bulk-load
+   it back from.
+
+   The snapshot is what a transaction beginning at the start of the
+   backup sees. Backup threads take the tables one at a time and scan
+   each table's index with transactions stamped with that begin LSN,
+   so the OID array hands out the version visible at the snapshot for
+   every key, and stream the records to their own file. A transaction
+   only lives for one block of records, so the backup never keeps an
+   epoch open for long; MM::gc_hold_lsn instead keeps the GC daemon
+   from trimming the versions the snapshot still reads, while it trims
+   everything else as usual.
+
+   Files in the backup directory:
+     data-N     one per backup thread, a sequence of blocks, each a
+                block_header followed by the records of one table:
+                [key size, key, value size, value] (sizes are uint32_t)
+     manifest   written last, so a backup without one is incomplete:
+                [snapshot LSN offset (uint64_t), number of data files
+                 (uint32_t), number of tables (uint32_t)]
+                [FID, name length (uint32_t), name] per table
+ */
+namespace backup {
+
+static uint32_t const BLOCK_MAGIC = 0xbac0ffee;
+
+// payload bytes per block; the unit of checksums, transactions and writes
+static size_t const BLOCK_SIZE = 1024 * 1024;
+
+struct block_header {
+    uint32_t magic;
+    FID fid;
+    uint32_t nrecords;
+    uint32_t size;      // payload bytes
+    uint32_t checksum;  // crc32c of the payload
+};
+
+struct stats {
+    uint64_t snapshot;  // begin LSN offset of the snapshot
+    uint64_t nrecords;
+    uint64_t nbytes;    // written, headers included
+    double seconds;
+};
+
+/* Back up the database to [dir], which must exist, with [nthreads]
+   threads writing at most [mb_per_sec] MB/s between them (0 for no
+   limit). Only one backup can run at a time.
+ */
+stats take(std::string const &dir, uint32_t nthreads, uint32_t mb_per_sec);
+
+struct manifest {
+    uint64_t snapshot;
+    std::vector<std::pair<FID, std::string> > tables;
+    std::vector<std::string> files;  // data files, full paths
+
+    // throws if [dir] holds no complete backup
+    explicit manifest(std::string const &dir);
+};
+
+/* Reads the records of one data file in order, checking each block */
+class reader {
+public:
+    explicit reader(std::string const &path);
+    ~reader();
+
+    /* Point [key] and [value] at the next record, valid until the next
+       call, and return its table; 0 at the end of the file
+     */
+    FID next(char const *&key, uint32_t &key_size,
+             char const *&value, uint32_t &value_size);
+
+private:
+    int _fd;
+    off_t _offset;
+    block_header _header;
+    std::vector<char> _block;
+    uint32_t _pos;
+    uint32_t _left;     // records left in the block
+};
+
+}  // namespace backup
+
+#endif
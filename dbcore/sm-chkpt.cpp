@@ -1,15 +1,19 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include "../txn.h"
+#include "serial.h"
+#include "sm-alloc.h"
 #include "sm-chkpt.h"
 #include "sm-log.h"
 #include "sm-oid.h"
+#include "sm-trace.h"
 
 sm_chkpt_mgr *chkptmgr;
 
-sm_chkpt_mgr::sm_chkpt_mgr(LSN last_cstart) :
+sm_chkpt_mgr::sm_chkpt_mgr(LSN last_cstart, bool image) :
     _shutdown(false), _buf_pos(0), _dur_pos(0),
-    _fd(-1), _last_cstart(last_cstart)
+    _fd(-1), _last_cstart(last_cstart), _image(image)
 {
     ALWAYS_ASSERT(not mlock(_buffer, BUFFER_SIZE));
 }
@@ -37,47 +41,116 @@ sm_chkpt_mgr::take()
 void
 sm_chkpt_mgr::do_chkpt()
 {
+    // as sm_thread::idle_task does: images are read by a transaction
+#if defined(SSN) || defined(SSI)
+    TXN::assign_reader_bitmap_entry();
+#endif
     RCU::rcu_register();
+    MM::register_thread();
+    trace::name_thread("checkpoint");
 start:
     std::unique_lock<std::mutex> lock(_daemon_mutex);
     // Take a chkpt every 10 seconds
     _daemon_cv.wait_for(lock, std::chrono::seconds(10));
-    if (volatile_read(_shutdown)) {
-        RCU::rcu_deregister();
-        return;
+    if (volatile_read(_shutdown))
+        goto out;
+    if (_image) {
+        // Bulk-loaded versions have no log location to record, so keep
+        // writing images. Workers may be running: the snapshot begins
+        // right at cstart, so each commit is either in the image or
+        // after it in the log. If nothing was logged since the last
+        // image it is still current (and the snapshot would miss
+        // bulk-loaded versions, which are stamped with that LSN).
+        if (logmgr->cur_lsn().offset() != _last_cstart.offset()) {
+            RCU::rcu_enter();
+            auto cstart = write_image(false);
+            RCU::rcu_exit();
+            printf("[Checkpoint] image marker: 0x%lx\n", cstart.offset());
+        }
+    }
+    else {
+        RCU::rcu_enter();
+        trace::begin("checkpoint");
+        auto cstart = logmgr->flush();
+        prepare_file(cstart);
+        oidmgr->take_chkpt(cstart);
+        // FIXME (tzwang): originally we should put info about the chkpt
+        // in a log record and then commit that sys transaction that's
+        // responsible for doing chkpt. But that would interfere with
+        // normal forward processing. Instead, here we don't use a system
+        // transaction to chkpt, but use a dedicated thread and avoid going
+        // to the log at all. As a result, we only need to care abou the
+        // chkpt begin stamp, and only cstart is useful in this case. cend
+        // is ignored and emulated as cstart+1.
+        //
+        // Note that the chkpt data file's name only contains cstart, and
+        // we only write the chkpt marker file (chk-cstart-cend) when chkpt
+        // is succeeded.
+        //
+        // TODO: modify update_chkpt_mark etc to remove/ignore cend related.
+        //
+        // (align_up is there to supress an assert in sm-log-file.cpp when
+        // iterating files in the log dir)
+        finish(cstart);
+        trace::end("checkpoint", cstart.offset());
+        RCU::rcu_exit();
+        printf("[Checkpoint] marker: 0x%lx\n", cstart.offset());
     }
+    if (not volatile_read(_shutdown))
+        goto start;
+out:
+    MM::deregister_thread();
+    RCU::rcu_deregister();
+#if defined(SSN) || defined(SSI)
+    TXN::deassign_reader_bitmap_entry();
+#endif
+}
+
+void
+sm_chkpt_mgr::take_image()
+{
+    std::unique_lock<std::mutex> lock(_daemon_mutex);
     RCU::rcu_enter();
-    auto cstart = logmgr->flush();
-    prepare_file(cstart);
-    oidmgr->take_chkpt(cstart);
-    // FIXME (tzwang): originally we should put info about the chkpt
-    // in a log record and then commit that sys transaction that's
-    // responsible for doing chkpt. But that would interfere with
-    // normal forward processing. Instead, here we don't use a system
-    // transaction to chkpt, but use a dedicated thread and avoid going
-    // to the log at all. As a result, we only need to care abou the
-    // chkpt begin stamp, and only cstart is useful in this case. cend
-    // is ignored and emulated as cstart+1.
-    //
-    // Note that the chkpt data file's name only contains cstart, and
-    // we only write the chkpt marker file (chk-cstart-cend) when chkpt
-    // is succeeded.
-    //
-    // TODO: modify update_chkpt_mark etc to remove/ignore cend related.
-    //
-    // (align_up is there to supress an assert in sm-log-file.cpp when
-    // iterating files in the log dir)
+    auto cstart = write_image(true);
+    _image = true;
+    RCU::rcu_exit();
+    printf("[Checkpoint] image marker: 0x%lx\n", cstart.offset());
+}
+
+/* Writes an image of the database as of the current LSN, cstart, and
+   moves the marker there, from where recovery replays the log
+ */
+LSN
+sm_chkpt_mgr::write_image(bool quiesced)
+{
+    trace::begin("checkpoint");
+    // Start the snapshot before taking cstart: the GC can't trim past
+    // the epoch the transaction entered, so what it reads stays around
+    str_arena arena;
+    transaction t(0, arena);
+    auto cstart = logmgr->cur_lsn();
+    // With nothing else running (the end of a bulk load), the snapshot
+    // can include the last commits, stamped with cstart itself
+    t.xc->begin = quiesced ? cstart.offset() + 1 : cstart.offset();
+    prepare_file(cstart, CHKPT_IMAGE_FILE_NAME_FMT);
+    oidmgr->take_image_chkpt(t.xc);
+    t.abort_impl();
+    // the log has to reach cstart before the marker points there
+    while (logmgr->flush().offset() < cstart.offset());
+    finish(cstart);
+    trace::end("checkpoint", cstart.offset());
+    return cstart;
+}
+
+void
+sm_chkpt_mgr::finish(LSN cstart)
+{
     os_fsync(_fd);
     os_close(_fd);
     logmgr->update_chkpt_mark(cstart,
             LSN::make(align_up(cstart.offset()+1), cstart.segment()));
     scavenge();
     _last_cstart = cstart;
-    RCU::rcu_exit();
-    printf("[Checkpoint] marker: 0x%lx\n", cstart.offset());
-    if (not volatile_read(_shutdown))
-        goto start;
-    RCU::rcu_deregister();
 }
 
 void
@@ -85,20 +158,21 @@ sm_chkpt_mgr::scavenge()
 {
     if (not _last_cstart.offset())
         return;
+    // _image tells what the last checkpoint was until take_image is done
     char buf[CHKPT_DATA_FILE_NAME_BUFSZ];
     size_t n = os_snprintf(buf, sizeof(buf),
-                           CHKPT_DATA_FILE_NAME_FMT, _last_cstart._val);
+                           _image ? CHKPT_IMAGE_FILE_NAME_FMT : CHKPT_DATA_FILE_NAME_FMT,
+                           _last_cstart._val);
     ASSERT(n < sizeof(buf));
     ASSERT(oidmgr and oidmgr->dfd);
     os_unlinkat(oidmgr->dfd, buf);
 }
 
 void
-sm_chkpt_mgr::prepare_file(LSN cstart)
+sm_chkpt_mgr::prepare_file(LSN cstart, char const *fmt)
 {
     char buf[CHKPT_DATA_FILE_NAME_BUFSZ];
-    size_t n = os_snprintf(buf, sizeof(buf),
-                           CHKPT_DATA_FILE_NAME_FMT, cstart._val);
+    size_t n = os_snprintf(buf, sizeof(buf), fmt, cstart._val);
     ASSERT(n < sizeof(buf));
     ASSERT(oidmgr and oidmgr->dfd);
     _fd = os_openat(oidmgr->dfd, buf, O_CREAT|O_WRONLY);
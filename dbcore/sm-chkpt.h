@@ -6,13 +6,22 @@
 #include "sm-common.h"
 
 #define CHKPT_DATA_FILE_NAME_FMT "oac-%016zx"
+#define CHKPT_IMAGE_FILE_NAME_FMT "oai-%016zx"
 #define CHKPT_DATA_FILE_NAME_BUFSZ sizeof("chd-0123456789abcdef")
 
 class sm_chkpt_mgr {
 public:
-    sm_chkpt_mgr(LSN last_cstart);
+    sm_chkpt_mgr(LSN last_cstart, bool image=false);
     ~sm_chkpt_mgr();
     void take();
+
+    /* Checkpoint the whole database, keys and values included, so that
+       recovery needs nothing from the log before it. This is what makes
+       a bulk load durable: call it at the end of loading, with nothing
+       else running. Periodic checkpoints write images from then on, as
+       bulk-loaded versions have no log location to record.
+     */
+    void take_image();
     void do_chkpt();
     void write_buffer(void *p, size_t s);
     void sync_buffer();
@@ -30,8 +39,11 @@ private:
     char                    _buffer[BUFFER_SIZE];
     int                     _fd;
     LSN                     _last_cstart;
+    bool                    _image;
 
-    void prepare_file(LSN cstart);
+    void prepare_file(LSN cstart, char const *fmt=CHKPT_DATA_FILE_NAME_FMT);
+    LSN write_image(bool quiesced);
+    void finish(LSN cstart);
     void scavenge();
 };
 
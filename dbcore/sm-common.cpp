@@ -6,7 +6,12 @@
 #include <cstdlib>
 #include <cerrno>
 #include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <vector>
 
 void
@@ -133,6 +138,24 @@ os_fsync(int fd)
     THROW_IF(err, os_error, errno, "Error synching fd %d to disk", fd);
 }
 
+void
+os_fdatasync(int fd)
+{
+    int err = fdatasync(fd);
+    THROW_IF(err, os_error, errno, "Error synching data of fd %d to disk", fd);
+}
+
+bool
+os_fallocate(int fd, off_t offset, off_t len)
+{
+    int err = fallocate(fd, 0, offset, len);
+    if (err and errno == EOPNOTSUPP)
+        return false;
+    THROW_IF(err, os_error, errno, "Error preallocating %zd bytes of fd %d",
+             size_t(len), fd);
+    return true;
+}
+
 void
 os_close(int fd)
 {
@@ -229,3 +252,101 @@ tmp_dir::~tmp_dir() {
     fprintf(stderr, "Deleting directory %s/\n", dname);
     rmdir(dname);
 }
+
+/* Create a socket for [addr], which is either unix:/path or
+   [host]:port, and listen on it or connect it to the peer. Return
+   -1 if the peer isn't there (yet).
+ */
+int
+os_socket(std::string const &addr, bool server)
+{
+    int fd;
+    int err;
+    if (not addr.compare(0, 5, "unix:")) {
+        std::string path = addr.substr(5);
+        sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        THROW_IF(path.empty() or path.size() >= sizeof(sa.sun_path),
+                 illegal_argument, "Invalid unix socket path: %s", path.c_str());
+        strcpy(sa.sun_path, path.c_str());
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        THROW_IF(fd < 0, os_error, errno, "Unable to create socket");
+        if (server) {
+            unlink(path.c_str());
+            THROW_IF(bind(fd, (sockaddr*) &sa, sizeof(sa)) or listen(fd, SOMAXCONN),
+                     os_error, errno, "Unable to listen on %s", addr.c_str());
+            return fd;
+        }
+        err = connect(fd, (sockaddr*) &sa, sizeof(sa));
+    }
+    else {
+        auto colon = addr.rfind(':');
+        THROW_IF(colon == std::string::npos, illegal_argument,
+                 "Expected unix:/path or host:port, got %s", addr.c_str());
+        std::string host = addr.substr(0, colon);
+        std::string port = addr.substr(colon+1);
+
+        addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = server ? AI_PASSIVE : 0;
+        err = getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &res);
+        THROW_IF(err, illegal_argument, "Unable to resolve %s: %s",
+                 addr.c_str(), gai_strerror(err));
+        DEFER(freeaddrinfo(res));
+
+        fd = socket(res->ai_family, SOCK_STREAM, 0);
+        THROW_IF(fd < 0, os_error, errno, "Unable to create socket");
+        int one = 1;
+        if (server) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            THROW_IF(bind(fd, res->ai_addr, res->ai_addrlen) or listen(fd, SOMAXCONN),
+                     os_error, errno, "Unable to listen on %s", addr.c_str());
+            return fd;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        err = connect(fd, res->ai_addr, res->ai_addrlen);
+    }
+
+    if (err) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// false if the peer went away
+bool
+os_send_all(int fd, void const *buf, size_t nbytes)
+{
+    char const *p = (char const*) buf;
+    while (nbytes) {
+        ssize_t n = send(fd, p, nbytes, MSG_NOSIGNAL);
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        nbytes -= n;
+    }
+    return true;
+}
+
+bool
+os_recv_all(int fd, void *buf, size_t nbytes)
+{
+    char *p = (char*) buf;
+    while (nbytes) {
+        ssize_t n = recv(fd, p, nbytes, 0);
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        nbytes -= n;
+    }
+    return true;
+}
@@ -20,6 +20,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <cerrno>
+#include <string>
 
 typedef uint32_t OID;
 typedef uint32_t FID;
@@ -459,11 +460,28 @@ void os_renameat(int tofd, char const *from, int fromfd, char const *to);
 void os_unlinkat(int dfd, char const *fname, int flags=0);
 
 void os_fsync(int fd);
+void os_fdatasync(int fd);
+
+/* Reserve disk blocks for bytes [offset, offset+len) of [fd],
+   extending the file if necessary. Return false if the file system
+   cannot preallocate (the caller can always fall back to writing).
+ */
+bool os_fallocate(int fd, off_t offset, off_t len);
 
 void os_close(int fd);
 
 int os_dup(int fd);
 
+/* Create a socket for [addr], which is either unix:/path or
+   [host]:port, and listen on it or connect it to the peer. Return -1
+   if the peer isn't there (yet).
+ */
+int os_socket(std::string const &addr, bool server);
+
+/* Send or receive exactly [nbytes]; false if the peer went away */
+bool os_send_all(int fd, void const *buf, size_t nbytes);
+bool os_recv_all(int fd, void *buf, size_t nbytes);
+
 /* like POSIX snprintf, but throws on error (return what-if size on overflow).
 
    WARNING: unlike snprintf, this function sets the last byte of [buf]
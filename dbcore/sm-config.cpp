@@ -3,7 +3,9 @@
 #include "../macros.h"
 #include "sm-config.h"
 #include "sm-log-recover-impl.h"
+#include "sm-metrics.h"
 #include "sm-thread.h"
+#include "sm-trace.h"
 #include <iostream>
 
 uint32_t sysconf::worker_threads = 0;
@@ -17,12 +19,28 @@ int sysconf::log_buffer_mb = 512;
 int sysconf::log_segment_mb = 8192;
 std::string sysconf::log_dir("");
 int sysconf::null_log_device = 0;
+int sysconf::log_update_delta = 0;
+int sysconf::log_preallocate = 0;
+int sysconf::log_checksum = sysconf::LOG_CHECKSUM_ADLER32;
+std::string sysconf::log_ship_listen("");
+std::string sysconf::standby_of("");
+std::string sysconf::save_snapshot("");
+std::string sysconf::from_snapshot("");
+std::string sysconf::backup_dir("");
+uint32_t sysconf::backup_threads = 2;
+uint32_t sysconf::backup_mb_per_sec = 0;
+std::string sysconf::restore_backup("");
+uint32_t sysconf::snapshot_retention_mb = 0;
+std::string sysconf::trace_file("");
+std::string sysconf::metrics_file("");
+std::string sysconf::metrics_listen("");
 int sysconf::htt_is_on= 1;
 uint64_t sysconf::node_memory_gb = 12;
 int sysconf::recovery_warm_up_policy = sysconf::WARM_UP_NONE;
 sm_log_recover_impl *sysconf::recover_functor = nullptr;
 uint32_t sysconf::max_threads_per_node = 0;
 bool sysconf::loading = true;
+int sysconf::bulk_load = 0;
 
 void
 sysconf::init() {
@@ -36,7 +54,11 @@ sysconf::init() {
         ncpus / 2 / (numa_max_node() + 1): ncpus / (numa_max_node() + 1);
     numa_nodes = (worker_threads + max_threads_per_node - 1) /  max_threads_per_node;
 
+    // before any thread is spawned, see trace::init()
+    if (trace_file.size())
+        trace::init(trace_file);
     thread::init();
+    metrics::init();
 }
 
 void sysconf::sanity_check() {
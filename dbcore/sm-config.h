@@ -20,13 +20,62 @@ public:
     static uint32_t max_threads_per_node;
     static bool loading;
 
+    // Bulk loads skip the log; a checkpoint with data images at the end of
+    // loading makes them durable (see sm_chkpt_mgr::take_image).
+    static int bulk_load;
+    inline static bool bulk_loading() {
+        return bulk_load and volatile_read(loading);
+    }
+
     static int log_buffer_mb;
     static int log_segment_mb;
     static std::string log_dir;
     static int null_log_device;
+    static int log_update_delta;  // log updates as deltas against the previous version
+    static int log_preallocate;   // preallocate, zero-fill and recycle log segment files
+
+    // Checksum for the blocks of a new log, set by --log-checksum=[adler32/crc32c].
+    // Existing logs keep the checksum they were created with (see sm-log-checksum.h).
+    enum LOG_CHECKSUM { LOG_CHECKSUM_ADLER32, LOG_CHECKSUM_CRC32C };
+    static int log_checksum;
+
+    // Log shipping (see sm-log-ship.h). A primary ships its durable log to a
+    // hot standby that connects to --log-ship-listen; a standby gets it from
+    // the primary at --standby-of. Both take unix:/path or host:port.
+    static std::string log_ship_listen;
+    static std::string standby_of;
+
+    // Snapshots of a loaded database: copy the log away after loading, or
+    // start from such a copy and skip loading (see sm_log::save_snapshot).
+    static std::string save_snapshot;
+    static std::string from_snapshot;
+
+    // Online backup taken to --backup-dir while the benchmark runs, by
+    // --backup-threads threads at most --backup-mb-per-sec MB/s (0 for
+    // no limit), and a backup to load instead of the benchmark's data
+    // (see sm-backup.h).
+    static std::string backup_dir;
+    static uint32_t backup_threads;
+    static uint32_t backup_mb_per_sec;
+    static std::string restore_backup;
+
+    // MB of log behind the current LSN that AS OF transactions can always
+    // begin at; the GC daemon keeps the versions they read (see
+    // MM::snapshot_horizon_lsn). 0 only keeps what the GC hasn't reached.
+    static uint32_t snapshot_retention_mb;
+
     static sm_log_recover_impl *recover_functor;
     static uint64_t node_memory_gb;
 
+    // Chrome trace JSON of workers and daemons, written at exit and on
+    // SIGUSR2 (see sm-trace.h); empty to leave tracing off.
+    static std::string trace_file;
+
+    // Prometheus text of the metrics in sm-metrics.h, rewritten to a file
+    // every second and/or served over HTTP at unix:/path or host:port
+    static std::string metrics_file;
+    static std::string metrics_listen;
+
     // Warm-up policy when recovering from a chkpt or the log.
     // Set by --recovery-warm-up=[lazy/eager/whatever].
     //
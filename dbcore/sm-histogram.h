@@ -0,0 +1,73 @@
+// -*- mode:c++ -*-
+#ifndef __SM_HISTOGRAM_H
+#define __SM_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+/* Counts of values (latencies, usually) in power-of-two buckets:
+   bucket i holds [2**(i-1), 2**i), bucket 0 holds 0, and the last
+   one everything past its lower bound. The unit is up to the user.
+   Not thread safe; keep one per thread and merge them to report.
+ */
+struct pow2_histogram {
+    static size_t const NBUCKETS = 32;
+
+    uint64_t buckets[NBUCKETS];
+    uint64_t count;
+    uint64_t total;
+    uint64_t max_value;
+
+    pow2_histogram() : count(0), total(0), max_value(0) {
+        memset(buckets, 0, sizeof(buckets));
+    }
+
+    /* Count [n] values of [v] each */
+    inline void record(uint64_t v, uint64_t n = 1) {
+        size_t i = v ? 64 - __builtin_clzll(v) : 0;
+        buckets[std::min(i, NBUCKETS-1)] += n;
+        count += n;
+        total += v * n;
+        max_value = std::max(max_value, v);
+    }
+
+    void merge(pow2_histogram const &h) {
+        for (size_t i = 0; i < NBUCKETS; i++)
+            buckets[i] += h.buckets[i];
+        count += h.count;
+        total += h.total;
+        max_value = std::max(max_value, h.max_value);
+    }
+
+    /* Upper bound of the bucket holding the [p]th percentile, or the
+       largest value if that's lower
+     */
+    uint64_t percentile(double p) const {
+        uint64_t target = count * p / 100, seen = 0;
+        for (size_t i = 0; i < NBUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > target)
+                return std::min(uint64_t(1) << i, max_value);
+        }
+        return max_value;
+    }
+
+    /* A summary line for [what], then the non-empty buckets */
+    void print(FILE *out, char const *what, char const *unit) const {
+        if (not count)
+            return;
+        fprintf(out, "%s: %lu, avg %.1f %s, p50 <%lu %s, p99 <%lu %s, p99.9 <%lu %s, max %lu %s\n",
+                what, count, double(total) / count, unit,
+                percentile(50), unit, percentile(99), unit,
+                percentile(99.9), unit, max_value, unit);
+        for (size_t i = 0; i < NBUCKETS; i++) {
+            if (buckets[i])
+                fprintf(out, "  <%10lu %s: %lu\n", uint64_t(1) << i, unit, buckets[i]);
+        }
+    }
+};
+
+#endif
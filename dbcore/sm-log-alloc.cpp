@@ -1,5 +1,6 @@
 #include "sm-config.h"
 #include "sm-log-alloc.h"
+#include "sm-trace.h"
 #include "stopwatch.h"
 #include "../benchmarks/bench.h"
 #include "../macros.h"
@@ -50,6 +51,7 @@ sm_log_alloc_mgr::sm_log_alloc_mgr(sm_log_recover_impl *rf, void *rfn_arg)
     : _lm(sysconf::null_log_device ? NULL : rf, rfn_arg)
     , _logbuf(sysconf::log_buffer_mb * 1024 * 1024, get_starting_byte_offset(&_lm))
     , _durable_flushed_lsn_offset(_lm.get_durable_mark().offset())
+    , _durable_flushed_lsn(_lm.get_durable_mark())
     , _write_daemon_state(0)
     , _waiting_for_durable(false)
     , _waiting_for_dmark(false)
@@ -95,6 +97,12 @@ sm_log_alloc_mgr::dur_flushed_lsn_offset()
     return volatile_read(_durable_flushed_lsn_offset);
 }
 
+LSN
+sm_log_alloc_mgr::dur_flushed_lsn()
+{
+    return volatile_read(_durable_flushed_lsn);
+}
+
 void
 sm_log_alloc_mgr::wait_for_durable(uint64_t dlsn_offset)
 {
@@ -217,8 +225,11 @@ sm_log_alloc_mgr::flush_log_buffer(window_buffer &logbuf, uint64_t new_dlsn_offs
         auto file_offset = durable_sid->offset(_durable_flushed_lsn_offset);
         bool flushed = false;
         if (not flushed and (not sysconf::null_log_device or sysconf::loading)) {
+            uint64_t start = stopwatch_t::now();
             uint64_t n = os_pwrite(active_fd, buf, nbytes, file_offset);
             THROW_IF(n < nbytes, log_file_error, "Incomplete log write");
+            if (not sysconf::loading)
+                _write_latency.record((stopwatch_t::now() - start) / 1000);
         }
 
         logbuf.advance_reader(new_byte);
@@ -232,6 +243,7 @@ sm_log_alloc_mgr::flush_log_buffer(window_buffer &logbuf, uint64_t new_dlsn_offs
         // update values for next round
         durable_sid = new_sid;
         _durable_flushed_lsn_offset = new_offset;
+        volatile_write(_durable_flushed_lsn._val, durable_sid->make_lsn(new_offset)._val);
         durable_byte = new_byte;
 
         if (update_dmark)
@@ -453,6 +465,48 @@ sm_log_alloc_mgr::discard(log_allocation *x)
     release(x);
 }
 
+void
+sm_log_alloc_mgr::append_shipped(segment_id *sid, uint64_t lsn_offset, char const *data, size_t nbytes,
+                                 bool block_end)
+{
+    ASSERT(nbytes <= _logbuf.window_size() / 4);
+    ASSERT(sid->start_offset <= lsn_offset and lsn_offset + nbytes <= sid->end_offset);
+    uint64_t byte = sid->byte_offset + (lsn_offset - sid->start_offset);
+
+ grab_buffer:
+    char *buf = _logbuf.write_buf(byte, nbytes);
+    if (not buf) {
+        // same as in allocate()
+        _write_daemon_mutex.lock();
+        DEFER(_write_daemon_mutex.unlock());
+        _waiting_for_durable = true;
+
+        _kick_log_write_daemon();
+        _write_complete_cond.wait(_write_daemon_mutex);
+        goto grab_buffer;
+    }
+    memcpy(buf, data, nbytes);
+
+    /* Never let a torn block become durable: replay and recovery
+       couldn't find their way past it. The tail of a segment only
+       becomes durable along with the start of the next one (see
+       flush_log_buffer), which the primary ships next.
+     */
+    uint64_t end = lsn_offset + nbytes;
+    if (not block_end)
+        return;
+    ASSERT(end < sid->end_offset);
+    volatile_write(_lsn_offset, end);
+
+    // no group commit to wait for: kick the daemon every time
+    auto old_state = __sync_fetch_and_or(&_write_daemon_state, DAEMON_HAS_WORK);
+    if (old_state == DAEMON_SLEEPING) {
+        _write_daemon_mutex.lock();
+        DEFER(_write_daemon_mutex.unlock());
+        _kick_log_write_daemon();
+    }
+}
+
 uint64_t
 sm_log_alloc_mgr::smallest_tls_lsn_offset()
 {
@@ -478,6 +532,7 @@ sm_log_alloc_mgr::_log_write_daemon()
     rcu_register();
     rcu_enter();
     DEFER(rcu_exit());
+    trace::name_thread("log writer");
 
     // every 100 ms or so, update the durable mark on disk
     static uint64_t const DURABLE_MARK_TIMEOUT_NS = uint64_t(5000)*1000*1000;
@@ -485,7 +540,9 @@ sm_log_alloc_mgr::_log_write_daemon()
     for (;;) {
         auto cur_offset = cur_lsn_offset();
         auto new_dlsn_offset = smallest_tls_lsn_offset();
+        trace::begin("log flush", new_dlsn_offset - _durable_flushed_lsn_offset);
         auto *durable_sid = flush_log_buffer(_logbuf, new_dlsn_offset);
+        trace::end("log flush");
 
         rcu_exit();
 
@@ -512,6 +569,7 @@ sm_log_alloc_mgr::_log_write_daemon()
             if (should_update) {
                 last_dmark = now;
                 _lm.update_durable_mark(durable_sid->make_lsn(_durable_flushed_lsn_offset));
+                trace::instant("durable mark", _durable_flushed_lsn_offset);
             }
         }
 
@@ -4,6 +4,7 @@
 
 #include <deque>
 #include "../spinlock.h"
+#include "sm-histogram.h"
 #include "sm-log-recover.h"
 
 /* The log block allocator.
@@ -42,6 +43,12 @@ struct sm_log_alloc_mgr {
      */
     uint64_t dur_flushed_lsn_offset();
 
+    /* Same, as an LSN. Unlike the offset alone, this also tells which
+       segment the log is durable in, which matters near a segment
+       change (segment bounds may overlap by up to MIN_LOG_BLOCK_SIZE).
+     */
+    LSN dur_flushed_lsn();
+
     /* Block the caller until the specified LSN offset has become durable
      */
     void wait_for_durable(uint64_t dlsn_offset);
@@ -72,6 +79,17 @@ struct sm_log_alloc_mgr {
      */
     void discard(log_allocation *x);
 
+    /* Log shipping, standby side (see sm-log-ship.h): copy [nbytes]
+       that the primary wrote at [lsn_offset] of segment [sid] into the
+       log buffer, as if they had been allocated and released here, and
+       let the log write daemon persist them. Chunks must arrive in log
+       order and be at most a quarter of the buffer in size. Only a
+       chunk that ends a log block ([block_end]) lets the log, and
+       with it the durable mark, move past what came before it.
+     */
+    void append_shipped(segment_id *sid, uint64_t lsn_offset, char const *data, size_t nbytes,
+                        bool block_end);
+
     void _log_write_daemon();
     void _kick_log_write_daemon();
     segment_id *flush_log_buffer(window_buffer &logbuf, uint64_t new_dlsn_dlsn, bool update_dmark=false);
@@ -79,6 +97,12 @@ struct sm_log_alloc_mgr {
     sm_log_recover_mgr _lm;
     window_buffer _logbuf;
     uint64_t _durable_flushed_lsn_offset;
+    LSN _durable_flushed_lsn;
+    /* Latency of synchronous log writes in us (the fd is O_SYNC or
+       O_DSYNC, so each write includes its fsync). Only the log write
+       daemon records into it, and only once loading is over.
+     */
+    pow2_histogram _write_latency;
 
     pthread_t _write_daemon_tid;
     os_mutex _write_daemon_mutex;
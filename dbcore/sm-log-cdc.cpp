@@ -0,0 +1,127 @@
+#include "sm-log-cdc.h"
+
+#include "sm-log-delta.h"
+#include "sm-log-impl.h"
+#include "../object.h"
+#include "../varstr.h"
+
+#include <unistd.h>
+
+sm_log_cdc::sm_log_cdc(LSN start)
+    : _pos(start)
+{
+}
+
+bool
+sm_log_cdc::next(batch &b, uint64_t timeout_us, size_t max_records)
+{
+    b.records.clear();
+    b.data.clear();
+    b.ntxns = 0;
+    b.next = _pos;
+
+    for (uint64_t waited = 0; ; waited += 100) {
+        LSN dlsn = logmgr->durable_flushed_lsn();
+        if (_pos.offset() < dlsn.offset() and _fill(b, dlsn, max_records))
+            return true;
+        if (waited >= timeout_us)
+            return false;
+        usleep(100);
+    }
+}
+
+/* Scan whole transactions from [_pos] up to [dlsn], which ends a
+   block. The scan may see blocks past [dlsn], some only half written,
+   but stops before using any of them.
+ */
+size_t
+sm_log_cdc::_fill(batch &b, LSN dlsn, size_t max_records)
+{
+    auto &lm = get_impl(logmgr)->_lm._lm;
+    auto *sid = lm.get_segment(_pos.segment());
+    THROW_IF(not sid or _pos.offset() < sid->start_offset or sid->end_offset <= _pos.offset(),
+             log_file_error, "Change stream at LSN %012zx fell behind log reclamation",
+             _pos.offset());
+
+    RCU::rcu_enter();
+    DEFER(RCU::rcu_exit());
+    auto *scan = logmgr->get_scan_mgr()->new_log_scan(_pos, true);
+    DEFER(delete scan);
+
+    LSN tx = INVALID_LSN;
+    LSN next = dlsn;
+    for (; scan->valid(); scan->next()) {
+        LSN t = scan->tx_lsn();
+        if (t != tx) {
+            if (dlsn.offset() <= t.offset() or max_records <= b.records.size()) {
+                next = t;
+                break;
+            }
+            tx = t;
+            b.ntxns++;
+        }
+        if (scan->type() != sm_log_scan_mgr::LOG_CHKPT)
+            _append(b, scan);
+    }
+
+    /* Keys and values were recorded as offsets, since [data] may have
+       moved while growing.
+     */
+    for (auto &r : b.records) {
+        r.key = r.key_size ? &b.data[(uintptr_t) r.key] : NULL;
+        r.value = r.value_size ? &b.data[(uintptr_t) r.value] : NULL;
+    }
+
+    _pos = b.next = next;
+    return b.ntxns;
+}
+
+void
+sm_log_cdc::_append(batch &b, sm_log_scan_mgr::record_scan *scan)
+{
+    record r = {scan->tx_lsn(), scan->type(), scan->fid(), scan->oid(), NULL, 0, NULL, 0};
+    size_t sz = scan->payload_size();
+    if (sz == sm_log_scan_mgr::NO_PAYLOAD) {
+        b.records.push_back(r);
+        return;
+    }
+
+    size_t at = align_up(b.data.size());
+    b.data.resize(at + sz);
+    scan->load_object(&b.data[at], sz);
+    auto *v = (varstr *) &b.data[at];
+
+    switch (r.type) {
+    case sm_log_scan_mgr::LOG_FID:
+        r.key = (char const *) at;
+        r.key_size = strnlen(&b.data[at], sz);
+        break;
+    case sm_log_scan_mgr::LOG_INSERT_INDEX:
+        r.key = (char const *) (at + sizeof(varstr));
+        r.key_size = v->size();
+        break;
+    case sm_log_scan_mgr::LOG_INSERT_WITH_KEY: {
+        // the key follows the version, see log_insert_with_key
+        size_t kat = at + align_up(sizeof(varstr) + v->size());
+        r.value = (char const *) (at + sizeof(varstr));
+        r.value_size = v->size();
+        r.key = (char const *) (kat + sizeof(varstr));
+        r.key_size = ((varstr *) &b.data[kat])->size();
+        break;
+    }
+    case sm_log_scan_mgr::LOG_UPDATE_DELTA: {
+        uint32_t value_size = ((log_delta *) &b.data[at])->value_size;
+        size_t vat = at + align_up(sz);
+        b.data.resize(vat + value_size);
+        object::load_delta_value((uint8_t *) &b.data[vat], (log_delta *) &b.data[at]);
+        r.value = (char const *) vat;
+        r.value_size = value_size;
+        break;
+    }
+    default:
+        r.value = (char const *) (at + sizeof(varstr));
+        r.value_size = v->size();
+        break;
+    }
+    b.records.push_back(r);
+}
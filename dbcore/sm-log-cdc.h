@@ -0,0 +1,84 @@
+// -*- mode:c++ -*-
+#ifndef __SM_LOG_CDC_H
+#define __SM_LOG_CDC_H
+
+#include "sm-log.h"
+
+#include <vector>
+
+/* Change data capture: tail the redo log.
+
+   A change stream hands out the records of committed transactions, in
+   commit order, as they become durable. Each batch holds whole
+   transactions; records carry their transaction's commit block LSN
+   (see sm_log_scan_mgr::record_scan::tx_lsn), and the batch carries
+   the LSN to resume from, so a consumer that persists it alongside
+   its own state can pick up exactly where it left off, in this
+   process or after a restart.
+
+   What a record holds depends on its type:
+
+   LOG_INSERT, LOG_UPDATE, LOG_RELOCATE: the new value
+   LOG_UPDATE_DELTA: the new value, rebuilt in full from the log
+   LOG_INSERT_INDEX: the key
+   LOG_INSERT_WITH_KEY: both
+   LOG_DELETE: neither
+   LOG_FID: the table name, as the key
+
+   Updates and deletes only name the OID; consumers that need keys
+   remember them from the inserts (OIDs are never reused while a
+   record exists).
+
+   The stream reads the durable log back from the segment files and
+   pins nothing, so it never holds back log reclamation. A consumer
+   that falls behind reclamation gets a log_file_error instead.
+
+   Call next() from a thread registered with RCU.
+ */
+class sm_log_cdc {
+public:
+    struct record {
+        LSN tx_lsn;
+        sm_log_scan_mgr::record_type type;
+        FID fid;
+        OID oid;
+        char const *key;
+        uint32_t key_size;
+        char const *value;
+        uint32_t value_size;
+    };
+
+    struct batch {
+        // valid until the batch is reused
+        std::vector<record> records;
+        uint64_t ntxns;
+
+        // resume the stream from here to continue after this batch
+        LSN next;
+
+        // where keys and values live
+        std::vector<char> data;
+    };
+
+    /* Start streaming at [start], which must be the start of a
+       transaction: durable_flushed_lsn(), or a batch's [next].
+     */
+    sm_log_cdc(LSN start);
+
+    /* Fill [b] with the next committed transactions, waiting up to
+       [timeout_us] for some to become durable. Return false if none
+       did. A batch stops at the first transaction boundary after
+       [max_records] records.
+     */
+    bool next(batch &b, uint64_t timeout_us, size_t max_records=4096);
+
+    LSN position() { return _pos; }
+
+private:
+    size_t _fill(batch &b, LSN dlsn, size_t max_records);
+    void _append(batch &b, sm_log_scan_mgr::record_scan *scan);
+
+    LSN _pos;
+};
+
+#endif
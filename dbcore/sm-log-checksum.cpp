@@ -0,0 +1,71 @@
+#include "sm-log-checksum.h"
+
+#include "adler.h"
+#include "crc32c.h"
+#include "sm-config.h"
+
+#include <string.h>
+
+static log_checksum
+make_adler32()
+{
+    __builtin_cpu_init();
+    log_checksum c = {sysconf::LOG_CHECKSUM_ADLER32, "adler32", "vanilla",
+                      ADLER32_CSUM_INIT, &adler32_vanilla,
+                      &adler32_memcpy_vanilla, &adler32_merge};
+#ifdef __SSSE3__
+    c.impl = "sse";
+    c.sum = &adler32_sse;
+    c.sum_memcpy = &adler32_memcpy_sse;
+#endif
+#ifdef __x86_64__
+    if (__builtin_cpu_supports("avx2")) {
+        c.impl = "avx2";
+        c.sum = &adler32_avx2;
+        c.sum_memcpy = &adler32_memcpy_avx2;
+    }
+#endif
+    return c;
+}
+
+static log_checksum
+make_crc32c()
+{
+    __builtin_cpu_init();
+    log_checksum c = {sysconf::LOG_CHECKSUM_CRC32C, "crc32c", "vanilla",
+                      CRC32C_CSUM_INIT, &crc32c_vanilla,
+                      &crc32c_memcpy_vanilla, &crc32c_merge};
+#ifdef __x86_64__
+    if (__builtin_cpu_supports("sse4.2")) {
+        c.impl = "sse4.2";
+        c.sum = &crc32c_sse42;
+        c.sum_memcpy = &crc32c_memcpy_sse42;
+    }
+#endif
+    return c;
+}
+
+// indexed by sysconf::LOG_CHECKSUM
+static log_checksum const checksums[] = {make_adler32(), make_crc32c()};
+static size_t const NUM_CHECKSUMS = sizeof(checksums)/sizeof(checksums[0]);
+
+log_checksum const *log_csum = &checksums[sysconf::LOG_CHECKSUM_ADLER32];
+
+log_checksum const *
+log_checksum_find(char const *name)
+{
+    for (auto &c : checksums) {
+        if (not strcmp(c.name, name))
+            return &c;
+    }
+    return NULL;
+}
+
+bool
+log_checksum_select(int kind)
+{
+    if (kind < 0 or size_t(kind) >= NUM_CHECKSUMS)
+        return false;
+    log_csum = &checksums[kind];
+    return true;
+}
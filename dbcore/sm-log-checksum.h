@@ -0,0 +1,52 @@
+// -*- mode:c++ -*-
+#ifndef __SM_LOG_CHECKSUM_H
+#define __SM_LOG_CHECKSUM_H
+
+#include <stdint.h>
+#include <cstddef>
+
+/* Checksums for log blocks.
+
+   Recovery finds the end of the log by checking block checksums, so
+   every block must be checked with the algorithm that wrote it. The
+   algorithm is therefore a property of the log: sysconf::log_checksum
+   chooses it when a log is created, the log directory records it (see
+   sm-log-file.cpp), and reopening the log selects it again regardless
+   of the current setting. Logs that predate the choice use adler32.
+
+   Each algorithm may have several implementations. Unlike the plain
+   adler32/crc32c entry points, which pick one at compile time, we
+   pick the fastest one the CPU supports at runtime, so binaries built
+   without -march=native still get AVX2 adler32 and hardware CRC32C.
+ */
+struct log_checksum {
+    int kind;           // sysconf::LOG_CHECKSUM
+    char const *name;   // as accepted by --log-checksum
+    char const *impl;   // implementation picked for this CPU
+    uint32_t init;
+
+    uint32_t (*sum)(char const *data, size_t nbytes, uint32_t sofar);
+
+    /* Checksum and copy at the same time. The adler32 SSE version
+       requires src and dest to share their alignment to a 16-byte
+       boundary, so callers must always respect that.
+     */
+    uint32_t (*sum_memcpy)(char *dest, char const *src, size_t nbytes, uint32_t sofar);
+    uint32_t (*merge)(uint32_t left, uint32_t right, size_t right_size);
+};
+
+/* The checksum in use by the log. Set once during log bootstrap,
+   before any block is written or checked.
+ */
+extern log_checksum const *log_csum;
+
+/* Return the checksum named [name], or NULL if there is none */
+log_checksum const *log_checksum_find(char const *name);
+
+/* Use checksum [kind] from now on. Return false, leaving the current
+   checksum in place, if [kind] is unknown; for an existing log that
+   means it was written by a newer version.
+ */
+bool log_checksum_select(int kind);
+
+#endif
@@ -10,9 +10,9 @@
  */
 #include "sm-log.h"
 
-#include "adler.h"
 #include "cslist.h"
 #include "rcu-slist.h"
+#include "sm-log-checksum.h"
 #include "stub-impl.h"
 #include "window-buffer.h"
 
@@ -115,6 +115,14 @@ enum log_record_type : uint8_t {
     LOG_INSERT_EXT = LOG_FLAG_IS_EXT | LOG_INSERT,
     LOG_INSERT_INDEX = LOG_FLAG_HAS_PAYLOAD | 0x2,
 
+    /* An insert and its index entry in a single record: the payload
+       is the version's varstr followed by the key's varstr (starting
+       at the next aligned offset), so the record's location doubles
+       as the version's location. Always embedded; payloads too large
+       to embed are logged as LOG_INSERT_EXT + LOG_INSERT_INDEX.
+     */
+    LOG_INSERT_WITH_KEY = LOG_FLAG_HAS_PAYLOAD | 0xb,
+
     /* Update a record. Version may be embedded or external. */
     LOG_UPDATE = LOG_FLAG_HAS_PAYLOAD | 0x3,
     LOG_UPDATE_EXT = LOG_FLAG_IS_EXT | LOG_UPDATE,
@@ -153,6 +161,15 @@ enum log_record_type : uint8_t {
     /* Records the creation of an FID with a given table name
      */
     LOG_FID = LOG_FLAG_HAS_PAYLOAD | 0x9,
+
+    /* Update a record by logging only the byte ranges that changed
+       relative to the previous version (see sm-log-delta.h). The
+       payload is self-describing and names the log location of the
+       image it applies to, so a version can be rebuilt by starting
+       from the nearest full image and applying deltas forward.
+     */
+    LOG_UPDATE_DELTA = LOG_FLAG_HAS_PAYLOAD | 0xa,
+    LOG_UPDATE_DELTA_EXT = LOG_FLAG_IS_EXT | LOG_UPDATE_DELTA,
 };
 
 // log records are 16B sans payload
@@ -308,12 +325,12 @@ struct LOG_ALIGN log_block {
      */
     uint32_t body_checksum() {
         auto *begin = checksum_begin();
-        return adler32(begin, payload_begin()-begin);
+        return log_csum->sum(begin, payload_begin()-begin, log_csum->init);
     }
 
     uint32_t full_checksum() {
         auto *begin = checksum_begin();
-        return adler32(begin, payload_end()-begin);
+        return log_csum->sum(begin, payload_end()-begin, log_csum->init);
     }
 
     /* Return the LSN that identifies the payload for record [i]. 
@@ -383,6 +400,14 @@ struct LOG_ALIGN log_request {
 
     // where to write the record's location (once assigned)
     fat_ptr *pdest;
+
+    /* LOG_INSERT_WITH_KEY only: the key is gathered into the log
+       right after the first (payload_size - key_size) bytes of the
+       version, so neither has to be copied before the log block is
+       populated.
+     */
+    fat_ptr key_ptr;
+    uint32_t key_size;
 };
 
 /* The smallest meaningful log block carries no payload. Like all log
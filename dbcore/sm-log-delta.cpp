@@ -0,0 +1,89 @@
+#include "sm-log-delta.h"
+
+#include <string.h>
+
+size_t
+log_delta::size() const
+{
+    size_t sz = sizeof(log_delta) + nranges * sizeof(range);
+    for (uint16_t i = 0; i < nranges; i++)
+        sz += ranges[i].length;
+    return sz;
+}
+
+void
+log_delta::apply(uint8_t *value) const
+{
+    ASSERT(magic == MAGIC);
+    auto *bytes = (uint8_t const *) &ranges[nranges];
+    for (uint16_t i = 0; i < nranges; i++) {
+        ASSERT(ranges[i].offset + ranges[i].length <= value_size);
+        memcpy(value + ranges[i].offset, bytes, ranges[i].length);
+        bytes += ranges[i].length;
+    }
+}
+
+static inline
+uint64_t
+load_word(uint8_t const *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+size_t
+log_delta::encode(char *dest, size_t max, fat_ptr base, uint16_t depth,
+                  uint8_t const *before, uint8_t const *after, uint32_t size)
+{
+    if (max < sizeof(log_delta))
+        return 0;
+
+    auto *d = (log_delta *) dest;
+    d->magic = MAGIC;
+    d->base = base;
+    d->value_size = size;
+    d->nranges = 0;
+    d->depth = depth;
+
+    /* Find the changed ranges first; their bytes go after the last
+       range descriptor, so we can't place them until we know how many
+       ranges there are. Unchanged gaps shorter than a range descriptor
+       cost less to log than to skip, so fold them into the range.
+     */
+    size_t nbytes = 0;
+    uint32_t i = 0;
+    while (i < size) {
+        if (i + sizeof(uint64_t) <= size and
+            load_word(before + i) == load_word(after + i)) {
+            i += sizeof(uint64_t);
+            continue;
+        }
+        if (before[i] == after[i]) {
+            i++;
+            continue;
+        }
+
+        uint32_t end = i + 1;
+        for (uint32_t j = end; j < size and j < end + sizeof(range); j++) {
+            if (before[j] != after[j])
+                end = j + 1;
+        }
+
+        if (d->nranges == UINT16_MAX)
+            return 0;
+        nbytes += end - i;
+        if (sizeof(log_delta) + (d->nranges + 1) * sizeof(range) + nbytes > max)
+            return 0;
+        d->ranges[d->nranges++] = range{i, end - i};
+        i = end;
+    }
+
+    auto *bytes = (uint8_t *) &d->ranges[d->nranges];
+    for (uint16_t r = 0; r < d->nranges; r++) {
+        memcpy(bytes, after + d->ranges[r].offset, d->ranges[r].length);
+        bytes += d->ranges[r].length;
+    }
+    ASSERT(d->size() == (size_t) ((char *) bytes - dest));
+    return (char *) bytes - dest;
+}
@@ -0,0 +1,65 @@
+// -*- mode:c++ -*-
+#ifndef __SM_LOG_DELTA_H
+#define __SM_LOG_DELTA_H
+
+#include "sm-common.h"
+
+/* Payload of a LOG_UPDATE_DELTA record.
+
+   Updates typically change a few fields of an otherwise unchanged
+   tuple (think TPC-C's stock and district rows), so logging the full
+   new image spends most of the log bandwidth on bytes the previous
+   version already has. A delta records only the byte ranges that
+   changed:
+
+   [header] [range 0] ... [range n-1] [bytes of range 0] ... [bytes of range n-1]
+
+   The header overlaps the varstr that starts a full image (see
+   do_tree_put), and [magic] can never be a valid varstr length, so
+   readers that fetch a version by location alone (ensure_tuple,
+   checkpoint recovery) can tell the two kinds of payload apart.
+
+   [base] is the log location of the image the delta applies to, which
+   may itself be a delta. [depth] counts the deltas between this one
+   and the nearest full image, this one included. Writers cap it at
+   MAX_DEPTH so that rebuilding a version never chases a long chain
+   through the log.
+ */
+struct log_delta {
+    static uint64_t const MAGIC = ~uint64_t(0);
+    static uint16_t const MAX_DEPTH = 8;
+
+    struct range {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    uint64_t magic;
+    fat_ptr base;
+    uint32_t value_size;
+    uint16_t nranges;
+    uint16_t depth;
+    range ranges[0];
+
+    static bool is_delta(void const *payload) {
+        return ((log_delta const *) payload)->magic == MAGIC;
+    }
+
+    /* Bytes occupied by the delta, not counting alignment padding */
+    size_t size() const;
+
+    /* Turn the [value_size] bytes at [value], which hold the image at
+       [base], into the image this delta describes.
+     */
+    void apply(uint8_t *value) const;
+
+    /* Encode the difference between [before] and [after], both [size]
+       bytes long, into [dest] as a delta against the image at
+       [base]. Return the size of the delta, or zero if it does not fit
+       in [max] bytes; the caller should log the full image instead.
+     */
+    static size_t encode(char *dest, size_t max, fat_ptr base, uint16_t depth,
+                         uint8_t const *before, uint8_t const *after, uint32_t size);
+};
+
+#endif
@@ -5,10 +5,21 @@
 
 #include <new>
 #include <sys/fcntl.h>
+#include <sys/stat.h>
 #include <algorithm>
 
 using namespace RCU;
 
+namespace {
+    extern "C"
+    void*
+    zero_fill_daemon_thunk(void *arg)
+    {
+        ((sm_log_file_mgr*) arg)->_zero_fill_daemon();
+        return NULL;
+    }
+}
+
 // segment, start offset, end offset
 #define SEGMENT_FILE_NAME_FMT "log-%08x-%012zx-%012zx"
 #define SEGMENT_FILE_NAME_BUFSZ sizeof("log-01234567-0123456789ab-0123456789ab")
@@ -25,6 +36,19 @@ using namespace RCU;
 #define NXT_SEG_FILE_NAME_FMT "nxt-%08x"
 #define NXT_SEG_FILE_NAME_BUFSZ sizeof("nxt-01234567")
 
+// recycled segment
+#define RECYCLED_FILE_NAME_FMT "rcy-%08x"
+#define RECYCLED_FILE_NAME_BUFSZ sizeof("rcy-01234567")
+
+// format flags
+#define FORMAT_FILE_NAME_FMT "fmt-%08x"
+#define FORMAT_FILE_NAME_BUFSZ sizeof("fmt-01234567")
+
+/* Log format flags, recorded in the format marker. Logs created
+   before there were any flags have no marker and use adler32.
+ */
+static uint32_t const LOG_FORMAT_CHECKSUM_MASK = 0xff;
+
 #warning Crash durability is NOT fully guaranteed by this implementation
 /* ^^^
 
@@ -80,6 +104,14 @@ using namespace RCU;
 */
 static size_t const LOG_SEGMENT_ALIGN = 1024;
 
+/* With preallocation on, keep at most this many reclaimed segment
+   files around for reuse; delete the rest.
+ */
+static size_t const MAX_RECYCLED_SEGMENTS = 2;
+
+// zero-fill write size; also bounds how long open_for_write can wait
+static size_t const ZERO_FILL_CHUNK = 1024*1024;
+
 struct segment_file_name {
     char buf[SEGMENT_FILE_NAME_BUFSZ];
     segment_file_name(segment_id *sid)
@@ -117,6 +149,28 @@ struct dmark_file_name {
     char const *operator*() { return buf; }
 };
 
+struct rcy_file_name {
+    char buf[RECYCLED_FILE_NAME_BUFSZ];
+    rcy_file_name(uint32_t segnum) {
+        size_t n = os_snprintf(buf, sizeof(buf),
+                               RECYCLED_FILE_NAME_FMT, segnum);
+        ASSERT(n < sizeof(buf));
+    }
+    operator char const *() { return buf; }
+    char const *operator*() { return buf; }
+};
+
+struct format_file_name {
+    char buf[FORMAT_FILE_NAME_BUFSZ];
+    format_file_name(uint32_t flags) {
+        size_t n = os_snprintf(buf, sizeof(buf),
+                               FORMAT_FILE_NAME_FMT, flags);
+        ASSERT(n < sizeof(buf));
+    }
+    operator char const *() { return buf; }
+    char const *operator*() { return buf; }
+};
+
 struct nxt_seg_file_name {
     char buf[NXT_SEG_FILE_NAME_BUFSZ];
     nxt_seg_file_name(uint32_t segnum) {
@@ -187,7 +241,7 @@ sm_log_file_mgr::segment_array::~segment_array()
     }
 }
 
-/* The log consists of 18 files:
+/* The log consists of 19 files:
 
    Sixteen log segment files, of the form log-$SEGNO-$BEGIN-$END. Each
    segment's name encodes the segment number, as well as the range of
@@ -219,6 +273,14 @@ sm_log_file_mgr::segment_array::~segment_array()
    where to find the checkpoint transaction, and also identifies the
    LSN from which recovery should begin.
 
+   With preallocation on, the directory may also hold up to two
+   recycled segment files, rcy-$SEGNO, waiting to be reused. Opening
+   the log with preallocation off deletes them.
+
+   One format marker, an empty file named fmt-$FLAGS. The flags record
+   choices made when the log was created that readers must honor,
+   currently just the block checksum (see sm-log-checksum.h).
+
    Log bootstrap does three things:
 
    1. Verify that directory [dname] contains (only) valid log files
@@ -236,6 +298,11 @@ sm_log_file_mgr::segment_array::~segment_array()
    that the directory exists and is empty.
  */
 void sm_log_file_mgr::_make_new_log() {
+    // checksums below must already use the new log's format
+    THROW_IF(not log_checksum_select(sysconf::log_checksum), illegal_argument,
+             "Unknown log checksum: %d", sysconf::log_checksum);
+    uint32_t format = sysconf::log_checksum & LOG_FORMAT_CHECKSUM_MASK;
+
     // create and open the first segment file
     uint32_t segnum = oldest_segnum = 1;
     nxt_segment_fd = 0;
@@ -278,13 +345,17 @@ void sm_log_file_mgr::_make_new_log() {
     os_pwrite(fd, buf, sizeof(buf), 0);
     _durable_lsn = b.next_lsn();
 
-    // create the checkpoint and durable mark files
+    // create the checkpoint, durable and format mark files
     os_truncateat(dfd, cmark_file_name(_chkpt_start_lsn, _chkpt_end_lsn));
     os_truncateat(dfd, dmark_file_name(_durable_lsn));
+    os_truncateat(dfd, format_file_name(format));
     os_fsync(dfd);
 }
 
 sm_log_file_mgr::sm_log_file_mgr()
+    : _zero_fill_running(false)
+    , _zero_fill_fd(-1)
+    , _zero_fill_segnum(0)
 {
     set_segment_size(sysconf::log_segment_mb * sysconf::MB);
 
@@ -298,6 +369,8 @@ sm_log_file_mgr::sm_log_file_mgr()
     bool durable_found = false;
     bool chkpt_found = false;
     bool nxt_seg_found = false;
+    bool format_found = false;
+    uint32_t format = 0;
 
     std::vector<segment_id*> tmp;
     dirent_iterator dir(sysconf::log_dir.c_str());
@@ -344,6 +417,31 @@ sm_log_file_mgr::sm_log_file_mgr()
             }
             break;
         }
+        case 'f': {
+            // allowed: one format marker
+            char canary;
+            int n = sscanf(fname, FORMAT_FILE_NAME_FMT "%c",
+                           &format, &canary);
+            if (n == 1) {
+                THROW_IF(format_found, log_file_error,
+                         "Multiple log format markers found");
+                format_found = true;
+                continue;
+            }
+            break;
+        }
+        case 'r': {
+            // allowed: recycled segments
+            char canary;
+            uint32_t segnum;
+            int n = sscanf(fname, RECYCLED_FILE_NAME_FMT "%c",
+                           &segnum, &canary);
+            if (n == 1) {
+                recycled_segments.push_back(segnum);
+                continue;
+            }
+            break;
+        }
         case 'l': {
             // allowed: log segment
             char canary;
@@ -405,16 +503,31 @@ sm_log_file_mgr::sm_log_file_mgr()
         throw log_file_error("Invalid log file name `%s'", fname);
     }
 
+    // Recycled files are only ever reused with preallocation on
+    if (not sysconf::log_preallocate and not recycled_segments.empty()) {
+        for (uint32_t segnum : recycled_segments)
+            os_unlinkat(dfd, rcy_file_name(segnum));
+        os_fsync(dfd);
+        recycled_segments.clear();
+    }
+
     // Empty/missing log?
     if (tmp.empty()) {
-        THROW_IF(chkpt_found or durable_found or nxt_seg_found, log_file_error,
-                 "Found checkpoint, durable marker and/or new segment file, but no log segments");
+        THROW_IF(chkpt_found or durable_found or nxt_seg_found or format_found, log_file_error,
+                 "Found checkpoint, durable, format marker and/or new segment file, but no log segments");
         _make_new_log();
         sm_log::need_recovery = false;
         return;
     }
 
     sm_log::need_recovery = true;
+
+    // check the existing log with the checksum that wrote it
+    int csum_kind = format & LOG_FORMAT_CHECKSUM_MASK;
+    THROW_IF(format & ~LOG_FORMAT_CHECKSUM_MASK, log_file_error,
+             "Unsupported log format flags: %08x", format);
+    THROW_IF(not log_checksum_select(csum_kind), log_file_error,
+             "Unsupported log checksum: %d", csum_kind);
     
     THROW_IF(tmp.size() > NUM_LOG_SEGMENTS, log_file_error,
              "Log directory contains too many segment files: %zd",
@@ -461,15 +574,33 @@ sm_log_file_mgr::sm_log_file_mgr()
         THROW_IF(uint32_t(nxt_segment_fd) != shi->segnum+1, log_file_error,
                  "Wrong segment number for new segment file: %u (should be %u)",
                  uint32_t(nxt_segment_fd), shi->segnum+1);
+
+        /* We may have crashed before the zero-fill finished */
+        if (sysconf::log_preallocate) {
+            file_mutex.lock();
+            DEFER(file_mutex.unlock());
+            _preallocate(uint32_t(nxt_segment_fd));
+        }
     }
     else {
         /* Crash must have happened between opening of one segment and
-           creation of the new file for the next. Schedule its creation.
+           creation of the new file for the next (or this log is a
+           snapshot, see sm_log::save_snapshot). Create it now: the
+           newest segment already has its final name, so there is
+           nothing to rename.
          */
+        file_mutex.lock();
+        DEFER(file_mutex.unlock());
         nxt_segment_fd = shi->segnum;
+        _create_nxt_seg_file(true);
     }
 }
 
+sm_log_file_mgr::~sm_log_file_mgr()
+{
+    _stop_zero_fill();
+}
+
 /* Set the segment size, forcing to the log segment's minimum alignment
 
  */
@@ -508,9 +639,90 @@ sm_log_file_mgr::_create_nxt_seg_file(bool force)
     }
     if (doit) {
         nxt_seg_file_name sname(segnum);
-        uint64_t fd = os_openat(dfd, sname, O_CREAT|O_EXCL|O_RDONLY);
+        int flags = O_CREAT|O_EXCL|O_RDONLY;
+        if (sysconf::log_preallocate and not recycled_segments.empty()) {
+            /* Reuse a reclaimed segment file. Its old blocks are
+               harmless: every block records its own LSN, which recovery
+               checks, and the LSN offsets of a recycled file's blocks
+               all precede those of any segment we could create now.
+             */
+            uint32_t old_segnum = recycled_segments.back();
+            os_renameat(dfd, rcy_file_name(old_segnum), dfd, sname);
+            os_fsync(dfd);
+            recycled_segments.pop_back();
+            flags &= ~O_EXCL;
+        }
+        uint64_t fd = os_openat(dfd, sname, flags);
         nxt_segment_fd = (fd << 32) | segnum;
+        if (sysconf::log_preallocate)
+            _preallocate(segnum);
+    }
+}
+
+void
+sm_log_file_mgr::_preallocate(uint32_t segnum)
+{
+    // only the segment after the active one is ever preallocated
+    _stop_zero_fill();
+
+    nxt_seg_file_name sname(segnum);
+    int fd = os_openat(dfd, sname, O_WRONLY);
+    DEFER_UNLESS(started, os_close(fd));
+
+    /* fallocate alone leaves unwritten extents, and the first write to
+       each one still changes file system metadata; zeroing them in the
+       background gets that out of the way before the log arrives.
+       Recycled files were written in full already, up to their size.
+     */
+    struct stat st;
+    THROW_IF(fstat(fd, &st), os_error, errno, "Unable to stat %s", *sname);
+    uint64_t ssize = volatile_read(segment_size);
+    if (ssize <= uint64_t(st.st_size))
+        return;
+
+    os_fallocate(fd, 0, ssize);
+    _zero_fill_fd = fd;
+    _zero_fill_segnum = _zero_fill_target = segnum;
+    _zero_fill_begin = st.st_size;
+    _zero_fill_end = ssize;
+    int err = pthread_create(&_zero_fill_tid, NULL, &zero_fill_daemon_thunk, this);
+    THROW_IF(err, os_error, err, "Unable to start log zero-fill thread");
+    _zero_fill_running = started = true;
+}
+
+void
+sm_log_file_mgr::_stop_zero_fill()
+{
+    if (not _zero_fill_running)
+        return;
+
+    _zero_fill_mutex.lock();
+    _zero_fill_segnum = 0;
+    _zero_fill_mutex.unlock();
+
+    int err = pthread_join(_zero_fill_tid, NULL);
+    THROW_IF(err, os_error, err, "Unable to join log zero-fill thread");
+    _zero_fill_running = false;
+}
+
+void
+sm_log_file_mgr::_zero_fill_daemon()
+{
+    uint32_t segnum = _zero_fill_target;
+    DEFER(os_close(_zero_fill_fd));
+
+    char *zeros = (char*) calloc(1, ZERO_FILL_CHUNK);
+    DEFER(free(zeros));
+    for (uint64_t i = _zero_fill_begin; i < _zero_fill_end; i += ZERO_FILL_CHUNK) {
+        _zero_fill_mutex.lock();
+        DEFER(_zero_fill_mutex.unlock());
+        if (volatile_read(_zero_fill_segnum) != segnum)
+            return; // the log got here first
+
+        size_t nbytes = std::min(ZERO_FILL_CHUNK, size_t(_zero_fill_end - i));
+        os_pwrite(_zero_fill_fd, zeros, nbytes, i);
     }
+    os_fdatasync(_zero_fill_fd);
 }
 
 void
@@ -562,8 +774,19 @@ sm_log_file_mgr::open_for_write(segment_id *sid)
     DEFER(file_mutex.unlock());
     _create_nxt_seg_file(false);
 
+    if (sid->segnum == volatile_read(_zero_fill_segnum)) {
+        // too late to finish zero-filling; never race the log writer
+        _zero_fill_mutex.lock();
+        _zero_fill_segnum = 0;
+        _zero_fill_mutex.unlock();
+    }
+
+    /* Preallocated segments never grow as the log writes them, so
+       synchronous writes need not flush any metadata along with the
+       data; O_DSYNC says exactly that.
+     */
     segment_file_name sname(sid);
-    return os_openat(dfd, sname, O_WRONLY|O_SYNC);
+    return os_openat(dfd, sname, O_WRONLY|(sysconf::log_preallocate ? O_DSYNC : O_SYNC));
 }
 
 segment_id*
@@ -630,6 +853,28 @@ sm_log_file_mgr::create_segment(segment_id *sid)
     return false;
 }
 
+segment_id *
+sm_log_file_mgr::adopt_segment(uint32_t segnum, uint64_t start, uint64_t end)
+{
+    auto *psid = _newest_segment();
+    THROW_IF(segnum != psid->segnum+1, log_file_error,
+             "Shipped segment %u does not follow segment %u", segnum, psid->segnum);
+    THROW_IF(end - start != volatile_read(segment_size), log_file_error,
+             "Shipped segment %u has size %zd, expected %zd",
+             segnum, end - start, volatile_read(segment_size));
+
+    auto pssize = psid->end_offset - psid->start_offset;
+    auto *sid = _prepare_new_segment(segnum, start, psid->byte_offset+pssize);
+    THROW_IF(not sid or not create_segment(sid), log_file_error,
+             "Unable to create shipped segment %u", segnum);
+
+    // give the file its proper name right away
+    file_mutex.lock();
+    DEFER(file_mutex.unlock());
+    _create_nxt_seg_file(false);
+    return sid;
+}
+
 void
 sm_log_file_mgr::truncate_after(uint32_t segnum, uint64_t new_end)
 {
@@ -655,6 +900,7 @@ sm_log_file_mgr::truncate_after(uint32_t segnum, uint64_t new_end)
     if (uint32_t(nxt_segment_fd) > segnum+1) {
         // fun: replace those curlies with parens => compiler error
         nxt_seg_file_name sname{uint32_t(nxt_segment_fd)};
+        _stop_zero_fill();
         os_unlinkat(dfd, sname);
         nxt_segment_fd = segnum;
         _create_nxt_seg_file(true);
@@ -688,7 +934,14 @@ sm_log_file_mgr::reclaim_before(uint32_t segnum)
                  "Attempt to reclaim most recent checkpoint");
         
         segment_file_name sname(sid);
-        os_unlinkat(dfd, sname);
+        if (sysconf::log_preallocate and
+            recycled_segments.size() < MAX_RECYCLED_SEGMENTS) {
+            os_renameat(dfd, sname, dfd, rcy_file_name(sid->segnum));
+            recycled_segments.push_back(sid->segnum);
+        }
+        else {
+            os_unlinkat(dfd, sname);
+        }
         _pop_oldest();
         goto again;
     }
@@ -5,6 +5,7 @@
 #include "sm-log-defs.h"
 
 #include <deque>
+#include <vector>
 
 /* The file management part of the log.
 
@@ -78,6 +79,7 @@ struct sm_log_file_mgr {
     };
 
     sm_log_file_mgr();
+    ~sm_log_file_mgr();
 
     /* Change the segment size.
 
@@ -154,6 +156,12 @@ struct sm_log_file_mgr {
      */
     segment_id *prepare_new_segment(uint64_t start);
 
+    /* Create segment [segnum], which must follow the newest segment,
+       with the exact bounds a log-shipping primary gave it (see
+       sm-log-ship.h), and return it.
+     */
+    segment_id *adopt_segment(uint32_t segnum, uint64_t start, uint64_t end);
+
     /* Truncate the log at the given segment and offset.
 
        All segments that follow [segnum] are destroyed, and the
@@ -189,6 +197,16 @@ struct sm_log_file_mgr {
     segment_id* _prepare_new_segment(uint32_t segnum, uint64_t start, uint64_t byte_offset);
     void _make_new_log();
 
+    /* Segment preallocation (sysconf::log_preallocate).
+
+       Reserve the blocks of new segment file [segnum] and start a
+       background thread that zero-fills the part that was never
+       written. Called with the file_mutex held.
+     */
+    void _preallocate(uint32_t segnum);
+    void _stop_zero_fill();
+    void _zero_fill_daemon();
+
     // log file directory
     int dfd;
 
@@ -199,6 +217,26 @@ struct sm_log_file_mgr {
     uint32_t oldest_segnum;
 
     uint64_t nxt_segment_fd;
+
+    /* Reclaimed segment files, renamed rather than deleted so a later
+       segment can reuse their already-allocated blocks.
+     */
+    std::vector<uint32_t> recycled_segments;
+
+    /* The zero-fill daemon owns [_zero_fill_fd] and writes zeros to
+       bytes [_zero_fill_begin, _zero_fill_end) of segment
+       [_zero_fill_target]. It must stop before the log writes that
+       segment; open_for_write clears [_zero_fill_segnum] under
+       [_zero_fill_mutex] to make it stop.
+     */
+    pthread_t _zero_fill_tid;
+    bool _zero_fill_running;
+    int _zero_fill_fd;
+    uint32_t _zero_fill_target;
+    uint32_t volatile _zero_fill_segnum;
+    uint64_t _zero_fill_begin;
+    uint64_t _zero_fill_end;
+    os_mutex _zero_fill_mutex;
     
     LSN _durable_lsn;
     
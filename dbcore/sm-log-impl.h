@@ -9,6 +9,19 @@
 
 struct sm_log_impl : sm_log {
 
+    /* sm_log_alloc_mgr has cache-aligned members, which plain new
+       doesn't honor before C++17.
+     */
+    void *operator new(size_t sz) {
+        void *ptr;
+        int err = posix_memalign(&ptr, __alignof__(sm_log_impl), sz);
+        THROW_IF(err, os_error, err, "posix_memalign failed");
+        return ptr;
+    }
+    void operator delete(void *ptr) {
+        ::free(ptr);
+    }
+
     sm_log_impl(sm_log_recover_impl *rf, void *rarg)
         : _lm(rf, rarg)
     {
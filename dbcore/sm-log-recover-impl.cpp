@@ -2,7 +2,10 @@
 #include "../txn_btree.h"
 #include "../util.h"
 #include "sm-file.h"
+#include "sm-log-delta.h"
+#include "sm-log-impl.h"
 #include "sm-log-recover-impl.h"
+#include "sm-log-ship.h"
 #include "sm-oid.h"
 #include "sm-oid-impl.h"
 #include "sm-oid-alloc-impl.h"
@@ -30,6 +33,14 @@ sm_log_recover_impl::recover_prepare_version(sm_log_scan_mgr::record_scan *logre
   new (tuple) dbtuple(sz);
   logrec->load_object((char *)tuple->get_value_start(), sz);
 
+  if (log_delta::is_delta(tuple->get_value_start())) {
+    // [next] is usually the very image the delta was taken against
+    fat_ptr ptr = object::create_tuple_object((log_delta *)tuple->get_value_start(),
+      logrec->payload_ptr(), next, 0, get_impl(logrec)->lm);
+    MM::deallocate(fat_ptr::make(obj, encode_size_aligned(sz)));
+    return ptr;
+  }
+
   // Strip out the varstr stuff
   tuple->size = ((varstr *)tuple->get_value_start())->size();
   memmove(tuple->get_value_start(),
@@ -44,6 +55,16 @@ sm_log_recover_impl::recover_prepare_version(sm_log_scan_mgr::record_scan *logre
   return fat_ptr::make(obj, encode_size_aligned(sz));
 }
 
+// What a delete leaves behind, as a transaction's delete would
+fat_ptr
+sm_log_recover_impl::recover_prepare_tombstone(sm_log_scan_mgr::record_scan *logrec, fat_ptr next) {
+  size_t sz = align_up(sizeof(object) + sizeof(dbtuple));
+  object *obj = new (MM::allocate(sz, 0)) object(NULL_PTR, next, 0);
+  new (obj->tuple()) dbtuple(0);
+  obj->_clsn = logrec->payload_lsn().to_log_ptr();
+  return fat_ptr::make(obj, encode_size_aligned(sz));
+}
+
 void
 sm_log_recover_impl::recover_insert(sm_log_scan_mgr::record_scan *logrec) {
   FID f = logrec->fid();
@@ -79,12 +100,17 @@ sm_log_recover_impl::recover_index_insert(sm_log_scan_mgr::record_scan *logrec,
   }
   logrec->load_object(buf, sz);
 
+  // The key follows the version in a combined record, see log_insert_with_key
+  char *key_buf = buf;
+  if (logrec->type() == sm_log_scan_mgr::LOG_INSERT_WITH_KEY)
+    key_buf += align_up(sizeof(varstr) + ((varstr *)buf)->size());
+
   // Extract the real key length (don't use varstr.data()!)
-  size_t len = ((varstr *)buf)->size();
-  ASSERT(align_up(len + sizeof(varstr)) == sz);
+  size_t len = ((varstr *)key_buf)->size();
+  ASSERT(align_up(len + sizeof(varstr)) + (key_buf - buf) <= sz);
 
   // Construct the varkey (skip the varstr struct then it's data)
-  varkey key((uint8_t *)((char *)buf + sizeof(varstr)), len);
+  varkey key((uint8_t *)(key_buf + sizeof(varstr)), len);
 
   //printf("key %s %s\n", (char *)key.data(), buf);
   ALWAYS_ASSERT(index->btr.underlying_btree.insert_if_absent(key, logrec->oid(), NULL, 0));
@@ -99,6 +125,10 @@ sm_log_recover_impl::recover_update(sm_log_scan_mgr::record_scan *logrec, bool i
   fat_ptr ptr = NULL_PTR;
   if (not is_delete)
     ptr = recover_prepare_version(logrec, head_ptr);
+  else if (log_standby) {
+    // Standby readers may still be looking at the older versions
+    ptr = recover_prepare_tombstone(logrec, head_ptr);
+  }
   oidmgr->oid_put(f, o, ptr);
   ASSERT(oidmgr->oid_get(f, o).offset() == ptr.offset());
   // this has to go if on-demand loading is enabled
@@ -138,7 +168,8 @@ sm_log_recover_impl::rebuild_index(
   RCU::rcu_enter();
   auto *scan = scanner->new_log_scan(start_lsn, true);
   for (; scan->valid() and scan->payload_lsn() < end_lsn; scan->next()) {
-    if (scan->type() != sm_log_scan_mgr::LOG_INSERT_INDEX or scan->fid() != fid)
+    if ((scan->type() != sm_log_scan_mgr::LOG_INSERT_INDEX and
+         scan->type() != sm_log_scan_mgr::LOG_INSERT_WITH_KEY) or scan->fid() != fid)
       continue;
     // Below ASSERT has to go as the object might be already deleted
     //ASSERT(oidmgr->oid_get(fid, scan->oid()).offset());
@@ -149,6 +180,53 @@ sm_log_recover_impl::rebuild_index(
   RCU::rcu_exit();
 }
 
+uint64_t
+sm_log_recover_impl::redo_serial(sm_log_scan_mgr *scanner, LSN from, LSN to) {
+  RCU::rcu_enter();
+  uint64_t count = 0;
+  std::unordered_map<FID, OID> max_oid;
+  auto *scan = scanner->new_log_scan(from, sysconf::eager_warm_up());
+  for (; scan->valid() and scan->payload_lsn() < to; scan->next()) {
+    auto fid = scan->fid();
+    switch (scan->type()) {
+    case sm_log_scan_mgr::LOG_UPDATE:
+    case sm_log_scan_mgr::LOG_UPDATE_DELTA:
+    case sm_log_scan_mgr::LOG_RELOCATE:
+      recover_update(scan);
+      break;
+    case sm_log_scan_mgr::LOG_DELETE:
+      recover_update(scan, true);
+      break;
+    case sm_log_scan_mgr::LOG_INSERT_INDEX:
+      recover_index_insert(scan);
+      break;
+    case sm_log_scan_mgr::LOG_INSERT:
+      recover_insert(scan);
+      break;
+    case sm_log_scan_mgr::LOG_INSERT_WITH_KEY:
+      recover_insert(scan);
+      recover_index_insert(scan);
+      break;
+    case sm_log_scan_mgr::LOG_CHKPT:
+      continue;
+    case sm_log_scan_mgr::LOG_FID:
+      ALWAYS_ASSERT(oidmgr->file_exists(fid));
+      continue;
+    default:
+      DIE("unreachable");
+    }
+    max_oid[fid] = std::max(max_oid[fid], scan->oid());
+    count++;
+  }
+  delete scan;
+
+  for (auto &m : max_oid) {
+    oidmgr->recreate_allocator(m.first, m.second);
+  }
+  RCU::rcu_exit();
+  return count;
+}
+
 /* The main recovery function of parallel_file_replay.
  *
  * Without checkpointing, recovery starts with an empty, new oidmgr, and then
@@ -292,6 +370,7 @@ parallel_file_replay::redo_runner::redo_file() {
 
     switch (scan->type()) {
     case sm_log_scan_mgr::LOG_UPDATE:
+    case sm_log_scan_mgr::LOG_UPDATE_DELTA:
     case sm_log_scan_mgr::LOG_RELOCATE:
       ucount++;
       owner->recover_update(scan);
@@ -312,6 +391,15 @@ parallel_file_replay::redo_runner::redo_file() {
       owner->recover_insert(scan);
       size += scan->payload_size();
       break;
+    case sm_log_scan_mgr::LOG_INSERT_WITH_KEY:
+      icount++;
+      iicount++;
+      owner->recover_insert(scan);
+#if SEPARATE_INDEX_REBUILD == 0
+      owner->recover_index_insert(scan);
+#endif
+      size += scan->payload_size();
+      break;
     case sm_log_scan_mgr::LOG_CHKPT:
       break;
     case sm_log_scan_mgr::LOG_FID:
@@ -428,6 +516,7 @@ parallel_oid_replay::redo_runner::redo_partition() {
 
     switch (scan->type()) {
     case sm_log_scan_mgr::LOG_UPDATE:
+    case sm_log_scan_mgr::LOG_UPDATE_DELTA:
     case sm_log_scan_mgr::LOG_RELOCATE:
       ucount++;
       owner->recover_update(scan);
@@ -448,6 +537,15 @@ parallel_oid_replay::redo_runner::redo_partition() {
       owner->recover_insert(scan);
       size += scan->payload_size();
       break;
+    case sm_log_scan_mgr::LOG_INSERT_WITH_KEY:
+      icount++;
+      iicount++;
+      owner->recover_insert(scan);
+#if SEPARATE_INDEX_REBUILD == 0
+      owner->recover_index_insert(scan);
+#endif
+      size += scan->payload_size();
+      break;
     case sm_log_scan_mgr::LOG_CHKPT:
       break;
     case sm_log_scan_mgr::LOG_FID:
@@ -16,11 +16,21 @@ struct sm_log_recover_impl {
   fat_ptr recover_prepare_version(
                               sm_log_scan_mgr::record_scan *logrec,
                               fat_ptr next);
+  fat_ptr recover_prepare_tombstone(
+                              sm_log_scan_mgr::record_scan *logrec,
+                              fat_ptr next);
   ndb_ordered_index *recover_fid(sm_log_scan_mgr::record_scan *logrec);
   void recover_index_insert(
       sm_log_scan_mgr::record_scan *logrec, ndb_ordered_index *index);
   void rebuild_index(sm_log_scan_mgr *scanner, FID fid, ndb_ordered_index *index, LSN from, LSN to);
 
+  // Replay [from, to) in log order on the calling thread and return the
+  // number of records applied. Standbys use this between batches (see
+  // sm-log-ship.h): it needs no redo threads, which their read-only
+  // workers occupy, but it can't create tables, so the first batch must
+  // go through operator().
+  uint64_t redo_serial(sm_log_scan_mgr *scanner, LSN from, LSN to);
+
   // The main recovery function; the inheriting class should implement this
   // The implementation shall replay the log from position [from] until [to],
   // no more and no less; this is important for async log replay on backups.
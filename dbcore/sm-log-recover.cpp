@@ -293,11 +293,17 @@ get_type(log_record_type tp)
         return sm_log_scan_mgr::LOG_INSERT;
     case LOG_INSERT_INDEX:
         return sm_log_scan_mgr::LOG_INSERT_INDEX;
+    case LOG_INSERT_WITH_KEY:
+        return sm_log_scan_mgr::LOG_INSERT_WITH_KEY;
         
     case LOG_UPDATE:
     case LOG_UPDATE_EXT:
         return sm_log_scan_mgr::LOG_UPDATE;
 
+    case LOG_UPDATE_DELTA:
+    case LOG_UPDATE_DELTA_EXT:
+        return sm_log_scan_mgr::LOG_UPDATE_DELTA;
+
     case LOG_DELETE:
         return sm_log_scan_mgr::LOG_DELETE;
 
@@ -394,6 +400,12 @@ sm_log_scan_mgr::record_scan::payload_lsn()
     return impl->scan.payload_lsn();
 }
 
+LSN
+sm_log_scan_mgr::record_scan::tx_lsn()
+{
+    return get_impl(this)->scan.tx_lsn();
+}
+
 static
 std::pair<fat_ptr, bool>
 get_payload_ptr(sm_log_recover_mgr *lm, sm_log_recover_mgr::log_scanner &s, bool follow_ext)
@@ -71,6 +71,14 @@ struct sm_log_recover_mgr : sm_log_offset_mgr {
 
         bool valid() { return _cur_block and _cur_block->lsn != INVALID_LSN; }
 
+        /* The LSN of the commit block that owns the current block: the
+           current block itself, unless we're still working through its
+           overflow chain.
+         */
+        LSN tx_lsn() {
+            return _overflow_chain.empty() ? _cur_block->lsn : _overflow_chain.front();
+        }
+
         log_block *get() { return valid()? _cur_block : NULL; }
         operator log_block*() { return get(); }
         log_block *operator->() { return get(); }
@@ -128,6 +136,8 @@ struct sm_log_recover_mgr : sm_log_offset_mgr {
 
         LSN payload_lsn() { return _bscan->payload_lsn(_i); }
 
+        LSN tx_lsn() { return _bscan.tx_lsn(); }
+
         size_t payload_size() {
             return _bscan->payload_size(_i);
         }
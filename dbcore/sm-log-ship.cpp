@@ -0,0 +1,421 @@
+#include "sm-log-ship.h"
+
+#include "sm-config.h"
+#include "sm-log-checksum.h"
+#include "sm-log-impl.h"
+#include "sm-log-recover-impl.h"
+#include "stopwatch.h"
+
+#include <unistd.h>
+#include <vector>
+
+using namespace RCU;
+
+sm_log_shipper *log_shipper = NULL;
+sm_log_standby *log_standby = NULL;
+
+namespace {
+
+    static uint64_t const LOG_SHIP_MAGIC = 0x3170696873676f6c; // "logship1"
+
+    // largest chunk of log we send at once
+    static size_t const SHIP_CHUNK_SIZE = 1024*1024;
+
+    // tell an idle standby we're still here (and how far along we are)
+    static uint64_t const SHIP_HEARTBEAT_NS = uint64_t(100)*1000*1000;
+
+    // the primary may still be starting up when the standby does
+    static int const CONNECT_RETRIES = 60;
+
+    /* Primary -> standby, on connect */
+    struct ship_hello {
+        uint64_t magic;
+        uint32_t segment_mb;
+        uint32_t checksum;
+        uint32_t durable_segnum;
+        uint64_t durable_offset;
+    };
+
+    /* Standby -> primary, in response: where the standby's log ends */
+    struct ship_start {
+        uint64_t magic;
+        uint32_t segnum;
+        uint64_t offset;
+    };
+
+    /* Primary -> standby, followed by [nbytes] of log. Chunks arrive
+       in log order and hold whole log blocks, except for the one that
+       ends a segment; the first chunk of a segment may be empty.
+     */
+    struct ship_chunk {
+        uint32_t segnum;
+        uint32_t nbytes;
+        uint64_t seg_start;
+        uint64_t seg_end;
+        uint64_t lsn_offset;
+        uint64_t primary_dlsn_offset;
+        uint64_t sent_ns;
+    };
+
+    /* Return how many of the [nbytes] of [sid]'s log in [buf], which
+       starts with a block, hold whole blocks. The last block of a
+       segment extends to the segment's end.
+     */
+    size_t
+    whole_blocks(segment_id *sid, char const *buf, uint64_t offset, size_t nbytes)
+    {
+        size_t n = 0;
+        while (n + MIN_LOG_BLOCK_SIZE <= nbytes) {
+            auto *b = (log_block*) (buf + n);
+            if (n + log_block::size(b->nrec, 0) > nbytes)
+                break;
+            LSN next = b->next_lsn();
+            uint64_t end = (next.segment() == sid->segnum % NUM_LOG_SEGMENTS)
+                ? next.offset() : sid->end_offset;
+            ASSERT(offset + n < end);
+            if (end - offset > nbytes)
+                break;
+            n = end - offset;
+        }
+        return n;
+    }
+
+    sm_log_recover_mgr &
+    get_log_file_mgr()
+    {
+        return get_impl(logmgr)->_lm._lm;
+    }
+
+    // segment [segnum] if we still (or already) have it
+    segment_id *
+    find_segment(uint32_t segnum)
+    {
+        auto &lm = get_log_file_mgr();
+        if (segnum > lm._newest_segment()->segnum)
+            return NULL;
+        auto *sid = lm.get_segment(segnum % NUM_LOG_SEGMENTS);
+        return (sid and sid->segnum == segnum) ? sid : NULL;
+    }
+
+    extern "C"
+    void*
+    ship_daemon_thunk(void *arg)
+    {
+        ((sm_log_shipper*) arg)->_ship_daemon();
+        return NULL;
+    }
+
+    extern "C"
+    void*
+    receive_daemon_thunk(void *arg)
+    {
+        ((sm_log_standby*) arg)->_receive_daemon();
+        return NULL;
+    }
+
+    extern "C"
+    void*
+    replay_daemon_thunk(void *arg)
+    {
+        ((sm_log_standby*) arg)->_replay_daemon();
+        return NULL;
+    }
+
+} // end anonymous namespace
+
+sm_log_shipper::sm_log_shipper(std::string const &addr)
+    : _connected(false)
+    , _shipped_offset(0)
+    , _nstandbys(0)
+    , _nchunks(0)
+    , _nbytes(0)
+{
+    THROW_IF(sysconf::null_log_device, illegal_argument,
+             "Can't ship a log that isn't written to disk");
+    _listen_fd = os_socket(addr, true);
+    printf("[LogShip] shipping the log to standbys at %s\n", addr.c_str());
+
+    int err = pthread_create(&_tid, NULL, &ship_daemon_thunk, this);
+    THROW_IF(err, os_error, err, "Unable to start log shipping thread");
+}
+
+bool
+sm_log_shipper::drain(uint64_t timeout_ms)
+{
+    uint64_t deadline = stopwatch_t::now() + timeout_ms*1000*1000;
+    while (volatile_read(_connected)) {
+        if (volatile_read(_shipped_offset) == logmgr->durable_flushed_lsn().offset())
+            return true;
+        if (deadline < stopwatch_t::now())
+            return false;
+        usleep(1000);
+    }
+    return true;
+}
+
+void
+sm_log_shipper::print_stats(FILE *out)
+{
+    fprintf(out, "log shipping: %lu standbys, %lu chunks, %lu bytes shipped\n",
+            _nstandbys, _nchunks, _nbytes);
+}
+
+void
+sm_log_shipper::_ship_daemon()
+{
+    rcu_register();
+    for (;;) {
+        int fd = accept(_listen_fd, NULL, NULL);
+        if (fd < 0 and errno == EINTR)
+            continue;
+        THROW_IF(fd < 0, os_error, errno, "Unable to accept standby connection");
+
+        _nstandbys++;
+        _serve(fd);
+        volatile_write(_connected, false);
+        close(fd);
+        printf("[LogShip] standby disconnected\n");
+    }
+}
+
+void
+sm_log_shipper::_serve(int fd)
+{
+    LSN dlsn = logmgr->durable_flushed_lsn();
+    auto *dsid = get_log_file_mgr().get_segment(dlsn.segment());
+    ship_hello hello = {LOG_SHIP_MAGIC, uint32_t(sysconf::log_segment_mb),
+                        uint32_t(log_csum->kind), dsid->segnum, dlsn.offset()};
+    ship_start start;
+    if (not os_send_all(fd, &hello, sizeof(hello)) or not os_recv_all(fd, &start, sizeof(start)))
+        return;
+
+    /* The standby must not be ahead of us (it would have to be some
+       other primary's standby), and we must still have its segment.
+     */
+    auto *sid = find_segment(start.segnum);
+    dsid = get_log_file_mgr().get_segment(logmgr->durable_flushed_lsn().segment());
+    if (start.magic != LOG_SHIP_MAGIC or not sid
+        or start.offset < sid->start_offset or sid->end_offset < start.offset
+        or dsid->segnum < sid->segnum
+        or (dsid == sid and logmgr->durable_flushed_lsn().offset() < start.offset)) {
+        printf("[LogShip] standby asked for LSN %08x-%012zx, which we don't have\n",
+               start.segnum, start.offset);
+        return;
+    }
+    printf("[LogShip] standby connected, shipping from LSN %08x-%012zx\n",
+           start.segnum, start.offset);
+
+    std::vector<char> buf(SHIP_CHUNK_SIZE);
+    uint64_t shipped = start.offset;
+    uint64_t last_sent = 0;
+    bool new_segment = false;
+    volatile_write(_connected, true);
+    for (;;) {
+        volatile_write(_shipped_offset, shipped);
+        dlsn = logmgr->durable_flushed_lsn();
+        dsid = get_log_file_mgr().get_segment(dlsn.segment());
+
+        /* Once the log is durable in a later segment, all of this one
+           is durable, up to its very end (see flush_log_buffer).
+         */
+        uint64_t end = (dsid == sid) ? dlsn.offset() : sid->end_offset;
+        if (shipped == end and dsid != sid) {
+            sid = find_segment(sid->segnum+1);
+            ASSERT(sid);
+            shipped = sid->start_offset;
+            new_segment = true;
+            continue;
+        }
+
+        uint64_t now = stopwatch_t::now();
+        if (shipped == end and not new_segment and now - last_sent < SHIP_HEARTBEAT_NS) {
+            usleep(100);
+            continue;
+        }
+
+        /* The standby can only replay whole blocks, so never leave it
+           with part of one. Log blocks are much smaller than a chunk.
+         */
+        size_t nbytes = std::min(end - shipped, SHIP_CHUNK_SIZE);
+        if (nbytes) {
+            size_t n = os_pread(sid->fd, buf.data(), nbytes, shipped - sid->start_offset);
+            THROW_IF(n < nbytes, log_file_error, "Incomplete read of durable log");
+            nbytes = whole_blocks(sid, buf.data(), shipped, nbytes);
+            THROW_IF(not nbytes, log_file_error,
+                     "Log block at %012zx is too large to ship", shipped);
+        }
+
+        ship_chunk c = {sid->segnum, uint32_t(nbytes), sid->start_offset, sid->end_offset,
+                        shipped, dlsn.offset(), now};
+        if (not os_send_all(fd, &c, sizeof(c)) or not os_send_all(fd, buf.data(), nbytes))
+            return;
+
+        shipped += nbytes;
+        last_sent = now;
+        new_segment = false;
+        _nchunks++;
+        _nbytes += nbytes;
+    }
+}
+
+sm_log_standby::sm_log_standby(std::string const &addr)
+    : _receiving(false)
+    , _promoted(false)
+    , _replayed_lsn(INVALID_LSN)
+    , _nbatches(0)
+    , _nrecords(0)
+    , _nlag_samples(0)
+    , _lag_total_ns(0)
+    , _lag_max_ns(0)
+{
+    for (int i = 0; (_fd = os_socket(addr, false)) < 0; i++) {
+        THROW_IF(i == CONNECT_RETRIES, os_error, errno,
+                 "Unable to connect to the primary at %s", addr.c_str());
+        sleep(1);
+    }
+
+    ship_hello hello;
+    THROW_IF(not os_recv_all(_fd, &hello, sizeof(hello)) or hello.magic != LOG_SHIP_MAGIC,
+             log_file_error, "Bad log shipping handshake from %s", addr.c_str());
+
+    // our log has to be laid out exactly like the primary's
+    sysconf::log_segment_mb = hello.segment_mb;
+    sysconf::log_checksum = hello.checksum;
+    _primary_start_offset = _primary_dlsn_offset = _received_offset = hello.durable_offset;
+    printf("[Standby] connected to %s, primary is durable up to LSN %08x-%012zx\n",
+           addr.c_str(), hello.durable_segnum, hello.durable_offset);
+}
+
+void
+sm_log_standby::start()
+{
+    // an existing standby log keeps its own checksum
+    THROW_IF(log_csum->kind != sysconf::log_checksum, log_file_error,
+             "Standby log uses checksum %s, the primary uses another one", log_csum->name);
+    THROW_IF(get_impl(logmgr)->_lm._logbuf.window_size() < 4*SHIP_CHUNK_SIZE, illegal_argument,
+             "A standby needs a log buffer of at least %zd MB", 4*SHIP_CHUNK_SIZE >> 20);
+
+    LSN dlsn = logmgr->durable_flushed_lsn();
+    auto *sid = get_log_file_mgr().get_segment(dlsn.segment());
+    ship_start start = {LOG_SHIP_MAGIC, sid->segnum, dlsn.offset()};
+    THROW_IF(not os_send_all(_fd, &start, sizeof(start)), os_error, errno,
+             "Lost the connection to the primary");
+
+    volatile_write(_replayed_lsn._val, dlsn._val);
+    volatile_write(_receiving, true);
+    int err = pthread_create(&_receive_tid, NULL, &receive_daemon_thunk, this);
+    THROW_IF(err, os_error, err, "Unable to start log receiver thread");
+    err = pthread_create(&_replay_tid, NULL, &replay_daemon_thunk, this);
+    THROW_IF(err, os_error, err, "Unable to start log replay thread");
+
+    _lag_mutex.lock();
+    DEFER(_lag_mutex.unlock());
+    while (not _nbatches and not promoted())
+        _replay_cond.wait(_lag_mutex);
+}
+
+void
+sm_log_standby::print_stats(FILE *out)
+{
+    LSN rlsn = replayed_lsn();
+    uint64_t pdlsn = volatile_read(_primary_dlsn_offset);
+    fprintf(out, "standby: %s at LSN %012zx, %lu batches, %lu records replayed, %lu bytes behind the primary\n",
+            promoted() ? "promoted" : "replaying", rlsn.offset(), _nbatches, _nrecords,
+            pdlsn > rlsn.offset() ? pdlsn - rlsn.offset() : 0);
+    if (_nlag_samples) {
+        fprintf(out, "replay lag: avg %.1f ms, max %.1f ms\n",
+                _lag_total_ns / 1e6 / _nlag_samples, _lag_max_ns / 1e6);
+    }
+}
+
+void
+sm_log_standby::_receive_daemon()
+{
+    rcu_register();
+    auto &lm = get_log_file_mgr();
+    auto &alloc = get_impl(logmgr)->_lm;
+
+    std::vector<char> buf;
+    ship_chunk c;
+    while (os_recv_all(_fd, &c, sizeof(c))) {
+        buf.resize(c.nbytes);
+        if (not os_recv_all(_fd, buf.data(), c.nbytes))
+            break;
+
+        rcu_enter();
+        segment_id *sid = find_segment(c.segnum);
+        if (not sid)
+            sid = lm.adopt_segment(c.segnum, c.seg_start, c.seg_end);
+        rcu_exit();
+        THROW_IF(sid->start_offset != c.seg_start or sid->end_offset != c.seg_end,
+                 log_file_error, "Shipped segment %u does not match ours", c.segnum);
+
+        uint64_t end = c.lsn_offset + c.nbytes;
+        alloc.append_shipped(sid, c.lsn_offset, buf.data(), c.nbytes, end < c.seg_end);
+
+        volatile_write(_primary_dlsn_offset, c.primary_dlsn_offset);
+        if (c.nbytes) {
+            volatile_write(_received_offset, end);
+            _lag_mutex.lock();
+            _pending.emplace_back(end, c.sent_ns);
+            _lag_mutex.unlock();
+        }
+    }
+
+    // the primary is gone; make what we got durable and let replay finish
+    printf("[Standby] lost the primary after LSN %012zx\n", volatile_read(_received_offset));
+    close(_fd);
+    logmgr->flush();
+    volatile_write(_receiving, false);
+}
+
+void
+sm_log_standby::_replay_daemon()
+{
+    rcu_register();
+    auto *scanner = logmgr->get_scan_mgr();
+    for (;;) {
+        bool receiving = volatile_read(_receiving);
+        LSN from = replayed_lsn();
+        LSN to = logmgr->durable_flushed_lsn();
+        if (_nbatches ? to == from : (receiving and to.offset() < _primary_start_offset)) {
+            if (not receiving)
+                break;
+            usleep(100);
+            continue;
+        }
+
+        uint64_t nrecords = 0;
+        if (_nbatches)
+            nrecords = sysconf::recover_functor->redo_serial(scanner, from, to);
+        else
+            (*sysconf::recover_functor)(NULL, scanner, from, to);
+
+        uint64_t now = stopwatch_t::now();
+        _lag_mutex.lock();
+        DEFER(_lag_mutex.unlock());
+        uint64_t sent_ns = 0;
+        while (not _pending.empty() and _pending.front().first <= to.offset()) {
+            sent_ns = _pending.front().second;
+            _pending.pop_front();
+        }
+        if (sent_ns and sent_ns < now) {
+            _lag_total_ns += now - sent_ns;
+            _lag_max_ns = std::max(_lag_max_ns, now - sent_ns);
+            _nlag_samples++;
+        }
+        _nbatches++;
+        _nrecords += nrecords;
+        volatile_write(_replayed_lsn._val, to._val);
+        _replay_cond.broadcast();
+    }
+
+    /* Everything we received is now replayed, and our log continues
+       right where the primary's shipped log ended. Time to take over.
+     */
+    _lag_mutex.lock();
+    DEFER(_lag_mutex.unlock());
+    volatile_write(_promoted, true);
+    _replay_cond.broadcast();
+    printf("[Standby] promoted to primary at LSN %012zx\n", replayed_lsn().offset());
+}
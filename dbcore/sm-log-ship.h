@@ -0,0 +1,136 @@
+// -*- mode:c++ -*-
+#ifndef __SM_LOG_SHIP_H
+#define __SM_LOG_SHIP_H
+
+#include "sm-common.h"
+
+#include <deque>
+#include <string>
+#include <utility>
+
+/* Log shipping to a hot standby.
+
+   The primary runs a shipper thread that accepts one standby at a
+   time on sysconf::log_ship_listen, and streams it every byte of
+   durable log from the point the standby asks for, read back from the
+   segment files. The standby keeps a byte-identical copy of the log in
+   its own log directory: shipped bytes go through its log buffer and
+   write daemon as if it had generated them, so its durable mark,
+   segment files and recovery behave exactly as on the primary. A
+   standby that restarts recovers its copy and asks for the rest.
+
+   The standby starts from an empty log directory, or from the log of
+   an earlier run of the same standby. Either way the primary must
+   still have every segment from the standby's durable LSN on, and the
+   two must agree on segment size and checksum, which the primary
+   dictates when the standby connects.
+
+   A replay thread on the standby applies the log in batches, each one
+   ending at the standby's durable LSN. The first batch goes through
+   the recovery functor, which sets up the tables; later ones replay
+   serially (sm_log_recover_impl::redo_serial) so they don't compete
+   with the workers for threads. Transactions on a standby must be
+   read-only. They see a snapshot as of the end of the last batch,
+   replayed_lsn(), and writes abort with RC_ABORT_USER.
+
+   When the primary goes away, the standby finishes replaying what it
+   received and promotes itself: from then on transactions read the
+   latest data and write to the log as on any primary, continuing
+   right after the last shipped LSN. Nothing is shipped synchronously,
+   so whatever the primary made durable but didn't get to ship is lost
+   on failover.
+
+   NOTE: replayed versions are never garbage collected, and only SI is
+   supported (SSN and SSI would need reader tracking on replay).
+ */
+
+class sm_log_shipper {
+public:
+    /* Listen on [addr] and start shipping to whoever connects */
+    sm_log_shipper(std::string const &addr);
+
+    /* Wait until a connected standby has received all durable log,
+       or [timeout_ms] passed. Return false on timeout.
+     */
+    bool drain(uint64_t timeout_ms);
+
+    void print_stats(FILE *out);
+
+    void _ship_daemon();
+
+private:
+    void _serve(int fd);
+
+    int _listen_fd;
+    pthread_t _tid;
+
+    bool volatile _connected;
+    uint64_t volatile _shipped_offset;
+
+    uint64_t _nstandbys;
+    uint64_t _nchunks;
+    uint64_t _nbytes;
+};
+
+class sm_log_standby {
+public:
+    /* Connect to the primary at [addr] and adopt its log format. Call
+       before creating the log manager.
+     */
+    sm_log_standby(std::string const &addr);
+
+    /* Tell the primary where our log ends and start receiving and
+       replaying. Call once the log manager exists; return when the
+       first batch, which covers at least everything the primary had
+       made durable when we connected, has been replayed.
+     */
+    void start();
+
+    /* End of the last replayed batch */
+    LSN replayed_lsn() { return volatile_read(_replayed_lsn); }
+
+    bool promoted() { return volatile_read(_promoted); }
+
+    void print_stats(FILE *out);
+
+    void _receive_daemon();
+    void _replay_daemon();
+
+private:
+    int _fd;
+    pthread_t _receive_tid;
+    pthread_t _replay_tid;
+
+    // primary's durable end when we connected
+    uint64_t _primary_start_offset;
+
+    bool volatile _receiving;
+    bool volatile _promoted;
+    LSN volatile _replayed_lsn;
+    uint64_t volatile _primary_dlsn_offset;
+    uint64_t volatile _received_offset;
+
+    // (end offset, send time) of received chunks not yet replayed
+    os_mutex _lag_mutex;
+    os_condvar _replay_cond;
+    std::deque<std::pair<uint64_t, uint64_t> > _pending;
+
+    uint64_t _nbatches;
+    uint64_t _nrecords;
+    uint64_t _nlag_samples;
+    uint64_t _lag_total_ns;
+    uint64_t _lag_max_ns;
+};
+
+/* Set by bench_runner when shipping or running as a standby */
+extern sm_log_shipper *log_shipper;
+extern sm_log_standby *log_standby;
+
+/* True on a standby until it is promoted */
+static inline bool
+sm_log_is_standby()
+{
+    return log_standby and not log_standby->promoted();
+}
+
+#endif
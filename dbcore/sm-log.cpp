@@ -3,10 +3,80 @@
 #include "sm-oid.h"
 #include "sm-oid-impl.h"
 #include "sm-thread.h"
+#include <atomic>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
 
 using namespace RCU;
 
+namespace {
+    // segments and the markers recovery needs; the next segment file
+    // and recycled ones get recreated as needed
+    bool
+    is_snapshot_file(char const *fname)
+    {
+        static char const *prefixes[] = {"log-", "chk-", "dur-", "fmt-", "oac-", "oai-"};
+        for (auto *p : prefixes) {
+            if (not strncmp(fname, p, 4))
+                return true;
+        }
+        return false;
+    }
+
+    static size_t const SNAPSHOT_COPY_SIZE = 16*1024*1024;
+    static size_t const SNAPSHOT_COPY_THREADS = 8;
+
+    /* Copy the log in directory [from] to [to], a few files at a
+       time, in large sequential chunks.
+     */
+    void
+    copy_log_files(char const *from, char const *to)
+    {
+        dirent_iterator src(from);
+        dirent_iterator dst(to);
+        int sfd = src.dup();
+        int dfd = dst.dup();
+        DEFER(os_close(sfd));
+        DEFER(os_close(dfd));
+
+        std::vector<std::string> names;
+        for (char const *fname : src) {
+            if (is_snapshot_file(fname))
+                names.push_back(fname);
+        }
+        THROW_IF(names.empty(), log_file_error, "No log found in %s", from);
+
+        std::atomic<size_t> next(0);
+        auto copy = [&]() {
+            std::vector<char> buf(SNAPSHOT_COPY_SIZE);
+            for (size_t i; (i = next++) < names.size(); ) {
+                int in = os_openat(sfd, names[i].c_str(), O_RDONLY);
+                DEFER(os_close(in));
+                int out = os_openat(dfd, names[i].c_str(), O_CREAT|O_EXCL|O_WRONLY);
+                DEFER(os_close(out));
+                off_t offset = 0;
+                while (size_t n = os_pread(in, buf.data(), buf.size(), offset)) {
+                    THROW_IF(os_pwrite(out, buf.data(), n, offset) != n, log_file_error,
+                             "Short write copying %s", names[i].c_str());
+                    offset += n;
+                }
+                os_fsync(out);
+            }
+        };
+
+        std::vector<std::thread> copiers;
+        for (size_t i = 0; i < std::min(names.size(), SNAPSHOT_COPY_THREADS); i++)
+            copiers.emplace_back(copy);
+        for (auto &t : copiers)
+            t.join();
+        os_fsync(dfd);
+        printf("[Snapshot] copied %zd files from %s to %s\n", names.size(), from, to);
+    }
+}
+
 sm_log *logmgr = NULL;
 bool sm_log::need_recovery = false;
 
@@ -29,6 +99,12 @@ sm_log::get_tls_lsn_offset()
     return get_impl(this)->_lm.get_tls_lsn_offset();
 }
 
+void
+sm_log::print_write_latency(FILE *out)
+{
+    get_impl(this)->_lm._write_latency.print(out, "log writes", "us");
+}
+
 LSN
 sm_log::flush()
 {
@@ -54,6 +130,29 @@ sm_log::load_ext_pointer(fat_ptr ptr)
 }
 
 
+void
+sm_log::save_snapshot(std::string const &dir)
+{
+    THROW_IF(sysconf::null_log_device, illegal_argument,
+             "Nothing to snapshot without a log device");
+    THROW_IF(mkdir(dir.c_str(), 0755), os_error, errno,
+             "Unable to create snapshot directory %s", dir.c_str());
+    flush();
+    copy_log_files(sysconf::log_dir.c_str(), dir.c_str());
+}
+
+void
+sm_log::restore_snapshot(std::string const &dir)
+{
+    dirent_iterator iter(sysconf::log_dir.c_str());
+    for (char const *fname : iter) {
+        THROW_IF(strcmp(fname, ".") and strcmp(fname, ".."), illegal_argument,
+                 "Log directory %s must be empty to restore a snapshot",
+                 sysconf::log_dir.c_str());
+    }
+    copy_log_files(dir.c_str(), sysconf::log_dir.c_str());
+}
+
 sm_log *
 sm_log::new_log(sm_log_recover_impl *recover_functor, void *rarg)
 {
@@ -126,11 +225,7 @@ retry:
 LSN
 sm_log::durable_flushed_lsn()
 {
-    auto *log = &get_impl(this)->_lm;
-    auto offset = log->dur_flushed_lsn_offset();
-    auto *sid = log->_lm.get_offset_segment(offset);
-    ASSERT(sid);
-    return sid->make_lsn(offset);
+    return get_impl(this)->_lm.dur_flushed_lsn();
 }
 
 void
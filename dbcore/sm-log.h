@@ -53,12 +53,29 @@ struct sm_tx_log {
     /* Record an insert to the index. p stores a pointer to the key value
      */
     void log_insert_index(FID f, OID o, fat_ptr p, int abits, fat_ptr *pdest);
+
+    /* Record an insertion and its index entry in one log record. [p]
+       and [k] point to the version's and the key's varstr,
+       respectively; the key lands right after the version's varstr
+       in the log. [pdest] receives the record's location, which is
+       also where the version can be loaded from.
+     */
+    void log_insert_with_key(FID f, OID o, fat_ptr p, fat_ptr k, int abits, fat_ptr *pdest);
     
     /* Record an update. Like an insertion, except that the OID is
        assumed to already have been allocated.
      */
     void log_update(FID f, OID o, fat_ptr p, int abits, fat_ptr *pdest);
 
+    /* Record an update as a delta against the previous version. [p]
+       points to a log_delta (see sm-log-delta.h) that names the log
+       location of the image it applies to; otherwise the same as
+       log_update. [pdest] receives the location of the delta itself,
+       so later readers must go through log_delta to rebuild the
+       version from the log.
+     */
+    void log_update_delta(FID f, OID o, fat_ptr p, int abits, fat_ptr *pdest);
+
     /* Record a change in a record's on-disk location, to the address
        indicated. The OID remains the same and the data for the new
        location is already durable. Unlike an insertion or update, the
@@ -116,6 +133,22 @@ struct sm_tx_log {
      */
     LSN commit(LSN *pdest);
 
+    /* A position in this transaction's log records, to drop the ones
+       added after it with rollback_to().
+     */
+    struct savepoint {
+        size_t nreq;
+        size_t payload_bytes;
+        LSN prev_overflow;
+    };
+    savepoint get_savepoint();
+
+    /* Drop the log records added since [sp]. Returns false, dropping
+       nothing, if some records older than [sp] have been spilled to an
+       overflow block since: they can't be split from the newer ones.
+     */
+    bool rollback_to(savepoint const &sp);
+
     /* Transaction failed (perhaps even before pre-commit). Discard
        all log state and do not write anything to disk. 
 
@@ -138,7 +171,8 @@ struct sm_log_scan_mgr {
     static size_t const NO_PAYLOAD = -1;
     
     enum record_type { LOG_INSERT, LOG_INSERT_INDEX, LOG_UPDATE,
-                       LOG_RELOCATE, LOG_DELETE, LOG_CHKPT, LOG_FID };
+                       LOG_RELOCATE, LOG_DELETE, LOG_CHKPT, LOG_FID,
+                       LOG_UPDATE_DELTA, LOG_INSERT_WITH_KEY };
 
     /* A cursor for iterating over log records, whether those of a single
        transaction or all which follow some arbitrary starting point.
@@ -177,6 +211,14 @@ struct sm_log_scan_mgr {
 
         LSN payload_lsn();
 
+        /* Return the LSN of the commit block of the transaction the
+           current record belongs to, even if the record itself
+           overflowed into an earlier block. Records of a transaction
+           are always visited together, and transactions in commit
+           order.
+         */
+        LSN tx_lsn();
+
         /* Copy the current record's payload into [buf]. Throw
            illegal_argument if the record has no payload, or the payload
            is larger than [bufsz], or the record does not reside in the
@@ -375,6 +417,21 @@ struct sm_log {
     void redo_log(LSN start_lsn, LSN end_lsn);
     void enqueue_committed_xct(uint32_t worker_id, uint64_t start_time);
 
+    /* Print the latency histogram of synchronous log writes */
+    void print_write_latency(FILE *out);
+
+    /* Copy the durable log into directory [dir], which must not
+       exist yet, as a snapshot of the database that a later run can
+       start from instead of loading it again.
+     */
+    void save_snapshot(std::string const &dir);
+
+    /* Fill the (empty) log directory with the snapshot in [dir]. Call
+       before new_log(), which then finds and recovers it like any
+       other log, tables and indexes included.
+     */
+    static void restore_snapshot(std::string const &dir);
+
     virtual ~sm_log() { }
 
 protected:
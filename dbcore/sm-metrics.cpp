@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "sm-alloc.h"
+#include "sm-common.h"
+#include "sm-config.h"
+#include "sm-file.h"
+#include "sm-log.h"
+#include "sm-metrics.h"
+#include "sm-oid.h"
+#include "sm-oid-alloc-impl.h"
+
+namespace metrics {
+
+namespace {
+
+struct metric {
+    std::string help;
+    char const *type;
+    std::function<void(samples &)> values;
+};
+
+// function-local so modules can register from static constructors
+std::mutex &registry_lock() {
+    static std::mutex m;
+    return m;
+}
+
+std::map<std::string, metric> &registry() {
+    static std::map<std::string, metric> r;
+    return r;
+}
+
+uint64_t log_offset(bool durable) {
+    if (not volatile_read(logmgr))
+        return 0;
+    return durable ? logmgr->durable_flushed_lsn().offset() : logmgr->cur_lsn().offset();
+}
+
+// how far [lsn_offset] trails the current end of the log
+double lag(uint64_t lsn_offset) {
+    uint64_t cur = log_offset(false);
+    return cur > lsn_offset ? cur - lsn_offset : 0;
+}
+
+/* OID high-water mark of each table. The file map only changes while
+   tables are created and loaded, so stay away from it until then.
+ */
+void oid_hiwater(samples &s) {
+    if (volatile_read(sysconf::loading) or not volatile_read(oidmgr))
+        return;
+    for (auto &fm : sm_file_mgr::fid_map) {
+        auto *alloc = oidmgr->get_allocator(fm.first);
+        if (fm.second and alloc)
+            s.push_back({"table=\"" + fm.second->name + "\"", double(alloc->head.hiwater_mark)});
+    }
+}
+
+void register_builtin() {
+    add("ermia_log_current_lsn_offset", "Offset of the end of the log", "gauge",
+        [] { return log_offset(false); });
+    add("ermia_log_durable_lsn_offset", "Offset up to which the log is durable", "gauge",
+        [] { return log_offset(true); });
+    add("ermia_log_undurable_bytes", "Bytes of log not yet durable", "gauge",
+        [] { return lag(log_offset(true)); });
+    add("ermia_gc_trim_lsn_lag_bytes", "Bytes of log since the GC trim LSN", "gauge",
+        [] { return lag(MM::trim_lsn); });
+    add("ermia_safesnap_lsn_lag_bytes", "Bytes of log since the safe snapshot LSN", "gauge",
+        [] { return lag(MM::safesnap_lsn); });
+    add("ermia_snapshot_horizon_lag_bytes", "Bytes of log AS OF transactions can reach back", "gauge",
+        [] { return lag(MM::snapshot_horizon_lsn); });
+    add("ermia_mm_epoch", "Current memory manager epoch", "gauge",
+        [] { return volatile_read(MM::mm_epochs.state) ? MM::mm_epochs.get_cur_epoch() : 0; });
+    add("ermia_gc_backlog_oids", "Updated OIDs queued for the GC daemon", "gauge",
+        [] { return MM::gc_backlog(); });
+    add("ermia_gc_reclaimed_bytes_total", "Bytes of old versions reclaimed by GC", "counter",
+        [] { return volatile_read(MM::gc_reclaimed_nbytes); });
+    add("ermia_object_pool_objects", "Reclaimed objects waiting in the central pool", "gauge",
+        [] { return MM::central_pool_nobjects(); });
+    add("ermia_node_memory_allocated_bytes", "Bytes handed out from the per-node pools", "gauge",
+        [] { return MM::allocated_memory(); });
+    add_labeled("ermia_oid_hiwater", "Highest OID allocated per table", "gauge", &oid_hiwater);
+}
+
+void dump_daemon(std::string path) {
+    std::string tmp = path + ".tmp";
+    for (;;) {
+        std::string text = render();
+        FILE *f = fopen(tmp.c_str(), "w");
+        bool ok = f and fwrite(text.data(), 1, text.size(), f) == text.size();
+        ok = f and fclose(f) == 0 and ok;
+        if (not ok or rename(tmp.c_str(), path.c_str()))
+            perror("[Metrics] dump");
+        usleep(METRICS_DUMP_INTERVAL_MS * 1000);
+    }
+}
+
+/* One request per connection, whatever it asks for. */
+void serve_daemon(int listen_fd) {
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        char req[1024];
+        if (recv(fd, req, sizeof(req), 0) > 0) {
+            std::string body = render();
+            std::ostringstream o;
+            o << "HTTP/1.0 200 OK\r\n"
+              << "Content-Type: text/plain; version=0.0.4\r\n"
+              << "Content-Length: " << body.size() << "\r\n"
+              << "Connection: close\r\n\r\n" << body;
+            std::string reply = o.str();
+            os_send_all(fd, reply.data(), reply.size());
+        }
+        close(fd);
+    }
+}
+
+}  // end anonymous namespace
+
+void add(std::string const &name, std::string const &help, char const *type,
+         std::function<double()> value) {
+    add_labeled(name, help, type, [value](samples &s) { s.push_back({"", value()}); });
+}
+
+void add_labeled(std::string const &name, std::string const &help, char const *type,
+                 std::function<void(samples &)> values) {
+    std::lock_guard<std::mutex> guard(registry_lock());
+    registry()[name] = metric{help, type, values};
+}
+
+void remove(std::string const &name) {
+    std::lock_guard<std::mutex> guard(registry_lock());
+    registry().erase(name);
+}
+
+std::string render() {
+    std::lock_guard<std::mutex> guard(registry_lock());
+    std::ostringstream o;
+    o.precision(17);
+    samples s;
+    for (auto &r : registry()) {
+        s.clear();
+        r.second.values(s);
+        o << "# HELP " << r.first << " " << r.second.help << "\n"
+          << "# TYPE " << r.first << " " << r.second.type << "\n";
+        for (auto &v : s) {
+            o << r.first;
+            if (v.first.size())
+                o << "{" << v.first << "}";
+            o << " " << v.second << "\n";
+        }
+    }
+    return o.str();
+}
+
+void init() {
+    register_builtin();
+    if (sysconf::metrics_file.size())
+        std::thread(dump_daemon, sysconf::metrics_file).detach();
+    if (sysconf::metrics_listen.size()) {
+        int fd = os_socket(sysconf::metrics_listen, true);
+        printf("[Metrics] serving metrics at %s\n", sysconf::metrics_listen.c_str());
+        std::thread(serve_daemon, fd).detach();
+    }
+}
+
+}  // namespace metrics
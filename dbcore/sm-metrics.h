@@ -0,0 +1,53 @@
+// -*- mode:c++ -*-
+#ifndef __SM_METRICS_H
+#define __SM_METRICS_H
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Internal metrics, readable while a run is going.
+
+   A metric is a name plus a function that reads its current value;
+   nothing is sampled until somebody asks, so registering one costs
+   the hot path nothing. A labeled metric reads several values at once,
+   each with its own label set (e.g., one per table).
+
+   render() formats all of them as Prometheus text (exposition format
+   0.0.4). With sysconf::metrics_file set, a dumper thread rewrites
+   that file every METRICS_DUMP_INTERVAL_MS (node_exporter's textfile
+   collector picks such files up); with sysconf::metrics_listen set,
+   an HTTP server answers every request on that address (unix:/path or
+   host:port) with the same text.
+
+   Value functions run on the dumper and server threads, concurrently
+   with everything else, so they must only read state that stays
+   valid, like counters and global marks.
+ */
+namespace metrics {
+
+static unsigned int const METRICS_DUMP_INTERVAL_MS = 1000;
+
+// {label set, e.g. table="customer"; value}
+typedef std::vector<std::pair<std::string, double> > samples;
+
+/* [type] is "gauge" or "counter". Adding a name again replaces it */
+void add(std::string const &name, std::string const &help, char const *type,
+         std::function<double()> value);
+void add_labeled(std::string const &name, std::string const &help, char const *type,
+                 std::function<void(samples &)> values);
+
+/* Unregister [name]; call before whatever its function reads goes away */
+void remove(std::string const &name);
+
+std::string render();
+
+/* Register the storage manager's own metrics, then start the dumper
+   and the server if asked for
+ */
+void init();
+
+}  // namespace metrics
+
+#endif
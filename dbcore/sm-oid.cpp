@@ -3,8 +3,10 @@
 
 #include <map>
 
+#include "../benchmarks/ndb_wrapper.h"
 #include "../util.h"
 #include "../txn.h"
+#include "../txn_btree.h"
 
 #include "burt-hash.h"
 #include "sc-hash.h"
@@ -14,6 +16,7 @@
 #include "sm-file.h"
 #include "sm-log-recover-impl.h"
 #include "sm-oid-impl.h"
+#include "sm-phase.h"
 
 sm_oid_mgr *oidmgr = NULL;
 
@@ -195,6 +198,70 @@ thread_free(sm_oid_mgr_impl *om, FID f, OID o)
     it->entries[it->nentries++] = o;
 }
 
+/* Image checkpoints get big, so read them back through a buffer
+   instead of a read() per field.
+ */
+struct chkpt_reader {
+    static size_t const BUFFER_SIZE = 16 * 1024 * 1024;
+
+    chkpt_reader(int fd) : _fd(fd), _buf(new char[BUFFER_SIZE]), _pos(0), _end(0) { }
+    ~chkpt_reader() { delete [] _buf; }
+
+    // Return false at EOF, throw if it cuts [p] short
+    bool read(void *p, size_t n) {
+        for (size_t done = 0; done < n; ) {
+            if (_pos == _end) {
+                ssize_t m = ::read(_fd, _buf, BUFFER_SIZE);
+                THROW_IF(m < 0, os_error, errno, "Error reading checkpoint");
+                THROW_IF(m == 0 and done, illegal_argument, "Checkpoint file is truncated");
+                if (m == 0)
+                    return false;
+                _pos = 0;
+                _end = m;
+            }
+            size_t m = std::min(n - done, _end - _pos);
+            memcpy((char *)p + done, _buf + _pos, m);
+            _pos += m;
+            done += m;
+        }
+        return true;
+    }
+
+    void must_read(void *p, size_t n) {
+        THROW_IF(not read(p, n), illegal_argument, "Checkpoint file is truncated");
+    }
+
+    int _fd;
+    char *_buf;
+    size_t _pos;
+    size_t _end;
+};
+
+/* Writes [OID, key size, key, value size, value] for each record a
+   scan finds
+ */
+struct image_writer : public concurrent_btree::low_level_search_range_callback {
+    image_writer() : count(0) { }
+
+    virtual void on_resp_node(const concurrent_btree::node_opaque_t *n, uint64_t version) { }
+
+    virtual bool invoke(const concurrent_btree *btr, const concurrent_btree::string_type &k,
+                        OID oid, dbtuple *v, const concurrent_btree::node_opaque_t *n,
+                        uint64_t version) {
+        uint32_t key_size = k.length();
+        uint32_t value_size = v->size;
+        chkptmgr->write_buffer(&oid, sizeof(OID));
+        chkptmgr->write_buffer(&key_size, sizeof(uint32_t));
+        chkptmgr->write_buffer((void *)k.data(), key_size);
+        chkptmgr->write_buffer(&value_size, sizeof(uint32_t));
+        chkptmgr->write_buffer(v->get_value_start(), value_size);
+        count++;
+        return true;
+    }
+
+    uint64_t count;
+};
+
 # if 0
 { // exit namespace, disable autoindent
 #endif
@@ -495,40 +562,43 @@ sm_oid_mgr::create(LSN chkpt_start, sm_log_recover_mgr *lm)
     // Create an empty oidmgr, with initial internal files
     oidmgr = new sm_oid_mgr_impl{};
     oidmgr->dfd = dirent_iterator(sysconf::log_dir.c_str()).dup();
-    chkptmgr = new sm_chkpt_mgr(chkpt_start);
-
-    if (not sm_log::need_recovery or chkpt_start.offset() == 0)
-        return;
 
     // Find the chkpt file and recover from there
+    bool recover = sm_log::need_recovery and chkpt_start.offset();
+    // Both names are as long as the "chd-" one the buffer is sized for
     char buf[CHKPT_DATA_FILE_NAME_BUFSZ];
-    size_t n = os_snprintf(buf, sizeof(buf),
-                           CHKPT_DATA_FILE_NAME_FMT, chkpt_start._val);
+    os_snprintf(buf, sizeof(buf), CHKPT_IMAGE_FILE_NAME_FMT, chkpt_start._val);
+    bool image = recover and faccessat(oidmgr->dfd, buf, F_OK, 0) == 0;
+    chkptmgr = new sm_chkpt_mgr(chkpt_start, image);
+    if (not recover)
+        return;
+
+    if (not image)
+        os_snprintf(buf, sizeof(buf), CHKPT_DATA_FILE_NAME_FMT, chkpt_start._val);
     printf("[Recovery.chkpt] %s\n", buf);
-    ASSERT(n < sizeof(buf));
     int fd = os_openat(oidmgr->dfd, buf, O_RDONLY);
+    DEFER(os_close(fd));
+    chkpt_reader in(fd);
 
+    std::vector<char> key, value;
     while (1) {
         // Read himark
         OID himark = 0;
-        n = read(fd, &himark, sizeof(OID));
-        if (not n)  // EOF
+        if (not in.read(&himark, sizeof(OID)))  // EOF
             break;
 
-        ASSERT(n == sizeof(OID));
-
         // Read the table's name
         size_t len = 0;
-        n = read(fd, &len, sizeof(size_t));
-        THROW_IF(n != sizeof(size_t), illegal_argument,
+        in.must_read(&len, sizeof(size_t));
+        THROW_IF(len > 256, illegal_argument,
                  "Error reading tabel name length");
         char name_buf[256];
-        n = read(fd, name_buf, len);
+        in.must_read(name_buf, len);
         std::string name(name_buf, len);
 
         // FID
         FID f = 0;
-        n = read(fd, &f, sizeof(FID));
+        in.must_read(&f, sizeof(FID));
 
         // Recover fid_map and recreate the empty file
         ASSERT(sm_file_mgr::get_index(name));
@@ -536,6 +606,7 @@ sm_oid_mgr::create(LSN chkpt_start, sm_log_recover_mgr *lm)
         sm_file_mgr::fid_map[f] = new sm_file_descriptor(f, name, sm_file_mgr::get_index(name));
         ASSERT(not oidmgr->file_exists(f));
         oidmgr->recreate_file(f);
+        sm_file_mgr::get_index(name)->set_oid_array(f);
         printf("[Recovery.chkpt] FID=%d %s\n", f, name.c_str());
 
         // Recover allocator status
@@ -544,22 +615,44 @@ sm_oid_mgr::create(LSN chkpt_start, sm_log_recover_mgr *lm)
         oidmgr->recreate_allocator(f, himark);
 
         // Populate the OID array
+        auto &btr = sm_file_mgr::get_index(name)->btr.underlying_btree;
+        fat_ptr clsn = LSN::make(chkpt_start.offset(), 0).to_log_ptr();
         while (1) {
             OID o = 0;
-            n = read(fd, &o, sizeof(OID));
+            in.must_read(&o, sizeof(OID));
             if (o == himark)
                 break;
 
             fat_ptr ptr = NULL_PTR;
-            n = read(fd, &ptr, sizeof(fat_ptr));
-            if (sysconf::eager_warm_up()) {
-                ptr = object::create_tuple_object(ptr, NULL_PTR, 0, lm);
-                ASSERT(ptr.asi_type() == 0);
+            if (image) {
+                // Rebuild the version and its index entry
+                uint32_t sz = 0;
+                in.must_read(&sz, sizeof(uint32_t));
+                key.resize(sz);
+                in.must_read(key.data(), sz);
+                in.must_read(&sz, sizeof(uint32_t));
+                value.resize(sz);
+                in.must_read(value.data(), sz);
+
+                varstr v(value.data(), sz);
+                ptr = object::create_tuple_object(&v, true, 0);
+                object *obj = (object *)ptr.offset();
+                obj->tuple()->pvalue = NULL;
+                obj->_clsn = clsn;
+                ALWAYS_ASSERT(btr.insert_if_absent(varkey((uint8_t *)key.data(), key.size()),
+                                                   o, NULL, 0));
             }
             else {
-                object *obj = new (MM::allocate(sizeof(object), 0)) object(ptr, NULL_PTR, 0);
-                ptr = fat_ptr::make(obj, INVALID_SIZE_CODE, fat_ptr::ASI_LOG_FLAG);
-                ASSERT(ptr.asi_type() == fat_ptr::ASI_LOG);
+                in.must_read(&ptr, sizeof(fat_ptr));
+                if (sysconf::eager_warm_up()) {
+                    ptr = object::create_tuple_object(ptr, NULL_PTR, 0, lm);
+                    ASSERT(ptr.asi_type() == 0);
+                }
+                else {
+                    object *obj = new (MM::allocate(sizeof(object), 0)) object(ptr, NULL_PTR, 0);
+                    ptr = fat_ptr::make(obj, INVALID_SIZE_CODE, fat_ptr::ASI_LOG_FLAG);
+                    ASSERT(ptr.asi_type() == fat_ptr::ASI_LOG);
+                }
             }
             oidmgr->oid_put_new(f, o, ptr);
         }
@@ -637,6 +730,33 @@ sm_oid_mgr::take_chkpt(LSN cstart)
     chkptmgr->sync_buffer();
 }
 
+void
+sm_oid_mgr::take_image_chkpt(xid_context *xc)
+{
+    // Same layout as take_chkpt, with [OID, key size, key, value size,
+    // value] instead of [OID, ptr]: a bulk load's keys and values are
+    // nowhere in the log. Records come out of each table's index, as
+    // seen by the snapshot transaction [xc].
+    for (auto &fm : sm_file_mgr::fid_map) {
+        auto* fd = fm.second;
+        auto *alloc = get_impl(this)->get_allocator(fd->fid);
+        OID himark = alloc->head.hiwater_mark;
+        chkptmgr->write_buffer(&himark, sizeof(OID));
+
+        size_t len = fd->name.length();
+        chkptmgr->write_buffer(&len, sizeof(size_t));
+        chkptmgr->write_buffer((void *)fd->name.c_str(), len);
+        chkptmgr->write_buffer(&fd->fid, sizeof(FID));
+
+        image_writer w;
+        fd->index->btr.underlying_btree.search_range_call(varkey(), NULL, w, xc);
+        chkptmgr->write_buffer(&himark, sizeof(OID));
+        std::cout << "[Checkpoint] FID(" << fd->fid << ") = " << fd->name
+                  << ", himark = " << himark << ", records = " << w.count << std::endl;
+    }
+    chkptmgr->sync_buffer();
+}
+
 sm_allocator*
 sm_oid_mgr::get_allocator(FID f)
 {
@@ -813,7 +933,6 @@ start_over:
     fat_ptr head = volatile_read(*ptr);
     object *old_desc = (object *)head.offset();
     ASSERT(head.size_code() != INVALID_SIZE_CODE);
-    dbtuple *version = (dbtuple *)old_desc->payload();
     bool overwrite = false;
 
     auto clsn = volatile_read(old_desc->_clsn);
@@ -900,7 +1019,7 @@ install:
         volatile_write(new_object->_next, old_desc->_next);
         // I already claimed it, no need to use cas then
         volatile_write(ptr->_ptr, new_obj_ptr->_ptr);
-        version->mark_defunct();
+        // the caller marks the old one defunct, once it saw its pvalue
         __sync_synchronize();
         return head;
     }
@@ -957,6 +1076,7 @@ sm_oid_mgr::ensure_tuple(fat_ptr *ptr, epoch_num epoch)
         return p;
     }
 
+    phase::timer pt(phase::ENSURE_TUPLE);
     auto *obj = (object *)p.offset();
 
     // obj->_pdest should point to some location in the log
@@ -983,6 +1103,7 @@ sm_oid_mgr::oid_get_version(FID f, OID o, xid_context *visitor_xc)
 dbtuple*
 sm_oid_mgr::oid_get_version(oid_array *oa, OID o, xid_context *visitor_xc)
 {
+    phase::timer pt(phase::VERSION);
 start_over:
     // must pui start_over above this, because we'll update pp later
     fat_ptr *pp = oa->get(o);
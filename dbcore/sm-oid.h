@@ -121,6 +121,12 @@ struct sm_oid_mgr {
      */
     void take_chkpt(LSN cstart);
 
+    /* Like take_chkpt, but record each live record's key and value, as
+       the snapshot [xc] sees it, instead of its log location (see
+       sm_chkpt_mgr::take_image).
+     */
+    void take_image_chkpt(xid_context *xc);
+
     /* Create a new file and return its FID. If [needs_alloc]=true,
        the new file will be managed by an allocator and its FID can be
        passed to alloc_oid(); otherwise, the file is either unmanaged
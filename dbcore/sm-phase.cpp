@@ -0,0 +1,15 @@
+#include "sm-phase.h"
+
+namespace phase {
+
+char const *const names[NPHASES] = {
+    "index", "version", "ensure_tuple", "alloc",
+    "log", "precommit", "validate", "postcommit",
+};
+
+#ifdef ENABLE_PHASE_TIMING
+__thread counters tls_counters;
+__thread uint64_t tls_nested_cycles;
+#endif
+
+}  // namespace phase
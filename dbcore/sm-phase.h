@@ -0,0 +1,108 @@
+// -*- mode:c++ -*-
+#ifndef __SM_PHASE_H
+#define __SM_PHASE_H
+
+#include <stdint.h>
+
+#include "../amd64.h"
+#include "../macros.h"
+
+/* Where a transaction's time goes.
+
+   Each thread keeps a cycle count (rdtsc) and a call count for every
+   phase below. Phases nest - an index lookup may have to read a
+   version, which may have to fetch it from the log - and each one is
+   charged only its own cycles, not those of the phases nested in
+   it, so the counters add up to the time spent in all of them.
+   Benchmark workers snapshot the counters around each transaction to
+   break them down by transaction type.
+
+   Only compiled in with PHASE_TIMING=1 (-DENABLE_PHASE_TIMING);
+   otherwise the timers below are empty and compile away.
+ */
+namespace phase {
+
+enum kind {
+    INDEX,          // index traversal
+    VERSION,        // version chain walk (oid_get_version)
+    ENSURE_TUPLE,   // loading a version from the log
+    ALLOC,          // version allocation (MM::allocate)
+    LOG,            // creating and copying log records
+    PRECOMMIT,      // commit LSN acquisition
+    VALIDATE,       // SSN/SSI commit checks
+    POSTCOMMIT,     // stamping versions after commit
+    NPHASES
+};
+
+extern char const *const names[NPHASES];
+
+struct counters {
+    uint64_t cycles[NPHASES];
+    uint64_t calls[NPHASES];
+
+    counters &operator+=(counters const &c) {
+        for (int i = 0; i < NPHASES; i++) {
+            cycles[i] += c.cycles[i];
+            calls[i] += c.calls[i];
+        }
+        return *this;
+    }
+
+    counters operator-(counters const &c) const {
+        counters d = *this;
+        for (int i = 0; i < NPHASES; i++) {
+            d.cycles[i] -= c.cycles[i];
+            d.calls[i] -= c.calls[i];
+        }
+        return d;
+    }
+};
+
+#ifdef ENABLE_PHASE_TIMING
+static bool const enabled = true;
+
+extern __thread counters tls_counters;
+// cycles spent in phases nested inside the innermost running one
+extern __thread uint64_t tls_nested_cycles;
+
+struct timer {
+    kind k;
+    bool running;
+    uint64_t start;
+    uint64_t outer_nested_cycles;
+
+    inline ALWAYS_INLINE timer(kind k)
+        : k(k), running(true), start(rdtsc()), outer_nested_cycles(tls_nested_cycles)
+    {
+        tls_nested_cycles = 0;
+    }
+
+    // End the phase before the end of the scope
+    inline ALWAYS_INLINE void stop() {
+        if (not running)
+            return;
+        running = false;
+        uint64_t total = rdtsc() - start;
+        tls_counters.cycles[k] += total - tls_nested_cycles;
+        tls_counters.calls[k]++;
+        tls_nested_cycles = outer_nested_cycles + total;
+    }
+
+    inline ALWAYS_INLINE ~timer() { stop(); }
+};
+
+inline counters snapshot() { return tls_counters; }
+#else
+static bool const enabled = false;
+
+struct timer {
+    inline ALWAYS_INLINE timer(kind) {}
+    inline ALWAYS_INLINE void stop() {}
+};
+
+inline counters snapshot() { return counters(); }
+#endif
+
+}  // namespace phase
+
+#endif
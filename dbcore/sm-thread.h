@@ -171,6 +171,14 @@ public:
     return me != nullptr;
   }
 
+  // Same, but only on [node], e.g., to allocate there
+  inline bool try_impersonate(uint16_t node) {
+    ALWAYS_ASSERT(not me);
+    ALWAYS_ASSERT(node < sysconf::numa_nodes);
+    me = thread::get_thread(node);
+    return me != nullptr;
+  }
+
   inline void join() {
     me->join();
     put_thread(me);
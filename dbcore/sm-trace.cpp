@@ -0,0 +1,146 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sm-trace.h"
+#include "stopwatch.h"
+
+namespace trace {
+
+bool enabled = false;
+__thread ring *tls_ring = nullptr;
+
+// every ring ever created; rings are never freed, so dump() can walk
+// the list while threads come and go
+static ring *volatile rings = nullptr;
+
+static std::string trace_path;
+static uint64_t base_tsc;
+static double tsc_per_us;
+
+ring *new_ring() {
+    ring *r = new ring();
+    r->tid = syscall(SYS_gettid);
+    snprintf(r->name, sizeof(r->name), "thread %d", r->tid);
+    ring *old;
+    do {
+        old = volatile_read(rings);
+        r->next = old;
+    } while (not __sync_bool_compare_and_swap(&rings, old, r));
+    tls_ring = r;
+    return r;
+}
+
+void name_thread(char const *name) {
+    if (not enabled)
+        return;
+    ring *r = tls_ring ? tls_ring : new_ring();
+    strncpy(r->name, name, sizeof(r->name) - 1);
+}
+
+static void dump_at_exit() {
+    dump(trace_path);
+}
+
+/* SIGUSR2 is blocked everywhere (see init()), so this thread is the
+   only one that ever receives it.
+ */
+static void dump_on_signal(sigset_t set) {
+    for (;;) {
+        int sig;
+        if (sigwait(&set, &sig) == 0 and dump(trace_path))
+            fprintf(stderr, "[Trace] dumped to %s\n", trace_path.c_str());
+    }
+}
+
+void init(std::string const &path) {
+    trace_path = path;
+
+    // rdtsc to microseconds, good enough for a timeline
+    uint64_t ns = stopwatch_t::now(), tsc = rdtsc();
+    usleep(20 * 1000);
+    tsc_per_us = double(rdtsc() - tsc) * 1000 / (stopwatch_t::now() - ns);
+    base_tsc = rdtsc();
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    ALWAYS_ASSERT(pthread_sigmask(SIG_BLOCK, &set, nullptr) == 0);
+    std::thread(dump_on_signal, set).detach();
+    atexit(dump_at_exit);
+    volatile_write(enabled, true);
+}
+
+static void write_event(FILE *f, ring const *r, event const &e) {
+    double ts = e.ts > base_tsc ? (e.ts - base_tsc) / tsc_per_us : 0;
+    fprintf(f, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+            e.ph, getpid(), r->tid, ts);
+    if (e.ph == 'E') {
+        fprintf(f, ",\"args\":{\"end\":\"%s\"", e.name);
+    } else {
+        fprintf(f, ",\"name\":\"%s\"", e.name);
+        if (e.ph == 'i')
+            fprintf(f, ",\"s\":\"t\"");
+        fprintf(f, ",\"args\":{");
+    }
+    if (e.arg)
+        fprintf(f, "%s\"v\":%lu", e.ph == 'E' ? "," : "", e.arg);
+    fprintf(f, "}}");
+}
+
+/* Each ring is copied while its owner may keep recording. Events
+   recorded during the copy can overwrite slots being copied, so after
+   the copy only the slots the owner can't have reached yet are kept:
+   those at least EVENTS_PER_THREAD events behind the head as seen
+   afterwards, minus one for the event it may be writing right now.
+ */
+bool dump(std::string const &path) {
+    static std::mutex dump_lock;
+    std::lock_guard<std::mutex> guard(dump_lock);
+
+    std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if (not f) {
+        perror("[Trace] fopen");
+        return false;
+    }
+
+    std::vector<event> copy(EVENTS_PER_THREAD);
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+            "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"ermia\"}}",
+            getpid());
+    for (ring *r = volatile_read(rings); r; r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t lo = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+        for (uint64_t i = lo; i < head; i++)
+            copy[i - lo] = r->events[i & (EVENTS_PER_THREAD - 1)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t head_after = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t valid = head_after + 1 > EVENTS_PER_THREAD ? head_after + 1 - EVENTS_PER_THREAD : 0;
+
+        fprintf(f, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                getpid(), r->tid, r->name);
+        for (uint64_t i = std::max(lo, valid); i < head; i++)
+            write_event(f, r, copy[i - lo]);
+    }
+    fprintf(f, "\n]}\n");
+
+    bool ok = fflush(f) == 0 and fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 and ok;
+    if (not ok or rename(tmp.c_str(), path.c_str())) {
+        perror("[Trace] write");
+        return false;
+    }
+    return true;
+}
+
+}  // namespace trace
@@ -0,0 +1,105 @@
+// -*- mode:c++ -*-
+#ifndef __SM_TRACE_H
+#define __SM_TRACE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+#include "../amd64.h"
+#include "../macros.h"
+
+/* Event tracing for timelines of what workers and daemons are doing.
+
+   Every thread appends events to its own ring buffer, so recording
+   one is a handful of stores and nothing is shared. The ring keeps
+   the last EVENTS_PER_THREAD events of its thread; older ones are
+   overwritten. A dump copies out what each ring holds at that moment,
+   without stopping anybody, and writes it as Chrome trace JSON
+   (chrome://tracing or ui.perfetto.dev).
+
+   Tracing is off unless init() is called, and a disabled tracepoint
+   is a single load and branch. Once enabled, the trace is dumped at
+   exit and whenever the process gets SIGUSR2.
+
+   Event names are not copied: pass string literals only.
+ */
+namespace trace {
+
+static uint64_t const EVENTS_PER_THREAD = 1 << 16;
+
+struct event {
+    uint64_t ts;        // rdtsc
+    char const *name;
+    uint64_t arg;
+    char ph;            // Chrome trace phase: B(egin), E(nd), i(nstant)
+};
+
+struct ring {
+    ring *next;
+    uint64_t head;      // events ever recorded; only the owner writes it
+    pid_t tid;
+    char name[32];
+    event events[EVENTS_PER_THREAD];
+};
+
+extern bool enabled;
+extern __thread ring *tls_ring;
+
+ring *new_ring();
+
+inline ALWAYS_INLINE void record(char ph, char const *name, uint64_t arg) {
+    if (likely(not enabled))
+        return;
+    ring *r = tls_ring ? tls_ring : new_ring();
+    uint64_t h = r->head;
+    event &e = r->events[h & (EVENTS_PER_THREAD - 1)];
+    e.ts = rdtsc();
+    e.name = name;
+    e.arg = arg;
+    e.ph = ph;
+    // publish the event only after it's complete, see dump()
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+/* A slice on this thread's timeline. [end]'s name shows up as the
+   slice's "end" argument (e.g., commit or abort).
+ */
+inline ALWAYS_INLINE void begin(char const *name, uint64_t arg = 0) {
+    record('B', name, arg);
+}
+
+inline ALWAYS_INLINE void end(char const *name, uint64_t arg = 0) {
+    record('E', name, arg);
+}
+
+inline ALWAYS_INLINE void instant(char const *name, uint64_t arg = 0) {
+    record('i', name, arg);
+}
+
+struct scope {
+    char const *name;
+
+    inline ALWAYS_INLINE scope(char const *name, uint64_t arg = 0) : name(name) {
+        begin(name, arg);
+    }
+
+    inline ALWAYS_INLINE ~scope() { end(name); }
+};
+
+// Label the calling thread in the trace (copied, truncated to 31 chars)
+void name_thread(char const *name);
+
+/* Turn tracing on and dump to [path] at exit and on SIGUSR2. Call
+   before any other thread is created, so SIGUSR2 stays blocked in all
+   of them and only reaches the dumper.
+ */
+void init(std::string const &path);
+
+// Write what the rings hold now; false if the file can't be written
+bool dump(std::string const &path);
+
+}  // namespace trace
+
+#endif
@@ -1,5 +1,6 @@
 #include <string>
 #include "sm-log-impl.h"
+#include "sm-phase.h"
 
 using namespace RCU;
 
@@ -44,6 +45,11 @@ sm_tx_log::log_update(FID f, OID o, fat_ptr ptr, int abits, fat_ptr *pdest) {
     get_log_impl(this)->add_payload_request(LOG_UPDATE, f, o, ptr, abits, pdest);
 }
 
+void
+sm_tx_log::log_update_delta(FID f, OID o, fat_ptr ptr, int abits, fat_ptr *pdest) {
+    get_log_impl(this)->add_payload_request(LOG_UPDATE_DELTA, f, o, ptr, abits, pdest);
+}
+
 void
 sm_tx_log::log_fid(FID f, const std::string &name)
 {
@@ -79,6 +85,8 @@ make_log_request(log_record_type type, FID f, OID o, fat_ptr ptr, int abits) {
     req.size_align_bits = abits;
     req.payload_ptr = ptr;
     req.payload_size = decode_size_aligned(ptr.size_code(), abits);
+    req.key_ptr = NULL_PTR;
+    req.key_size = 0;
     return req;
 }
 
@@ -95,6 +103,33 @@ sm_tx_log::log_delete(FID f, OID o) {
     get_log_impl(this)->add_request(req);
 }
 
+void
+sm_tx_log::log_insert_with_key(FID f, OID o, fat_ptr ptr, fat_ptr key, int abits, fat_ptr *pdest) {
+    // The key starts at the first aligned offset past the version's varstr
+    size_t vsize = align_up(sizeof(varstr) + ((varstr *)ptr.offset())->size());
+    size_t ksize = decode_size_aligned(key.size_code(), abits);
+    size_t psize = vsize + ksize;
+
+    /* add_payload_request would move an oversized payload to an
+       external block, which only knows how to copy one object. Such
+       records are rare enough to just log the two halves separately.
+     */
+    if (sm_log_recover_mgr::MAX_BLOCK_SIZE < log_block::wrapped_size(8, 8*psize)) {
+        log_insert(f, o, ptr, abits, pdest);
+        log_insert_index(f, o, key, abits, NULL);
+        return;
+    }
+
+    auto size_code = encode_size_aligned(psize, abits);
+    log_request req = make_log_request(LOG_INSERT_WITH_KEY, f, o,
+                                       fat_ptr::make(ptr.offset(), size_code), abits);
+    ASSERT(req.payload_size >= psize);
+    req.key_ptr = key;
+    req.key_size = req.payload_size - vsize;
+    req.pdest = pdest;
+    get_log_impl(this)->add_request(req);
+}
+
 LSN
 sm_tx_log::get_clsn() {
     /* The caller already has a published CLSN, so if this tx still
@@ -120,8 +155,10 @@ sm_tx_log::get_clsn() {
 LSN
 sm_tx_log::pre_commit() {
     auto *impl = get_log_impl(this);
-    if (not impl->_commit_block)
+    if (not impl->_commit_block) {
+        phase::timer pt(phase::PRECOMMIT);
         impl->enter_precommit();
+    }
     return impl->_commit_block->block->next_lsn();
 }
 
@@ -132,7 +169,10 @@ sm_tx_log::commit(LSN *pdest) {
 
     auto *impl = get_log_impl(this);
     // now copy log record data
-    impl->_populate_block(impl->_commit_block->block);
+    {
+        phase::timer pt(phase::LOG);
+        impl->_populate_block(impl->_commit_block->block);
+    }
 
     if (pdest)
         *pdest = impl->_commit_block->block->lsn;
@@ -142,6 +182,24 @@ sm_tx_log::commit(LSN *pdest) {
     return clsn;
 }
 
+sm_tx_log::savepoint
+sm_tx_log::get_savepoint() {
+    auto *impl = get_log_impl(this);
+    return savepoint{impl->_nreq, impl->_payload_bytes, impl->_prev_overflow};
+}
+
+bool
+sm_tx_log::rollback_to(savepoint const &sp) {
+    auto *impl = get_log_impl(this);
+    ASSERT(not impl->_commit_block);
+    if (impl->_prev_overflow != sp.prev_overflow)
+        return false;
+    ASSERT(sp.nreq <= impl->_nreq);
+    impl->_nreq = sp.nreq;
+    impl->_payload_bytes = sp.payload_bytes;
+    return true;
+}
+
 void
 sm_tx_log::discard() {
     auto *impl = get_log_impl(this);
@@ -189,7 +247,7 @@ sm_tx_log_impl::add_payload_request(log_record_type type, FID f, OID o,
         b->records->size_align_bits = abits;
 
         uint32_t csum = b->body_checksum();
-        b->checksum = adler32_memcpy(b->payload_begin(), p, psize, csum);
+        b->checksum = log_csum->sum_memcpy(b->payload_begin(), p, psize, csum);
 
         // update the request to point to the external record
         req.type = (log_record_type) (req.type | LOG_FLAG_IS_EXT);
@@ -211,6 +269,7 @@ sm_tx_log_impl::add_payload_request(log_record_type type, FID f, OID o,
 }
 
 void sm_tx_log_impl::add_request(log_request const &req) {
+    phase::timer pt(phase::LOG);
     ASSERT (not _commit_block);
     auto new_nreq = _nreq+1;
     bool too_many = (new_nreq > sm_log_recover_mgr::MAX_BLOCK_RECORDS);
@@ -234,7 +293,7 @@ sm_tx_log_impl::_populate_block(log_block *b)
 {
     size_t i = 0;
     uint32_t payload_end = 0;
-    uint32_t csum_payload = ADLER32_CSUM_INIT;
+    uint32_t csum_payload = log_csum->init;
 
     // link to previous overflow?
     if (_prev_overflow != INVALID_LSN) {
@@ -267,7 +326,15 @@ sm_tx_log_impl::_populate_block(log_block *b)
             }
             
             char *dest = b->payload_begin() + payload_end;
-            csum_payload = adler32_memcpy(dest, it->payload_ptr, it->payload_size, csum_payload);
+            if (it->type == LOG_INSERT_WITH_KEY) {
+                // gather the version and its key into one payload
+                auto vsize = it->payload_size - it->key_size;
+                csum_payload = log_csum->sum_memcpy(dest, it->payload_ptr, vsize, csum_payload);
+                csum_payload = log_csum->sum_memcpy(dest + vsize, it->key_ptr, it->key_size, csum_payload);
+            }
+            else {
+                csum_payload = log_csum->sum_memcpy(dest, it->payload_ptr, it->payload_size, csum_payload);
+            }
             payload_end += it->payload_size;
         }
         else {
@@ -281,7 +348,7 @@ sm_tx_log_impl::_populate_block(log_block *b)
 
     // finalize the checksum
     uint32_t csum = b->body_checksum();
-    b->checksum = adler32_merge(csum, csum_payload, payload_end);
+    b->checksum = log_csum->merge(csum, csum_payload, payload_end);
 }
 
 /* Transactions assign this value to their commit block as a signal of
@@ -315,7 +382,7 @@ void sm_tx_log_impl::spill_overflow() {
     _populate_block(inner);
         
     uint32_t csum = b->body_checksum();
-    b->checksum = adler32_merge(csum, inner->checksum, pbytes);
+    b->checksum = log_csum->merge(csum, inner->checksum, pbytes);
     _nreq = 1; // for the overflow LSN
     _prev_overflow = inner->lsn;
     _payload_bytes = 0;
@@ -1,4 +1,5 @@
 #include "adler.h"
+#include "crc32c.h"
 
 #include "sm-defs.h"
 #include "sm-exceptions.h"
@@ -433,6 +434,27 @@ uint32_t __attribute__((noinline)) adler32_custom(char *data, size_t nbytes)
 #include <unistd.h>
 #include <fcntl.h>
 
+/* Run [fn] [ntimes] and report the last checksum, the elapsed time
+   and the throughput it achieved.
+ */
+template <typename Fn>
+uint32_t time_variant(char const *name, stopwatch_t &timer, size_t ntimes, size_t len, Fn fn) {
+    size_t tick = ntimes/10;
+    if (not tick)
+        tick = 1;
+
+    uint32_t x = 0;
+    timer.reset();
+    for (size_t i=0; i < ntimes; i++) {
+        if (not (i%tick))
+            fprintf(stderr, ".");
+        x = fn();
+    }
+    double secs = timer.time();
+    printf("\n%08xd %.3f %6.2f GB/s %s\n", x, secs, ntimes*len/secs/1e9, name);
+    return x;
+}
+
 void bakeoff(char const *msg, size_t nbytes, char *data, size_t len) {
     printf("\n\n%s (%zd bytes):\n", msg, len);
     size_t ntimes = nbytes/len;
@@ -443,7 +465,6 @@ void bakeoff(char const *msg, size_t nbytes, char *data, size_t len) {
     char *dest_buf = (char*) malloc(len+32);
     uintptr_t n = (uintptr_t) data;
     n &= 0xf;
-    uint32_t x = 0;
     uintptr_t m = (uintptr_t) dest_buf;
     m = (m + 0xf) & ~0xf;
     m += n;
@@ -451,49 +472,74 @@ void bakeoff(char const *msg, size_t nbytes, char *data, size_t len) {
 
     // go!
     stopwatch_t timer;
-    size_t tick = ntimes/10;
-    if (not tick)
-        tick = 1;
     
 #if 0
-    for (size_t i=0; i < ntimes; i++) {
-        if (not (i%tick))
-            fprintf(stderr, ".");
-        x = adler32_orig(data, len);
-    }
-    printf("\n%08xd %.3f adler3_orig\n", x, timer.time());
+    time_variant("adler32_orig", timer, ntimes, len, [&]{ return adler32_orig(data, len); });
 #endif
-    
-    for (size_t i=0; i < ntimes; i++) {
-        if (not (i%tick))
-            fprintf(stderr, ".");
-        x = adler32_vanilla(data, len);
-    }
-    printf("\n%08xd %.3f adler32_vanilla\n", x, timer.time());
 
-    for (size_t i=0; i < ntimes; i++) {
-        if (not (i%tick))
-            fprintf(stderr, ".");
-        x = adler32_memcpy_vanilla(dest, data, len);
-    }
-    ASSERT (not memcmp(dest, data, len));
-    printf("\n%08xd %.3f adler32_memcpy_vanilla\n", x, timer.time());
+    uint32_t expect = time_variant("adler32_vanilla", timer, ntimes, len, [&]{
+            return adler32_vanilla(data, len);
+        });
+    auto check = [&](char const *name, uint32_t x, uint32_t expect) {
+        if (x != expect)
+            printf("\tOops! %s gave %08x instead of %08x\n", name, x, expect);
+    };
+    auto check_copy = [&](char const *name) {
+        if (memcmp(dest, data, len))
+            printf("\tOops! %s did not copy the data\n", name);
+        memset(dest, 0, len);
+    };
+
+    check("adler32_memcpy_vanilla", time_variant("adler32_memcpy_vanilla", timer, ntimes, len, [&]{
+                return adler32_memcpy_vanilla(dest, data, len);
+            }), expect);
+    check_copy("adler32_memcpy_vanilla");
 
 #ifdef __SSSE3__
-    for (size_t i=0; i < ntimes; i++) {
-        if (not (i%tick))
-            fprintf(stderr, ".");
-        x = adler32_sse(data, len);
+    check("adler32_sse", time_variant("adler32_sse", timer, ntimes, len, [&]{
+                return adler32_sse(data, len);
+            }), expect);
+    check("adler32_memcpy_sse", time_variant("adler32_memcpy_sse", timer, ntimes, len, [&]{
+                return adler32_memcpy_sse(dest, data, len);
+            }), expect);
+    check_copy("adler32_memcpy_sse");
+#endif
+
+#ifdef __x86_64__
+    if (__builtin_cpu_supports("avx2")) {
+        check("adler32_avx2", time_variant("adler32_avx2", timer, ntimes, len, [&]{
+                    return adler32_avx2(data, len);
+                }), expect);
+        check("adler32_memcpy_avx2", time_variant("adler32_memcpy_avx2", timer, ntimes, len, [&]{
+                    return adler32_memcpy_avx2(dest, data, len);
+                }), expect);
+        check_copy("adler32_memcpy_avx2");
+
+        // no alignment requirement, unlike adler32_memcpy_sse
+        check("adler32_memcpy_avx2 (misaligned)", adler32_memcpy_avx2(dest+1, data, len), expect);
+        if (memcmp(dest+1, data, len))
+            printf("\tOops! adler32_memcpy_avx2 (misaligned) did not copy the data\n");
     }
-    printf("\n%08xd %.3f adler32_sse\n", x, timer.time());
+#endif
 
-    for (size_t i=0; i < ntimes; i++) {
-        if (not (i%tick))
-            fprintf(stderr, ".");
-        x = adler32_memcpy_sse(dest, data, len);
+    expect = time_variant("crc32c_vanilla", timer, ntimes, len, [&]{
+            return crc32c_vanilla(data, len);
+        });
+    check("crc32c_memcpy_vanilla", time_variant("crc32c_memcpy_vanilla", timer, ntimes, len, [&]{
+                return crc32c_memcpy_vanilla(dest, data, len);
+            }), expect);
+    check_copy("crc32c_memcpy_vanilla");
+
+#ifdef __x86_64__
+    if (__builtin_cpu_supports("sse4.2")) {
+        check("crc32c_sse42", time_variant("crc32c_sse42", timer, ntimes, len, [&]{
+                    return crc32c_sse42(data, len);
+                }), expect);
+        check("crc32c_memcpy_sse42", time_variant("crc32c_memcpy_sse42", timer, ntimes, len, [&]{
+                    return crc32c_memcpy_sse42(dest, data, len);
+                }), expect);
+        check_copy("crc32c_memcpy_sse42");
     }
-    printf("\n%08xd %.3f adler32_memcpy_sse\n", x, timer.time());
-    ASSERT (not memcmp(dest, data, len));
 #endif
     free(dest_buf);
 }
@@ -527,6 +573,7 @@ int main(int argc, char const *argv[]) {
         exit(-1);
     }
     
+    size_t full_len = len;
     len = 1039;
     uint32_t csum = adler32_orig(data, len);
     printf("\n\n\n%08xd bulk[%zd]\n", csum, len);
@@ -544,4 +591,22 @@ int main(int argc, char const *argv[]) {
         uint32_t lr = adler32(data+lsz, rsz, left);
         printf("%08xd cont[%zd/%zd]\n", lr, lsz, rsz);
     }
+
+    printf("\nVerify crc32c against the standard check value...\n");
+    if (crc32c("123456789", 9) != 0xe3069283)
+        printf("\tOops! crc32c(\"123456789\") = %08x\n", crc32c("123456789", 9));
+
+    printf("Verify crc32c merges and continues...\n");
+    for (size_t len : {size_t(1039), full_len}) {
+        csum = crc32c(data, len);
+        for (int i=2; i < 10; i++) {
+            size_t lsz = len/i, rsz = len - lsz;
+            uint32_t left = crc32c(data, lsz);
+            uint32_t right = crc32c(data + lsz, rsz);
+            if (crc32c_merge(left, right, rsz) != csum)
+                printf("\tOops! incr[%zd/%zd] does not match\n", lsz, rsz);
+            if (crc32c(data + lsz, rsz, left) != csum)
+                printf("\tOops! cont[%zd/%zd] does not match\n", lsz, rsz);
+        }
+    }
 }
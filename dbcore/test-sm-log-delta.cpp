@@ -0,0 +1,82 @@
+#include "sm-log-delta.h"
+
+#include "w_rand.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static size_t const MAX_DELTA = 64 * 1024;
+
+/* Encode [after] against [before], apply the result to a copy of
+   [before] and check that we get [after] back.
+ */
+static size_t
+roundtrip(std::vector<uint8_t> const &before, std::vector<uint8_t> const &after)
+{
+    static char buf[MAX_DELTA];
+    fat_ptr base = fat_ptr::make(0x1000, 1, fat_ptr::ASI_LOG_FLAG);
+    size_t sz = log_delta::encode(buf, sizeof(buf), base, 1,
+                                  before.data(), after.data(), before.size());
+    if (not sz) {
+        printf("\tOops! %zd-byte value does not fit in %zd bytes of delta\n",
+               before.size(), sizeof(buf));
+        return 0;
+    }
+
+    auto *d = (log_delta *) buf;
+    if (not log_delta::is_delta(buf) or d->size() != sz or d->base != base)
+        printf("\tOops! Malformed delta header\n");
+
+    std::vector<uint8_t> value(before);
+    d->apply(value.data());
+    if (value != after)
+        printf("\tOops! %zd-byte value with %d ranges did not roundtrip\n",
+               before.size(), d->nranges);
+    return sz;
+}
+
+int main() {
+    w_rand rng;
+
+    printf("Verify that unchanged values produce empty deltas...\n");
+    std::vector<uint8_t> before(500), after;
+    for (auto &b : before)
+        b = rng.rand();
+    if (roundtrip(before, before) != sizeof(log_delta))
+        printf("\tOops! Identical values produced ranges\n");
+
+    printf("Verify random field-sized updates roundtrip...\n");
+    for (int i = 0; i < 10000; i++) {
+        before.resize(1 + rng.randn(4000));
+        for (auto &b : before)
+            b = rng.rand();
+        after = before;
+        int nfields = rng.randn(8);
+        for (int f = 0; f < nfields; f++) {
+            size_t off = rng.randn(after.size());
+            size_t len = 1 + rng.randn(16);
+            for (size_t j = off; j < after.size() and j < off + len; j++)
+                after[j] = rng.rand();
+        }
+        roundtrip(before, after);
+    }
+
+    printf("Verify nearby changes are coalesced...\n");
+    before.assign(256, 0);
+    after = before;
+    after[10] = after[12] = after[14] = 1;
+    roundtrip(before, after);
+    static char buf[MAX_DELTA];
+    log_delta::encode(buf, sizeof(buf), NULL_PTR, 1, before.data(), after.data(), before.size());
+    if (((log_delta *) buf)->nranges != 1)
+        printf("\tOops! Expected one range, got %d\n", ((log_delta *) buf)->nranges);
+
+    printf("Verify deltas larger than the limit are rejected...\n");
+    for (auto &b : after)
+        b = 0xff;
+    char small[sizeof(log_delta) + 64];
+    if (log_delta::encode(small, sizeof(small), NULL_PTR, 1,
+                          before.data(), after.data(), before.size()))
+        printf("\tOops! Oversized delta was accepted\n");
+}
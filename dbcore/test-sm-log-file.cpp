@@ -1,9 +1,11 @@
 #include "sm-log-file.h"
+#include "sm-config.h"
 
 #include <string>
 #include <vector>
 #include <unistd.h>
 #include <cerrno>
+#include <cstring>
 
 using namespace RCU;
 
@@ -13,9 +15,18 @@ int main() {
     try {
 
         tmp_dir dname;
+        sysconf::log_dir = *dname;
+        sysconf::log_segment_mb = 1;
+
+        auto count_recycled = [&]() {
+            int n = 0;
+            for (char const *fname : dirent_iterator(dname))
+                n += not strncmp(fname, "rcy-", 4);
+            return n;
+        };
 
         {
-            sm_log_file_mgr lm(dname, 1);
+            sm_log_file_mgr lm;
             
             fprintf(stderr, "Listing contents of newly-created log at %s:\n", *dname);
             for (char const *fname : dirent_iterator(dname)) 
@@ -40,15 +51,15 @@ int main() {
             }
 
             LSN
-                cb = LSN::make(0x6000, 5),
-                ce = LSN::make(0x12000, 6);
+                cb = lm.segments[5]->make_lsn(lm.segments[5]->start_offset + 0x6000),
+                ce = lm.segments[6]->make_lsn(lm.segments[6]->start_offset + 0x12000);
             lm.update_chkpt_mark(cb, ce);
         
             fprintf(stderr, "Listing contents of expanded log:\n");
             for (char const *fname : dirent_iterator(dname)) 
                 fprintf(stderr, "\t%s\n", fname);
 
-            lm.truncate_after(8, 0x30000);
+            lm.truncate_after(8, lm.segments[8]->start_offset + 0x30000);
 
             auto *sid = lm._newest_segment();
             LSN dmark = sid->make_lsn(sid->start_offset+384);
@@ -57,17 +68,23 @@ int main() {
             for (char const *fname : dirent_iterator(dname)) 
                 fprintf(stderr, "\t%s\n", fname);
         
+            // with preallocation, reclaimed segments are kept for reuse
+            sysconf::log_preallocate = 1;
             lm.reclaim_before(3);
+            sysconf::log_preallocate = 0;
             fprintf(stderr, "Contents of log after reclamation:\n");
             for (char const *fname : dirent_iterator(dname)) 
                 fprintf(stderr, "\t%s\n", fname);
+            DIE_IF(not count_recycled(), "Reclaimed segments were not recycled");
         }
         
         {
-            sm_log_file_mgr lm(dname, 1);
+            // ... and deleted when the log is opened without it
+            sm_log_file_mgr lm;
             fprintf(stderr, "Listing contents of existing log at %s:\n", *dname);
             for (char const *fname : dirent_iterator(dname)) 
                 fprintf(stderr, "\t%s\n", fname);
+            DIE_IF(count_recycled(), "Recycled segments left behind");
         }
         
         
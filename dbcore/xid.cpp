@@ -2,6 +2,7 @@
 #include "sm-log.h"
 #include "epoch.h"
 #include "serial.h"
+#include "sm-trace.h"
 #include "../txn.h"
 #include <atomic>
 #include <unistd.h>
@@ -175,6 +176,7 @@ xid_alloc()
                 xid_bitmaps[(e+1) % NBITMAPS].widx = 0;
                 while (not xid_epochs.new_epoch())
                     usleep(1000);
+                trace::instant("xid epoch", e + 1);
                 
             }
             
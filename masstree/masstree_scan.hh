@@ -349,7 +349,7 @@ int basic_table<P>::scan(H helper,
             OID o = entry.value();
             v = oidmgr->oid_get_version(oid_array_, o, xc);
             if (v) {
-                if (!scanner.visit_value(ka, v))
+                if (!scanner.visit_value(ka, o, v))
                     goto done;
             }
             stack[stackpos].ki_ = helper.next(stack[stackpos].ki_);
@@ -141,6 +141,14 @@ class KVConn {
         send();
     }
 
+    // a command without arguments, e.g. a server's own
+    void sendcmd(int cmd, unsigned seq) {
+        j_.resize(2);
+        j_[0] = seq;
+        j_[1] = cmd;
+        send();
+    }
+
     void checkpoint(int childno) {
 	always_assert(childno == 0);
         fprintf(stderr, "asking for a checkpoint\n");
@@ -37,6 +37,7 @@
 
 #include "dbcore/sm-oid.h"
 #include "dbcore/sm-alloc.h"
+#include "dbcore/sm-phase.h"
 
 class simple_threadinfo {
  public:
@@ -270,10 +271,11 @@ public:
     virtual void on_resp_node(const node_opaque_t *n, uint64_t version) = 0;
 
     /**
-     * This key/value pair was read from node n @ version
+     * This key/value pair was read from node n @ version; o is the
+     * key's OID and v its version visible to the scan
      */
-    virtual bool  invoke(const mbtree<masstree_params> *btr_ptr, const string_type &k, dbtuple *v,
-                        const node_opaque_t *n, uint64_t version) = 0;
+    virtual bool  invoke(const mbtree<masstree_params> *btr_ptr, const string_type &k, OID o,
+                        dbtuple *v, const node_opaque_t *n, uint64_t version) = 0;
   };
 
   /**
@@ -573,6 +575,7 @@ template <typename P>
 inline bool mbtree<P>::search(const key_type &k, OID &o, dbtuple* &v, xid_context *xc,
                               versioned_node_t *search_info) const
 {
+  phase::timer pt(phase::INDEX);
   threadinfo ti(xc->begin_epoch);
   Masstree::unlocked_tcursor<P> lp(table_, k.data(), k.length());
   bool found = lp.find_unlocked(ti);
@@ -711,14 +714,14 @@ class mbtree<P>::low_level_search_range_scanner
     if (this->boundary_)
       this->check(iter, key);
   }
-  bool visit_value(const Masstree::key<uint64_t>& key, dbtuple * value) {
+  bool visit_value(const Masstree::key<uint64_t>& key, OID o, dbtuple * value) {
     if (this->boundary_compar_) {
       lcdf::Str bs(this->boundary_->data(), this->boundary_->size());
       if ((!Reverse && bs <= key.full_string()) ||
           ( Reverse && bs >= key.full_string()))
         return false;
     }
-    return callback_.invoke(this->btr_ptr_, key.full_string(), value, this->n_, this->v_);
+    return callback_.invoke(this->btr_ptr_, key.full_string(), o, value, this->n_, this->v_);
   }
  private:
   Masstree::leaf<P>* n_;
@@ -737,7 +740,7 @@ public:
   void on_resp_node(const node_opaque_t *n, uint64_t version) override {}
 
   bool
-  invoke(const string_type &k, OID o, dbtuple * v,
+  invoke(const mbtree<P> *btr_ptr, const string_type &k, OID o, dbtuple * v,
          const node_opaque_t *n, uint64_t version) override
   {
     return callback_(k, o, v);
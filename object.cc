@@ -1,5 +1,6 @@
 #include "object.h"
 #include "tuple.h"
+#include "dbcore/sm-log-delta.h"
 #include "dbcore/sm-log-recover.h"
 #include "dbcore/sm-log.h"
 fat_ptr
@@ -30,6 +31,79 @@ object::create_tuple_object(const varstr *tuple_value, bool do_write, epoch_num
     return fat_ptr::make(obj, aligned_sz);
 }
 
+// Load the payload at [ptr], through the recovery manager if we are
+// still recovering and through the log manager otherwise
+static void
+load_payload(char *buf, size_t bufsz, fat_ptr ptr, sm_log_recover_mgr *lm)
+{
+    if (lm)
+        lm->load_object(buf, bufsz, ptr);
+    else {
+        ASSERT(logmgr);
+        logmgr->load_object(buf, bufsz, ptr);
+    }
+}
+
+// Fill [value] with the image [delta] was taken against. Use the older
+// version [nxt] if it is that image and in memory; otherwise dig it out
+// of the log, rebuilding it from the nearest full image if need be.
+static void
+load_delta_base(uint8_t *value, const log_delta *delta, fat_ptr nxt, sm_log_recover_mgr *lm)
+{
+    if (nxt.asi_type() == 0 and nxt.offset()) {
+        object *base = (object *)nxt.offset();
+        if (base->_pdest.offset() == delta->base.offset()) {
+            ASSERT(base->tuple()->size == delta->value_size);
+            memcpy(value, base->tuple()->get_value_start(), delta->value_size);
+            return;
+        }
+    }
+
+    ASSERT(delta->base.asi_type() == fat_ptr::ASI_LOG);
+    size_t sz = decode_size_aligned(delta->base.size_code());
+    char *buf = (char *)malloc(sz);
+    DEFER(free(buf));
+    load_payload(buf, sz, delta->base, lm);
+    if (log_delta::is_delta(buf)) {
+        auto *base_delta = (log_delta *)buf;
+        ASSERT(base_delta->depth + 1 == delta->depth);
+        load_delta_base(value, base_delta, NULL_PTR, lm);
+        base_delta->apply(value);
+    }
+    else {
+        ASSERT(((varstr *)buf)->size() == delta->value_size);
+        memcpy(value, buf + sizeof(varstr), delta->value_size);
+    }
+}
+
+void
+object::load_delta_value(uint8_t *value, const log_delta *delta, sm_log_recover_mgr *lm)
+{
+    load_delta_base(value, delta, NULL_PTR, lm);
+    delta->apply(value);
+}
+
+// Rebuild the version a LOG_UPDATE_DELTA payload describes: [delta] is
+// the payload already loaded from log location [ptr], the rest comes
+// from the image the delta was taken against.
+fat_ptr
+object::create_tuple_object(const log_delta *delta, fat_ptr ptr, fat_ptr nxt,
+                            epoch_num epoch, sm_log_recover_mgr *lm)
+{
+    ASSERT(ptr.asi_type() == fat_ptr::ASI_LOG);
+    auto sz = sizeof(object) + sizeof(dbtuple) + delta->value_size;
+    object *obj = new (MM::allocate(sz, 0)) object(ptr, nxt, epoch);
+
+    dbtuple *tuple = obj->tuple();
+    new (tuple) dbtuple(delta->value_size);
+    tuple->delta_depth = delta->depth;
+    load_delta_base(tuple->get_value_start(), delta, nxt, lm);
+    delta->apply(tuple->get_value_start());
+
+    obj->_clsn = ptr;
+    return fat_ptr::make(obj, encode_size_aligned(sz));
+}
+
 // Dig out a tuple from the durable log
 // ptr should point to some position in the log
 // Returns a fat_ptr to the object created
@@ -44,11 +118,13 @@ object::create_tuple_object(fat_ptr ptr, fat_ptr nxt, epoch_num epoch, sm_log_re
     // Load tuple varstr from the log
     dbtuple* tuple = obj->tuple();
     new (tuple) dbtuple(sz);
-    if (lm)
-        lm->load_object((char *)tuple->get_value_start(), sz, ptr);
-    else {
-        ASSERT(logmgr);
-        logmgr->load_object((char *)tuple->get_value_start(), sz, ptr);
+    load_payload((char *)tuple->get_value_start(), sz, ptr, lm);
+
+    if (log_delta::is_delta(tuple->get_value_start())) {
+        fat_ptr vptr = create_tuple_object(
+          (log_delta *)tuple->get_value_start(), ptr, nxt, epoch, lm);
+        MM::deallocate(fat_ptr::make(obj, encode_size_aligned(sz)));
+        return vptr;
     }
 
     // Strip out the varstr stuff
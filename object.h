@@ -4,6 +4,7 @@
 #include "dbcore/sm-common.h"
 
 class dbtuple;
+struct log_delta;
 struct sm_log_recover_mgr;
 
 // An object wraps a tuple with its physical location in storage (the log)
@@ -31,5 +32,11 @@ class object
       fat_ptr ptr, fat_ptr nxt, epoch_num epoch, sm_log_recover_mgr *lm = NULL);
     static fat_ptr create_tuple_object(
       const varstr *tuple_value, bool do_write, epoch_num epoch);
+    static fat_ptr create_tuple_object(
+      const log_delta *delta, fat_ptr ptr, fat_ptr nxt, epoch_num epoch, sm_log_recover_mgr *lm = NULL);
+    // Fill [value] with the full image [delta] describes, digging the
+    // image it was taken against out of the log
+    static void load_delta_value(
+      uint8_t *value, const log_delta *delta, sm_log_recover_mgr *lm = NULL);
 };
 
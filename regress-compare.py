@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+# Compare the --results-json files regress.sh collected for two builds.
+#
+# Expects <results>/<scheme>/<benchmark>/{base,cand}/<rep>.json. Each
+# repetition's throughput is recomputed from its per-second series with
+# the first --warmup seconds dropped; the two builds are then compared
+# with Welch's t-test on throughput and on average commit latency.
+# p99 latencies are power-of-two bucket bounds (see pow2_histogram in
+# dbcore/sm-histogram.h), so only their medians are shown.
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+
+
+def betacf(a, b, x):
+    # continued fraction for the incomplete beta function (Lentz)
+    tiny = 1e-300
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def betai(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    lbeta = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+    front = math.exp(lbeta + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1.0 - x) / b
+
+
+def mean(xs):
+    return sum(xs) / len(xs)
+
+
+def stdev(xs):
+    if len(xs) < 2:
+        return 0.0
+    m = mean(xs)
+    return math.sqrt(sum((x - m) ** 2 for x in xs) / (len(xs) - 1))
+
+
+def median(xs):
+    s = sorted(xs)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2.0
+
+
+def welch(a, b):
+    """Two-sided p-value for the means of a and b being equal."""
+    if len(a) < 2 or len(b) < 2:
+        return float('nan')
+    va, vb = stdev(a) ** 2 / len(a), stdev(b) ** 2 / len(b)
+    if va + vb == 0:
+        return 0.0 if mean(a) != mean(b) else 1.0
+    t = (mean(a) - mean(b)) / math.sqrt(va + vb)
+    df = (va + vb) ** 2 / (va ** 2 / (len(a) - 1) + vb ** 2 / (len(b) - 1))
+    return betai(df / 2.0, 0.5, df / (df + t * t))
+
+
+def load(path, warmup):
+    with open(path) as f:
+        r = json.load(f)
+    series = [s for s in r.get('series', []) if s['sec'] > warmup]
+    # an ops-mode run stops part way through its last second
+    if r['config'].get('run_mode') == 'ops':
+        series = series[:-1]
+    if series:
+        tput = sum(s['commits'] for s in series) / float(len(series))
+    else:
+        tput = r['throughput']
+    return tput, r['latency_us']['avg'], r['latency_us']['p99']
+
+
+def collect(results, warmup):
+    runs = {}
+    for path in sorted(glob.glob(os.path.join(results, '*', '*', '*', '*.json'))):
+        rest, _ = os.path.split(path)
+        rest, side = os.path.split(rest)
+        rest, bench = os.path.split(rest)
+        _, scheme = os.path.split(rest)
+        try:
+            sample = load(path, warmup)
+        except (ValueError, KeyError) as e:
+            print('skipping %s: %s' % (path, e), file=sys.stderr)
+            continue
+        runs.setdefault((scheme, bench), {}).setdefault(side, []).append(sample)
+    return runs
+
+
+def verdict(delta, p, alpha, higher_is_better):
+    if math.isnan(p) or p >= alpha:
+        return 'same'
+    return 'better' if (delta > 0) == higher_is_better else 'WORSE'
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument('results', help='results directory written by regress.sh')
+    ap.add_argument('--warmup', type=int, default=5,
+                    help='seconds dropped from the start of every run')
+    ap.add_argument('--alpha', type=float, default=0.05,
+                    help='significance level')
+    ap.add_argument('--fail-on', type=float, default=None, metavar='PCT',
+                    help='exit 1 if any throughput drops significantly by more than PCT%%')
+    args = ap.parse_args()
+
+    runs = collect(args.results, args.warmup)
+    if not runs:
+        print('no results under %s' % args.results, file=sys.stderr)
+        return 1
+
+    fmt = '%-8s %-11s %3s %12s %12s %8s %7s %-6s %9s %9s %8s %7s %-6s %7s %7s'
+    print(fmt % ('scheme', 'bench', 'n', 'base tps', 'cand tps', 'delta', 'p', '',
+                 'base us', 'cand us', 'delta', 'p', '', 'p99 b', 'p99 c'))
+    failed = False
+    for (scheme, bench), sides in sorted(runs.items()):
+        base, cand = sides.get('base', []), sides.get('cand', [])
+        if not base or not cand:
+            print('%-8s %-11s missing %s results' % (scheme, bench, 'base' if not base else 'cand'))
+            continue
+        bt, ct = [r[0] for r in base], [r[0] for r in cand]
+        bl, cl = [r[1] for r in base], [r[1] for r in cand]
+        dt = (mean(ct) - mean(bt)) / mean(bt) * 100 if mean(bt) else 0.0
+        dl = (mean(cl) - mean(bl)) / mean(bl) * 100 if mean(bl) else 0.0
+        pt, pl = welch(bt, ct), welch(bl, cl)
+        vt = verdict(dt, pt, args.alpha, True)
+        print(fmt % (scheme, bench, '%d/%d' % (len(base), len(cand)) if len(base) != len(cand) else len(base),
+                     '%.0f' % mean(bt), '%.0f' % mean(ct), '%+.1f%%' % dt, '%.3f' % pt, vt,
+                     '%.2f' % mean(bl), '%.2f' % mean(cl), '%+.1f%%' % dl, '%.3f' % pl,
+                     verdict(dl, pl, args.alpha, False),
+                     '%d' % median([r[2] for r in base]), '%d' % median([r[2] for r in cand])))
+        if args.fail_on is not None and vt == 'WORSE' and -dt > args.fail_on:
+            failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
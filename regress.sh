@@ -0,0 +1,142 @@
+#!/bin/bash
+# Compare the performance of two builds on a fixed benchmark matrix.
+#
+# $1 - baseline: a git revision, or an out-perf.* directory already built
+# $2 - candidate: same
+# $3 - repetitions per benchmark (default 5)
+# $4 - runtime per repetition in seconds (default 20)
+# $5 - worker threads (default: all cores)
+#
+# Environment:
+#   SCHEMES   CC schemes to build revisions with (default "SI SSI SI_SSN");
+#             a prebuilt out-perf.* directory is run once, as "as-built",
+#             so give either two revisions or two directories
+#   BENCHES   subset of the matrix (default: all of it, see below)
+#   WARMUP    seconds trimmed from the start of every run (default 5)
+#   WORKDIR   where builds and results go (default /tmp/ermia-regress)
+#   LOGDIR    log directory; the log goes to the null device unless
+#             TMPFS_LOG=1, in which case LOGDIR should be on tmpfs
+#   NODE_MEMORY_GB  --node-memory-gb for every run (default 8)
+#   YCSB_OPS  length of each YCSB worker's trace (default 10000000)
+#
+# Repetitions of the two builds are interleaved so drift on the box hits
+# both alike. regress-compare.py does the statistics afterwards and can
+# be rerun on $WORKDIR/results alone.
+
+if [[ $# -lt 2 ]]; then
+    echo "Usage $0 <baseline rev|out-dir> <candidate rev|out-dir> [reps] [runtime] [threads]"
+    exit 1
+fi
+
+base=$1
+cand=$2
+reps=${3:-5}
+runtime=${4:-20}
+threads=${5:-`nproc`}
+schemes=${SCHEMES:-"SI SSI SI_SSN"}
+benches=${BENCHES:-"ycsb_a ycsb_b ycsb_c ycsb_f tpcc_1 tpcc_n tpce_small"}
+warmup=${WARMUP:-5}
+workdir=${WORKDIR:-/tmp/ermia-regress}
+logdir=${LOGDIR:-/dev/shm/$USER/ermia-regress-log}
+node_memory_gb=${NODE_MEMORY_GB:-8}
+ycsb_ops=${YCSB_OPS:-10000000}
+top=$(cd "$(dirname "$0")" && pwd)
+
+if [[ $runtime -le $warmup ]]; then
+    echo "Runtime ($runtime s) must be longer than the warm-up ($warmup s)."
+    exit 1
+fi
+
+rm -rf $workdir/bin $workdir/results
+mkdir -p $workdir/bin $workdir/results $logdir
+trap "rm -rf $logdir/*" EXIT
+
+# $1 - side (base or cand), $2 - revision or out-perf.* dir
+# Leaves $workdir/bin/<side>-<scheme>/dbtest and src (for TPC-E's flat files)
+build() {
+    side=$1
+    what=$2
+    if [[ -d $what ]]; then
+        mkdir -p $workdir/bin/$side-as-built
+        cp $what/benchmarks/dbtest $workdir/bin/$side-as-built/dbtest || exit 1
+        ln -sfn $top $workdir/bin/$side-as-built/src
+        return
+    fi
+    src=$workdir/src-$side
+    rm -rf $src
+    git -C $top worktree prune
+    git -C $top worktree add --detach $src $what > /dev/null || exit 1
+    for scheme in $schemes; do
+        echo Build: $side $what $scheme
+        flags=""
+        if [[ $scheme != "SI" ]]; then
+            flags="$scheme=1"
+        fi
+        (cd $src && make clean &> /dev/null &&
+         env MODE=perf DEBUG=0 NDEBUG=1 $flags make -j dbtest &> $workdir/build-$side-$scheme.log) || {
+            echo "Build failed, see $workdir/build-$side-$scheme.log"
+            exit 1
+        }
+        mkdir -p $workdir/bin/$side-$scheme
+        cp $src/out-perf.masstree/benchmarks/dbtest $workdir/bin/$side-$scheme/dbtest
+        ln -sfn $src $workdir/bin/$side-$scheme/src
+    done
+}
+
+# $1 - benchmark name in the matrix; prints its dbtest arguments
+bench_args() {
+    case $1 in
+        # YCSB replays a pre-generated trace of --ops-per-worker operations
+        # per worker; max-runtime cuts it short if it's long enough
+        ycsb_*)  echo "--bench ycsb --scale-factor 1 --ops-per-worker $ycsb_ops --max-runtime $runtime" ;;
+        tpcc_1)  echo "--bench tpcc --scale-factor 1 --runtime $runtime" ;;
+        tpcc_n)  echo "--bench tpcc --scale-factor $threads --runtime $runtime" ;;
+        tpce_*)  echo "--bench tpce --scale-factor 500 --runtime $runtime" ;;
+        *)
+            echo "Unknown benchmark $1" >&2
+            exit 1 ;;
+    esac
+}
+
+# $1 - benchmark name in the matrix; prints its --bench-opts
+bench_opts() {
+    case $1 in
+        ycsb_*)
+            w=${1: -1}
+            echo "--workload ${w^^}" ;;
+        tpce_small)
+            echo "--egen-dir ./benchmarks/egen/flat/egen_flat_in --customer 1000 --working-days 1" ;;
+    esac
+}
+
+build base $base
+build cand $cand
+
+log_opts="--null-log-device"
+if [[ "$TMPFS_LOG" == "1" ]]; then
+    log_opts=""
+fi
+
+for b in $benches; do
+    args=`bench_args $b` || exit 1
+    opts=`bench_opts $b`
+    for rep in `seq 1 $reps`; do
+        for bin in $workdir/bin/*; do
+            build_name=`basename $bin`
+            side=${build_name%%-*}
+            scheme=${build_name#*-}
+            out=$workdir/results/$scheme/$b/$side
+            mkdir -p $out
+            rm -rf $logdir/*
+            echo "Run: $b $scheme $side rep $rep"
+            # TPC-E finds its flat files relative to the source tree
+            (cd $bin/src && $bin/dbtest $log_opts --num-threads $threads \
+                --log-dir $logdir --log-buffer-mb=512 --log-segment-mb=8192 \
+                --node-memory-gb=$node_memory_gb --tmpfs-dir /dev/shm/ \
+                --results-json $out/$rep.json $args -o "$opts") &> $out/$rep.log ||
+                echo "  failed, see $out/$rep.log"
+        done
+    done
+done
+
+python3 $top/regress-compare.py --warmup $warmup $workdir/results
@@ -20,6 +20,12 @@ public:
 	  reset();
   }
 
+  // dynarray only commits what's used, so deferring buys nothing here
+  enum deferred_t { deferred };
+  str_arena(deferred_t) : str_arena() {}
+  void attach() { reset(); }
+  void detach() {}
+
   // non-copyable/non-movable for the time being
   str_arena(str_arena &&) = delete;
   str_arena(const str_arena &) = delete;
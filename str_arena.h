@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "small_vector.h"
 #include "varstr.h"
 #include "dbcore/sm-common.h"
@@ -15,14 +17,49 @@ public:
 
   static const uint64_t ReserveBytes = 128 * 1024 * 1024;
   static const size_t MinStrReserveLength = 2 * CACHELINE_SIZE;
-  str_arena() : n(0)
+  str_arena() : str(nullptr), n(0)
   {
-    // adler32 (log checksum) needs it aligned
-    ALWAYS_ASSERT(not posix_memalign((void **)&str, DEFAULT_ALIGNMENT, ReserveBytes));
-    memset(str, '\0', ReserveBytes);
+    attach();
+  }
+
+  // A deferred arena holds no memory until attach(); loaders use it so only
+  // the ones actually running pin a buffer.
+  enum deferred_t { deferred };
+  str_arena(deferred_t) : str(nullptr), n(0) {}
+
+  ~str_arena()
+  {
+    detach();
+  }
+
+  // Take a buffer, preferably one a detached arena gave back (already
+  // faulted in, so no need to clear it again).
+  void
+  attach()
+  {
+    ASSERT(not str);
+    std::lock_guard<std::mutex> guard(free_lock());
+    if (free_list().size()) {
+      str = free_list().back();
+      free_list().pop_back();
+    } else {
+      // adler32 (log checksum) needs it aligned
+      ALWAYS_ASSERT(not posix_memalign((void **)&str, DEFAULT_ALIGNMENT, ReserveBytes));
+      memset(str, '\0', ReserveBytes);
+    }
     reset();
   }
 
+  void
+  detach()
+  {
+    if (str) {
+      std::lock_guard<std::mutex> guard(free_lock());
+      free_list().push_back(str);
+      str = nullptr;
+    }
+  }
+
   // non-copyable/non-movable for the time being
   str_arena(str_arena &&) = delete;
   str_arena(const str_arena &) = delete;
@@ -59,6 +96,18 @@ public:
   }
 
 private:
+  static std::vector<char *> &free_list()
+  {
+    static std::vector<char *> buffers;
+    return buffers;
+  }
+
+  static std::mutex &free_lock()
+  {
+    static std::mutex lock;
+    return lock;
+  }
+
   char *str;
   size_t n;
 };
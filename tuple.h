@@ -51,6 +51,7 @@ public:
                 // and must abort.
 #endif
   size_type size; // actual size of record
+  uint16_t delta_depth; // deltas between this version's log image and the nearest full one
   varstr *pvalue;    // points to the value that will be put into value_start if committed
                      // so that read-my-own-update can copy from here.
   uint8_t value_start[0];   // must be last field
@@ -66,6 +67,7 @@ public:
       s2(0),
 #endif
       size(CheckBounds(size)),
+      delta_depth(0),
       pvalue(NULL)
   {
   }
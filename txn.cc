@@ -3,6 +3,9 @@
 #include "txn.h"
 #include "lockguard.h"
 #include "dbcore/serial.h"
+#include "dbcore/sm-log-ship.h"
+#include "dbcore/sm-phase.h"
+#include "dbcore/sm-trace.h"
 
 #include <atomic>
 #include <algorithm>
@@ -21,9 +24,11 @@ static __thread transaction::write_set_t* tls_write_set;
 #if defined(SSN) || defined(SSI)
 static __thread transaction::read_set_t* tls_read_set;
 #endif
+static __thread transaction::undo_set_t* tls_undo_set;
+static __thread transaction::savepoint_set_t* tls_savepoints;
 
-transaction::transaction(uint64_t flags, str_arena &sa)
-  : flags(flags), sa(&sa)
+transaction::transaction(uint64_t flags, str_arena &sa, uint64_t as_of)
+  : flags(as_of ? flags | TXN_FLAG_AS_OF | TXN_FLAG_READ_ONLY : flags), sa(&sa)
 {
 #ifdef BTREE_LOCK_OWNERSHIP_CHECKING
     concurrent_btree::NodeLockRegionBegin();
@@ -46,7 +51,16 @@ transaction::transaction(uint64_t flags, str_arena &sa)
     read_set = tls_read_set;
     read_set->clear();
 #endif
+    if (unlikely(not tls_undo_set)) {
+        tls_undo_set = new undo_set_t;
+        tls_savepoints = new savepoint_set_t;
+    }
+    undo_set = tls_undo_set;
+    undo_set->clear();
+    savepoints = tls_savepoints;
+    savepoints->clear();
     updated_oids_head = updated_oids_tail = NULL_PTR;
+    nupdated_oids = 0;
     xid = TXN::xid_alloc();
     xc = xid_get_context(xid);
     xc->begin_epoch = MM::epoch_enter();
@@ -61,10 +75,14 @@ transaction::transaction(uint64_t flags, str_arena &sa)
     // (ie the safesnap is T1, updater is T2). So for SSI updaters also needs
     // to take a look at the safesnap lsn.
 
-    // Take a safe snapshot if read-only.
-    if (sysconf::enable_safesnap and (flags & TXN_FLAG_READ_ONLY)) {
-        ASSERT(MM::safesnap_lsn);
-        xc->begin = volatile_read(MM::safesnap_lsn);
+    // Take a safe snapshot if read-only, or the one asked for.
+    if (on_snapshot()) {
+        if (as_of)
+            begin_as_of(as_of);
+        else {
+            ASSERT(MM::safesnap_lsn);
+            xc->begin = volatile_read(MM::safesnap_lsn);
+        }
         log = NULL;
     }
     else {
@@ -78,7 +96,7 @@ transaction::transaction(uint64_t flags, str_arena &sa)
         // progress when retrying an aborted transaction: everyone is trying
         // to update the same tuple with latest version stamped at cur_lsn()
         // but no one can succeed (because version.clsn == cur_lsn == t.begin).
-        xc->begin = logmgr->cur_lsn().offset() + 1;
+        xc->begin = begin_lsn_offset();
 #ifdef SSN
         xc->pstamp = volatile_read(MM::safesnap_lsn);
 #elif defined(SSI)
@@ -86,31 +104,73 @@ transaction::transaction(uint64_t flags, str_arena &sa)
 #endif
     }
 #else
+    if (as_of) {
+        begin_as_of(as_of);
+        log = NULL;
+    }
+    else {
+        RCU::rcu_enter();
+        log = logmgr->new_tx_log();
+        xc->begin = begin_lsn_offset();
+    }
+#endif
+    trace::begin("txn", xc->begin);
+}
+
+/* The pin keeps the GC daemon off the versions the snapshot reads; the
+   transaction stays aborted if there is nothing left to pin
+ */
+void
+transaction::begin_as_of(uint64_t as_of)
+{
+    // Unlike a safesnap reader, which shares its thread with writers, an
+    // analytics thread may run nothing else: it has to pass through RCU
     RCU::rcu_enter();
-    log = logmgr->new_tx_log();
-    xc->begin = logmgr->cur_lsn().offset() + 1;
+    xc->begin = as_of;
+#if defined(RC) || defined(RC_SPIN)
+    volatile_write(xc->state, TXN_ABRTD);
+#else
+    if (as_of > begin_lsn_offset() or not MM::snapshot_pin(as_of))
+        volatile_write(xc->state, TXN_ABRTD);
 #endif
 }
 
+uint64_t
+transaction::begin_lsn_offset()
+{
+    // A standby's replay thread installs versions up to the end of the
+    // last replayed batch; anything past it may be half-way replayed.
+    if (sm_log_is_standby())
+        return log_standby->replayed_lsn().offset();
+    return logmgr->cur_lsn().offset() + 1;
+}
+
 transaction::~transaction()
 {
     // transaction shouldn't fall out of scope w/o resolution
     // resolution means TXN_CMMTD, and TXN_ABRTD
     ASSERT(state() != TXN_ACTIVE && state() != TXN_COMMITTING);
-#if defined(SSN) || defined(SSI)
-    if (not sysconf::enable_safesnap or (not (flags & TXN_FLAG_READ_ONLY)))
+    trace::end(state() == TXN_CMMTD ? "commit" : "abort", xc->end);
+    if (flags & TXN_FLAG_AS_OF or not on_snapshot())
         RCU::rcu_exit();
-#else
-    RCU::rcu_exit();
-#endif
 #ifdef BTREE_LOCK_OWNERSHIP_CHECKING
     concurrent_btree::AssertAllNodeLocksReleased();
 #endif
 #if defined(SSN) || defined(SSI)
-    if (not sysconf::enable_safesnap or (not (flags & TXN_FLAG_READ_ONLY)))
+    if (not on_snapshot())
         serial_deregister_tx(xid);
 #endif
-    if (sysconf::enable_safesnap and flags & TXN_FLAG_READ_ONLY)
+    if (flags & TXN_FLAG_AS_OF) {
+        MM::snapshot_unpin();
+        // No log block to release, but the log writer only flushes up to
+        // each thread's last one: move ours along like an empty commit
+        if (logmgr->get_tls_lsn_offset())
+            logmgr->set_tls_lsn_offset(logmgr->cur_lsn().offset());
+    }
+    // versions kept for savepoints are garbage either way now
+    for (auto &u : *undo_set)
+        MM::deallocate(u.old_object);
+    if (flags & TXN_FLAG_AS_OF or (sysconf::enable_safesnap and flags & TXN_FLAG_READ_ONLY))
         MM::epoch_exit(0, xc->begin_epoch);
     else
         MM::epoch_exit(xc->end, xc->begin_epoch);
@@ -158,11 +218,95 @@ transaction::abort_impl()
         MM::deallocate(w.new_object);
     }
 
-    // Read-only tx on a safesnap won't have log
+    // Read-only tx on a safesnap or AS OF won't have log
     if (log)
         log->discard();
 }
 
+size_t
+transaction::set_savepoint()
+{
+    savepoint_t sp;
+    sp.nwrites = write_set->size();
+    sp.nundo = undo_set->size();
+    if (log)
+        sp.log = log->get_savepoint();
+    savepoints->push_back(sp);
+    return savepoints->size() - 1;
+}
+
+bool
+transaction::rollback_to(size_t savepoint)
+{
+    ASSERT(savepoint < savepoints->size());
+    ASSERT(state() == TXN_ACTIVE);
+    savepoint_t &sp = (*savepoints)[savepoint];
+#ifdef SSN
+    // Reads since the savepoint stay in the stamps too: if they already
+    // close the exclusion window, going on can't end in a commit
+    if (not TXN::ssn_check_exclusion(xc))
+        return false;
+#endif
+    if (log and not log->rollback_to(sp.log))
+        return false;
+
+    // Newest first, as abort_impl() does. Overwritten versions are out
+    // of their chains already (defunct); the rest are chain heads.
+#if defined(SSI) || defined(SSN)
+    std::vector<write_record_t> overwritten;  // committed versions to release
+#endif
+    for (uint32_t i = write_set->size(); i-- > sp.nwrites; ) {
+        auto &w = (*write_set)[i];
+        dbtuple *tuple = w.get_object()->tuple();
+        ASSERT(XID::from_ptr(tuple->get_object()->_clsn) == xid);
+        if (tuple->is_defunct())
+            continue;
+#if defined(SSI) || defined(SSN)
+        if (tuple->next())
+            overwritten.emplace_back(tuple->get_object()->_next, w.oa, w.oid);
+#endif
+        oidmgr->oid_unlink(w.oa, w.oid, tuple);
+        volatile_write(w.get_object()->_clsn, NULL_PTR);
+        MM::deallocate(w.new_object);
+    }
+
+    // Put back the versions written before the savepoint that later
+    // updates replaced; they have the same successors as their chains'
+    // heads had
+    for (uint32_t i = undo_set->size(); i-- > sp.nundo; ) {
+        auto &u = (*undo_set)[i];
+        if (u.write_index >= sp.nwrites) {
+            MM::deallocate(u.old_object);
+            continue;
+        }
+        dbtuple *tuple = ((object *)u.old_object.offset())->tuple();
+        ASSERT(tuple->is_defunct());
+        volatile_write(tuple->pvalue, u.pvalue);
+        fat_ptr *head = u.oa->get(u.oid);
+        ASSERT(*head == ((object *)u.old_object.offset())->_next);
+        volatile_write(head->_ptr, u.old_object._ptr);
+    }
+    __sync_synchronize();
+
+#if defined(SSI) || defined(SSN)
+    // As abort_impl() does, unless a restored version still overwrites it
+    for (auto &o : overwritten) {
+        if (*o.oa->get(o.oid) != o.new_object)
+            continue;
+        dbtuple *prev = o.get_object()->tuple();
+        volatile_write(prev->sstamp, NULL_PTR);
+#ifdef SSN
+        prev->welcome_read_mostly_tx();
+#endif
+    }
+#endif
+
+    write_set->resize(sp.nwrites);
+    undo_set->erase(undo_set->begin() + sp.nundo, undo_set->end());
+    savepoints->resize(savepoint + 1);
+    return true;
+}
+
 namespace {
 inline const char *
 transaction_state_to_cstr(txn_state state)
@@ -210,33 +354,72 @@ transaction::commit()
 {
     ALWAYS_ASSERT(state() == TXN_ACTIVE);
     volatile_write(xc->state, TXN_COMMITTING);
-#if defined(SSN) || defined(SSI)
+    if (sysconf::bulk_loading())
+        return bulk_commit();
     // Safe snapshot optimization for read-only transactions:
     // Use the begin ts as cstamp if it's a read-only transaction
-    // This is the same for both SSN and SSI.
-    if (sysconf::enable_safesnap and (flags & TXN_FLAG_READ_ONLY)) {
+    // This is the same for both SSN and SSI, and for AS OF readers.
+    if (on_snapshot()) {
         ASSERT(not log);
         ASSERT(write_set->size() == 0);
         xc->end = xc->begin;
         volatile_write(xc->state, TXN_CMMTD);
         return {RC_TRUE};
     }
-    else {
-        ASSERT(log);
-        xc->end = log->pre_commit().offset();
-        if (xc->end == 0)
-            return rc_t{RC_ABORT_INTERNAL};
+#if defined(SSN) || defined(SSI)
+    ASSERT(log);
+    xc->end = log->pre_commit().offset();
+    if (xc->end == 0)
+        return rc_t{RC_ABORT_INTERNAL};
 #ifdef SSN
-        return parallel_ssn_commit();
+    return parallel_ssn_commit();
 #elif defined SSI
-        return parallel_ssi_commit();
+    return parallel_ssi_commit();
 #endif
-    }
 #else
+    // Standby transactions are read-only and must not touch the log,
+    // which mirrors the primary's byte for byte.
+    if (sm_log_is_standby()) {
+        ASSERT(write_set->size() == 0);
+        xc->end = xc->begin;
+        log->discard();
+        log = nullptr;
+        volatile_write(xc->state, TXN_CMMTD);
+        return rc_t{RC_TRUE};
+    }
     return si_commit();
 #endif
 }
 
+/* Bulk loads write nothing to the log, so there is no commit block to
+   stamp versions with. Nothing else advances the log while loading, so
+   the current LSN is below every later transaction's begin stamp.
+ */
+rc_t
+transaction::bulk_commit()
+{
+    if (log) {
+        log->discard();
+        log = nullptr;
+    }
+    xc->end = logmgr->cur_lsn().offset();
+    fat_ptr clsn_ptr = LSN::make(xc->end, 0).to_log_ptr();
+    for (uint32_t i = 0; i < write_set->size(); ++i) {
+        auto &w = (*write_set)[i];
+        dbtuple* tuple = w.get_object()->tuple();
+        if (tuple->is_defunct())
+            continue;
+        tuple->do_write();
+        tuple->get_object()->_clsn = clsn_ptr;
+    }
+#if defined(SSN) || defined(SSI)
+    for (uint32_t i = 0; i < read_set->size(); ++i)
+        serial_deregister_reader_tx(&(*read_set)[i]->readers_bitmap);
+#endif
+    volatile_write(xc->state, TXN_CMMTD);
+    return rc_t{RC_TRUE};
+}
+
 #if defined(SSN) || defined(SSI)
 #define set_tuple_xstamp(tuple, s)    \
 {   \
@@ -253,6 +436,7 @@ rc_t
 transaction::parallel_ssn_commit()
 {
     auto cstamp = xc->end;
+    phase::timer validate(phase::VALIDATE);
 
     // note that sstamp comes from reads, but the read optimization might
     // ignore looking at tuple's sstamp at all, so if tx sstamp is still
@@ -558,7 +742,9 @@ transaction::parallel_ssn_commit()
 #endif
 
     // ok, can really commit if we reach here
+    validate.stop();
     log->commit(NULL);
+    phase::timer postcommit(phase::POSTCOMMIT);
 
     // Do this before setting TXN_CMMTD state so that it'll be stable
     // no matter the guy spinning on me noticed a context change or
@@ -660,7 +846,7 @@ transaction::parallel_ssn_commit()
     if (updated_oids_head != NULL_PTR) {
         ASSERT(sysconf::enable_gc);
         ASSERT(updated_oids_tail != NULL_PTR);
-        MM::recycle(updated_oids_head, updated_oids_tail);
+        MM::recycle(updated_oids_head, updated_oids_tail, nupdated_oids);
     }
 
     return rc_t{RC_TRUE};
@@ -728,6 +914,7 @@ transaction::parallel_ssi_commit()
     //  v.xstamp.
 
     auto cstamp = xc->end;
+    phase::timer validate(phase::VALIDATE);
 
     // get the smallest s1 in each tuple we have read (ie, the smallest cstamp
     // of T3 in the dangerous structure that clobbered our read)
@@ -937,7 +1124,9 @@ transaction::parallel_ssi_commit()
 #endif
 
     // survived!
+    validate.stop();
     log->commit(NULL);
+    phase::timer postcommit(phase::POSTCOMMIT);
 
     fat_ptr clsn_ptr = LSN::make(cstamp, 0).to_log_ptr();
     // stamp overwritten versions, stuff clsn
@@ -1023,7 +1212,7 @@ transaction::parallel_ssi_commit()
     if (updated_oids_head != NULL_PTR) {
         ASSERT(sysconf::enable_gc);
         ASSERT(updated_oids_tail != NULL_PTR);
-        MM::recycle(updated_oids_head, updated_oids_tail);
+        MM::recycle(updated_oids_head, updated_oids_tail, nupdated_oids);
     }
 
     return rc_t{RC_TRUE};
@@ -1039,11 +1228,15 @@ transaction::si_commit()
         return rc_t{RC_ABORT_INTERNAL};
 
 #ifdef PHANTOM_PROT
-    if (not check_phantom())
-        return rc_t{RC_ABORT_PHANTOM};
+    {
+        phase::timer pt(phase::VALIDATE);
+        if (not check_phantom())
+            return rc_t{RC_ABORT_PHANTOM};
+    }
 #endif
 
     log->commit(NULL);    // will populate log block
+    phase::timer postcommit(phase::POSTCOMMIT);
 
     // post-commit cleanup: install clsn to tuples
     // (traverse write-tuple)
@@ -1079,7 +1272,7 @@ transaction::si_commit()
     if (updated_oids_head != NULL_PTR) {
         ASSERT(sysconf::enable_gc);
         ASSERT(updated_oids_tail != NULL_PTR);
-        MM::recycle(updated_oids_head, updated_oids_tail);
+        MM::recycle(updated_oids_head, updated_oids_tail, nupdated_oids);
     }
 
     return rc_t{RC_TRUE};
@@ -1139,27 +1332,32 @@ transaction::try_insert_new_tuple(
     }
 #endif
 
-    // insert to log
+    // insert to log, unless the load's checkpoint will carry it
     ASSERT(log);
+    if (sysconf::bulk_loading()) {
+        add_to_write_set(new_head, btr->get_oid_array(), oid);
+        return true;
+    }
     ASSERT(tuple->size == value->size());
     auto record_size = align_up((size_t)tuple->size) + sizeof(varstr);
     auto size_code = encode_size_aligned(record_size);
     ASSERT(not ((uint64_t)value & ((uint64_t)0xf)));
     ASSERT(tuple->size);
-    // log the whole varstr so that recovery can figure out the real size
-    // of the tuple, instead of using the decoded (larger-than-real) size.
-    log->log_insert(fid, oid, fat_ptr::make((void *)value, size_code),
-                    DEFAULT_ALIGNMENT_BITS, &tuple->get_object()->_pdest);
 
     // Note: here we log the whole key varstr so that recovery
     // can figure out the real key length with key->size(), otherwise
     // it'll have to use the decoded (inaccurate) size (and so will
     // build a different index...).
-    record_size = align_up(sizeof(varstr) + key->size());
+    auto key_record_size = align_up(sizeof(varstr) + key->size());
     ASSERT((char *)key->data() == (char *)key + sizeof(varstr));
-    size_code = encode_size_aligned(record_size);
-    log->log_insert_index(fid, oid, fat_ptr::make((void *)key, size_code),
-                          DEFAULT_ALIGNMENT_BITS, NULL);
+    auto key_size_code = encode_size_aligned(key_record_size);
+
+    // log the whole varstr so that recovery can figure out the real size
+    // of the tuple, instead of using the decoded (larger-than-real) size;
+    // the key rides in the same record.
+    log->log_insert_with_key(fid, oid, fat_ptr::make((void *)value, size_code),
+                             fat_ptr::make((void *)key, key_size_code),
+                             DEFAULT_ALIGNMENT_BITS, &tuple->get_object()->_pdest);
 
     // update write_set
     ASSERT(tuple->pvalue->size() == tuple->size);
@@ -1179,7 +1377,7 @@ transaction::do_tuple_read(dbtuple *tuple, value_reader &value_reader)
 #if defined(SSI) || defined(SSN)
     if (not read_my_own) {
         rc_t rc = {RC_INVALID};
-        if (sysconf::enable_safesnap and (flags & TXN_FLAG_READ_ONLY))
+        if (on_snapshot())
             rc = {RC_TRUE};
         else {
 #ifdef SSN
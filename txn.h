@@ -44,6 +44,8 @@ class transaction {
   // XXX: weaker than necessary
   friend class base_txn_btree;
   friend class sm_oid_mgr;
+  friend class backup_scanner;
+  friend class sm_chkpt_mgr;
 
 public:
   typedef dbtuple::size_type size_type;
@@ -66,6 +68,26 @@ public:
   };
   typedef std::vector<write_record_t> write_set_t;
 
+  // An own version a later update replaced while a savepoint taken
+  // after it was set, kept so rollback_to() can put it back
+  struct undo_record_t {
+    undo_record_t(fat_ptr obj, varstr *pvalue, oid_array *a, OID o, uint32_t w) :
+        old_object(obj), pvalue(pvalue), oa(a), oid(o), write_index(w) {}
+    fat_ptr old_object;
+    varstr *pvalue;         // what mark_defunct() overwrote
+    oid_array *oa;
+    OID oid;
+    uint32_t write_index;   // old_object's place in the write set
+  };
+  typedef std::vector<undo_record_t> undo_set_t;
+
+  struct savepoint_t {
+    uint32_t nwrites;
+    uint32_t nundo;
+    sm_tx_log::savepoint log;
+  };
+  typedef std::vector<savepoint_t> savepoint_set_t;
+
   enum {
     // use the low-level scan protocol for checking scan consistency,
     // instead of keeping track of absent ranges
@@ -78,12 +100,26 @@ public:
 
     TXN_FLAG_READ_MOSTLY = 0x3,
 
+    // begins at a caller-chosen LSN, see transaction(flags, sa, as_of);
+    // read-only, and like a safesnap reader it has no log and no SSN/SSI
+    // bookkeeping
+    TXN_FLAG_AS_OF = 0x4,
+
     // XXX: more flags in the future, things like consistency levels
   };
 
   inline bool is_read_mostly() { return flags & TXN_FLAG_READ_MOSTLY; }
   inline bool is_read_only() { return flags & TXN_FLAG_READ_ONLY; }
 
+  // reads a fixed snapshot: a safesnap (SSN/SSI only) or an AS OF LSN
+  inline bool on_snapshot() const {
+#if defined(SSN) || defined(SSI)
+    if (sysconf::enable_safesnap and (flags & TXN_FLAG_READ_ONLY))
+      return true;
+#endif
+    return flags & TXN_FLAG_AS_OF;
+  }
+
   // KeyWriter is expected to implement:
   // [1-arg constructor]
   //   KeyWriter(const Key *)
@@ -166,10 +202,29 @@ protected:
 
 public:
 
-  transaction(uint64_t flags, str_arena &sa);
+  /* A non-zero [as_of] makes a read-only TXN_FLAG_AS_OF transaction that
+     sees the database as one beginning at that LSN offset did, e.g., one
+     taken from begin_lsn_offset() earlier. The GC daemon keeps snapshots
+     back to --snapshot-retention-mb of log readable (MM::snapshot_pin);
+     check snapshot_available() before using the transaction.
+   */
+  transaction(uint64_t flags, str_arena &sa, uint64_t as_of = 0);
   ~transaction();
 
+  /* False for an AS OF transaction whose snapshot the GC daemon already
+     trimmed, or which is not there yet (past the current LSN, or in an
+     RC build, where reads ignore the begin LSN). It is aborted already
+     and only has to be destroyed. Only meaningful before first use.
+   */
+  inline bool snapshot_available() const {
+    return not (flags & TXN_FLAG_AS_OF) or state() != TXN_ABRTD;
+  }
+
+  // begin timestamp for a new transaction
+  static uint64_t begin_lsn_offset();
+
   rc_t commit();
+  rc_t bulk_commit();
 #ifdef SSN
   rc_t parallel_ssn_commit();
   rc_t ssn_read(dbtuple *tuple);
@@ -186,9 +241,23 @@ public:
 
   void abort_impl();
 
+  /* Savepoints: set_savepoint() returns a handle to how far the
+     transaction got; rollback_to() unlinks the versions it wrote since
+     and drops their log records, and the transaction goes on from there
+     (e.g., to retry a failed step). The savepoint stays set, later ones
+     are gone. Reads since stay in the read set: the caller saw them.
+     Returns false, changing nothing, if the log records can't be taken
+     back (see sm_tx_log::rollback_to) or, under SSN, if the reads so far
+     already rule out a commit; the transaction has to abort.
+   */
+  size_t set_savepoint();
+  bool rollback_to(size_t savepoint);
+
   void dump_debug_info() const;
 
 protected:
+  void begin_as_of(uint64_t as_of);
+
   bool
   try_insert_new_tuple(
       concurrent_btree *btr,
@@ -215,6 +284,7 @@ protected:
     new (r) recycle_oid(w.oa, w.oid);
     fat_ptr myptr = fat_ptr::make(objr, size_code);
     ASSERT(objr->_next == NULL_PTR);
+    nupdated_oids++;
     if (updated_oids_head == NULL_PTR) {
         updated_oids_head = updated_oids_tail = myptr;
     } else {
@@ -226,6 +296,21 @@ protected:
     }
   }
 
+  // Keep an own version an update of the same record is replacing if
+  // a savepoint set after it may need it back; false if it's garbage
+  inline bool save_overwritten(fat_ptr obj, oid_array *oa, OID oid) {
+    if (savepoints->empty())
+      return false;
+    uint32_t nwrites = savepoints->back().nwrites;
+    for (uint32_t i = 0; i < nwrites; ++i) {
+      if ((*write_set)[i].new_object == obj) {
+        undo_set->emplace_back(obj, ((object *)obj.offset())->tuple()->pvalue, oa, oid, i);
+        return true;
+      }
+    }
+    return false;
+  }
+
 public:
   // expected public overrides
 
@@ -261,7 +346,10 @@ protected:
 #if defined(SSN) || defined(SSI)
   read_set_t* read_set;
 #endif
+  undo_set_t* undo_set;
+  savepoint_set_t* savepoints;
   fat_ptr updated_oids_head;
   fat_ptr updated_oids_tail;
+  uint32_t nupdated_oids;
 };
 #endif /* _NDB_TXN_H_ */